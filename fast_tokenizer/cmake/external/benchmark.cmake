@@ -0,0 +1,74 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+INCLUDE(GNUInstallDirs)
+INCLUDE(ExternalProject)
+
+SET(BENCHMARK_PREFIX_DIR    ${THIRD_PARTY_PATH}/benchmark)
+SET(BENCHMARK_INSTALL_DIR   ${THIRD_PARTY_PATH}/install/benchmark)
+SET(BENCHMARK_INCLUDE_DIR   "${BENCHMARK_INSTALL_DIR}/include" CACHE PATH "benchmark include directory." FORCE)
+set(BENCHMARK_REPOSITORY    ${GIT_URL}/google/benchmark.git)
+set(BENCHMARK_TAG           v1.7.1)
+
+INCLUDE_DIRECTORIES(${BENCHMARK_INCLUDE_DIR})
+
+IF(WIN32)
+    set(BENCHMARK_LIBRARIES
+        "${BENCHMARK_INSTALL_DIR}/${CMAKE_INSTALL_LIBDIR}/benchmark.lib" CACHE FILEPATH "benchmark libraries." FORCE)
+    set(BENCHMARK_MAIN_LIBRARIES
+        "${BENCHMARK_INSTALL_DIR}/${CMAKE_INSTALL_LIBDIR}/benchmark_main.lib" CACHE FILEPATH "benchmark main libraries." FORCE)
+ELSE(WIN32)
+    set(BENCHMARK_LIBRARIES
+        "${BENCHMARK_INSTALL_DIR}/${CMAKE_INSTALL_LIBDIR}/libbenchmark.a" CACHE FILEPATH "benchmark libraries." FORCE)
+    set(BENCHMARK_MAIN_LIBRARIES
+        "${BENCHMARK_INSTALL_DIR}/${CMAKE_INSTALL_LIBDIR}/libbenchmark_main.a" CACHE FILEPATH "benchmark main libraries." FORCE)
+ENDIF(WIN32)
+
+ExternalProject_Add(
+    extern_benchmark
+    ${EXTERNAL_PROJECT_LOG_ARGS}
+    ${SHALLOW_CLONE}
+    GIT_REPOSITORY  ${BENCHMARK_REPOSITORY}
+    GIT_TAG         ${BENCHMARK_TAG}
+    PREFIX          ${BENCHMARK_PREFIX_DIR}
+    UPDATE_COMMAND  ""
+    CMAKE_ARGS      -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER}
+                    -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER}
+                    -DCMAKE_CXX_FLAGS=${CMAKE_CXX_FLAGS}
+                    -DCMAKE_CXX_FLAGS_RELEASE=${CMAKE_CXX_FLAGS_RELEASE}
+                    -DCMAKE_CXX_FLAGS_DEBUG=${CMAKE_CXX_FLAGS_DEBUG}
+                    -DCMAKE_C_FLAGS=${CMAKE_C_FLAGS}
+                    -DCMAKE_C_FLAGS_DEBUG=${CMAKE_C_FLAGS_DEBUG}
+                    -DCMAKE_C_FLAGS_RELEASE=${CMAKE_C_FLAGS_RELEASE}
+                    -DCMAKE_INSTALL_PREFIX=${BENCHMARK_INSTALL_DIR}
+                    -DCMAKE_POSITION_INDEPENDENT_CODE=ON
+                    -DBENCHMARK_ENABLE_TESTING=OFF
+                    -DBENCHMARK_ENABLE_GTEST_TESTS=OFF
+                    -DBENCHMARK_ENABLE_INSTALL=ON
+                    -DCMAKE_BUILD_TYPE=Release
+                    ${EXTERNAL_OPTIONAL_ARGS}
+    CMAKE_CACHE_ARGS -DCMAKE_INSTALL_PREFIX:PATH=${BENCHMARK_INSTALL_DIR}
+                     -DCMAKE_POSITION_INDEPENDENT_CODE:BOOL=ON
+                     -DCMAKE_BUILD_TYPE:STRING=Release
+    BUILD_BYPRODUCTS ${BENCHMARK_LIBRARIES}
+    BUILD_BYPRODUCTS ${BENCHMARK_MAIN_LIBRARIES}
+)
+
+ADD_LIBRARY(benchmark STATIC IMPORTED GLOBAL)
+SET_PROPERTY(TARGET benchmark PROPERTY IMPORTED_LOCATION ${BENCHMARK_LIBRARIES})
+ADD_DEPENDENCIES(benchmark extern_benchmark)
+
+ADD_LIBRARY(benchmark_main STATIC IMPORTED GLOBAL)
+SET_PROPERTY(TARGET benchmark_main PROPERTY IMPORTED_LOCATION ${BENCHMARK_MAIN_LIBRARIES})
+ADD_DEPENDENCIES(benchmark_main extern_benchmark)
@@ -126,6 +126,21 @@ function(cc_test TARGET_NAME)
   endif()
 endfunction(cc_test)
 
+function(cc_benchmark TARGET_NAME)
+  if(WITH_BENCHMARK)
+    set(oneValueArgs "")
+    set(multiValueArgs SRCS DEPS)
+    cmake_parse_arguments(cc_benchmark "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+    add_executable(${TARGET_NAME} ${cc_benchmark_SRCS})
+    get_property(os_dependency_modules GLOBAL PROPERTY OS_DEPENDENCY_MODULES)
+    target_link_libraries(${TARGET_NAME} ${cc_benchmark_DEPS} ${os_dependency_modules} benchmark_main benchmark glog)
+    if(NOT WIN32)
+      target_link_libraries(${TARGET_NAME} pthread)
+    endif()
+    add_dependencies(${TARGET_NAME} ${cc_benchmark_DEPS} benchmark)
+  endif()
+endfunction(cc_benchmark)
+
 # create a dummy source file, then create a static library.
 # LIB_NAME should be the static lib name.
 # FILE_PATH should be the dummy source file path.
@@ -21,6 +21,9 @@ include(external/icu)
 if(WITH_TESTING)
     include(external/gtest)
 endif()
+if(WITH_BENCHMARK)
+    include(external/benchmark)
+endif()
 include(external/gflags)
 include(external/glog)
 include(external/re2)
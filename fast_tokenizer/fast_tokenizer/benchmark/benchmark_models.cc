@@ -0,0 +1,169 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/models/models.h"
+#include "fast_tokenizer/utils/flat_vocab.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+// The number of words tokenized in one iteration
+constexpr size_t WORDS_NUM = 4096;
+
+template <typename ModelType>
+static void TokenizeWords(::benchmark::State& state, ModelType* model) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto words = GenerateWords(text_type, WORDS_NUM);
+  for (auto _ : state) {
+    for (auto& word : words) {
+      auto tokens = model->Tokenize(word);
+      ::benchmark::DoNotOptimize(tokens.data());
+    }
+  }
+  SetCounters(state, text_type, words.size(), GetTotalBytes(words));
+}
+
+static void BM_WordPiece(::benchmark::State& state) {
+  models::WordPiece model(GetWordPieceVocab());
+  TokenizeWords(state, &model);
+}
+
+static void BM_FastWordPiece(::benchmark::State& state) {
+  models::FastWordPiece model(GetWordPieceVocab());
+  TokenizeWords(state, &model);
+}
+
+// FastWordPiece splits the whole text into words by itself.
+static void BM_FastWordPieceWithPreTokenization(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  models::FastWordPiece model(GetWordPieceVocab(), "[UNK]", 100, "##", true);
+  for (auto _ : state) {
+    for (auto& text : texts) {
+      auto tokens = model.Tokenize(text);
+      ::benchmark::DoNotOptimize(tokens.data());
+    }
+  }
+  SetCounters(state, text_type, texts.size(), GetTotalBytes(texts));
+}
+
+static void BM_BPE(::benchmark::State& state) {
+  core::Vocab vocab;
+  core::Merges merges;
+  GetBPEVocabAndMerges(&vocab, &merges);
+  models::BPE model(vocab, merges, 0, {}, {"[UNK]"});
+  TokenizeWords(state, &model);
+}
+
+static void BM_BPEWithCache(::benchmark::State& state) {
+  core::Vocab vocab;
+  core::Merges merges;
+  GetBPEVocabAndMerges(&vocab, &merges);
+  models::BPE model(vocab, merges, utils::DEFAULT_CACHE_CAPACITY, {}, {"[UNK]"});
+  TokenizeWords(state, &model);
+}
+
+static void BM_Unigram(::benchmark::State& state) {
+  models::Unigram model(GetUnigramVocab(), {0});
+  TokenizeWords(state, &model);
+}
+
+// The size of the vocab used by the lookup benchmarks, close to the vocab of
+// bert-base.
+constexpr size_t LOOKUP_VOCAB_SIZE = 30000;
+
+static core::Vocab GetLookupVocab() {
+  auto vocab = GetWordPieceVocab();
+  for (size_t i = vocab.size(); i < LOOKUP_VOCAB_SIZE; ++i) {
+    vocab["##subword" + std::to_string(i)] = i;
+  }
+  return vocab;
+}
+
+// The candidates that WordPiece looks up for every word: all the prefixes,
+// most of which are missing in the vocab.
+static std::vector<std::string> GetLookupCandidates(TextType text_type) {
+  std::vector<std::string> candidates;
+  for (auto& word : GenerateWords(text_type, WORDS_NUM)) {
+    for (size_t len = word.length(); len > 0; --len) {
+      candidates.push_back(word.substr(0, len));
+    }
+  }
+  return candidates;
+}
+
+// An estimation of the bytes allocated by a std::unordered_map, including the
+// nodes with the cached hash, the buckets and the long strings.
+static size_t GetMemoryUsage(const core::Vocab& vocab) {
+  size_t bytes = vocab.bucket_count() * sizeof(void*);
+  for (auto& item : vocab) {
+    bytes += sizeof(void*) + sizeof(item) + sizeof(size_t);
+    if (item.first.capacity() > 15) {
+      bytes += item.first.capacity() + 1;
+    }
+  }
+  return bytes;
+}
+
+static void BM_VocabLookupUnorderedMap(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto vocab = GetLookupVocab();
+  auto candidates = GetLookupCandidates(text_type);
+  for (auto _ : state) {
+    for (auto& candidate : candidates) {
+      auto it = vocab.find(candidate);
+      ::benchmark::DoNotOptimize(it);
+    }
+  }
+  SetCounters(state, text_type, candidates.size(), 0);
+  state.counters["memory_bytes"] = GetMemoryUsage(vocab);
+}
+
+static void BM_VocabLookupFlatVocab(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  utils::FlatVocab vocab(GetLookupVocab());
+  auto candidates = GetLookupCandidates(text_type);
+  for (auto _ : state) {
+    for (auto& candidate : candidates) {
+      uint32_t id;
+      bool found = vocab.Find(candidate.data(), candidate.length(), &id);
+      ::benchmark::DoNotOptimize(found);
+    }
+  }
+  SetCounters(state, text_type, candidates.size(), 0);
+  state.counters["memory_bytes"] = vocab.GetMemoryUsage();
+}
+
+BENCHMARK(BM_WordPiece)->DenseRange(EN_TEXT, MIXED_TEXT)->ArgName("text");
+BENCHMARK(BM_FastWordPiece)->DenseRange(EN_TEXT, MIXED_TEXT)->ArgName("text");
+BENCHMARK(BM_FastWordPieceWithPreTokenization)->Apply(TextArgs);
+BENCHMARK(BM_BPE)->DenseRange(EN_TEXT, MIXED_TEXT)->ArgName("text");
+BENCHMARK(BM_BPEWithCache)->DenseRange(EN_TEXT, MIXED_TEXT)->ArgName("text");
+BENCHMARK(BM_Unigram)->DenseRange(EN_TEXT, MIXED_TEXT)->ArgName("text");
+BENCHMARK(BM_VocabLookupUnorderedMap)
+    ->DenseRange(EN_TEXT, MIXED_TEXT)
+    ->ArgName("text");
+BENCHMARK(BM_VocabLookupFlatVocab)
+    ->DenseRange(EN_TEXT, MIXED_TEXT)
+    ->ArgName("text");
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,80 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/normalizers/normalizers.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+template <typename NormalizerType>
+static void BM_Normalizer(::benchmark::State& state,
+                          const NormalizerType& normalizer) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  for (auto _ : state) {
+    for (auto& text : texts) {
+      normalizers::NormalizedString normalized(text);
+      normalizer(&normalized);
+      ::benchmark::DoNotOptimize(normalized.GetStr().data());
+    }
+  }
+  SetCounters(state, text_type, texts.size(), GetTotalBytes(texts));
+}
+
+static void BM_SequenceNormalizer(::benchmark::State& state) {
+  normalizers::NFDNormalizer nfd;
+  normalizers::StripAccentsNormalizer strip_accents;
+  normalizers::LowercaseNormalizer lowercase;
+  normalizers::SequenceNormalizer normalizer(
+      std::vector<normalizers::Normalizer*>{&nfd, &strip_accents, &lowercase});
+  BM_Normalizer(state, normalizer);
+}
+
+BENCHMARK_CAPTURE(BM_Normalizer, bert, normalizers::BertNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, nfc, normalizers::NFCNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, nfd, normalizers::NFDNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, nfkc, normalizers::NFKCNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, nfkd, normalizers::NFKDNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, nmt, normalizers::NmtNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer,
+                  lowercase,
+                  normalizers::LowercaseNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer, strip, normalizers::StripNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer,
+                  strip_accents,
+                  normalizers::StripAccentsNormalizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_Normalizer,
+                  replace,
+                  normalizers::ReplaceNormalizer(" ", "\xe2\x96\x81"))
+    ->Apply(TextArgs);
+BENCHMARK(BM_SequenceNormalizer)->Apply(TextArgs);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,115 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/postprocessors/postprocessors.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+static std::vector<core::Encoding> GenerateEncodings(TextType text_type,
+                                                     size_t len,
+                                                     uint32_t type_id,
+                                                     uint32_t seed) {
+  auto words = GenerateWords(text_type, BATCH_SIZE * len, seed);
+  std::vector<core::Encoding> encodings;
+  encodings.reserve(BATCH_SIZE);
+  for (size_t i = 0; i < BATCH_SIZE; ++i) {
+    std::vector<core::Token> tokens;
+    tokens.reserve(len);
+    uint32_t offset = 0;
+    for (size_t j = 0; j < len; ++j) {
+      const auto& word = words[i * len + j];
+      uint32_t end = offset + word.length();
+      tokens.emplace_back(i * len + j, word, core::Offset(offset, end));
+      offset = end + 1;
+    }
+    encodings.emplace_back(tokens, type_id);
+  }
+  return encodings;
+}
+
+// The args are {text type, text len, is pair}
+template <typename PostProcessorType>
+static void BM_PostProcessor(::benchmark::State& state,
+                             const PostProcessorType& postprocessor) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  size_t len = state.range(1);
+  bool is_pair = state.range(2);
+  auto encodings = GenerateEncodings(text_type, len, 0, 0);
+  std::vector<core::Encoding> pair_encodings;
+  if (is_pair) {
+    pair_encodings = GenerateEncodings(text_type, len, 1, 1);
+  }
+  std::vector<core::Encoding> inputs, pair_inputs;
+  core::Encoding result;
+  for (auto _ : state) {
+    // The post processors may modify the inputs
+    state.PauseTiming();
+    inputs = encodings;
+    pair_inputs = pair_encodings;
+    state.ResumeTiming();
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      core::Encoding* pair_input = is_pair ? &pair_inputs[i] : nullptr;
+      postprocessor(&inputs[i], pair_input, true, &result);
+      ::benchmark::DoNotOptimize(result.GetIds().data());
+    }
+  }
+  SetCounters(state, text_type, encodings.size(), 0);
+}
+
+static void PostProcessorArgs(::benchmark::internal::Benchmark* b) {
+  b->ArgNames({"text", "len", "pair"});
+  for (auto text_type : {EN_TEXT, ZH_TEXT, MIXED_TEXT}) {
+    for (auto len : {SHORT_TEXT_LEN, MEDIUM_TEXT_LEN, LONG_TEXT_LEN}) {
+      for (int64_t is_pair : {0, 1}) {
+        b->Args({text_type, len, is_pair});
+      }
+    }
+  }
+}
+
+static void BM_TemplatePostProcessor(::benchmark::State& state) {
+  postprocessors::TemplatePostProcessor postprocessor;
+  postprocessor.UpdateSinglePieces("[CLS]:0 $A:0 [SEP]:0");
+  postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  postprocessor.SetTokensMap({postprocessors::SpecialToken("[CLS]", 2),
+                              postprocessors::SpecialToken("[SEP]", 3)});
+  BM_PostProcessor(state, postprocessor);
+}
+
+BENCHMARK_CAPTURE(BM_PostProcessor,
+                  bert,
+                  postprocessors::BertPostProcessor({"[SEP]", 3},
+                                                    {"[CLS]", 2}))
+    ->Apply(PostProcessorArgs);
+BENCHMARK_CAPTURE(BM_PostProcessor,
+                  roberta,
+                  postprocessors::RobertaPostProcessor())
+    ->Apply(PostProcessorArgs);
+BENCHMARK_CAPTURE(BM_PostProcessor,
+                  byte_level,
+                  postprocessors::ByteLevelPostProcessor())
+    ->Apply(PostProcessorArgs);
+BENCHMARK(BM_TemplatePostProcessor)->Apply(PostProcessorArgs);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
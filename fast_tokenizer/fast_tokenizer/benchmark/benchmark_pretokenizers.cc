@@ -0,0 +1,73 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/pretokenizers/pretokenizers.h"
+#include "re2/re2.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+template <typename PreTokenizerType>
+static void BM_PreTokenizer(::benchmark::State& state,
+                            const PreTokenizerType& pretokenizer) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  for (auto _ : state) {
+    for (auto& text : texts) {
+      pretokenizers::PreTokenizedString pretokenized(text);
+      pretokenizer(&pretokenized);
+      ::benchmark::DoNotOptimize(pretokenized.GetSplitsSize());
+    }
+  }
+  SetCounters(state, text_type, texts.size(), GetTotalBytes(texts));
+}
+
+static void BM_SequencePreTokenizer(::benchmark::State& state) {
+  pretokenizers::WhitespacePreTokenizer whitespace;
+  pretokenizers::BertPreTokenizer bert;
+  pretokenizers::SequencePreTokenizer pretokenizer(
+      std::vector<pretokenizers::PreTokenizer*>{&whitespace, &bert});
+  BM_PreTokenizer(state, pretokenizer);
+}
+
+BENCHMARK_CAPTURE(BM_PreTokenizer, bert, pretokenizers::BertPreTokenizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_PreTokenizer,
+                  whitespace,
+                  pretokenizers::WhitespacePreTokenizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_PreTokenizer,
+                  metaspace,
+                  pretokenizers::MetaSpacePreTokenizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_PreTokenizer,
+                  byte_level,
+                  pretokenizers::ByteLevelPreTokenizer())
+    ->Apply(TextArgs);
+BENCHMARK_CAPTURE(BM_PreTokenizer,
+                  split,
+                  pretokenizers::SplitPreTokenizer(
+                      "\\s+", core::SplitMode::REMOVED, false))
+    ->Apply(TextArgs);
+BENCHMARK(BM_SequencePreTokenizer)->Apply(TextArgs);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
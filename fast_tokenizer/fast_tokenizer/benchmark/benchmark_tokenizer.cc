@@ -0,0 +1,146 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/core/added_vocabulary.h"
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/tokenizer.h"
+#include "fast_tokenizer/decoders/decoders.h"
+#include "fast_tokenizer/models/models.h"
+#include "fast_tokenizer/normalizers/normalizers.h"
+#include "fast_tokenizer/postprocessors/postprocessors.h"
+#include "fast_tokenizer/pretokenizers/pretokenizers.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+// Build a bert style tokenizer, which is padded to the longest encoding of
+// the batch.
+template <typename ModelType>
+static core::Tokenizer GetBertTokenizer() {
+  ModelType model(GetWordPieceVocab());
+  core::Tokenizer tokenizer(model);
+  tokenizer.SetNormalizer(normalizers::BertNormalizer());
+  tokenizer.SetPreTokenizer(pretokenizers::BertPreTokenizer());
+  tokenizer.SetPostProcessor(
+      postprocessors::BertPostProcessor({"[SEP]", 3}, {"[CLS]", 2}));
+  tokenizer.SetDecoder(decoders::WordPiece());
+  tokenizer.SetTruncMethod(core::TruncMethod());
+  tokenizer.SetPadMethod(core::PadMethod());
+  tokenizer.AddSpecialTokens({{"[PAD]", true},
+                              {"[UNK]", true},
+                              {"[CLS]", true},
+                              {"[SEP]", true},
+                              {"[MASK]", true}});
+  return tokenizer;
+}
+
+// Set the thread num of fast_tokenizer during the benchmark.
+class ThreadNumGuard {
+public:
+  explicit ThreadNumGuard(int thread_num) : origin_(core::GetThreadNum()) {
+    core::SetThreadNum(thread_num);
+  }
+  ~ThreadNumGuard() { core::SetThreadNum(origin_); }
+
+private:
+  int origin_;
+};
+
+// The args are {text type, text len, thread num}
+template <typename ModelType>
+static void BM_EncodeBatchStrings(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  auto tokenizer = GetBertTokenizer<ModelType>();
+  ThreadNumGuard guard(state.range(2));
+  std::vector<core::Encoding> encodings;
+  for (auto _ : state) {
+    tokenizer.EncodeBatchStrings(texts, &encodings);
+    ::benchmark::DoNotOptimize(encodings.data());
+  }
+  SetCounters(state, text_type, texts.size(), GetTotalBytes(texts));
+}
+
+// Same as BM_EncodeBatchStrings, but only the model inputs are generated.
+static void BM_EncodeBatchStringsModelInputs(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  auto tokenizer = GetBertTokenizer<models::FastWordPiece>();
+  ThreadNumGuard guard(state.range(2));
+  std::vector<core::Encoding> encodings;
+  for (auto _ : state) {
+    tokenizer.EncodeBatchStrings(
+        texts, &encodings, true, core::MODEL_INPUT_FIELDS);
+    ::benchmark::DoNotOptimize(encodings.data());
+  }
+  SetCounters(state, text_type, texts.size(), GetTotalBytes(texts));
+}
+
+template <typename ModelType>
+static void BM_EncodeBatchPairStrings(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  // Each text of the pair has half of the length.
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1) / 2, 0);
+  auto text_pairs = GenerateTexts(text_type, BATCH_SIZE, state.range(1) / 2, 1);
+  auto tokenizer = GetBertTokenizer<ModelType>();
+  ThreadNumGuard guard(state.range(2));
+  std::vector<core::Encoding> encodings;
+  for (auto _ : state) {
+    tokenizer.EncodeBatchStrings(texts, text_pairs, &encodings);
+    ::benchmark::DoNotOptimize(encodings.data());
+  }
+  SetCounters(state,
+              text_type,
+              texts.size(),
+              GetTotalBytes(texts) + GetTotalBytes(text_pairs));
+}
+
+static void BM_DecodeBatch(::benchmark::State& state) {
+  auto text_type = static_cast<TextType>(state.range(0));
+  auto texts = GenerateTexts(text_type, BATCH_SIZE, state.range(1));
+  auto tokenizer = GetBertTokenizer<models::FastWordPiece>();
+  std::vector<core::Encoding> encodings;
+  tokenizer.EncodeBatchStrings(texts, &encodings);
+  std::vector<std::vector<uint32_t>> batch_ids;
+  for (auto& encoding : encodings) {
+    batch_ids.push_back(encoding.GetIds());
+  }
+  ThreadNumGuard guard(state.range(2));
+  std::vector<std::string> results;
+  for (auto _ : state) {
+    tokenizer.DecodeBatch(batch_ids, &results);
+    ::benchmark::DoNotOptimize(results.data());
+  }
+  SetCounters(state, text_type, batch_ids.size(), GetTotalBytes(texts));
+}
+
+BENCHMARK_TEMPLATE(BM_EncodeBatchStrings, models::WordPiece)
+    ->Apply(TextThreadArgs);
+BENCHMARK_TEMPLATE(BM_EncodeBatchStrings, models::FastWordPiece)
+    ->Apply(TextThreadArgs);
+BENCHMARK(BM_EncodeBatchStringsModelInputs)->Apply(TextThreadArgs);
+BENCHMARK_TEMPLATE(BM_EncodeBatchPairStrings, models::FastWordPiece)
+    ->Apply(TextThreadArgs);
+BENCHMARK(BM_DecodeBatch)->Apply(TextThreadArgs);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
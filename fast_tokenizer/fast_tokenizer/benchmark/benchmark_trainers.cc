@@ -0,0 +1,137 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+#include "fast_tokenizer/normalizers/bert.h"
+#include "fast_tokenizer/pretokenizers/bert.h"
+#include "fast_tokenizer/trainers/trainers.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+// The size of the corpus of BM_WordCounter is the first argument in MB, it can
+// be raised to several GB to measure a real pretraining corpus.
+constexpr size_t CORPUS_MB = 1 << 20;
+
+// The words of the generated corpus are too few to train a large vocab, so
+// the trainers are fed by a synthetic lexicon whose words are made of random
+// syllables and whose counts follow the Zipf's law.
+static trainers::WordCounts GenerateWordCounts(size_t num, uint32_t seed = 0) {
+  static const char* syllables[] = {
+      "ka", "to", "ri", "ne", "su", "ma", "lo", "pe", "di", "ga", "qu", "ba",
+      "sh", "ion", "ent", "ing", "er", "th", "an", "re", "co", "un", "st", "al"};
+  const size_t syllable_num = sizeof(syllables) / sizeof(syllables[0]);
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> syllable_dist(0, syllable_num - 1);
+  std::uniform_int_distribution<size_t> len_dist(1, 5);
+  trainers::WordCounts word_counts;
+  for (size_t rank = 1; word_counts.size() < num; ++rank) {
+    std::string word;
+    for (size_t i = len_dist(gen); i > 0; --i) {
+      word += syllables[syllable_dist(gen)];
+    }
+    word_counts[word] += 1000000 / rank + 1;
+  }
+  return word_counts;
+}
+
+static void BM_WordCounter(::benchmark::State& state) {
+  size_t corpus_bytes = state.range(0) * CORPUS_MB;
+  core::SetThreadNum(state.range(1));
+  auto texts = GenerateTexts(MIXED_TEXT, BATCH_SIZE, MEDIUM_TEXT_LEN);
+  size_t batch_bytes = GetTotalBytes(texts);
+  std::vector<std::string> corpus;
+  for (size_t bytes = 0; bytes < corpus_bytes; bytes += batch_bytes) {
+    corpus.insert(corpus.end(), texts.begin(), texts.end());
+  }
+  normalizers::BertNormalizer normalizer;
+  pretokenizers::BertPreTokenizer pretokenizer;
+  for (auto _ : state) {
+    trainers::WordCounter counter(&normalizer, &pretokenizer);
+    counter.Feed(corpus);
+    ::benchmark::DoNotOptimize(counter.GetWordCounts().size());
+  }
+  core::SetThreadNum(1);
+  SetCounters(state, MIXED_TEXT, corpus.size(), GetTotalBytes(corpus));
+}
+
+static void BM_BPETrainer(::benchmark::State& state) {
+  auto word_counts = GenerateWordCounts(100000);
+  core::SetThreadNum(state.range(1));
+  trainers::BPETrainer trainer(state.range(0));
+  for (auto _ : state) {
+    core::Vocab vocab;
+    core::Merges merges;
+    trainer.Train(word_counts, &vocab, &merges);
+    ::benchmark::DoNotOptimize(merges.size());
+  }
+  core::SetThreadNum(1);
+  state.SetItemsProcessed(state.iterations() * word_counts.size());
+}
+
+static void BM_WordPieceTrainer(::benchmark::State& state) {
+  auto word_counts = GenerateWordCounts(100000);
+  core::SetThreadNum(state.range(1));
+  trainers::WordPieceTrainer trainer(state.range(0));
+  for (auto _ : state) {
+    core::Vocab vocab;
+    trainer.Train(word_counts, &vocab);
+    ::benchmark::DoNotOptimize(vocab.size());
+  }
+  core::SetThreadNum(1);
+  state.SetItemsProcessed(state.iterations() * word_counts.size());
+}
+
+static void BM_UnigramTrainer(::benchmark::State& state) {
+  auto word_counts = GenerateWordCounts(100000);
+  core::SetThreadNum(state.range(1));
+  trainers::UnigramTrainer trainer(state.range(0));
+  for (auto _ : state) {
+    core::VocabList vocab;
+    std::vector<size_t> unk_id;
+    trainer.Train(word_counts, &vocab, &unk_id);
+    ::benchmark::DoNotOptimize(vocab.size());
+  }
+  core::SetThreadNum(1);
+  state.SetItemsProcessed(state.iterations() * word_counts.size());
+}
+
+static void TrainerArgs(::benchmark::internal::Benchmark* b) {
+  b->ArgNames({"vocab", "threads"});
+  for (int64_t vocab_size : {1000, 8000}) {
+    for (int64_t thread_num : {1, 4}) {
+      b->Args({vocab_size, thread_num});
+    }
+  }
+  b->UseRealTime()->Unit(::benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_WordCounter)
+    ->ArgNames({"mb", "threads"})
+    ->ArgsProduct({{16, 64}, {1, 2, 4, 8}})
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+BENCHMARK(BM_BPETrainer)->Apply(TrainerArgs);
+BENCHMARK(BM_WordPieceTrainer)->Apply(TrainerArgs);
+BENCHMARK(BM_UnigramTrainer)->Apply(TrainerArgs);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,282 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/benchmark/benchmark_utils.h"
+
+#include <random>
+#include <set>
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+static const std::vector<std::string> kEnglishWords = {
+    "the",       "of",         "and",       "to",         "in",
+    "is",        "was",        "for",       "that",       "with",
+    "as",        "on",         "by",        "he",         "it",
+    "at",        "from",       "his",       "an",         "were",
+    "are",       "which",      "this",      "be",         "or",
+    "has",       "had",        "first",     "one",        "their",
+    "its",       "new",        "after",     "who",        "they",
+    "have",      "her",        "she",       "two",        "been",
+    "other",     "when",       "there",     "all",        "during",
+    "into",      "school",     "time",      "may",        "years",
+    "more",      "most",       "only",      "over",       "city",
+    "some",      "world",      "would",     "where",      "later",
+    "up",        "such",       "used",      "many",       "can",
+    "state",     "about",      "national",  "out",        "known",
+    "university", "united",    "then",      "made",       "season",
+    "tokenizer", "performance", "benchmark", "throughput", "latency",
+    "sentence",  "paragraph",  "language",  "model",      "training",
+    "inference", "vocabulary", "character", "normalize",  "encoding"};
+
+static const std::vector<std::string> kChineseChars = {
+    "的", "一", "是", "不", "了", "人", "我", "在", "有", "他", "这", "中",
+    "大", "来", "上", "国", "个", "到", "说", "们", "为", "子", "和", "你",
+    "地", "出", "道", "也", "时", "年", "得", "就", "那", "要", "下", "以",
+    "生", "会", "自", "着", "去", "之", "过", "家", "学", "对", "可", "她",
+    "里", "后", "小", "么", "心", "多", "天", "而", "能", "好", "都", "然",
+    "没", "日", "于", "起", "还", "发", "成", "事", "只", "作", "当", "想",
+    "看", "文", "无", "开", "手", "十", "用", "主", "行", "方", "又", "如",
+    "前", "所", "本", "见", "经", "头", "面", "公", "同", "三", "已", "老"};
+
+static const std::vector<std::string> kEnglishPunctuations = {",", "."};
+static const std::vector<std::string> kChinesePunctuations = {"，", "。"};
+
+// The words that are only in the vocab as a prefix and a suffix.
+static bool IsSplitWord(size_t word_idx) {
+  return word_idx % 4 == 3 && kEnglishWords[word_idx].length() >= 4;
+}
+
+static std::string Capitalize(const std::string& word) {
+  std::string result = word;
+  if (!result.empty() && result[0] >= 'a' && result[0] <= 'z') {
+    result[0] = result[0] - 'a' + 'A';
+  }
+  return result;
+}
+
+std::vector<std::string> GenerateTexts(TextType text_type,
+                                       size_t num,
+                                       size_t len,
+                                       uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> en_dist(0, kEnglishWords.size() - 1);
+  std::uniform_int_distribution<size_t> zh_dist(0, kChineseChars.size() - 1);
+  std::uniform_int_distribution<int> percent_dist(0, 99);
+  std::vector<std::string> texts(num);
+  for (auto& text : texts) {
+    bool sentence_start = true;
+    bool last_is_en = false;
+    for (size_t i = 0; i < len; ++i) {
+      bool is_en = (text_type == EN_TEXT) ||
+                   (text_type == MIXED_TEXT && percent_dist(gen) < 50);
+      if (is_en) {
+        if (!text.empty()) {
+          text += " ";
+        }
+        const auto& word = kEnglishWords[en_dist(gen)];
+        text += sentence_start ? Capitalize(word) : word;
+      } else {
+        if (last_is_en) {
+          text += " ";
+        }
+        text += kChineseChars[zh_dist(gen)];
+      }
+      last_is_en = is_en;
+      sentence_start = false;
+      // End a clause or a sentence sometimes.
+      int p = percent_dist(gen);
+      if (p < 10) {
+        const auto& puncs = is_en ? kEnglishPunctuations : kChinesePunctuations;
+        text += puncs[p % 2];
+        sentence_start = (p % 2 == 1);
+      }
+    }
+  }
+  return texts;
+}
+
+std::vector<std::string> GenerateWords(TextType text_type,
+                                       size_t num,
+                                       uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> en_dist(0, kEnglishWords.size() - 1);
+  std::uniform_int_distribution<size_t> zh_dist(0, kChineseChars.size() - 1);
+  std::uniform_int_distribution<int> percent_dist(0, 99);
+  std::vector<std::string> words(num);
+  for (auto& word : words) {
+    bool is_en = (text_type == EN_TEXT) ||
+                 (text_type == MIXED_TEXT && percent_dist(gen) < 50);
+    if (is_en) {
+      word = kEnglishWords[en_dist(gen)];
+    } else {
+      word = kChineseChars[zh_dist(gen)];
+    }
+  }
+  return words;
+}
+
+core::Vocab GetWordPieceVocab() {
+  core::Vocab vocab;
+  auto add_token = [&vocab](const std::string& token) {
+    if (vocab.find(token) == vocab.end()) {
+      uint32_t id = vocab.size();
+      vocab[token] = id;
+    }
+  };
+  for (auto& token : {"[PAD]", "[UNK]", "[CLS]", "[SEP]", "[MASK]"}) {
+    add_token(token);
+  }
+  for (auto& punc : kEnglishPunctuations) {
+    add_token(punc);
+  }
+  for (auto& punc : kChinesePunctuations) {
+    add_token(punc);
+  }
+  for (size_t i = 0; i < kEnglishWords.size(); ++i) {
+    const auto& word = kEnglishWords[i];
+    if (IsSplitWord(i)) {
+      size_t half = word.length() / 2;
+      add_token(word.substr(0, half));
+      add_token("##" + word.substr(half));
+    } else {
+      add_token(word);
+    }
+  }
+  for (auto& ch : kChineseChars) {
+    add_token(ch);
+  }
+  return vocab;
+}
+
+void GetBPEVocabAndMerges(core::Vocab* vocab, core::Merges* merges) {
+  vocab->clear();
+  merges->clear();
+  auto add_token = [vocab](const std::string& token) {
+    if (vocab->find(token) == vocab->end()) {
+      uint32_t id = vocab->size();
+      (*vocab)[token] = id;
+    }
+  };
+  add_token("[UNK]");
+  for (char ch = 'a'; ch <= 'z'; ++ch) {
+    add_token(std::string(1, ch));
+  }
+  for (char ch = 'A'; ch <= 'Z'; ++ch) {
+    add_token(std::string(1, ch));
+  }
+  for (auto& punc : kEnglishPunctuations) {
+    add_token(punc);
+  }
+  for (auto& punc : kChinesePunctuations) {
+    add_token(punc);
+  }
+  for (auto& ch : kChineseChars) {
+    add_token(ch);
+  }
+  // Merge the english words from left to right, the split words are only
+  // merged up to their halves.
+  std::set<std::pair<std::string, std::string>> merged;
+  for (size_t i = 0; i < kEnglishWords.size(); ++i) {
+    const auto& word = kEnglishWords[i];
+    size_t end = IsSplitWord(i) ? word.length() / 2 : word.length();
+    for (size_t j = 1; j < end; ++j) {
+      auto merge = std::make_pair(word.substr(0, j), word.substr(j, 1));
+      if (merged.insert(merge).second) {
+        merges->push_back(merge);
+        add_token(word.substr(0, j + 1));
+      }
+    }
+  }
+}
+
+core::VocabList GetUnigramVocab() {
+  core::VocabList vocab;
+  const std::string space = "\xe2\x96\x81";
+  vocab.emplace_back("<unk>", 0.0);
+  vocab.emplace_back(space, -2.0);
+  for (size_t i = 0; i < kEnglishWords.size(); ++i) {
+    const auto& word = kEnglishWords[i];
+    float score = -3.0 - static_cast<float>(i % 7);
+    if (IsSplitWord(i)) {
+      size_t half = word.length() / 2;
+      vocab.emplace_back(space + word.substr(0, half), score);
+      vocab.emplace_back(word.substr(half), score);
+    } else {
+      vocab.emplace_back(space + word, score);
+    }
+  }
+  for (char ch = 'a'; ch <= 'z'; ++ch) {
+    vocab.emplace_back(std::string(1, ch), -12.0);
+  }
+  for (char ch = 'A'; ch <= 'Z'; ++ch) {
+    vocab.emplace_back(std::string(1, ch), -13.0);
+  }
+  for (auto& punc : kEnglishPunctuations) {
+    vocab.emplace_back(punc, -4.0);
+  }
+  for (auto& punc : kChinesePunctuations) {
+    vocab.emplace_back(punc, -4.0);
+  }
+  for (size_t i = 0; i < kChineseChars.size(); ++i) {
+    vocab.emplace_back(kChineseChars[i], -5.0 - static_cast<float>(i % 5));
+  }
+  return vocab;
+}
+
+size_t GetTotalBytes(const std::vector<std::string>& texts) {
+  size_t bytes = 0;
+  for (auto& text : texts) {
+    bytes += text.length();
+  }
+  return bytes;
+}
+
+void SetCounters(::benchmark::State& state,
+                 TextType text_type,
+                 size_t items,
+                 size_t bytes) {
+  static const char* text_type_names[] = {"en", "zh", "mixed"};
+  state.SetLabel(text_type_names[text_type]);
+  state.SetItemsProcessed(state.iterations() * items);
+  if (bytes > 0) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+  }
+}
+
+void TextArgs(::benchmark::internal::Benchmark* b) {
+  b->ArgNames({"text", "len"});
+  for (auto text_type : {EN_TEXT, ZH_TEXT, MIXED_TEXT}) {
+    for (auto len : {SHORT_TEXT_LEN, MEDIUM_TEXT_LEN, LONG_TEXT_LEN}) {
+      b->Args({text_type, len});
+    }
+  }
+}
+
+void TextThreadArgs(::benchmark::internal::Benchmark* b) {
+  b->ArgNames({"text", "len", "threads"});
+  for (auto text_type : {EN_TEXT, ZH_TEXT, MIXED_TEXT}) {
+    for (auto len : {SHORT_TEXT_LEN, MEDIUM_TEXT_LEN, LONG_TEXT_LEN}) {
+      for (int64_t thread_num : {1, 2, 4, 8}) {
+        b->Args({text_type, len, thread_num});
+      }
+    }
+  }
+  b->UseRealTime();
+}
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,75 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fast_tokenizer/core/base.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace benchmarks {
+
+// The corpus and the vocabularies of the benchmarks are generated from a fixed
+// word list, so that the results are reproducible without downloading any
+// model files.
+enum TextType { EN_TEXT, ZH_TEXT, MIXED_TEXT };
+
+// The number of words (or chinese chars) of the short, medium and long texts.
+constexpr int64_t SHORT_TEXT_LEN = 16;
+constexpr int64_t MEDIUM_TEXT_LEN = 128;
+constexpr int64_t LONG_TEXT_LEN = 512;
+
+// The number of texts in a batch of the tokenizer benchmarks.
+constexpr size_t BATCH_SIZE = 256;
+
+// Generate num texts, each of them contains len words. The words are drawn
+// from a fixed seeded distribution, so the texts are the same in every run.
+std::vector<std::string> GenerateTexts(TextType text_type,
+                                       size_t num,
+                                       size_t len,
+                                       uint32_t seed = 0);
+
+// Generate num words without any whitespace or punctuation, which are the
+// inputs of the models.
+std::vector<std::string> GenerateWords(TextType text_type,
+                                       size_t num,
+                                       uint32_t seed = 0);
+
+// Vocabularies covering the generated corpus. Some of the english words are
+// only in the vocab as a prefix and a suffix, so that the models have to
+// split them.
+core::Vocab GetWordPieceVocab();
+void GetBPEVocabAndMerges(core::Vocab* vocab, core::Merges* merges);
+core::VocabList GetUnigramVocab();
+
+size_t GetTotalBytes(const std::vector<std::string>& texts);
+
+// Set the label of the benchmark and the processed items and bytes.
+void SetCounters(::benchmark::State& state,
+                 TextType text_type,
+                 size_t items,
+                 size_t bytes);
+
+// Apply {text type} x {text len} to the benchmark.
+void TextArgs(::benchmark::internal::Benchmark* b);
+// Apply {text type} x {text len} x {thread num} to the benchmark.
+void TextThreadArgs(::benchmark::internal::Benchmark* b);
+
+}  // namespace benchmarks
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,265 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#include "fast_tokenizer/c_api/c_api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/tokenizer.h"
+
+namespace core = paddlenlp::fast_tokenizer::core;
+
+struct ft_tokenizer {
+  // The padding of the tokenizer is disabled, the rows are padded to the
+  // output buffers by ft_encode_batch with pad_method instead.
+  core::Tokenizer tokenizer;
+  core::PadMethod pad_method;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+void SetLastError(const std::string& message) { last_error = message; }
+
+ft_tokenizer* CreateTokenizer(const core::Tokenizer& tokenizer) {
+  auto* result = new ft_tokenizer;
+  result->tokenizer = tokenizer;
+  result->pad_method = tokenizer.GetPadMethod();
+  result->tokenizer.DisablePadMethod();
+  return result;
+}
+
+template <typename T>
+void FillRow(T* row, size_t max_len, size_t len, size_t pad_begin, T value) {
+  std::fill(row, row + pad_begin, value);
+  std::fill(row + pad_begin + len, row + max_len, value);
+}
+
+template <typename T>
+void WriteRow(const core::Encoding& encoding,
+              const core::PadMethod& pad_method,
+              size_t row_idx,
+              ft_encode_output* output) {
+  const size_t max_len = output->max_len;
+  const size_t len = encoding.GetLen();
+  // The tokens start after the padding if pad to the left.
+  const size_t begin = pad_method.direction_ == core::LEFT ? max_len - len : 0;
+  if (output->ids != nullptr) {
+    T* row = static_cast<T*>(output->ids) + row_idx * max_len;
+    const auto& ids = encoding.GetIds();
+    std::copy(ids.begin(), ids.end(), row + begin);
+    FillRow<T>(row, max_len, len, begin, pad_method.pad_id_);
+  }
+  if (output->type_ids != nullptr) {
+    T* row = static_cast<T*>(output->type_ids) + row_idx * max_len;
+    const auto& type_ids = encoding.GetTypeIds();
+    std::copy(type_ids.begin(), type_ids.end(), row + begin);
+    FillRow<T>(row, max_len, len, begin, pad_method.pad_token_type_id_);
+  }
+  if (output->attention_mask != nullptr) {
+    T* row = static_cast<T*>(output->attention_mask) + row_idx * max_len;
+    std::fill(row + begin, row + begin + len, 1);
+    FillRow<T>(row, max_len, len, begin, 0);
+  }
+  if (output->special_tokens_mask != nullptr) {
+    T* row = static_cast<T*>(output->special_tokens_mask) + row_idx * max_len;
+    const auto& special_tokens_mask = encoding.GetSpecialTokensMask();
+    std::copy(
+        special_tokens_mask.begin(), special_tokens_mask.end(), row + begin);
+    FillRow<T>(row, max_len, len, begin, 1);
+  }
+  if (output->offsets != nullptr) {
+    T* row = static_cast<T*>(output->offsets) + row_idx * max_len * 2;
+    const auto& offsets = encoding.GetOffsets();
+    T* curr = row + begin * 2;
+    for (const auto& offset : offsets) {
+      *curr++ = offset.first;
+      *curr++ = offset.second;
+    }
+    FillRow<T>(row, max_len * 2, len * 2, begin * 2, 0);
+  }
+}
+
+uint32_t GetRequiredFields(const ft_encode_output& output) {
+  // The ids are always generated, and the attention mask is written
+  // directly since the encodings aren't padded.
+  uint32_t fields = 0;
+  if (output.type_ids != nullptr) fields |= core::TYPE_IDS_FIELD;
+  if (output.special_tokens_mask != nullptr) {
+    fields |= core::SPECIAL_TOKENS_MASK_FIELD;
+  }
+  if (output.offsets != nullptr) fields |= core::OFFSETS_FIELD;
+  return fields;
+}
+
+}  // namespace
+
+extern "C" {
+
+ft_tokenizer* ft_tokenizer_load(const char* json_path) {
+  if (json_path == nullptr) {
+    SetLastError("The json path is NULL.");
+    return nullptr;
+  }
+  try {
+    return CreateTokenizer(core::Tokenizer::LoadFromFile(json_path));
+  } catch (const std::exception& e) {
+    SetLastError(e.what());
+  }
+  return nullptr;
+}
+
+ft_tokenizer* ft_tokenizer_load_from_str(const char* json_str, size_t len) {
+  if (json_str == nullptr) {
+    SetLastError("The json string is NULL.");
+    return nullptr;
+  }
+  try {
+    return CreateTokenizer(
+        core::Tokenizer::LoadFromStr(std::string(json_str, len)));
+  } catch (const std::exception& e) {
+    SetLastError(e.what());
+  }
+  return nullptr;
+}
+
+void ft_tokenizer_free(ft_tokenizer* tokenizer) { delete tokenizer; }
+
+const char* ft_last_error(void) { return last_error.c_str(); }
+
+void ft_set_thread_num(int thread_num) { core::SetThreadNum(thread_num); }
+
+size_t ft_tokenizer_vocab_size(const ft_tokenizer* tokenizer) {
+  if (tokenizer == nullptr) {
+    return 0;
+  }
+  return tokenizer->tokenizer.GetVocabSize();
+}
+
+int64_t ft_tokenizer_token_to_id(const ft_tokenizer* tokenizer,
+                                 const char* token,
+                                 size_t len) {
+  if (tokenizer == nullptr || token == nullptr) {
+    return -1;
+  }
+  uint32_t id;
+  if (!tokenizer->tokenizer.TokenToId(std::string(token, len), &id)) {
+    return -1;
+  }
+  return id;
+}
+
+ft_status ft_encode_batch(const ft_tokenizer* tokenizer,
+                          const char* const* texts,
+                          const size_t* text_lens,
+                          const char* const* text_pairs,
+                          const size_t* text_pair_lens,
+                          size_t batch_size,
+                          int add_special_tokens,
+                          ft_encode_output* output) {
+  if (tokenizer == nullptr || output == nullptr ||
+      (texts == nullptr && batch_size > 0)) {
+    SetLastError("The tokenizer, texts and output can't be NULL.");
+    return FT_INVALID_ARGUMENT;
+  }
+  if (output->dtype != FT_INT32 && output->dtype != FT_INT64) {
+    SetLastError("The dtype of output should be FT_INT32 or FT_INT64.");
+    return FT_INVALID_ARGUMENT;
+  }
+  const auto& pad_method = tokenizer->pad_method;
+  const uint32_t fields = GetRequiredFields(*output);
+  std::atomic<size_t> seq_len(0);
+  std::atomic<bool> too_small(false);
+  std::mutex error_mutex;
+  std::string error;
+  auto func = [&](size_t start_index, size_t step_index) {
+    size_t end_index = std::min(start_index + step_index, batch_size);
+    // The encodings are reused by the texts of a thread, and only the final
+    // results are copied to the output buffers.
+    core::Encoding encoding, pair_encoding, result;
+    try {
+      for (size_t i = start_index; i < end_index; ++i) {
+        if (texts[i] == nullptr ||
+            (text_pairs != nullptr && text_pairs[i] == nullptr)) {
+          throw std::invalid_argument("The text can't be NULL.");
+        }
+        size_t text_len =
+            text_lens != nullptr ? text_lens[i] : std::strlen(texts[i]);
+        tokenizer->tokenizer.EncodeSingleString(
+            std::string(texts[i], text_len),
+            0,
+            core::OffsetType::CHAR,
+            &encoding,
+            fields);
+        core::Encoding* pair_ptr = nullptr;
+        if (text_pairs != nullptr) {
+          size_t pair_len = text_pair_lens != nullptr
+                                ? text_pair_lens[i]
+                                : std::strlen(text_pairs[i]);
+          tokenizer->tokenizer.EncodeSingleString(
+              std::string(text_pairs[i], pair_len),
+              1,
+              core::OffsetType::CHAR,
+              &pair_encoding,
+              fields);
+          pair_ptr = &pair_encoding;
+        }
+        tokenizer->tokenizer.PostProcess(
+            &encoding, pair_ptr, add_special_tokens != 0, &result);
+        size_t len = result.GetLen();
+        if (output->lengths != nullptr) {
+          output->lengths[i] = static_cast<int32_t>(len);
+        }
+        size_t curr_seq_len = seq_len.load();
+        while (len > curr_seq_len &&
+               !seq_len.compare_exchange_weak(curr_seq_len, len)) {
+        }
+        if (len > output->max_len) {
+          too_small = true;
+          continue;
+        }
+        if (output->dtype == FT_INT32) {
+          WriteRow<int32_t>(result, pad_method, i, output);
+        } else {
+          WriteRow<int64_t>(result, pad_method, i, output);
+        }
+      }
+    } catch (const std::exception& e) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      error = e.what();
+    }
+  };
+  core::RunMultiThread(func, batch_size);
+  output->seq_len = seq_len;
+  if (!error.empty()) {
+    SetLastError(error);
+    return FT_RUNTIME_ERROR;
+  }
+  if (too_small) {
+    SetLastError("The max_len of output is less than the length of encodings.");
+    return FT_BUFFER_TOO_SMALL;
+  }
+  return FT_OK;
+}
+
+}  // extern "C"
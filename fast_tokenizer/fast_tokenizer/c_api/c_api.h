@@ -0,0 +1,110 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// A C interface of the tokenizer for the languages that can't bind to C++,
+// e.g. Go, Rust and JNI. The encoding results are written into the buffers
+// that are allocated by the caller, so that no intermediate object needs to
+// be copied at the language boundary.
+
+#if defined(_WIN32)
+#ifdef FASTTOKENIZER_LIB
+#define FT_C_API __declspec(dllexport)
+#else
+#define FT_C_API __declspec(dllimport)
+#endif  // FASTTOKENIZER_LIB
+#else
+#define FT_C_API __attribute__((visibility("default")))
+#endif  // _WIN32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ft_tokenizer ft_tokenizer;
+
+typedef enum {
+  FT_OK = 0,
+  FT_INVALID_ARGUMENT = 1,
+  // Some encodings are longer than the row length of the output buffers.
+  // The required lengths are stored in ft_encode_output.lengths.
+  FT_BUFFER_TOO_SMALL = 2,
+  FT_RUNTIME_ERROR = 3,
+} ft_status;
+
+typedef enum {
+  FT_INT32 = 0,
+  FT_INT64 = 1,
+} ft_dtype;
+
+// The output buffers of ft_encode_batch. Each buffer stores batch_size rows
+// of max_len elements (offsets store 2 * max_len elements per row, the begin
+// and end of each token), and the rows are padded to max_len with the pad id
+// and pad type id of the tokenizer. All the buffers have the element type
+// dtype, and the buffers that are NULL are skipped.
+typedef struct {
+  ft_dtype dtype;
+  size_t max_len;
+  void* ids;
+  void* type_ids;
+  void* attention_mask;
+  void* special_tokens_mask;
+  void* offsets;
+  // [batch_size] The number of tokens of each row without padding, can be
+  // NULL.
+  int32_t* lengths;
+  // The largest number of tokens of the rows, so that the buffers can be
+  // sliced to the longest row of the batch.
+  size_t seq_len;
+} ft_encode_output;
+
+// Load a tokenizer from the json file saved by Tokenizer::Save. Return NULL
+// on failure, and the reason can be fetched by ft_last_error.
+FT_C_API ft_tokenizer* ft_tokenizer_load(const char* json_path);
+FT_C_API ft_tokenizer* ft_tokenizer_load_from_str(const char* json_str,
+                                                  size_t len);
+FT_C_API void ft_tokenizer_free(ft_tokenizer* tokenizer);
+
+// The message of the last failed call of the current thread.
+FT_C_API const char* ft_last_error(void);
+
+FT_C_API void ft_set_thread_num(int thread_num);
+
+FT_C_API size_t ft_tokenizer_vocab_size(const ft_tokenizer* tokenizer);
+// Return -1 if the token isn't in the vocab.
+FT_C_API int64_t ft_tokenizer_token_to_id(const ft_tokenizer* tokenizer,
+                                          const char* token,
+                                          size_t len);
+
+// Encode a batch of texts, or text pairs if text_pairs isn't NULL. The
+// lengths of the texts are given by text_lens, or by strlen if text_lens is
+// NULL. The truncation of the tokenizer is applied, and the rows are always
+// padded to output->max_len, to the left if the padding direction of the
+// tokenizer is left.
+FT_C_API ft_status ft_encode_batch(const ft_tokenizer* tokenizer,
+                                   const char* const* texts,
+                                   const size_t* text_lens,
+                                   const char* const* text_pairs,
+                                   const size_t* text_pair_lens,
+                                   size_t batch_size,
+                                   int add_special_tokens,
+                                   ft_encode_output* output);
+
+#ifdef __cplusplus
+}
+#endif
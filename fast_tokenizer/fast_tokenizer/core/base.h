@@ -48,6 +48,20 @@ enum FASTTOKENIZER_DECL TruncStrategy {
 };
 enum FASTTOKENIZER_DECL PadStrategy { BATCH_LONGEST, FIXED_SIZE };
 
+// The optional fields of Encoding, which can be combined into a mask to skip
+// generating the fields that are not needed. The ids are always generated.
+enum FASTTOKENIZER_DECL EncodeField : uint32_t {
+  TYPE_IDS_FIELD = 1 << 0,
+  TOKENS_FIELD = 1 << 1,
+  WORDS_IDX_FIELD = 1 << 2,
+  OFFSETS_FIELD = 1 << 3,
+  SPECIAL_TOKENS_MASK_FIELD = 1 << 4,
+  ATTENTION_MASK_FIELD = 1 << 5,
+  ALL_FIELDS = (1 << 6) - 1,
+  // The input ids, token type ids and attention mask of a model.
+  MODEL_INPUT_FIELDS = TYPE_IDS_FIELD | ATTENTION_MASK_FIELD
+};
+
 enum FASTTOKENIZER_DECL SplitMode {
   REMOVED,
   ISOLATED,
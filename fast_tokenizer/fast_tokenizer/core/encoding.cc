@@ -96,7 +96,9 @@ Encoding::Encoding(Encoding&& other)
       special_tokens_mask_(std::move(other.special_tokens_mask_)),
       attention_mask_(std::move(other.attention_mask_)),
       overflowing_(std::move(other.overflowing_)),
-      sequence_ranges_(std::move(other.sequence_ranges_)) {}
+      sequence_ranges_(std::move(other.sequence_ranges_)),
+      fields_(other.fields_),
+      alignment_index_(std::move(other.alignment_index_)) {}
 
 Encoding& Encoding::operator=(Encoding&& other) {
   ids_ = std::move(other.ids_);
@@ -108,11 +110,52 @@ Encoding& Encoding::operator=(Encoding&& other) {
   attention_mask_ = std::move(other.attention_mask_);
   overflowing_ = std::move(other.overflowing_);
   sequence_ranges_ = std::move(other.sequence_ranges_);
+  fields_ = other.fields_;
+  alignment_index_ = std::move(other.alignment_index_);
   return *this;
 }
 
 bool Encoding::IsEmpty() const { return ids_.empty(); }
 
+uint32_t Encoding::GetFields() const { return fields_; }
+
+bool Encoding::HasField(EncodeField field) const {
+  return (fields_ & field) != 0;
+}
+
+void Encoding::SetFields(uint32_t fields) {
+  ResetAlignmentIndex();
+  fields_ = fields & ALL_FIELDS;
+  if (!HasField(TYPE_IDS_FIELD)) {
+    std::vector<uint32_t>().swap(type_ids_);
+  }
+  if (!HasField(TOKENS_FIELD)) {
+    std::vector<std::string>().swap(tokens_);
+  }
+  if (!HasField(WORDS_IDX_FIELD)) {
+    std::vector<uint32_t>().swap(words_idx_);
+  }
+  if (!HasField(OFFSETS_FIELD)) {
+    std::vector<Offset>().swap(offsets_);
+  }
+  if (!HasField(SPECIAL_TOKENS_MASK_FIELD)) {
+    std::vector<uint32_t>().swap(special_tokens_mask_);
+  }
+  if (!HasField(ATTENTION_MASK_FIELD)) {
+    std::vector<uint32_t>().swap(attention_mask_);
+  }
+  for (auto& overflowing : overflowing_) {
+    overflowing.SetFields(fields_);
+  }
+}
+
+void Encoding::CheckField(EncodeField field, const char* method) const {
+  if (!HasField(field)) {
+    throw std::runtime_error(std::string("Encoding::") + method +
+                             " needs a field that is skipped when encoding.");
+  }
+}
+
 int Encoding::GetLen() const { return ids_.size(); }
 
 int Encoding::GetNumSequence() const {
@@ -123,6 +166,7 @@ int Encoding::GetNumSequence() const {
 }
 
 void Encoding::SetSequenceIds(uint32_t seq_ids) {
+  ResetAlignmentIndex();
   sequence_ranges_[seq_ids] = {0, GetLen()};
 }
 
@@ -132,7 +176,10 @@ const std::vector<uint32_t>& Encoding::GetWordsIdx() const {
   return words_idx_;
 }
 
-std::vector<uint32_t>& Encoding::GetMutableWordsIdx() { return words_idx_; }
+std::vector<uint32_t>& Encoding::GetMutableWordsIdx() {
+  ResetAlignmentIndex();
+  return words_idx_;
+}
 
 std::vector<uint32_t> Encoding::GetSequenceIds() const {
   std::vector<uint32_t> sequences(GetLen());
@@ -152,7 +199,10 @@ const std::vector<uint32_t>& Encoding::GetTypeIds() const { return type_ids_; }
 
 const std::vector<Offset>& Encoding::GetOffsets() const { return offsets_; }
 
-std::vector<Offset>& Encoding::GetMutableOffsets() { return offsets_; }
+std::vector<Offset>& Encoding::GetMutableOffsets() {
+  ResetAlignmentIndex();
+  return offsets_;
+}
 
 const std::vector<uint32_t>& Encoding::GetSpecialTokensMask() const {
   return special_tokens_mask_;
@@ -177,57 +227,272 @@ Range Encoding::GetSequenceRange(uint32_t seq_id) const {
 void Encoding::ProcessTokenWithOffsets(
     std::function<void(uint32_t, const std::string&, Offset*)>
         process_token_fn) {
+  CheckField(TOKENS_FIELD, "ProcessTokenWithOffsets");
+  CheckField(OFFSETS_FIELD, "ProcessTokenWithOffsets");
+  ResetAlignmentIndex();
   auto length = GetLen();
   for (int i = 0; i < length; ++i) {
     process_token_fn(i, tokens_[i], &offsets_[i]);
   }
 }
 
-std::vector<uint32_t> Encoding::TokenIdxToSequenceIds(
-    uint32_t token_idx) const {
-  std::vector<uint32_t> seq_ids;
-  if (token_idx < GetLen()) {
-    if (sequence_ranges_.empty()) {
-      seq_ids.push_back(0);
-    } else {
-      for (auto iter = sequence_ranges_.begin(); iter != sequence_ranges_.end();
-           ++iter) {
-        if (token_idx >= iter->second.first &&
-            token_idx < iter->second.second) {
-          seq_ids.push_back(iter->first);
+struct Encoding::AlignmentIndex {
+  // The tokens [start_, end_) of a word in a sequence
+  struct WordSpan {
+    uint32_t word_idx_;
+    uint32_t start_;
+    uint32_t end_;
+  };
+  struct Sequence {
+    bool valid_;
+    Range range_;
+    // Whether both the starts and the ends of the offsets are non-decreasing
+    // in the sequence, so that the offsets can be binary searched.
+    bool sorted_offsets_;
+    // Sorted by word_idx_
+    std::vector<WordSpan> word_spans_;
+    Sequence() : valid_(false), range_(0, 0), sorted_offsets_(false) {}
+  };
+  // Indexed by the sequence id
+  std::vector<Sequence> sequences_;
+
+  const Sequence* GetSequence(uint32_t seq_id) const {
+    if (seq_id >= sequences_.size() || !sequences_[seq_id].valid_) {
+      return nullptr;
+    }
+    return &sequences_[seq_id];
+  }
+};
+
+std::shared_ptr<const Encoding::AlignmentIndex> Encoding::GetAlignmentIndex()
+    const {
+  auto index = std::atomic_load(&alignment_index_);
+  if (index != nullptr) {
+    return index;
+  }
+  // It may be built by several threads at the same time, they build the same
+  // index and one of them is kept.
+  auto new_index = std::make_shared<AlignmentIndex>();
+  uint32_t len = GetLen();
+  if (sequence_ranges_.empty()) {
+    new_index->sequences_.resize(1);
+    new_index->sequences_[0].valid_ = true;
+    new_index->sequences_[0].range_ = {0, len};
+  } else {
+    for (const auto& seq_range : sequence_ranges_) {
+      if (seq_range.first >= new_index->sequences_.size()) {
+        new_index->sequences_.resize(seq_range.first + 1);
+      }
+      auto& seq = new_index->sequences_[seq_range.first];
+      seq.valid_ = true;
+      seq.range_ = {std::min(seq_range.second.first, len),
+                    std::min(seq_range.second.second, len)};
+    }
+  }
+  for (auto& seq : new_index->sequences_) {
+    if (!seq.valid_) {
+      continue;
+    }
+    auto start = seq.range_.first;
+    auto end = seq.range_.second;
+    if (HasField(OFFSETS_FIELD)) {
+      seq.sorted_offsets_ = true;
+      for (size_t i = start + 1; i < end; ++i) {
+        if (offsets_[i].first < offsets_[i - 1].first ||
+            offsets_[i].second < offsets_[i - 1].second) {
+          seq.sorted_offsets_ = false;
           break;
         }
       }
     }
+    if (HasField(WORDS_IDX_FIELD)) {
+      auto& spans = seq.word_spans_;
+      bool sorted = true;
+      for (uint32_t i = start; i < end; ++i) {
+        // The special tokens don't belong to any word
+        if (words_idx_[i] == std::numeric_limits<uint32_t>::max()) {
+          continue;
+        }
+        if (!spans.empty() && spans.back().word_idx_ == words_idx_[i]) {
+          spans.back().end_ = i + 1;
+          continue;
+        }
+        if (!spans.empty() && spans.back().word_idx_ > words_idx_[i]) {
+          sorted = false;
+        }
+        spans.push_back({words_idx_[i], i, i + 1});
+      }
+      if (!sorted) {
+        // Merge the tokens of the same word into one span
+        std::sort(spans.begin(),
+                  spans.end(),
+                  [](const AlignmentIndex::WordSpan& a,
+                     const AlignmentIndex::WordSpan& b) {
+                    return a.word_idx_ < b.word_idx_ ||
+                           (a.word_idx_ == b.word_idx_ && a.start_ < b.start_);
+                  });
+        size_t merged = 0;
+        for (size_t i = 1; i < spans.size(); ++i) {
+          if (spans[i].word_idx_ == spans[merged].word_idx_) {
+            spans[merged].end_ = std::max(spans[merged].end_, spans[i].end_);
+          } else {
+            spans[++merged] = spans[i];
+          }
+        }
+        spans.resize(merged + 1);
+      }
+    }
+  }
+  index = new_index;
+  std::atomic_store(&alignment_index_, index);
+  return index;
+}
+
+void Encoding::ResetAlignmentIndex() {
+  std::atomic_store(&alignment_index_,
+                    std::shared_ptr<const AlignmentIndex>());
+}
+
+bool Encoding::TokenIdxToSequenceId(uint32_t token_idx,
+                                    uint32_t* seq_id) const {
+  if (token_idx >= static_cast<uint32_t>(GetLen())) {
+    return false;
+  }
+  if (sequence_ranges_.empty()) {
+    *seq_id = 0;
+    return true;
+  }
+  auto index = GetAlignmentIndex();
+  for (uint32_t i = 0; i < index->sequences_.size(); ++i) {
+    const auto& seq = index->sequences_[i];
+    if (seq.valid_ && token_idx >= seq.range_.first &&
+        token_idx < seq.range_.second) {
+      *seq_id = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Encoding::TokenIdxToCharOffset(uint32_t token_idx,
+                                    uint32_t* seq_id,
+                                    Offset* offset) const {
+  CheckField(OFFSETS_FIELD, "TokenIdxToCharOffset");
+  if (!TokenIdxToSequenceId(token_idx, seq_id)) {
+    return false;
+  }
+  *offset = offsets_[token_idx];
+  return true;
+}
+
+bool Encoding::TokenIdxToWordIdx(uint32_t token_idx,
+                                 uint32_t* seq_id,
+                                 uint32_t* word_idx) const {
+  CheckField(WORDS_IDX_FIELD, "TokenIdxToWordIdx");
+  if (!TokenIdxToSequenceId(token_idx, seq_id)) {
+    return false;
+  }
+  *word_idx = words_idx_[token_idx];
+  return true;
+}
+
+bool Encoding::WordIdxToTokenRange(uint32_t word_idx,
+                                   uint32_t seq_id,
+                                   Range* token_range) const {
+  CheckField(WORDS_IDX_FIELD, "WordIdxToTokenRange");
+  auto index = GetAlignmentIndex();
+  auto seq = index->GetSequence(seq_id);
+  if (seq == nullptr) {
+    return false;
+  }
+  const auto& spans = seq->word_spans_;
+  auto it = std::lower_bound(
+      spans.begin(),
+      spans.end(),
+      word_idx,
+      [](const AlignmentIndex::WordSpan& span, uint32_t word_idx) {
+        return span.word_idx_ < word_idx;
+      });
+  if (it == spans.end() || it->word_idx_ != word_idx) {
+    return false;
+  }
+  *token_range = {it->start_, it->end_};
+  return true;
+}
+
+bool Encoding::WordIdxToCharOffset(uint32_t word_idx,
+                                   uint32_t seq_id,
+                                   Offset* offset) const {
+  CheckField(OFFSETS_FIELD, "WordIdxToCharOffset");
+  Range token_range;
+  if (!WordIdxToTokenRange(word_idx, seq_id, &token_range)) {
+    return false;
+  }
+  *offset = {offsets_[token_range.first].first,
+             offsets_[token_range.second - 1].second};
+  return true;
+}
+
+bool Encoding::CharOffsetToTokenIdx(uint32_t char_pos,
+                                    uint32_t seq_id,
+                                    uint32_t* token_idx) const {
+  CheckField(OFFSETS_FIELD, "CharOffsetToTokenIdx");
+  auto index = GetAlignmentIndex();
+  auto seq = index->GetSequence(seq_id);
+  if (seq == nullptr) {
+    return false;
+  }
+  auto begin = offsets_.begin() + seq->range_.first;
+  auto end = offsets_.begin() + seq->range_.second;
+  if (seq->sorted_offsets_) {
+    // The first token that ends after char_pos is the only candidate.
+    auto it = std::upper_bound(
+        begin, end, char_pos, [](uint32_t char_pos, const Offset& offset) {
+          return char_pos < offset.second;
+        });
+    if (it != end && it->first <= char_pos) {
+      *token_idx = it - offsets_.begin();
+      return true;
+    }
+    return false;
+  }
+  for (auto it = begin; it != end; ++it) {
+    if (char_pos >= it->first && char_pos < it->second) {
+      *token_idx = it - offsets_.begin();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Encoding::CharOffsetToWordIdx(uint32_t char_pos,
+                                   uint32_t seq_id,
+                                   uint32_t* word_idx) const {
+  CheckField(WORDS_IDX_FIELD, "CharOffsetToWordIdx");
+  uint32_t token_idx;
+  if (!CharOffsetToTokenIdx(char_pos, seq_id, &token_idx)) {
+    return false;
+  }
+  *word_idx = words_idx_[token_idx];
+  return true;
+}
+
+std::vector<uint32_t> Encoding::TokenIdxToSequenceIds(
+    uint32_t token_idx) const {
+  std::vector<uint32_t> seq_ids;
+  uint32_t seq_id;
+  if (TokenIdxToSequenceId(token_idx, &seq_id)) {
+    seq_ids.push_back(seq_id);
   }
   return seq_ids;
 }
 
 std::vector<Range> Encoding::WordIdxToTokensIdx(uint32_t word_idx,
                                                 uint32_t seq_id) const {
-  auto seq_range = sequence_ranges_.at(seq_id);
   std::vector<Range> ranges;
-  int start = -1;
-  int end = -1;
-  for (uint32_t i = seq_range.first; i < seq_range.second; ++i) {
-    // -1 is the word index of special token
-    if (words_idx_[i] > word_idx &&
-        words_idx_[i] != std::numeric_limits<uint32_t>::max()) {
-      break;
-    }
-    if (words_idx_[i] == word_idx) {
-      if (start < 0 || i < start) {
-        start = i;
-      }
-      if (end < 0 || i >= end) {
-        end = i + 1;
-      }
-    }
-  }
-  if (start >= 0 && end >= 0) {
-    seq_range.first += start;
-    seq_range.second += end;
-    ranges.push_back(seq_range);
+  Range token_range;
+  if (WordIdxToTokenRange(word_idx, seq_id, &token_range)) {
+    ranges.push_back(token_range);
   }
   return ranges;
 }
@@ -235,13 +500,9 @@ std::vector<Range> Encoding::WordIdxToTokensIdx(uint32_t word_idx,
 std::vector<Offset> Encoding::WordIdxToCharOffsets(uint32_t word_idx,
                                                    uint32_t seq_id) const {
   std::vector<Offset> offsets;
-  std::vector<Range> ranges = WordIdxToTokensIdx(word_idx, seq_id);
-  if (ranges.size() > 0) {
-    auto start = ranges[0].first;
-    auto end = ranges[0].second;
-    if (end > 0) {
-      offsets.push_back({offsets_[start].first, offsets_[end - 1].second});
-    }
+  Offset offset;
+  if (WordIdxToCharOffset(word_idx, seq_id, &offset)) {
+    offsets.push_back(offset);
   }
   return offsets;
 }
@@ -249,9 +510,10 @@ std::vector<Offset> Encoding::WordIdxToCharOffsets(uint32_t word_idx,
 std::vector<std::pair<uint32_t, Offset>> Encoding::TokenIdxToCharOffsets(
     uint32_t token_idx) const {
   std::vector<std::pair<uint32_t, Offset>> results;
-  auto seq_ids = TokenIdxToSequenceIds(token_idx);
-  if (seq_ids.size() > 0) {
-    results.push_back({seq_ids[0], offsets_[token_idx]});
+  uint32_t seq_id;
+  Offset offset;
+  if (TokenIdxToCharOffset(token_idx, &seq_id, &offset)) {
+    results.push_back({seq_id, offset});
   }
   return results;
 }
@@ -259,9 +521,10 @@ std::vector<std::pair<uint32_t, Offset>> Encoding::TokenIdxToCharOffsets(
 std::vector<std::pair<uint32_t, uint32_t>> Encoding::TokenIdxToWordIdx(
     uint32_t token_idx) const {
   std::vector<std::pair<uint32_t, uint32_t>> results;
-  auto seq_ids = TokenIdxToSequenceIds(token_idx);
-  if (seq_ids.size() > 0) {
-    results.push_back({seq_ids[0], words_idx_[token_idx]});
+  uint32_t seq_id;
+  uint32_t word_idx;
+  if (TokenIdxToWordIdx(token_idx, &seq_id, &word_idx)) {
+    results.push_back({seq_id, word_idx});
   }
   return results;
 }
@@ -269,34 +532,41 @@ std::vector<std::pair<uint32_t, uint32_t>> Encoding::TokenIdxToWordIdx(
 std::vector<uint32_t> Encoding::CharOffsetsToTokenIdx(uint32_t char_pos,
                                                       uint32_t seq_id) const {
   std::vector<uint32_t> token_idx;
-  auto seq_range = sequence_ranges_.at(seq_id);
-  for (int i = seq_range.first; i < seq_range.second; ++i) {
-    if (char_pos >= offsets_[i].first && char_pos < offsets_[i].second) {
-      token_idx.push_back(i);
-      break;
-    }
+  uint32_t idx;
+  if (CharOffsetToTokenIdx(char_pos, seq_id, &idx)) {
+    token_idx.push_back(idx);
   }
   return token_idx;
 }
 
 std::vector<uint32_t> Encoding::CharOffsetsToWordIdx(uint32_t char_pos,
                                                      uint32_t seq_id) const {
-  std::vector<uint32_t> token_idx = CharOffsetsToTokenIdx(char_pos, seq_id);
   std::vector<uint32_t> word_idx;
-  if (token_idx.size() > 0) {
-    auto words_idx = TokenIdxToWordIdx(token_idx[0]);
-    if (words_idx.size() > 0) {
-      word_idx.push_back(words_idx[0].second);
-    }
+  uint32_t idx;
+  if (CharOffsetToWordIdx(char_pos, seq_id, &idx)) {
+    word_idx.push_back(idx);
   }
   return word_idx;
 }
 
+template <typename T>
+static std::vector<T> SliceField(const std::vector<T>& field,
+                                 size_t start,
+                                 size_t end) {
+  if (field.empty()) {
+    return std::vector<T>();
+  }
+  return std::vector<T>(field.begin() + start, field.begin() + end);
+}
+
 void Encoding::Truncate(size_t max_len, size_t stride, Direction direction) {
+  ResetAlignmentIndex();
   size_t encoding_len = ids_.size();
   if (max_len < encoding_len) {
     if (max_len == 0) {
+      auto fields = fields_;
       *this = Encoding(0);
+      fields_ = fields;
       overflowing_.push_back(*this);
       return;
     }
@@ -326,43 +596,26 @@ void Encoding::Truncate(size_t max_len, size_t stride, Direction direction) {
         }
       }
     }
-    // Create new encoding
+    // Create new encodings. The skipped fields are empty and stay empty.
+    auto create_part = [this](size_t start, size_t end) {
+      Encoding part(SliceField(ids_, start, end),
+                    SliceField(type_ids_, start, end),
+                    SliceField(tokens_, start, end),
+                    SliceField(words_idx_, start, end),
+                    SliceField(offsets_, start, end),
+                    SliceField(special_tokens_mask_, start, end),
+                    SliceField(attention_mask_, start, end),
+                    std::vector<Encoding>(),
+                    std::unordered_map<uint32_t, Range>());
+      part.fields_ = fields_;
+      return part;
+    };
     auto new_encoding_len = part_ranges[0].second - part_ranges[0].first;
-    Encoding new_encoding(
-        std::vector<uint32_t>(ids_.begin(), ids_.begin() + new_encoding_len),
-        std::vector<uint32_t>(type_ids_.begin(),
-                              type_ids_.begin() + new_encoding_len),
-        std::vector<std::string>(tokens_.begin(),
-                                 tokens_.begin() + new_encoding_len),
-        std::vector<uint32_t>(words_idx_.begin(),
-                              words_idx_.begin() + new_encoding_len),
-        std::vector<Offset>(offsets_.begin(),
-                            offsets_.begin() + new_encoding_len),
-        std::vector<uint32_t>(special_tokens_mask_.begin(),
-                              special_tokens_mask_.begin() + new_encoding_len),
-        std::vector<uint32_t>(attention_mask_.begin(),
-                              attention_mask_.begin() + new_encoding_len),
-        std::vector<Encoding>(),
-        std::unordered_map<uint32_t, Range>());
+    Encoding new_encoding = create_part(0, new_encoding_len);
     // Set overflowing
     for (size_t i = 1; i < part_ranges.size() - 1; ++i) {
-      auto start = part_ranges[i].first;
-      auto end = part_ranges[i].second;
-      new_encoding.overflowing_.emplace_back(Encoding(
-          std::vector<uint32_t>(ids_.begin() + start, ids_.begin() + end),
-          std::vector<uint32_t>(type_ids_.begin() + start,
-                                type_ids_.begin() + end),
-          std::vector<std::string>(tokens_.begin() + start,
-                                   tokens_.begin() + end),
-          std::vector<uint32_t>(words_idx_.begin() + start,
-                                words_idx_.begin() + end),
-          std::vector<Offset>(offsets_.begin() + start, offsets_.begin() + end),
-          std::vector<uint32_t>(special_tokens_mask_.begin() + start,
-                                special_tokens_mask_.begin() + end),
-          std::vector<uint32_t>(attention_mask_.begin() + start,
-                                attention_mask_.begin() + end),
-          std::vector<Encoding>(),
-          std::unordered_map<uint32_t, Range>()));
+      new_encoding.overflowing_.emplace_back(
+          create_part(part_ranges[i].first, part_ranges[i].second));
     }
     *this = std::move(new_encoding);
   }
@@ -370,6 +623,7 @@ void Encoding::Truncate(size_t max_len, size_t stride, Direction direction) {
 
 
 void Encoding::MergeWith(const Encoding& pair, bool growing_offsets) {
+  ResetAlignmentIndex();
   std::vector<Encoding> overflowings;
 
   for (const auto& this_o : overflowing_) {
@@ -414,6 +668,9 @@ void Encoding::MergeWith(const Encoding& pair, bool growing_offsets) {
   }
 
   overflowing_ = std::move(overflowings);
+  if ((fields_ & pair.fields_) != fields_) {
+    SetFields(fields_ & pair.fields_);
+  }
 }
 
 void Encoding::Pad(uint32_t target_length,
@@ -421,31 +678,52 @@ void Encoding::Pad(uint32_t target_length,
                    uint32_t pad_type_id,
                    const std::string& pad_token,
                    Direction direction) {
+  ResetAlignmentIndex();
   for (auto& overflowing : overflowing_) {
     overflowing.Pad(target_length, pad_id, pad_type_id, pad_token, direction);
   }
   // Need to be padded in this situation
   if (GetLen() < target_length) {
     auto pad_len = target_length - GetLen();
+// Only the fields that the encoding contains are padded.
+#define PAD_FIELD(field, member, pos, value) \
+  if (HasField(field)) member.insert(pos, pad_len, value)
     if (direction == LEFT) {
       ids_.insert(ids_.begin(), pad_len, pad_id);
-      type_ids_.insert(type_ids_.begin(), pad_len, pad_type_id);
-      tokens_.insert(tokens_.begin(), pad_len, pad_token);
-      words_idx_.insert(
-          words_idx_.begin(), pad_len, std::numeric_limits<uint32_t>::max());
-      attention_mask_.insert(attention_mask_.begin(), pad_len, 0);
-      special_tokens_mask_.insert(special_tokens_mask_.begin(), pad_len, 1);
-      offsets_.insert(offsets_.begin(), pad_len, {0, 0});
+      PAD_FIELD(TYPE_IDS_FIELD, type_ids_, type_ids_.begin(), pad_type_id);
+      PAD_FIELD(TOKENS_FIELD, tokens_, tokens_.begin(), pad_token);
+      PAD_FIELD(WORDS_IDX_FIELD,
+                words_idx_,
+                words_idx_.begin(),
+                std::numeric_limits<uint32_t>::max());
+      PAD_FIELD(
+          ATTENTION_MASK_FIELD, attention_mask_, attention_mask_.begin(), 0);
+      PAD_FIELD(SPECIAL_TOKENS_MASK_FIELD,
+                special_tokens_mask_,
+                special_tokens_mask_.begin(),
+                1);
+      PAD_FIELD(OFFSETS_FIELD, offsets_, offsets_.begin(), Offset(0, 0));
+      for (auto& seq_range : sequence_ranges_) {
+        seq_range.second.first += pad_len;
+        seq_range.second.second += pad_len;
+      }
     } else {
       ids_.insert(ids_.end(), pad_len, pad_id);
-      type_ids_.insert(type_ids_.end(), pad_len, pad_type_id);
-      tokens_.insert(tokens_.end(), pad_len, pad_token);
-      words_idx_.insert(
-          words_idx_.end(), pad_len, std::numeric_limits<uint32_t>::max());
-      attention_mask_.insert(attention_mask_.end(), pad_len, 0);
-      special_tokens_mask_.insert(special_tokens_mask_.end(), pad_len, 1);
-      offsets_.insert(offsets_.end(), pad_len, {0, 0});
+      PAD_FIELD(TYPE_IDS_FIELD, type_ids_, type_ids_.end(), pad_type_id);
+      PAD_FIELD(TOKENS_FIELD, tokens_, tokens_.end(), pad_token);
+      PAD_FIELD(WORDS_IDX_FIELD,
+                words_idx_,
+                words_idx_.end(),
+                std::numeric_limits<uint32_t>::max());
+      PAD_FIELD(
+          ATTENTION_MASK_FIELD, attention_mask_, attention_mask_.end(), 0);
+      PAD_FIELD(SPECIAL_TOKENS_MASK_FIELD,
+                special_tokens_mask_,
+                special_tokens_mask_.end(),
+                1);
+      PAD_FIELD(OFFSETS_FIELD, offsets_, offsets_.end(), Offset(0, 0));
     }
+#undef PAD_FIELD
   }
 }
 
@@ -477,7 +755,8 @@ bool Encoding::operator==(const Encoding& other) const {
          offsets_ == other.offsets_ &&
          special_tokens_mask_ == other.special_tokens_mask_ &&
          attention_mask_ == other.attention_mask_ &&
-         sequence_ranges_ == other.sequence_ranges_;
+         sequence_ranges_ == other.sequence_ranges_ &&
+         fields_ == other.fields_;
 }
 
 std::string Encoding::DebugString() const {
@@ -637,22 +916,28 @@ void MultiThreadPadEncodings(std::vector<Encoding>* encodings,
                  method.direction_);
   }
 }
-void PadEncodings(std::vector<Encoding>* encodings, const PadMethod& method) {
-  if (encodings == nullptr || encodings->empty()) {
-    return;
-  }
-  size_t pad_length = 0;
-  if (method.strategy_ == PadStrategy::BATCH_LONGEST) {
-    for (const auto& encoding : *encodings) {
-      pad_length = std::max(encoding.GetIds().size(), pad_length);
-    }
-  } else {
+size_t GetPadLength(size_t max_len, const PadMethod& method) {
+  size_t pad_length = max_len;
+  if (method.strategy_ == PadStrategy::FIXED_SIZE) {
     pad_length = method.pad_len_;
   }
   if (method.pad_to_multiple_of_ > 0 &&
       pad_length % method.pad_to_multiple_of_) {
-    pad_length += pad_length - pad_length % method.pad_to_multiple_of_;
+    pad_length +=
+        method.pad_to_multiple_of_ - pad_length % method.pad_to_multiple_of_;
+  }
+  return pad_length;
+}
+
+void PadEncodings(std::vector<Encoding>* encodings, const PadMethod& method) {
+  if (encodings == nullptr || encodings->empty()) {
+    return;
+  }
+  size_t max_len = 0;
+  for (const auto& encoding : *encodings) {
+    max_len = std::max(encoding.GetIds().size(), max_len);
   }
+  size_t pad_length = GetPadLength(max_len, method);
   auto batch_size = encodings->size();
   auto func = std::bind(&MultiThreadPadEncodings,
                         encodings,
@@ -15,6 +15,7 @@ limitations under the License. */
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -62,6 +63,12 @@ public:
 
   bool IsEmpty() const;
   void SetSequenceIds(uint32_t seq_ids);
+  // The mask of EncodeField that the encoding contains. The vectors of the
+  // other fields are left empty.
+  uint32_t GetFields() const;
+  bool HasField(EncodeField field) const;
+  // Clear the vectors of the fields that are not in the mask.
+  void SetFields(uint32_t fields);
 
   // Getter
   int GetLen() const;
@@ -98,6 +105,30 @@ public:
                                               uint32_t seq_id) const;
   std::vector<uint32_t> CharOffsetsToWordIdx(uint32_t char_pos,
                                              uint32_t seq_id) const;
+
+  // The allocation-free versions of the alignment queries above, which
+  // return false if nothing is found. They are answered by binary search on
+  // an index that is built on the first query and dropped when the encoding
+  // is modified. The token range is [first, second) in the whole encoding.
+  bool TokenIdxToSequenceId(uint32_t token_idx, uint32_t* seq_id) const;
+  bool TokenIdxToCharOffset(uint32_t token_idx,
+                            uint32_t* seq_id,
+                            Offset* offset) const;
+  bool TokenIdxToWordIdx(uint32_t token_idx,
+                         uint32_t* seq_id,
+                         uint32_t* word_idx) const;
+  bool WordIdxToTokenRange(uint32_t word_idx,
+                           uint32_t seq_id,
+                           Range* token_range) const;
+  bool WordIdxToCharOffset(uint32_t word_idx,
+                           uint32_t seq_id,
+                           Offset* offset) const;
+  bool CharOffsetToTokenIdx(uint32_t char_pos,
+                            uint32_t seq_id,
+                            uint32_t* token_idx) const;
+  bool CharOffsetToWordIdx(uint32_t char_pos,
+                           uint32_t seq_id,
+                           uint32_t* word_idx) const;
   void Truncate(size_t max_len, size_t stride, Direction direction);
   void MergeWith(const Encoding& pair, bool growing_offsets);
   void Pad(uint32_t target_length,
@@ -122,6 +153,15 @@ private:
   std::vector<uint32_t> attention_mask_;
   std::vector<Encoding> overflowing_;
   std::unordered_map<uint32_t, Range> sequence_ranges_;
+  uint32_t fields_ = ALL_FIELDS;
+  // Built lazily by the alignment queries, it's shared by the copies of the
+  // encoding since it's never modified after being built.
+  struct AlignmentIndex;
+  mutable std::shared_ptr<const AlignmentIndex> alignment_index_;
+
+  void CheckField(EncodeField field, const char* method) const;
+  std::shared_ptr<const AlignmentIndex> GetAlignmentIndex() const;
+  void ResetAlignmentIndex();
 };
 
 bool FASTTOKENIZER_DECL TruncateEncodings(Encoding* encoding,
@@ -129,6 +169,9 @@ bool FASTTOKENIZER_DECL TruncateEncodings(Encoding* encoding,
                                           const TruncMethod& method);
 void FASTTOKENIZER_DECL PadEncodings(std::vector<Encoding>* encoding,
                                      const PadMethod& method);
+// Get the length that encodings of max_len tokens are padded to.
+size_t FASTTOKENIZER_DECL GetPadLength(size_t max_len,
+                                       const PadMethod& method);
 
 }  // namespace core
 }  // namespace fast_tokenizer
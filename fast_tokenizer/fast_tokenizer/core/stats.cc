@@ -0,0 +1,108 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/core/stats.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace core {
+
+const char* GetStageName(Stage stage) {
+  switch (stage) {
+    case EXTRACT_AND_NORMALIZE:
+      return "extract_and_normalize";
+    case PRE_TOKENIZE:
+      return "pre_tokenize";
+    case TOKENIZE:
+      return "tokenize";
+    case POST_PROCESS:
+      return "post_process";
+    case PAD:
+      return "pad";
+    case DECODE:
+      return "decode";
+    default:
+      return "unknown";
+  }
+}
+
+double TokenizerStats::GetCacheHitRate() const {
+  uint64_t total = cache_hits_ + cache_misses_;
+  if (total == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(cache_hits_) / total;
+}
+
+double TokenizerStats::GetThreadUtilization() const {
+  if (parallel_capacity_ns_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(parallel_busy_ns_) / parallel_capacity_ns_;
+}
+
+StatsCollector::StatsCollector() { Reset(); }
+
+void StatsCollector::AddStage(Stage stage,
+                              uint64_t time_ns,
+                              uint64_t bytes_in,
+                              uint64_t tokens_out) {
+  auto& stats = stages_[stage];
+  stats.calls_.fetch_add(1, std::memory_order_relaxed);
+  stats.time_ns_.fetch_add(time_ns, std::memory_order_relaxed);
+  stats.bytes_in_.fetch_add(bytes_in, std::memory_order_relaxed);
+  stats.tokens_out_.fetch_add(tokens_out, std::memory_order_relaxed);
+}
+
+void StatsCollector::AddParallel(uint64_t wall_ns,
+                                 uint64_t busy_ns,
+                                 uint64_t thread_num) {
+  parallel_calls_.fetch_add(1, std::memory_order_relaxed);
+  parallel_wall_ns_.fetch_add(wall_ns, std::memory_order_relaxed);
+  parallel_busy_ns_.fetch_add(busy_ns, std::memory_order_relaxed);
+  parallel_capacity_ns_.fetch_add(wall_ns * thread_num,
+                                  std::memory_order_relaxed);
+}
+
+void StatsCollector::Reset() {
+  for (auto& stats : stages_) {
+    stats.calls_ = 0;
+    stats.time_ns_ = 0;
+    stats.bytes_in_ = 0;
+    stats.tokens_out_ = 0;
+  }
+  parallel_calls_ = 0;
+  parallel_wall_ns_ = 0;
+  parallel_busy_ns_ = 0;
+  parallel_capacity_ns_ = 0;
+}
+
+TokenizerStats StatsCollector::GetStats() const {
+  TokenizerStats result;
+  for (int i = 0; i < STAGE_NUM; ++i) {
+    result.stages_[i].calls_ = stages_[i].calls_.load();
+    result.stages_[i].time_ns_ = stages_[i].time_ns_.load();
+    result.stages_[i].bytes_in_ = stages_[i].bytes_in_.load();
+    result.stages_[i].tokens_out_ = stages_[i].tokens_out_.load();
+  }
+  result.parallel_calls_ = parallel_calls_.load();
+  result.parallel_wall_ns_ = parallel_wall_ns_.load();
+  result.parallel_busy_ns_ = parallel_busy_ns_.load();
+  result.parallel_capacity_ns_ = parallel_capacity_ns_.load();
+  return result;
+}
+
+}  // namespace core
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
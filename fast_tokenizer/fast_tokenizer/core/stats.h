@@ -0,0 +1,139 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace core {
+
+// The stages of encoding and decoding. When padding is fused into post
+// processing, its time is counted in POST_PROCESS, and PAD only counts the
+// standalone padding of a batch.
+enum FASTTOKENIZER_DECL Stage {
+  EXTRACT_AND_NORMALIZE,
+  PRE_TOKENIZE,
+  TOKENIZE,
+  POST_PROCESS,
+  PAD,
+  DECODE,
+  STAGE_NUM
+};
+
+FASTTOKENIZER_DECL const char* GetStageName(Stage stage);
+
+struct FASTTOKENIZER_DECL StageStats {
+  uint64_t calls_;
+  uint64_t time_ns_;
+  uint64_t bytes_in_;
+  uint64_t tokens_out_;
+  StageStats() : calls_(0), time_ns_(0), bytes_in_(0), tokens_out_(0) {}
+};
+
+// A snapshot of the statistics collected by a tokenizer.
+struct FASTTOKENIZER_DECL TokenizerStats {
+  // Indexed by Stage
+  std::vector<StageStats> stages_;
+  // The hits of the cache of the model, such as BPE and Unigram
+  uint64_t cache_hits_;
+  uint64_t cache_misses_;
+  // The multi-thread regions of the batch encoding and decoding. The busy
+  // time is the sum of the time that every thread spends on its work, and
+  // the capacity is the wall time multiplied by the number of threads.
+  uint64_t parallel_calls_;
+  uint64_t parallel_wall_ns_;
+  uint64_t parallel_busy_ns_;
+  uint64_t parallel_capacity_ns_;
+
+  TokenizerStats()
+      : stages_(STAGE_NUM),
+        cache_hits_(0),
+        cache_misses_(0),
+        parallel_calls_(0),
+        parallel_wall_ns_(0),
+        parallel_busy_ns_(0),
+        parallel_capacity_ns_(0) {}
+  double GetCacheHitRate() const;
+  double GetThreadUtilization() const;
+};
+
+// Collect the statistics of the stages, can be updated from multiple threads.
+class FASTTOKENIZER_DECL StatsCollector {
+public:
+  StatsCollector();
+  void AddStage(Stage stage,
+                uint64_t time_ns,
+                uint64_t bytes_in,
+                uint64_t tokens_out);
+  void AddParallel(uint64_t wall_ns, uint64_t busy_ns, uint64_t thread_num);
+  void Reset();
+  // The cache statistics are not collected here, they are left to zero.
+  TokenizerStats GetStats() const;
+
+private:
+  struct AtomicStageStats {
+    std::atomic<uint64_t> calls_;
+    std::atomic<uint64_t> time_ns_;
+    std::atomic<uint64_t> bytes_in_;
+    std::atomic<uint64_t> tokens_out_;
+  };
+  AtomicStageStats stages_[STAGE_NUM];
+  std::atomic<uint64_t> parallel_calls_;
+  std::atomic<uint64_t> parallel_wall_ns_;
+  std::atomic<uint64_t> parallel_busy_ns_;
+  std::atomic<uint64_t> parallel_capacity_ns_;
+};
+
+inline uint64_t GetTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Measure the time of a stage in its scope. It does nothing if the collector
+// is nullptr, so that the cost is only a branch when the stats are disabled.
+class FASTTOKENIZER_DECL StageTimer {
+public:
+  StageTimer(StatsCollector* collector, Stage stage, uint64_t bytes_in = 0)
+      : collector_(collector),
+        stage_(stage),
+        bytes_in_(bytes_in),
+        tokens_out_(0),
+        start_ns_(collector != nullptr ? GetTimeNs() : 0) {}
+  ~StageTimer() {
+    if (collector_ != nullptr) {
+      collector_->AddStage(
+          stage_, GetTimeNs() - start_ns_, bytes_in_, tokens_out_);
+    }
+  }
+  void SetTokensOut(uint64_t tokens_out) { tokens_out_ = tokens_out; }
+
+private:
+  StatsCollector* collector_;
+  Stage stage_;
+  uint64_t bytes_in_;
+  uint64_t tokens_out_;
+  uint64_t start_ns_;
+};
+
+}  // namespace core
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
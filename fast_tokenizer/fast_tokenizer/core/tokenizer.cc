@@ -14,11 +14,14 @@ limitations under the License. */
 
 #include "fast_tokenizer/core/tokenizer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 
 #include "fast_tokenizer/core/added_vocabulary.h"
 #include "fast_tokenizer/core/base.h"
 #include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/stats.h"
 #include "fast_tokenizer/decoders/decoders.h"
 #include "fast_tokenizer/models/models.h"
 #include "fast_tokenizer/normalizers/normalizers.h"
@@ -94,6 +97,19 @@ PadMethod Tokenizer::GetPadMethod() const { return pad_method_; }
 
 models::Model* Tokenizer::GetModelPtr() const { return model_.get(); }
 
+void Tokenizer::SetModelPtr(const std::shared_ptr<models::Model>& model) {
+  model_ = model;
+  // Don't disable the cache statistics of the other tokenizers that share the
+  // model.
+  if (model_ != nullptr && stats_ != nullptr) {
+    model_->EnableCacheStats(true);
+  }
+}
+
+std::shared_ptr<models::Model> Tokenizer::GetSharedModelPtr() const {
+  return model_;
+}
+
 void Tokenizer::ReleasePostProcessor() { post_processor_ = nullptr; }
 
 postprocessors::PostProcessor* Tokenizer::GetPostProcessorPtr() const {
@@ -143,12 +159,13 @@ bool Tokenizer::DoTokenize(pretokenizers::PreTokenizedString* pretokenized,
                            uint32_t type_id,
                            const std::vector<uint32_t>& word_idx,
                            OffsetType offset_type,
-                           Encoding* encoding) const {
+                           Encoding* encoding,
+                           uint32_t fields) const {
   pretokenized->Tokenize([&](normalizers::NormalizedString* normalized) {
     return this->GetModelPtr()->Tokenize(normalized->GetStr());
   });
   return pretokenized->TransformToEncoding(
-      word_idx, type_id, offset_type, encoding);
+      word_idx, type_id, offset_type, encoding, fields);
 }
 
 bool Tokenizer::DoPreTokenize(
@@ -163,31 +180,89 @@ struct InputStringVisitor {
   InputStringVisitor(const Tokenizer* tokenizer,
                      uint32_t type_id,
                      OffsetType offset_type,
-                     Encoding* encodings)
+                     Encoding* encodings,
+                     uint32_t fields)
       : tokenizer_(tokenizer),
         type_id_(type_id),
         offset_type_(offset_type),
-        encodings_(encodings) {}
+        encodings_(encodings),
+        fields_(fields) {}
   void operator()(const std::vector<std::string>& pretokenized_texts) const {
     tokenizer_->EncodeSingleText(
-        pretokenized_texts, type_id_, offset_type_, encodings_);
+        pretokenized_texts, type_id_, offset_type_, encodings_, fields_);
   }
 
   void operator()(const std::string& raw_text) const {
-    tokenizer_->EncodeSingleText(raw_text, type_id_, offset_type_, encodings_);
+    tokenizer_->EncodeSingleText(
+        raw_text, type_id_, offset_type_, encodings_, fields_);
   }
   const Tokenizer* tokenizer_;
   uint32_t type_id_;
   OffsetType offset_type_;
   Encoding* encodings_;
+  uint32_t fields_;
 };
 
 void Tokenizer::EncodeSingleString(const InputString& input_string,
                                    uint32_t type_id,
                                    OffsetType offset_type,
-                                   Encoding* encodings) const {
-  paddlenlp::visit(InputStringVisitor(this, type_id, offset_type, encodings),
-                   input_string);
+                                   Encoding* encodings,
+                                   uint32_t fields) const {
+  paddlenlp::visit(
+      InputStringVisitor(this, type_id, offset_type, encodings, fields),
+      input_string);
+}
+
+void Tokenizer::Truncate(Encoding* encoding,
+                         Encoding* pair_encoding,
+                         bool add_special_tokens) const {
+  if (!use_truncation_) {
+    return;
+  }
+  auto added_tokens_num = 0;
+  if (post_processor_ != nullptr) {
+    added_tokens_num = post_processor_->AddedTokensNum(pair_encoding != nullptr);
+  }
+  if (add_special_tokens && added_tokens_num > 0) {
+    auto trunc_method = trunc_method_;
+    trunc_method.max_len_ -= added_tokens_num;
+    TruncateEncodings(encoding, pair_encoding, trunc_method);
+  } else {
+    TruncateEncodings(encoding, pair_encoding, trunc_method_);
+  }
+}
+
+size_t Tokenizer::GetPostProcessedLen(const Encoding& encoding,
+                                      const Encoding* pair_encoding,
+                                      bool add_special_tokens) const {
+  size_t len = encoding.GetLen();
+  if (pair_encoding != nullptr) {
+    len += pair_encoding->GetLen();
+  }
+  if (add_special_tokens && post_processor_ != nullptr) {
+    len += post_processor_->AddedTokensNum(pair_encoding != nullptr);
+  }
+  return len;
+}
+
+void Tokenizer::ProcessAndPad(Encoding* encoding,
+                              Encoding* pair_encoding,
+                              bool add_special_tokens,
+                              uint32_t pad_len,
+                              Encoding* result_encoding) const {
+  StageTimer timer(stats_.get(), POST_PROCESS);
+  if (post_processor_ == nullptr) {
+    postprocessors::PostProcessor::DefaultProcessAndPad(
+        encoding, pair_encoding, pad_method_, pad_len, result_encoding);
+  } else {
+    post_processor_->ProcessAndPad(encoding,
+                                   pair_encoding,
+                                   add_special_tokens,
+                                   pad_method_,
+                                   pad_len,
+                                   result_encoding);
+  }
+  timer.SetTokensOut(result_encoding->GetLen());
 }
 
 void Tokenizer::PostProcess(Encoding* encoding,
@@ -195,33 +270,66 @@ void Tokenizer::PostProcess(Encoding* encoding,
                             bool add_special_tokens,
                             Encoding* result_encoding) const {
   // 1. Trunc
-  if (use_truncation_) {
-    auto added_tokens_num = 0;
-    if (post_processor_ != nullptr) {
-      added_tokens_num =
-          post_processor_->AddedTokensNum(pair_encoding != nullptr);
-    }
-    if (add_special_tokens && added_tokens_num > 0) {
-      auto trunc_method = trunc_method_;
-      trunc_method.max_len_ -= added_tokens_num;
-      TruncateEncodings(encoding, pair_encoding, trunc_method);
-    } else {
-      TruncateEncodings(encoding, pair_encoding, trunc_method_);
-    }
-  }
-  // 2. Post process
-  if (post_processor_ == nullptr) {
-    postprocessors::PostProcessor::DefaultProcess(
-        encoding, pair_encoding, result_encoding);
-  } else {
-    (*post_processor_)(
-        encoding, pair_encoding, add_special_tokens, result_encoding);
+  Truncate(encoding, pair_encoding, add_special_tokens);
+  // 2. Post process and pad in one pass, the result is written only once.
+  uint32_t pad_len = 0;
+  if (use_padding_) {
+    pad_len = GetPadLength(
+        GetPostProcessedLen(*encoding, pair_encoding, add_special_tokens),
+        pad_method_);
   }
-  // 3. Pad
+  ProcessAndPad(
+      encoding, pair_encoding, add_special_tokens, pad_len, result_encoding);
+}
+
+void Tokenizer::PostProcessBatch(std::vector<Encoding>* batch_encodings,
+                                 std::vector<Encoding>* batch_pair_encodings,
+                                 const std::vector<uint8_t>& has_pair,
+                                 bool add_special_tokens,
+                                 std::vector<Encoding>* encodings) const {
+  auto batch_size = batch_encodings->size();
+  encodings->resize(batch_size);
+  // The lengths are known once the inputs are truncated, so the final
+  // padding length can be computed before post processing and each
+  // encoding is padded while it's written.
+  uint32_t pad_len = 0;
   if (use_padding_) {
-    std::vector<Encoding> encodings;
-    encodings.push_back(*result_encoding);
-    PadEncodings(&encodings, pad_method_);
+    size_t max_len = 0;
+    for (size_t i = 0; i < batch_size; ++i) {
+      const Encoding* pair_encoding =
+          has_pair[i] ? &(*batch_pair_encodings)[i] : nullptr;
+      max_len = std::max(max_len,
+                         GetPostProcessedLen((*batch_encodings)[i],
+                                             pair_encoding,
+                                             add_special_tokens));
+    }
+    pad_len = GetPadLength(max_len, pad_method_);
+  }
+  auto func = [&](size_t start_index, size_t step_index) {
+    size_t end_index = start_index + step_index;
+    if (end_index > batch_size) end_index = batch_size;
+    for (size_t i = start_index; i < end_index; ++i) {
+      Encoding* pair_encoding =
+          has_pair[i] ? &(*batch_pair_encodings)[i] : nullptr;
+      ProcessAndPad(&(*batch_encodings)[i],
+                    pair_encoding,
+                    add_special_tokens,
+                    pad_len,
+                    &(*encodings)[i]);
+    }
+  };
+  RunMultiThreadWithStats(func, batch_size);
+
+  // A post processor may add a different number of tokens than it reports,
+  // pad the batch again in this case.
+  if (use_padding_ && pad_method_.strategy_ == PadStrategy::BATCH_LONGEST) {
+    for (const auto& encoding : *encodings) {
+      if (static_cast<uint32_t>(encoding.GetLen()) > pad_len) {
+        StageTimer timer(stats_.get(), PAD);
+        PadEncodings(encodings, pad_method_);
+        break;
+      }
+    }
   }
 }
 
@@ -306,89 +414,153 @@ void Tokenizer::MultiThreadEncodeBatchStrings(
 void Tokenizer::EncodeBatchStrings(
     const std::vector<EncodeInput>& batch_encode_input,
     std::vector<Encoding>* encodings,
-    bool add_special_tokens) const {
+    bool add_special_tokens,
+    uint32_t fields) const {
   auto batch_size = batch_encode_input.size();
-  encodings->resize(batch_size);
+  std::vector<Encoding> batch_encodings(batch_size);
+  std::vector<Encoding> batch_pair_encodings(batch_size);
+  std::vector<uint8_t> has_pair(batch_size, 0);
   auto func = [&](size_t start_index, size_t step_index) {
-    MultiThreadEncodeBatchStrings(batch_encode_input,
-                                  encodings,
-                                  add_special_tokens,
-                                  start_index,
-                                  step_index);
+    size_t end_index = start_index + step_index;
+    if (end_index > batch_size) end_index = batch_size;
+    for (size_t i = start_index; i < end_index; ++i) {
+      const auto& encode_input = batch_encode_input[i];
+      if (encode_input.type() == typeid(InputString)) {
+        const auto& input_string = paddlenlp::get<InputString>(encode_input);
+        EncodeSingleString(
+            input_string, 0, OffsetType::CHAR, &batch_encodings[i], fields);
+        Truncate(&batch_encodings[i], nullptr, add_special_tokens);
+      } else {
+        const auto& input_string_pair =
+            paddlenlp::get<std::pair<InputString, InputString>>(encode_input);
+        EncodeSingleString(input_string_pair.first,
+                           0,
+                           OffsetType::CHAR,
+                           &batch_encodings[i],
+                           fields);
+        EncodeSingleString(input_string_pair.second,
+                           1,
+                           OffsetType::CHAR,
+                           &batch_pair_encodings[i],
+                           fields);
+        has_pair[i] = 1;
+        Truncate(
+            &batch_encodings[i], &batch_pair_encodings[i], add_special_tokens);
+      }
+    }
   };
-  RunMultiThread(func, batch_size);
-
-  if (use_padding_) {
-    PadEncodings(encodings, pad_method_);
-  }
+  RunMultiThreadWithStats(func, batch_size);
+  PostProcessBatch(&batch_encodings,
+                   &batch_pair_encodings,
+                   has_pair,
+                   add_special_tokens,
+                   encodings);
 }
 
 void Tokenizer::EncodeBatchStrings(const std::vector<std::string>& texts,
                                    std::vector<Encoding>* encodings,
-                                   bool add_special_tokens) const {
+                                   bool add_special_tokens,
+                                   uint32_t fields) const {
   auto batch_size = texts.size();
-  encodings->resize(batch_size);
+  std::vector<Encoding> batch_encodings(batch_size);
+  std::vector<Encoding> batch_pair_encodings(batch_size);
+  std::vector<uint8_t> has_pair(batch_size, 0);
   auto func = [&](size_t start_index, size_t step_index) {
-    MultiThreadEncodeBatchStrings(
-        texts, encodings, add_special_tokens, start_index, step_index);
+    size_t end_index = start_index + step_index;
+    if (end_index > batch_size) end_index = batch_size;
+    for (size_t i = start_index; i < end_index; ++i) {
+      EncodeSingleString(
+          texts[i], 0, OffsetType::CHAR, &batch_encodings[i], fields);
+      Truncate(&batch_encodings[i], nullptr, add_special_tokens);
+    }
   };
-  RunMultiThread(func, batch_size);
-
-  if (use_padding_) {
-    PadEncodings(encodings, pad_method_);
-  }
+  RunMultiThreadWithStats(func, batch_size);
+  PostProcessBatch(&batch_encodings,
+                   &batch_pair_encodings,
+                   has_pair,
+                   add_special_tokens,
+                   encodings);
 }
 
 void Tokenizer::EncodeBatchStrings(const std::vector<std::string>& texts,
                                    const std::vector<std::string>& text_pairs,
                                    std::vector<Encoding>* encodings,
-                                   bool add_special_tokens) const {
+                                   bool add_special_tokens,
+                                   uint32_t fields) const {
+  if (texts.size() != text_pairs.size()) {
+    throw std::runtime_error(
+        "The size of text must equal to the size of text_pair");
+  }
   auto batch_size = texts.size();
-  encodings->resize(batch_size);
+  std::vector<Encoding> batch_encodings(batch_size);
+  std::vector<Encoding> batch_pair_encodings(batch_size);
+  std::vector<uint8_t> has_pair(batch_size, 1);
   auto func = [&](size_t start_index, size_t step_index) {
-    MultiThreadEncodeBatchStrings(texts,
-                                  text_pairs,
-                                  encodings,
-                                  add_special_tokens,
-                                  start_index,
-                                  step_index);
+    size_t end_index = start_index + step_index;
+    if (end_index > batch_size) end_index = batch_size;
+    for (size_t i = start_index; i < end_index; ++i) {
+      EncodeSingleString(
+          texts[i], 0, OffsetType::CHAR, &batch_encodings[i], fields);
+      EncodeSingleString(
+          text_pairs[i], 1, OffsetType::CHAR, &batch_pair_encodings[i], fields);
+      Truncate(
+          &batch_encodings[i], &batch_pair_encodings[i], add_special_tokens);
+    }
   };
-  RunMultiThread(func, batch_size);
-
-  if (use_padding_) {
-    PadEncodings(encodings, pad_method_);
-  }
+  RunMultiThreadWithStats(func, batch_size);
+  PostProcessBatch(&batch_encodings,
+                   &batch_pair_encodings,
+                   has_pair,
+                   add_special_tokens,
+                   encodings);
 }
 
 void Tokenizer::EncodeSingleText(
     const std::vector<std::string>& pretokenized_texts,
     uint32_t type_id,
     OffsetType offset_type,
-    Encoding* encoding) const {
+    Encoding* encoding,
+    uint32_t fields) const {
   std::vector<Encoding> encodings;
   for (uint32_t i = 0; i < pretokenized_texts.size(); ++i) {
-    encodings.emplace_back(
-        EncodeTextToEncoding({i}, type_id, offset_type, pretokenized_texts[i]));
+    encodings.emplace_back(EncodeTextToEncoding(
+        {i}, type_id, offset_type, pretokenized_texts[i], fields));
   }
   *encoding = Encoding::Merge(encodings, false);
+  encoding->SetFields(fields);
 }
 
 void Tokenizer::EncodeSingleText(const std::string& raw_text,
                                  uint32_t type_id,
                                  OffsetType offset_type,
-                                 Encoding* encodings) const {
-  *encodings = EncodeTextToEncoding({}, type_id, offset_type, raw_text);
+                                 Encoding* encodings,
+                                 uint32_t fields) const {
+  *encodings = EncodeTextToEncoding({}, type_id, offset_type, raw_text, fields);
 }
 
 Encoding Tokenizer::EncodeTextToEncoding(const std::vector<uint32_t>& word_idx,
                                          uint32_t type_id,
                                          OffsetType offset_type,
-                                         const std::string& text) const {
+                                         const std::string& text,
+                                         uint32_t fields) const {
+  StatsCollector* stats = stats_.get();
   pretokenizers::PreTokenizedString pretokenized;
-  added_vocabulary_.ExtractAndNormalize(normalizer_.get(), text, &pretokenized);
-  DoPreTokenize(&pretokenized);
+  {
+    StageTimer timer(stats, EXTRACT_AND_NORMALIZE, text.length());
+    added_vocabulary_.ExtractAndNormalize(
+        normalizer_.get(), text, &pretokenized);
+  }
+  {
+    StageTimer timer(stats, PRE_TOKENIZE, text.length());
+    DoPreTokenize(&pretokenized);
+  }
   Encoding encoding;
-  DoTokenize(&pretokenized, type_id, word_idx, offset_type, &encoding);
+  {
+    StageTimer timer(stats, TOKENIZE, text.length());
+    DoTokenize(
+        &pretokenized, type_id, word_idx, offset_type, &encoding, fields);
+    timer.SetTokensOut(encoding.GetLen());
+  }
   return encoding;
 }
 
@@ -431,6 +603,8 @@ Tokenizer Tokenizer::LoadFromStr(const std::string& json_str) {
 void Tokenizer::Decode(const std::vector<uint32_t>& token_ids,
                        std::string* result,
                        bool skip_special_tokens) const {
+  StageTimer timer(stats_.get(), DECODE);
+  timer.SetTokensOut(token_ids.size());
   // Get tokens
   std::vector<std::string> tokens;
   std::string token;
@@ -477,7 +651,62 @@ void Tokenizer::DecodeBatch(
     MultiThreadDecodeBatch(
         batch_token_ids, results, skip_special_tokens, start_index, step_index);
   };
-  RunMultiThread(func, batch_size);
+  RunMultiThreadWithStats(func, batch_size);
+}
+
+void Tokenizer::RunMultiThreadWithStats(
+    std::function<void(size_t, size_t)> func, size_t batch_size) const {
+  if (stats_ == nullptr) {
+    RunMultiThread(func, batch_size);
+    return;
+  }
+  std::atomic<uint64_t> busy_ns(0);
+  auto timed_func = [&](size_t start_index, size_t step_index) {
+    auto start_ns = GetTimeNs();
+    func(start_index, step_index);
+    busy_ns.fetch_add(GetTimeNs() - start_ns, std::memory_order_relaxed);
+  };
+  auto start_ns = GetTimeNs();
+  RunMultiThread(timed_func, batch_size);
+  stats_->AddParallel(GetTimeNs() - start_ns, busy_ns.load(), GetThreadNum());
+}
+
+void Tokenizer::UpdateModelCacheStats() {
+  if (model_ != nullptr) {
+    model_->EnableCacheStats(stats_ != nullptr);
+  }
+}
+
+void Tokenizer::EnableStats(bool enable) {
+  if (enable) {
+    if (stats_ == nullptr) {
+      stats_ = std::make_shared<StatsCollector>();
+      UpdateModelCacheStats();
+    }
+  } else {
+    stats_ = nullptr;
+    UpdateModelCacheStats();
+  }
+}
+
+bool Tokenizer::GetEnableStats() const { return stats_ != nullptr; }
+
+TokenizerStats Tokenizer::GetStats() const {
+  if (stats_ == nullptr) {
+    return TokenizerStats();
+  }
+  auto stats = stats_->GetStats();
+  if (model_ != nullptr) {
+    model_->GetCacheStats(&stats.cache_hits_, &stats.cache_misses_);
+  }
+  return stats;
+}
+
+void Tokenizer::ResetStats() {
+  if (stats_ != nullptr) {
+    stats_->Reset();
+    UpdateModelCacheStats();
+  }
 }
 
 bool Tokenizer::GetUseTruncation() const { return use_truncation_; }
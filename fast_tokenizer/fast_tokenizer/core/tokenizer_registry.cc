@@ -0,0 +1,211 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#include "fast_tokenizer/core/tokenizer_registry.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+
+#include "fast_tokenizer/utils/flat_vocab.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace core {
+
+TokenizerRegistry::ModelKey TokenizerRegistry::GetModelKey(
+    const nlohmann::json& model_json) {
+  std::string dump = model_json.dump();
+  return {utils::FlatVocab::Hash(dump.data(), dump.size()),
+          std::hash<std::string>()(dump),
+          dump.size()};
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::Register(
+    const std::string& name, const Tokenizer& tokenizer) {
+  Tokenizer result = tokenizer;
+  ModelKey key = {0, 0, 0};
+  std::string type;
+  if (result.GetModelPtr() != nullptr) {
+    nlohmann::json j = result;
+    const auto& model_json = j.at("model");
+    if (!model_json.is_null()) {
+      key = GetModelKey(model_json);
+      type = model_json.at("type");
+    }
+  }
+  return AddTokenizer(name, &result, key, type);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::LoadFromFile(
+    const std::string& name, const std::string& json_path) {
+  std::ifstream fin(json_path);
+  if (!fin) {
+    throw std::runtime_error("Can't open the tokenizer file " + json_path);
+  }
+  nlohmann::json j;
+  fin >> j;
+  return LoadFromJson(name, &j);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::LoadFromStr(
+    const std::string& name, const std::string& json_str) {
+  auto j = nlohmann::json::parse(json_str);
+  return LoadFromJson(name, &j);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::LoadFromJson(
+    const std::string& name, nlohmann::json* j) {
+  Tokenizer tokenizer;
+  ModelKey key = {0, 0, 0};
+  std::string type;
+  auto model_iter = j->find("model");
+  if (model_iter != j->end() && !model_iter->is_null()) {
+    key = GetModelKey(*model_iter);
+    type = model_iter->at("type");
+    std::shared_ptr<models::Model> model;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      model = FindModel(key);
+    }
+    if (model != nullptr) {
+      // Skip building the model. It's set before the other components are
+      // deserialized since the added tokens are looked up in the model.
+      tokenizer.SetModelPtr(model);
+      *model_iter = nullptr;
+    }
+  }
+  j->get_to(tokenizer);
+  return AddTokenizer(name, &tokenizer, key, type);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::Get(
+    const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = tokenizers_.find(name);
+  if (iter == tokenizers_.end()) {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+bool TokenizerRegistry::Remove(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (tokenizers_.erase(name) == 0) {
+    return false;
+  }
+  ReleaseUnusedModels();
+  return true;
+}
+
+std::vector<std::string> TokenizerRegistry::GetNames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> names;
+  names.reserve(tokenizers_.size());
+  for (const auto& item : tokenizers_) {
+    names.push_back(item.first);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+size_t TokenizerRegistry::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tokenizers_.size();
+}
+
+RegistryMemoryUsage TokenizerRegistry::GetMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<const models::Model*, size_t> model_users;
+  for (const auto& item : tokenizers_) {
+    ++model_users[item.second->GetModelPtr()];
+  }
+  RegistryMemoryUsage usage;
+  for (const auto& item : models_) {
+    const auto& shared_model = item.second;
+    RegistryMemoryUsage::ModelUsage model_usage;
+    model_usage.type_ = shared_model.type_;
+    model_usage.hash_ = shared_model.key_.hash_;
+    model_usage.num_tokenizers_ = model_users[shared_model.model_.get()];
+    model_usage.memory_ = shared_model.model_->GetMemoryUsage();
+    size_t bytes = model_usage.memory_.GetTotalBytes();
+    usage.total_bytes_ += bytes;
+    if (model_usage.num_tokenizers_ > 1) {
+      usage.saved_bytes_ += (model_usage.num_tokenizers_ - 1) * bytes;
+    }
+    usage.models_.push_back(model_usage);
+  }
+  return usage;
+}
+
+std::shared_ptr<models::Model> TokenizerRegistry::FindModel(
+    const ModelKey& key) const {
+  auto range = models_.equal_range(key.hash_);
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    const auto& curr_key = iter->second.key_;
+    if (curr_key.check_ == key.check_ && curr_key.size_ == key.size_) {
+      return iter->second.model_;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<models::Model> TokenizerRegistry::AddModel(
+    const ModelKey& key,
+    const std::string& type,
+    const std::shared_ptr<models::Model>& model) {
+  auto shared_model = FindModel(key);
+  if (shared_model != nullptr) {
+    return shared_model;
+  }
+  models_.emplace(key.hash_, SharedModel{key, type, model});
+  return model;
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::AddTokenizer(
+    const std::string& name,
+    Tokenizer* tokenizer,
+    const ModelKey& key,
+    const std::string& type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The models that can't be serialized aren't shared.
+  if (key.size_ > 0) {
+    tokenizer->SetModelPtr(
+        AddModel(key, type, tokenizer->GetSharedModelPtr()));
+  }
+  auto result = std::make_shared<const Tokenizer>(std::move(*tokenizer));
+  tokenizers_[name] = result;
+  ReleaseUnusedModels();
+  return result;
+}
+
+void TokenizerRegistry::ReleaseUnusedModels() {
+  std::unordered_set<const models::Model*> used_models;
+  for (const auto& item : tokenizers_) {
+    used_models.insert(item.second->GetModelPtr());
+  }
+  for (auto iter = models_.begin(); iter != models_.end();) {
+    if (used_models.count(iter->second.model_.get()) == 0) {
+      iter = models_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,117 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fast_tokenizer/core/tokenizer.h"
+#include "fast_tokenizer/models/model.h"
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace core {
+
+// The memory of the models held by a TokenizerRegistry.
+struct FASTTOKENIZER_DECL RegistryMemoryUsage {
+  struct ModelUsage {
+    std::string type_;
+    // The hash of the serialized model
+    uint64_t hash_;
+    // The number of the registered tokenizers that share the model
+    size_t num_tokenizers_;
+    models::ModelMemoryUsage memory_;
+  };
+  std::vector<ModelUsage> models_;
+  // The bytes allocated by the models
+  size_t total_bytes_;
+  // The bytes that would be allocated by the duplicated models if they
+  // weren't shared.
+  size_t saved_bytes_;
+  RegistryMemoryUsage() : total_bytes_(0), saved_bytes_(0) {}
+};
+
+// A thread-safe collection of named tokenizers for serving many tokenizers in
+// one process. The models of the registered tokenizers are deduplicated by
+// their content, so the tokenizers of the same vocab share one model, i.e.
+// its vocab, trie and failure array. The other components, such as the
+// normalizer, the added tokens, the truncation and the padding, are owned by
+// each tokenizer. A model is built only once when the tokenizers are loaded
+// by LoadFromFile or LoadFromStr.
+class FASTTOKENIZER_DECL TokenizerRegistry {
+public:
+  // Register the tokenizer as `name`, the tokenizer that is registered as
+  // `name` already is replaced. Return the registered tokenizer.
+  std::shared_ptr<const Tokenizer> Register(const std::string& name,
+                                            const Tokenizer& tokenizer);
+  std::shared_ptr<const Tokenizer> LoadFromFile(const std::string& name,
+                                                const std::string& json_path);
+  std::shared_ptr<const Tokenizer> LoadFromStr(const std::string& name,
+                                               const std::string& json_str);
+  // Return nullptr if there is no tokenizer named `name`.
+  std::shared_ptr<const Tokenizer> Get(const std::string& name) const;
+  bool Remove(const std::string& name);
+  std::vector<std::string> GetNames() const;
+  size_t Size() const;
+  RegistryMemoryUsage GetMemoryUsage() const;
+
+private:
+  // A model is identified by the two hashes and the length of its serialized
+  // json.
+  struct ModelKey {
+    uint64_t hash_;
+    uint64_t check_;
+    size_t size_;
+  };
+  struct SharedModel {
+    ModelKey key_;
+    std::string type_;
+    std::shared_ptr<models::Model> model_;
+  };
+  static ModelKey GetModelKey(const nlohmann::json& model_json);
+  std::shared_ptr<const Tokenizer> LoadFromJson(const std::string& name,
+                                                nlohmann::json* j);
+  // Share the model of the tokenizer and register it.
+  std::shared_ptr<const Tokenizer> AddTokenizer(const std::string& name,
+                                                Tokenizer* tokenizer,
+                                                const ModelKey& key,
+                                                const std::string& type);
+  // The methods below are called with mutex_ held.
+  // Return nullptr if there is no model of the key.
+  std::shared_ptr<models::Model> FindModel(const ModelKey& key) const;
+  // Return the model of the key if there is one already, otherwise add the
+  // model and return it.
+  std::shared_ptr<models::Model> AddModel(
+      const ModelKey& key,
+      const std::string& type,
+      const std::shared_ptr<models::Model>& model);
+  // Release the models that aren't used by the registered tokenizers.
+  void ReleaseUnusedModels();
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const Tokenizer>>
+      tokenizers_;
+  // Indexed by ModelKey::hash_
+  std::unordered_multimap<uint64_t, SharedModel> models_;
+};
+
+}  // namespace core
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
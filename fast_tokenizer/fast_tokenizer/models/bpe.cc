@@ -20,6 +20,7 @@ limitations under the License. */
 
 #include "glog/logging.h"
 #include "fast_tokenizer/models/bpe.h"
+#include "fast_tokenizer/utils/mapped_file.h"
 #include "fast_tokenizer/utils/path.h"
 #include "fast_tokenizer/utils/utf8.h"
 
@@ -37,11 +38,7 @@ void BPE::Init(const core::Merges& merges) {
       throw std::runtime_error(oss.str());
     }
   }
-  // construct vocab_r
-  for (auto&& item : vocab_) {
-    vocab_reversed_[item.second] = item.first;
-  }
-  int prefix_len = 0;
+  size_t prefix_len = 0;
   if (continuing_subword_prefix_.size() > 0) {
     prefix_len += continuing_subword_prefix_[0].length();
   }
@@ -49,33 +46,71 @@ void BPE::Init(const core::Merges& merges) {
   // construct merge_map
   for (int i = 0; i < merges.size(); i++) {
     auto&& merge = merges[i];
-    try {
-      auto a_id = vocab_.at(merge.first);
-      auto b_id = vocab_.at(merge.second);
-      auto new_token = merge.first + merge.second.substr(prefix_len);
-      auto new_id = vocab_.at(new_token);
-      merges_.insert({core::Pair(a_id, b_id), {i, new_id}});
-    } catch (...) {
+    uint32_t a_id, b_id, new_id;
+    if (!vocab_.Find(merge.first, &a_id) ||
+        !vocab_.Find(merge.second, &b_id) ||
+        merge.second.length() < prefix_len ||
+        !vocab_.Find(merge.first + merge.second.substr(prefix_len), &new_id)) {
       std::ostringstream oss;
       oss << "Can't merge token out of the vocabulary";
       throw std::runtime_error(oss.str());
     }
+    merges_.insert({core::Pair(a_id, b_id), {i, new_id}});
   }
 
   // construct unk
   if (unk_token_.size() > 0) {
-    try {
-      unk_token_id_.emplace_back(vocab_.at(unk_token_.front()));
-    } catch (...) {
+    uint32_t unk_id;
+    if (!vocab_.Find(unk_token_.front(), &unk_id)) {
       std::ostringstream oss;
       oss << "Unk token `" << unk_token_.front()
           << "` not found in the vocabulary";
       throw std::runtime_error(oss.str());
     }
+    unk_token_id_.emplace_back(unk_id);
+  }
+  if (byte_level_) {
+    InitByteIds();
+  }
+}
+
+void BPE::InitByteIds() {
+  auto bytes_to_chars = utils::CreateBytesToChars();
+  byte_ids_.assign(256 * 4, kNoByteId);
+  for (uint32_t byte = 0; byte < 256; ++byte) {
+    char chr[4];
+    auto chr_len = utils::UnicodeToUTF8Char(
+        utils::UnicodeToUTF8(bytes_to_chars.at(byte)), chr);
+    for (uint32_t is_first = 0; is_first < 2; ++is_first) {
+      for (uint32_t is_last = 0; is_last < 2; ++is_last) {
+        std::string curr_str(chr, chr_len);
+        if (!is_first && continuing_subword_prefix_.size() > 0) {
+          curr_str = continuing_subword_prefix_.front() + curr_str;
+        }
+        if (is_last && end_of_word_suffix_.size() > 0) {
+          curr_str = curr_str + end_of_word_suffix_.front();
+        }
+        uint32_t id;
+        if (vocab_.Find(curr_str, &id)) {
+          byte_ids_[byte * 4 + is_first * 2 + is_last] = id;
+        }
+      }
+    }
   }
 }
 
-BPE::BPE() : fuse_unk_(false), cache_(utils::DEFAULT_CACHE_CAPACITY) {}
+bool BPE::FindByteId(uint8_t byte,
+                     bool is_first,
+                     bool is_last,
+                     uint32_t* id) const {
+  *id = byte_ids_[byte * 4 + is_first * 2 + is_last];
+  return *id != kNoByteId;
+}
+
+BPE::BPE()
+    : cache_(utils::DEFAULT_CACHE_CAPACITY),
+      fuse_unk_(false),
+      byte_level_(false) {}
 
 BPE::BPE(const core::Vocab& vocab,
          const core::Merges& merges,
@@ -84,24 +119,53 @@ BPE::BPE(const core::Vocab& vocab,
          const std::vector<std::string>& unk_token,
          const std::vector<std::string>& continuing_subword_prefix,
          const std::vector<std::string>& end_of_word_suffix,
-         bool fuse_unk)
+         bool fuse_unk,
+         bool byte_level)
     : vocab_(vocab),
-      fuse_unk_(fuse_unk),
+      cache_(utils::DEFAULT_CACHE_CAPACITY),
       dropout_(dropout),
       unk_token_(unk_token),
       continuing_subword_prefix_(continuing_subword_prefix),
       end_of_word_suffix_(end_of_word_suffix),
-      cache_(utils::DEFAULT_CACHE_CAPACITY) {
+      fuse_unk_(fuse_unk),
+      byte_level_(byte_level) {
   Init(merges);
 }
 
 void BPE::ClearCache() { cache_.Clear(); }
 
+bool BPE::EnableCacheStats(bool enable) {
+  cache_.EnableStats(enable);
+  return true;
+}
+
+bool BPE::GetCacheStats(uint64_t* hits, uint64_t* misses) const {
+  cache_.GetStats(hits, misses);
+  return true;
+}
+
+ModelMemoryUsage BPE::GetMemoryUsage() const {
+  ModelMemoryUsage usage;
+  usage.vocab_bytes_ = vocab_.GetMemoryUsage();
+  usage.index_bytes_ =
+      byte_ids_.capacity() * sizeof(uint32_t) +
+      merges_.bucket_count() * sizeof(void*) +
+      merges_.size() *
+          (sizeof(core::MergeMap::value_type) + 2 * sizeof(void*));
+  return usage;
+}
+
 core::Vocab BPE::GetVocabFromFile(const std::string& vocab_json_path) {
-  std::ifstream fin(vocab_json_path);
+  utils::MappedFile mapped_file(vocab_json_path);
+  if (!mapped_file.IsValid()) {
+    throw std::runtime_error("The vocab file " + vocab_json_path +
+                             " doesn't exist or can't be accessed.");
+  }
   core::Vocab vocab;
-  nlohmann::json j;
-  fin >> j;
+  // Parse from the mapped buffer directly instead of an ifstream.
+  auto j = nlohmann::json::parse(mapped_file.Data(),
+                                 mapped_file.Data() + mapped_file.Size());
+  vocab.reserve(j.size());
   for (nlohmann::json::iterator it = j.begin(); it != j.end(); ++it) {
     vocab[it.key()] = it.value();
   }
@@ -110,26 +174,76 @@ core::Vocab BPE::GetVocabFromFile(const std::string& vocab_json_path) {
 
 void BPE::ConstructMergesPair(const std::string word_line,
                               std::pair<std::string, std::string>* result) {
-  auto pair_a_begin = word_line.find_first_not_of(WHITESPACE);
-  auto pair_a_end = word_line.find_first_of(WHITESPACE, pair_a_begin);
-  auto pair_b_begin = word_line.find_first_not_of(WHITESPACE, pair_a_end);
-  auto pair_b_end = word_line.find_first_of(WHITESPACE, pair_b_begin);
-  *result = {word_line.substr(pair_a_begin, pair_a_end - pair_a_begin),
-             word_line.substr(pair_b_begin, pair_b_end - pair_b_begin)};
+  if (!ConstructMergesPair(word_line.data(), word_line.length(), result)) {
+    throw std::runtime_error("The merge \"" + word_line +
+                             "\" is not a pair of tokens.");
+  }
+}
+
+bool BPE::ConstructMergesPair(const char* line,
+                              size_t len,
+                              std::pair<std::string, std::string>* result) {
+  auto is_whitespace = [](char ch) {
+    return WHITESPACE.find(ch) != std::string::npos;
+  };
+  const char* end = line + len;
+  const char* pair_a_begin = line;
+  while (pair_a_begin < end && is_whitespace(*pair_a_begin)) {
+    ++pair_a_begin;
+  }
+  const char* pair_a_end = pair_a_begin;
+  while (pair_a_end < end && !is_whitespace(*pair_a_end)) {
+    ++pair_a_end;
+  }
+  const char* pair_b_begin = pair_a_end;
+  while (pair_b_begin < end && is_whitespace(*pair_b_begin)) {
+    ++pair_b_begin;
+  }
+  const char* pair_b_end = pair_b_begin;
+  while (pair_b_end < end && !is_whitespace(*pair_b_end)) {
+    ++pair_b_end;
+  }
+  if (pair_a_begin == pair_a_end || pair_b_begin == pair_b_end) {
+    return false;
+  }
+  result->first.assign(pair_a_begin, pair_a_end - pair_a_begin);
+  result->second.assign(pair_b_begin, pair_b_end - pair_b_begin);
+  return true;
 }
 
 core::Merges BPE::GetMergesFromFile(const std::string& merge_path) {
-  std::ifstream fin(merge_path);
+  utils::MappedFile mapped_file(merge_path);
   core::Merges merges;
-  std::string word_str;
-  while (std::getline(fin, word_str)) {
-    if (word_str.find("#version") == 0) {
-      continue;
-    }
-    std::pair<std::string, std::string> result;
-    ConstructMergesPair(word_str, &result);
-    merges.emplace_back(result);
+  if (!mapped_file.IsValid()) {
+    return merges;
   }
+  merges.reserve(utils::CountLines(mapped_file.Data(), mapped_file.Size()));
+  size_t line_no = 0;
+  utils::ForEachLine(
+      mapped_file.Data(),
+      mapped_file.Size(),
+      [&](const char* line, size_t len) {
+        ++line_no;
+        static const char VERSION_PREFIX[] = "#version";
+        constexpr size_t VERSION_PREFIX_LEN = sizeof(VERSION_PREFIX) - 1;
+        if (len >= VERSION_PREFIX_LEN &&
+            std::memcmp(line, VERSION_PREFIX, VERSION_PREFIX_LEN) == 0) {
+          return;
+        }
+        // Skip the blank lines
+        if (std::all_of(line, line + len, [](char ch) {
+              return WHITESPACE.find(ch) != std::string::npos;
+            })) {
+          return;
+        }
+        std::pair<std::string, std::string> result;
+        if (!ConstructMergesPair(line, len, &result)) {
+          throw std::runtime_error("The line " + std::to_string(line_no) +
+                                   " of the merges file " + merge_path +
+                                   " is not a pair of tokens.");
+        }
+        merges.emplace_back(std::move(result));
+      });
   return merges;
 }
 
@@ -146,32 +260,41 @@ void BPE::MergeWord(const std::string& word, core::BPEWord* bpe_word) {
   bpe_word->Reserve(word.length());
   uint32_t start = 0;
   while (start < word.length()) {
-    uint32_t content_char;
-    uint32_t content_char_width =
-        utils::UTF8ToUInt32(word.data() + start, &content_char);
-    content_char = utils::UTF8ToUnicode(content_char);
-    uint32_t end = start + content_char_width;
+    uint32_t id;
+    bool found;
+    uint32_t content_char_width;
     bool is_first = (start == 0);
-    bool is_last = (end >= word.length());
-    std::string curr_str = word.substr(start, content_char_width);
-    // Add the `continuing_subword_prefix` if relevant
-    if (!is_first) {
-      if (continuing_subword_prefix_.size() > 0) {
-        curr_str = continuing_subword_prefix_.front() + curr_str;
+    if (byte_level_) {
+      // Every byte is a symbol, no need to build the string of the symbol.
+      content_char_width = 1;
+      found = FindByteId(
+          word[start], is_first, start + 1 >= word.length(), &id);
+    } else {
+      uint32_t content_char;
+      content_char_width =
+          utils::UTF8ToUInt32(word.data() + start, &content_char);
+      bool is_last = (start + content_char_width >= word.length());
+      std::string curr_str = word.substr(start, content_char_width);
+      // Add the `continuing_subword_prefix` if relevant
+      if (!is_first) {
+        if (continuing_subword_prefix_.size() > 0) {
+          curr_str = continuing_subword_prefix_.front() + curr_str;
+        }
       }
-    }
-    // Add the `end_of_word_suffix` if relevant
-    if (is_last) {
-      if (end_of_word_suffix_.size() > 0) {
-        curr_str = curr_str + end_of_word_suffix_.front();
+      // Add the `end_of_word_suffix` if relevant
+      if (is_last) {
+        if (end_of_word_suffix_.size() > 0) {
+          curr_str = curr_str + end_of_word_suffix_.front();
+        }
       }
+      found = vocab_.Find(curr_str, &id);
     }
-    if (vocab_.find(curr_str) != vocab_.end()) {
+    uint32_t end = start + content_char_width;
+    if (found) {
       if (unk.size() > 0) {
         bpe_word->Add(unk.front().first, unk.front().second);
         unk.clear();
       }
-      auto id = vocab_.at(curr_str);
       bpe_word->Add(id, content_char_width);
     } else {
       if (unk_token_id_.size() > 0) {
@@ -205,8 +328,11 @@ void BPE::WordToTokens(const core::BPEWord& bpe_word,
   bpe_word.GetOffset(&offsets);
 
   tokens->reserve(offsets.size());
+  std::string token;
   for (int i = 0; i < offsets.size(); ++i) {
-    tokens->emplace_back(chars[i], vocab_reversed_[chars[i]], offsets[i]);
+    token.clear();
+    vocab_.FindToken(chars[i], &token);
+    tokens->emplace_back(chars[i], token, offsets[i]);
   }
 }
 
@@ -238,24 +364,34 @@ std::vector<core::Token> BPE::Tokenize(const std::string& sequence) {
 }
 
 bool BPE::TokenToId(const std::string& token, uint32_t* id) const {
-  if (vocab_.find(token) == vocab_.end()) {
-    return false;
-  }
-  *id = vocab_.at(token);
-  return true;
+  return vocab_.Find(token, id);
 }
 
 bool BPE::IdToToken(uint32_t id, std::string* token) const {
-  if (vocab_reversed_.find(id) == vocab_reversed_.end()) {
-    return false;
-  }
-  *token = vocab_reversed_.at(id);
-  return true;
+  return vocab_.FindToken(id, token);
 }
 
-core::Vocab BPE::GetVocab() const { return vocab_; }
+core::Vocab BPE::GetVocab() const { return vocab_.ToMap(); }
+
+size_t BPE::GetVocabSize() const { return vocab_.Size(); }
 
-size_t BPE::GetVocabSize() const { return vocab_.size(); }
+static core::SortedVocabReversed GetSortedVocabReversed(
+    const utils::FlatVocab& vocab) {
+  core::SortedVocabReversed sorted_vocab_r;
+  vocab.ForEach([&sorted_vocab_r](const char* token, size_t len, uint32_t id) {
+    sorted_vocab_r.emplace(id, std::string(token, len));
+  });
+  return sorted_vocab_r;
+}
+
+static std::string GetToken(const utils::FlatVocab& vocab, uint32_t id) {
+  std::string token;
+  if (!vocab.FindToken(id, &token)) {
+    throw std::runtime_error("The id " + std::to_string(id) +
+                             " is not in the vocabulary");
+  }
+  return token;
+}
 
 // Return the saved voacb path and merges.txt
 std::vector<std::string> BPE::Save(const std::string& folder,
@@ -268,9 +404,7 @@ std::vector<std::string> BPE::Save(const std::string& folder,
     vocab_path = utils::PathJoin({folder, filename_prefix, "-vocab.json"});
   }
   VLOG(6) << "Vocab path" << vocab_path;
-  core::SortedVocabReversed sorted_vocab_r(vocab_reversed_.begin(),
-                                           vocab_reversed_.end());
-  nlohmann::json j = sorted_vocab_r;
+  nlohmann::json j = GetSortedVocabReversed(vocab_);
   std::ofstream fout(vocab_path);
   fout << j.dump();
   fout.close();
@@ -286,8 +420,8 @@ std::vector<std::string> BPE::Save(const std::string& folder,
   std::ofstream merge_fout(merges_path);
   merge_fout << "#version: 0.2\n";
   for (auto&& merge : merges_) {
-    merge_fout << vocab_reversed_.at(merge.first.first) << " "
-               << vocab_reversed_.at(merge.first.second) << "\n";
+    merge_fout << GetToken(vocab_, merge.first.first) << " "
+               << GetToken(vocab_, merge.first.second) << "\n";
   }
   merge_fout.close();
   return {vocab_path, merges_path};
@@ -306,31 +440,38 @@ void to_json(nlohmann::json& j, const BPE& model) {
             });
   std::vector<std::string> merge_strs;
   for (auto& merge : merges) {
-    std::string s = model.vocab_reversed_.at(merge.first.first) + " " +
-                    model.vocab_reversed_.at(merge.first.second);
+    std::string s = GetToken(model.vocab_, merge.first.first) + " " +
+                    GetToken(model.vocab_, merge.first.second);
     merge_strs.push_back(s);
   }
 
-  core::SortedVocabReversed sorted_vocab_r(model.vocab_reversed_.begin(),
-                                           model.vocab_reversed_.end());
+  // The std::map isn't serialized as an object by default, so the vocab is
+  // converted explicitly.
+  nlohmann::json vocab;
+  core::to_json(vocab, GetSortedVocabReversed(model.vocab_));
 
   j = {{"type", "BPE"},
        {"unk_token", model.unk_token_},
        {"continuing_subword_prefix", model.continuing_subword_prefix_},
        {"end_of_word_suffix", model.end_of_word_suffix_},
        {"fuse_unk", model.fuse_unk_},
+       {"byte_level", model.byte_level_},
        {"dropout", model.dropout_},
-       {"vocab", sorted_vocab_r},
+       {"vocab", vocab},
        {"merges", merge_strs}};
 }
 
 void from_json(const nlohmann::json& j, BPE& model) {
-  j["vocab"].get_to(model.vocab_);
+  model.vocab_ = utils::FlatVocab(j["vocab"].get<core::Vocab>());
   j["unk_token"].get_to(model.unk_token_);
   j["continuing_subword_prefix"].get_to(model.continuing_subword_prefix_);
   j["end_of_word_suffix"].get_to(model.end_of_word_suffix_);
   j["fuse_unk"].get_to(model.fuse_unk_);
   j["dropout"].get_to(model.dropout_);
+  model.byte_level_ = false;
+  if (j.find("byte_level") != j.end()) {
+    j["byte_level"].get_to(model.byte_level_);
+  }
 
   std::vector<std::string> merge_strs;
   j["merges"].get_to(merge_strs);
@@ -17,6 +17,7 @@ limitations under the License. */
 #include "fast_tokenizer/models/model.h"
 #include "nlohmann/json.hpp"
 #include "fast_tokenizer/utils/cache.h"
+#include "fast_tokenizer/utils/flat_vocab.h"
 #include "fast_tokenizer/utils/utils.h"
 
 namespace paddlenlp {
@@ -32,7 +33,8 @@ struct FASTTOKENIZER_DECL BPE : public Model {
       const std::vector<std::string>& unk_token = {},
       const std::vector<std::string>& continuing_subword_prefix = {},
       const std::vector<std::string>& end_of_word_suffix = {},
-      bool fuse_unk = false);
+      bool fuse_unk = false,
+      bool byte_level = false);
   virtual std::vector<core::Token> Tokenize(
       const std::string& sequence) override;
   virtual bool TokenToId(const std::string& token, uint32_t* id) const override;
@@ -43,8 +45,17 @@ struct FASTTOKENIZER_DECL BPE : public Model {
   virtual std::vector<std::string> Save(
       const std::string& folder,
       const std::string& filename_prefix) const override;
+  virtual bool EnableCacheStats(bool enable) override;
+  virtual bool GetCacheStats(uint64_t* hits, uint64_t* misses) const override;
+  virtual ModelMemoryUsage GetMemoryUsage() const override;
 
   void ClearCache();
+  // In byte level mode, the model tokenizes the raw bytes of the sequences
+  // instead of the chars that the bytes are mapped to by the
+  // ByteLevelPreTokenizer, which should be created with remap_bytes = false.
+  // The vocab and the merges still use the mapped chars, so the tokens and
+  // the files of the model are the same in both modes.
+  bool GetByteLevel() const { return byte_level_; }
   static core::Vocab GetVocabFromFile(const std::string& vocab_json_path);
   static core::Merges GetMergesFromFile(const std::string& merge_path);
   static void GetVocabAndMergesFromFile(const std::string& vocab_json_path,
@@ -53,16 +64,23 @@ struct FASTTOKENIZER_DECL BPE : public Model {
                                         core::Merges* merges);
   static void ConstructMergesPair(const std::string word_line,
                                   std::pair<std::string, std::string>* result);
+  // Split the line into a pair of tokens without copying the line. Return
+  // false if the line doesn't contain two tokens.
+  static bool ConstructMergesPair(const char* line,
+                                  size_t len,
+                                  std::pair<std::string, std::string>* result);
 
 private:
   void Init(const core::Merges& merges);
+  // Look up the id of every byte at every position of a word.
+  void InitByteIds();
+  bool FindByteId(uint8_t byte, bool is_first, bool is_last, uint32_t* id) const;
   void MergeWord(const std::string& word, core::BPEWord* bpe_word);
   void WordToTokens(const core::BPEWord& bpe_word,
                     std::vector<core::Token>* tokens);
   void TokenizeWithCache(const std::string& sequence,
                          std::vector<core::Token>* tokens);
-  core::Vocab vocab_;
-  core::VocabReversed vocab_reversed_;
+  utils::FlatVocab vocab_;
   core::MergeMap merges_;
 
   // The following vector may contain 0 or 1 element
@@ -73,6 +91,11 @@ private:
   std::vector<std::string> continuing_subword_prefix_;
   std::vector<std::string> end_of_word_suffix_;
   bool fuse_unk_;
+  bool byte_level_;
+  // Indexed by byte * 4 + is_first * 2 + is_last, kNoByteId if the byte
+  // isn't in the vocab.
+  std::vector<uint32_t> byte_ids_;
+  static constexpr uint32_t kNoByteId = 0xffffffff;
   friend void to_json(nlohmann::json& j, const BPE& model);
   friend void from_json(const nlohmann::json& j, BPE& model);
 };
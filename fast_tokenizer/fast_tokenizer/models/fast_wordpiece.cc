@@ -35,14 +35,16 @@ namespace models {
 const std::string WHITESPACE = " \n\r\t\f\v";
 
 void FastWordPiece::InitFailureAndTrie() {
-  unk_token_id_ = vocab_.at(unk_token_);
-  trie_.SetWithPretokenization(with_pretokenization_);
-  trie_.SetUNKToken(unk_token_);
-  trie_.SetContinuingSubwordPrefix(continuing_subword_prefix_);
+  // Called after Init(). The trie of WordPiece is only needed to tokenize
+  // the continuing subword prefix, so it's released once that's done.
+  fast_trie_.SetWithPretokenization(with_pretokenization_);
+  fast_trie_.SetUNKToken(unk_token_);
+  fast_trie_.SetContinuingSubwordPrefix(continuing_subword_prefix_);
   failure_array_.SetWithPretokenization(with_pretokenization_);
   failure_array_.InitFromVocabAndTrie(
-      vocab_, &trie_, unk_token_, continuing_subword_prefix_);
+      vocab_.ToMap(), &fast_trie_, unk_token_, continuing_subword_prefix_);
   PrecomputeEncodeValueForSubwordPrefix();
+  trie_ = nullptr;
 }
 
 FastWordPiece::FastWordPiece()
@@ -57,12 +59,21 @@ FastWordPiece::FastWordPiece(const core::Vocab& vocab,
                 unk_token,
                 max_input_chars_per_word,
                 continuing_subword_prefix),
-      trie_(continuing_subword_prefix, unk_token, with_pretokenization),
+      fast_trie_(continuing_subword_prefix, unk_token, with_pretokenization),
       with_pretokenization_(with_pretokenization),
       failure_array_(with_pretokenization) {
   InitFailureAndTrie();
 }
 
+ModelMemoryUsage FastWordPiece::GetMemoryUsage() const {
+  auto usage = WordPiece::GetMemoryUsage();
+  usage.index_bytes_ += fast_trie_.GetMemoryUsage() +
+                        failure_array_.GetMemoryUsage() +
+                        encoded_value_for_subword_prefix_.capacity() *
+                            sizeof(int);
+  return usage;
+}
+
 void FastWordPiece::PrecomputeEncodeValueForSubwordPrefix() {
   auto subword_prefix_tokens = WordPiece::Tokenize(continuing_subword_prefix_);
   encoded_value_for_subword_prefix_.reserve(subword_prefix_tokens.size());
@@ -85,13 +96,13 @@ bool FastWordPiece::TryFollowFailureLinkAndCollectTokens(
     utils::Trie::TraversalCursor* node,
     std::vector<core::Token>* tokens) const {
   int curr_node_value = 0;
-  if (trie_.TryGetData(*node, &curr_node_value)) {
+  if (fast_trie_.TryGetData(*node, &curr_node_value)) {
     AppendTokensToOutput(sequence,
                          sequence_offset_in_text,
                          curr_offset_in_sequence,
                          curr_node_value,
                          tokens);
-    trie_.SetTraversalCursor(
+    fast_trie_.SetTraversalCursor(
         node, failure_array_.GetFailure(node->node_id_)->failure_link_);
     return true;
   }
@@ -111,7 +122,7 @@ bool FastWordPiece::TryFollowFailureLinkAndCollectTokens(
                          failure_array_.GetFailurePop(i),
                          tokens);
   }
-  trie_.SetTraversalCursor(node, node_aux->failure_link_);
+  fast_trie_.SetTraversalCursor(node, node_aux->failure_link_);
   return true;
 }
 
@@ -169,7 +180,7 @@ bool FastWordPiece::TryHandleContinuingSubWordPrefix(
     int* original_num_tokens,
     int* curr_offset_in_sequence,
     std::vector<core::Token>* tokens) const {
-  if (curr_node.node_id_ != trie_.GetSuffixRoot()) {
+  if (curr_node.node_id_ != fast_trie_.GetSuffixRoot()) {
     return false;
   }
   int cur_num_tokens = tokens->size();
@@ -212,8 +223,8 @@ void FastWordPiece::HandleTheRemainingStringOnTriePath(
     *original_num_tokens = tokens->size();
     return;
   }
-  while (curr_node->node_id_ != trie_.GetSuffixRoot() &&
-         curr_node->node_id_ != trie_.GetPuncFailureNode()) {
+  while (curr_node->node_id_ != fast_trie_.GetSuffixRoot() &&
+         curr_node->node_id_ != fast_trie_.GetPuncFailureNode()) {
     if (!TryFollowFailureLinkAndCollectTokens(sequence,
                                               sequence_offset_in_text,
                                               curr_offset_in_sequence,
@@ -266,9 +277,9 @@ std::vector<core::Token> FastWordPiece::TokenizeWithoutPreTokenize(
     ResetOutputAppendUNK(0, sequence.size(), &original_num_tokens, &all_tokens);
   } else {
     int curr_offset_in_sequence = 0;
-    auto curr_node = trie_.CreateRootTraversalCursor();
+    auto curr_node = fast_trie_.CreateRootTraversalCursor();
     for (auto ch : sequence) {
-      while (!trie_.TryTraverseOneStep(&curr_node, ch)) {
+      while (!fast_trie_.TryTraverseOneStep(&curr_node, ch)) {
         if (!TryFollowFailureLinkAndCollectTokens(sequence,
                                                   0,
                                                   &curr_offset_in_sequence,
@@ -311,7 +322,7 @@ std::vector<core::Token> FastWordPiece::TokenizeWithPreTokenize(
   auto seq_len = sequence.length();
   while (curr_idx < seq_len) {
     int curr_offset_in_word = 0;
-    auto curr_node = trie_.CreateRootTraversalCursor();
+    auto curr_node = fast_trie_.CreateRootTraversalCursor();
     int bytes_length = 0;
     int word_offset_in_sequence = curr_idx;
     std::string sequence_substr = sequence.substr(curr_idx);
@@ -325,7 +336,7 @@ std::vector<core::Token> FastWordPiece::TokenizeWithPreTokenize(
         break;
       }
       std::string curr_substr = sequence.substr(curr_idx, chwidth);
-      while (!trie_.TryTraverseSeveralSteps(&curr_node, curr_substr)) {
+      while (!fast_trie_.TryTraverseSeveralSteps(&curr_node, curr_substr)) {
         if (!TryFollowFailureLinkAndCollectTokens(sequence_substr,
                                                   word_offset_in_sequence,
                                                   &curr_offset_in_word,
@@ -394,7 +405,7 @@ std::vector<core::Token> FastWordPiece::Tokenize(
 void to_json(nlohmann::json& j, const FastWordPiece& model) {
   j = {
       {"type", "FastWordPiece"},
-      {"vocab", model.vocab_},
+      {"vocab", model.vocab_.ToMap()},
       {"unk_token", model.unk_token_},
       {"max_input_chars_per_word", model.max_input_chars_per_word_},
       {"continuing_subword_prefix", model.continuing_subword_prefix_},
@@ -403,11 +414,12 @@ void to_json(nlohmann::json& j, const FastWordPiece& model) {
 }
 
 void from_json(const nlohmann::json& j, FastWordPiece& model) {
-  j["vocab"].get_to(model.vocab_);
+  model.vocab_ = utils::FlatVocab(j["vocab"].get<core::Vocab>());
   j["unk_token"].get_to(model.unk_token_);
   j["max_input_chars_per_word"].get_to(model.max_input_chars_per_word_);
   j["continuing_subword_prefix"].get_to(model.continuing_subword_prefix_);
   j["with_pretokenization"].get_to(model.with_pretokenization_);
+  model.Init();
   model.InitFailureAndTrie();
 }
 
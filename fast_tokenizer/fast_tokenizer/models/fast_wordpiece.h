@@ -36,6 +36,7 @@ struct FASTTOKENIZER_DECL FastWordPiece : public WordPiece {
 
   virtual std::vector<core::Token> Tokenize(
       const std::string& sequence) override;
+  virtual ModelMemoryUsage GetMemoryUsage() const override;
 
 private:
   void InitFailureAndTrie();
@@ -76,7 +77,7 @@ private:
   int SkipRemainingOfWordAndTrailingWhiteSpaces(const std::string& sequence,
                                                 int* curr_idx) const;
   void PrecomputeEncodeValueForSubwordPrefix();
-  utils::Trie trie_;
+  utils::Trie fast_trie_;
   utils::FailureArray failure_array_;
   std::vector<int> encoded_value_for_subword_prefix_;
   friend void to_json(nlohmann::json& j, const FastWordPiece& model);
@@ -23,6 +23,16 @@ namespace paddlenlp {
 namespace fast_tokenizer {
 namespace models {
 
+// The bytes allocated by a model, excluding its cache.
+struct FASTTOKENIZER_DECL ModelMemoryUsage {
+  // The tokens and ids of the vocab
+  size_t vocab_bytes_;
+  // The tries, failure arrays and merges that are built from the vocab
+  size_t index_bytes_;
+  ModelMemoryUsage() : vocab_bytes_(0), index_bytes_(0) {}
+  size_t GetTotalBytes() const { return vocab_bytes_ + index_bytes_; }
+};
+
 struct FASTTOKENIZER_DECL Model {
   virtual std::vector<core::Token> Tokenize(const std::string& tokens) = 0;
   virtual bool TokenToId(const std::string& token, uint32_t* id) const = 0;
@@ -32,6 +42,13 @@ struct FASTTOKENIZER_DECL Model {
   // Return the saved voacb path
   virtual std::vector<std::string> Save(
       const std::string& folder, const std::string& filename_prefix) const = 0;
+  // Collect the hit statistics of the cache of the model. Return false if the
+  // model doesn't have a cache.
+  virtual bool EnableCacheStats(bool enable) { return false; }
+  virtual bool GetCacheStats(uint64_t* hits, uint64_t* misses) const {
+    return false;
+  }
+  virtual ModelMemoryUsage GetMemoryUsage() const { return ModelMemoryUsage(); }
 };
 
 }  // namespace model
@@ -65,10 +65,12 @@ void Unigram::Init(const core::VocabList& vocab,
 
   std::vector<const char*> keys;
   std::vector<int> values;
+  token_to_ids_.Clear();
+  token_to_ids_.Reserve(n);
   // id = 0 is unk_id_
   for (size_t id = 0; id < n; ++id) {
     size_t actual_id = id;
-    token_to_ids_.insert({vocab[id].first, actual_id});
+    token_to_ids_.Insert(vocab[id].first, actual_id);
     keys.push_back(vocab[id].first.c_str());
     values.push_back(actual_id);
     if (vocab[id].second < min_score_) {
@@ -113,11 +115,7 @@ void Unigram::Init(const core::VocabList& vocab,
 float Unigram::GetVocabScore(uint32_t id) const { return vocab_.at(id).second; }
 
 bool Unigram::TokenToId(const std::string& token, uint32_t* id) const {
-  if (token_to_ids_.find(token) == token_to_ids_.end()) {
-    return false;
-  }
-  *id = token_to_ids_.at(token);
-  return true;
+  return token_to_ids_.Find(token, id);
 }
 
 bool Unigram::IdToToken(uint32_t id, std::string* token) const {
@@ -128,7 +126,7 @@ bool Unigram::IdToToken(uint32_t id, std::string* token) const {
   return true;
 }
 
-core::Vocab Unigram::GetVocab() const { return token_to_ids_; }
+core::Vocab Unigram::GetVocab() const { return token_to_ids_.ToMap(); }
 
 size_t Unigram::GetVocabSize() const { return vocab_.size(); }
 
@@ -140,9 +138,7 @@ std::vector<core::Token> Unigram::Tokenize(const std::string& sequence) {
   tokens.reserve(encode_result.size());
   auto UpdateTokens = [&](const std::string& str) {
     uint32_t id = 0;
-    if (token_to_ids_.find(str) != token_to_ids_.end()) {
-      id = token_to_ids_.at(str);
-    } else {
+    if (!token_to_ids_.Find(str, &id)) {
       if (unk_id_.size() > 0) {
         id = unk_id_[0];
       }
@@ -201,6 +197,29 @@ std::vector<std::string> Unigram::Save(
   return {vocab_path};
 }
 
+bool Unigram::EnableCacheStats(bool enable) {
+  cache_.EnableStats(enable);
+  return true;
+}
+
+bool Unigram::GetCacheStats(uint64_t* hits, uint64_t* misses) const {
+  cache_.GetStats(hits, misses);
+  return true;
+}
+
+ModelMemoryUsage Unigram::GetMemoryUsage() const {
+  ModelMemoryUsage usage;
+  usage.vocab_bytes_ = token_to_ids_.GetMemoryUsage() +
+                       vocab_.capacity() * sizeof(core::VocabList::value_type);
+  for (const auto& item : vocab_) {
+    usage.vocab_bytes_ += item.first.capacity();
+  }
+  if (trie_ != nullptr) {
+    usage.index_bytes_ = trie_->total_size();
+  }
+  return usage;
+}
+
 void Unigram::PopulateNodes(utils::Lattice* lattice) const {
   auto get_chars_length = [&lattice](int begin_pos, const char* end) {
     int pos = begin_pos;
@@ -17,6 +17,7 @@ limitations under the License. */
 #include "fast_tokenizer/core/base.h"
 #include "fast_tokenizer/models/model.h"
 #include "fast_tokenizer/utils/cache.h"
+#include "fast_tokenizer/utils/flat_vocab.h"
 #include "fast_tokenizer/utils/lattice.h"
 #include "fast_tokenizer/utils/trie.h"
 
@@ -41,6 +42,9 @@ struct FASTTOKENIZER_DECL Unigram : public Model {
   virtual std::vector<std::string> Save(
       const std::string& folder,
       const std::string& filename_prefix) const override;
+  virtual bool EnableCacheStats(bool enable) override;
+  virtual bool GetCacheStats(uint64_t* hits, uint64_t* misses) const override;
+  virtual ModelMemoryUsage GetMemoryUsage() const override;
   // Set the filter token for unigram.
   void SetFilterToken(const std::string& filtered_token);
   // Set the special spliting rule for unigram.
@@ -57,7 +61,7 @@ private:
   void EncodeUnoptimized(const std::string& normalized,
                          std::vector<std::string>* encode_result);
 
-  core::Vocab token_to_ids_;
+  utils::FlatVocab token_to_ids_;
   core::VocabList vocab_;
   utils::Cache<std::string, std::vector<std::string>> cache_;
   std::unique_ptr<Darts::DoubleArray> trie_;
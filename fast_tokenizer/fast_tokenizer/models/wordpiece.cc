@@ -15,11 +15,14 @@ limitations under the License. */
 #include <algorithm>
 #include <cctype>
 #include <codecvt>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <locale>
 #include <map>
 
 #include "fast_tokenizer/models/wordpiece.h"
+#include "fast_tokenizer/utils/mapped_file.h"
 #include "fast_tokenizer/utils/path.h"
 #include "fast_tokenizer/utils/utf8.h"
 #include "glog/logging.h"
@@ -27,13 +30,15 @@ limitations under the License. */
 namespace paddlenlp {
 namespace fast_tokenizer {
 namespace models {
-const std::string WHITESPACE = " \n\r\t\f\v";
 
 WordPiece::WordPiece()
     : unk_token_("[UNK]"),
       continuing_subword_prefix_("##"),
       max_input_chars_per_word_(100),
-      unk_token_id_(0) {}
+      unk_token_id_(0),
+      handle_chinese_chars_(true),
+      prefix_node_pos_(0),
+      has_prefix_node_(false) {}
 
 WordPiece::WordPiece(const core::Vocab& vocab,
                      const std::string& unk_token,
@@ -45,10 +50,7 @@ WordPiece::WordPiece(const core::Vocab& vocab,
       max_input_chars_per_word_(max_input_chars_per_word),
       continuing_subword_prefix_(continuing_subword_prefix),
       handle_chinese_chars_(handle_chinese_chars) {
-  for (const auto& vocab_item : vocab) {
-    vocab_reversed_[vocab_item.second] = vocab_item.first;
-  }
-  unk_token_id_ = vocab.at(unk_token);
+  Init();
 }
 
 // Move version
@@ -57,35 +59,96 @@ WordPiece::WordPiece(core::Vocab&& vocab,
                      size_t max_input_chars_per_word,
                      std::string&& continuing_subword_prefix,
                      bool handle_chinese_chars)
-    : vocab_(std::move(vocab)),
+    : vocab_(vocab),
       unk_token_(std::move(unk_token)),
       max_input_chars_per_word_(std::move(max_input_chars_per_word)),
       continuing_subword_prefix_(std::move(continuing_subword_prefix)),
       handle_chinese_chars_(handle_chinese_chars) {
-  for (const auto& vocab_item : vocab) {
-    vocab_reversed_[vocab_item.second] = vocab_item.first;
+  Init();
+}
+
+void WordPiece::Init() {
+  if (!vocab_.Find(unk_token_, &unk_token_id_)) {
+    throw std::runtime_error("The unk token `" + unk_token_ +
+                             "` is not in the vocabulary");
+  }
+  // The tokens in the vocab are not null-terminated, so their lengths are
+  // passed to the trie.
+  struct TrieKey {
+    const char* data_;
+    size_t len_;
+    uint32_t id_;
+  };
+  std::vector<TrieKey> trie_keys;
+  trie_keys.reserve(vocab_.Size());
+  vocab_.ForEach([&trie_keys](const char* token, size_t len, uint32_t id) {
+    if (len > 0) {
+      trie_keys.push_back({token, len, id});
+    }
+  });
+  std::sort(trie_keys.begin(),
+            trie_keys.end(),
+            [](const TrieKey& a, const TrieKey& b) {
+              int result = std::memcmp(
+                  a.data_, b.data_, std::min(a.len_, b.len_));
+              return result < 0 || (result == 0 && a.len_ < b.len_);
+            });
+  std::vector<const char*> keys;
+  std::vector<size_t> lengths;
+  std::vector<int> values;
+  keys.reserve(trie_keys.size());
+  lengths.reserve(trie_keys.size());
+  values.reserve(trie_keys.size());
+  for (const auto& key : trie_keys) {
+    if (key.id_ > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+      throw std::runtime_error("The id of token `" +
+                               std::string(key.data_, key.len_) +
+                               "` is too large");
+    }
+    keys.push_back(key.data_);
+    lengths.push_back(key.len_);
+    values.push_back(static_cast<int>(key.id_));
+  }
+  trie_ = std::make_shared<Darts::DoubleArray>();
+  if (!keys.empty() &&
+      trie_->build(keys.size(), keys.data(), lengths.data(), values.data()) !=
+          0) {
+    throw std::runtime_error("Cannot build the trie of the vocabulary.");
+  }
+  prefix_node_pos_ = 0;
+  has_prefix_node_ = true;
+  if (!keys.empty() && !continuing_subword_prefix_.empty()) {
+    size_t key_pos = 0;
+    has_prefix_node_ =
+        trie_->traverse(continuing_subword_prefix_.data(),
+                        prefix_node_pos_,
+                        key_pos,
+                        continuing_subword_prefix_.length()) != -2;
+  }
+  if (keys.empty()) {
+    trie_ = nullptr;
   }
-  unk_token_id_ = vocab.at(unk_token);
 }
 
-core::Vocab WordPiece::GetVocab() const { return vocab_; }
+core::Vocab WordPiece::GetVocab() const { return vocab_.ToMap(); }
 
-size_t WordPiece::GetVocabSize() const { return vocab_.size(); }
+size_t WordPiece::GetVocabSize() const { return vocab_.Size(); }
 
-bool WordPiece::TokenToId(const std::string& token, uint32_t* id) const {
-  if (vocab_.find(token) == vocab_.end()) {
-    return false;
+ModelMemoryUsage WordPiece::GetMemoryUsage() const {
+  ModelMemoryUsage usage;
+  usage.vocab_bytes_ = vocab_.GetMemoryUsage();
+  if (trie_ != nullptr) {
+    usage.index_bytes_ = trie_->total_size();
   }
-  *id = vocab_.at(token);
-  return true;
+  return usage;
+}
+
+bool WordPiece::TokenToId(const std::string& token, uint32_t* id) const {
+  return vocab_.Find(token, id);
 }
 
 bool WordPiece::IdToToken(uint32_t id, std::string* token) const {
-  if (vocab_reversed_.find(id) == vocab_reversed_.end()) {
-    return false;
-  }
-  *token = vocab_reversed_.at(id);
-  return true;
+  return vocab_.FindToken(id, token);
 }
 
 std::vector<std::string> WordPiece::Save(
@@ -98,25 +161,82 @@ std::vector<std::string> WordPiece::Save(
   }
   VLOG(6) << "Full path" << filepath;
   std::ofstream fout(filepath);
-  std::vector<std::pair<std::string, uint32_t>> vocab(vocab_.begin(),
-                                                      vocab_.end());
-  std::sort(vocab.begin(),
-            vocab.end(),
-            [](const std::pair<std::string, uint32_t>& left,
-               const std::pair<std::string, uint32_t>& right) -> bool {
-              return left.second < right.second;
-            });
+  std::vector<std::pair<uint32_t, std::string>> vocab;
+  vocab.reserve(vocab_.Size());
+  vocab_.ForEach([&vocab](const char* token, size_t len, uint32_t id) {
+    vocab.emplace_back(id, std::string(token, len));
+  });
+  std::sort(vocab.begin(), vocab.end());
   for (const auto& vocab_item : vocab) {
-    fout << vocab_item.first << "\n";
+    fout << vocab_item.second << "\n";
   }
   fout.close();
   return {filepath};
 }
 
-static bool CheckIfStringIsAlphaNum(const std::string& str) {
-  return std::count_if(str.begin(), str.end(), [](char ch) {
-           return std::isalnum(ch) > 0;
-         }) == str.length();
+bool WordPiece::MatchLongestTokenFromNode(const std::string& sequence,
+                                          size_t node_pos,
+                                          uint32_t start,
+                                          uint32_t limit,
+                                          uint32_t min_end,
+                                          uint32_t* end,
+                                          uint32_t* id) const {
+  bool found = false;
+  size_t key_pos = start;
+  while (key_pos < limit) {
+    int result =
+        trie_->traverse(sequence.data(), node_pos, key_pos, key_pos + 1);
+    if (result == -2) {
+      break;
+    }
+    // The token should end at the boundary of a character.
+    if (result >= 0 && key_pos >= min_end &&
+        (key_pos == sequence.length() ||
+         utils::IsCharBeginBoundary(sequence[key_pos]))) {
+      found = true;
+      *end = key_pos;
+      *id = result;
+    }
+  }
+  return found;
+}
+
+bool WordPiece::MatchLongestToken(const std::string& sequence,
+                                  uint32_t start,
+                                  uint32_t* end,
+                                  uint32_t* id,
+                                  bool* with_prefix) const {
+  if (trie_ == nullptr) {
+    return false;
+  }
+  uint32_t len = sequence.length();
+  // The subwords that end before prefix_end are prefixed by
+  // continuing_subword_prefix_. If handle_chinese_chars_ is false, only the
+  // alphanumeric subwords are prefixed.
+  uint32_t prefix_end = len;
+  if (start == 0) {
+    prefix_end = start;
+  } else if (!handle_chinese_chars_) {
+    prefix_end = start;
+    while (prefix_end < len &&
+           std::isalnum(static_cast<unsigned char>(sequence[prefix_end]))) {
+      ++prefix_end;
+    }
+  }
+  // The longer subwords are preferred, which are not prefixed.
+  if (prefix_end < len &&
+      MatchLongestTokenFromNode(
+          sequence, 0, start, len, prefix_end + 1, end, id)) {
+    *with_prefix = false;
+    return true;
+  }
+  if (prefix_end > start && has_prefix_node_ &&
+      MatchLongestTokenFromNode(
+          sequence, prefix_node_pos_, start, prefix_end, start + 1, end, id)) {
+    *with_prefix = true;
+    return true;
+  }
+  return false;
 }
 
 std::vector<core::Token> WordPiece::Tokenize(const std::string& sequence) {
@@ -124,77 +244,37 @@ std::vector<core::Token> WordPiece::Tokenize(const std::string& sequence) {
   std::vector<core::Token> all_tokens;
   size_t unicode_len =
       utils::GetUnicodeLenFromUTF8(sequence.data(), sequence.length());
-  if (unicode_len > max_input_chars_per_word_) {
-    all_tokens.emplace_back(
-        vocab_.at(unk_token_), unk_token_, core::Offset{0, sequence.length()});
-  } else {
-    bool found_token = true;
+  if (unicode_len <= max_input_chars_per_word_) {
+    // Match the longest token greedily by walking down the trie, so that no
+    // candidate subword is allocated.
     uint32_t start = 0;
-
     while (start < sequence.length()) {
-      uint32_t end = sequence.length();
-      core::Token cur_token;
-      bool match_cur_token = false;
-      while (start < end) {
-        std::string sub_str = sequence.substr(start, end - start);
-        if (start > 0 &&
-            (handle_chinese_chars_ || CheckIfStringIsAlphaNum(sub_str))) {
-          sub_str = continuing_subword_prefix_ + sub_str;
-        }
-        const auto& vocab_iter = vocab_.find(sub_str);
-        if (vocab_iter != vocab_.end()) {
-          cur_token = {vocab_iter->second, sub_str, {start, end}};
-          match_cur_token = true;
-          break;
-        }
-        // std::u32string u32sub_str = conv.from_bytes(sub_str);
-        // end -= utils::GetUTF8CharLen(u32sub_str.back());
-        for (auto it = sub_str.rbegin(); it != sub_str.rend(); ++it) {
-          --end;
-          if (utils::IsCharBeginBoundary(*it)) {
-            break;
-          }
-        }
-      }
-      if (!match_cur_token) {
-        found_token = false;
+      uint32_t end, id;
+      bool with_prefix;
+      if (!MatchLongestToken(sequence, start, &end, &id, &with_prefix)) {
+        all_tokens.clear();
         break;
       }
-      all_tokens.emplace_back(cur_token);
+      std::string value =
+          with_prefix ? continuing_subword_prefix_ : std::string();
+      value.append(sequence, start, end - start);
+      all_tokens.emplace_back(id, std::move(value), core::Offset{start, end});
       start = end;
     }
-
-    if (!found_token) {
-      all_tokens.clear();
-      all_tokens.emplace_back(vocab_.at(unk_token_),
-                              unk_token_,
-                              core::Offset{0, sequence.length()});
+    if (start >= sequence.length()) {
+      return all_tokens;
     }
   }
+  all_tokens.emplace_back(
+      unk_token_id_, unk_token_, core::Offset{0, sequence.length()});
   return all_tokens;
 }
 
-
 core::Vocab WordPiece::GetVocabFromFile(const std::string& file) {
-  std::ifstream fin(file);
   core::Vocab vocab;
-  int i = 0;
-  constexpr int MAX_BUFFER_SIZE = 256;
-  char word[MAX_BUFFER_SIZE];
-  while (fin.getline(word, MAX_BUFFER_SIZE)) {
-    std::string word_str = word;
-    auto leading_spaces = word_str.find_first_not_of(WHITESPACE);
-    if (leading_spaces != std::string::npos) {
-      leading_spaces = (std::min)(leading_spaces, word_str.length() - 1);
-      word_str = word_str.substr(leading_spaces);
-    }
-    auto trailing_spaces = word_str.find_last_not_of(WHITESPACE);
-    if (trailing_spaces != std::string::npos) {
-      word_str = word_str.substr(0, trailing_spaces + 1);
-    }
-    if (word_str != "") {
-      vocab[word_str] = i++;
-    }
+  utils::MappedFile mapped_file(file);
+  if (mapped_file.IsValid()) {
+    utils::GetVocabFromBuffer(mapped_file.Data(), mapped_file.Size(), &vocab);
   }
   return vocab;
 }
@@ -212,7 +292,7 @@ WordPiece WordPiece::GetWordPieceFromFile(
 void to_json(nlohmann::json& j, const WordPiece& model) {
   j = {
       {"type", "WordPiece"},
-      {"vocab", model.vocab_},
+      {"vocab", model.vocab_.ToMap()},
       {"unk_token", model.unk_token_},
       {"max_input_chars_per_word", model.max_input_chars_per_word_},
       {"continuing_subword_prefix", model.continuing_subword_prefix_},
@@ -220,10 +300,11 @@ void to_json(nlohmann::json& j, const WordPiece& model) {
 }
 
 void from_json(const nlohmann::json& j, WordPiece& model) {
-  j["vocab"].get_to(model.vocab_);
+  model.vocab_ = utils::FlatVocab(j["vocab"].get<core::Vocab>());
   j["unk_token"].get_to(model.unk_token_);
   j["max_input_chars_per_word"].get_to(model.max_input_chars_per_word_);
   j["continuing_subword_prefix"].get_to(model.continuing_subword_prefix_);
+  model.Init();
 }
 
 
@@ -267,26 +348,7 @@ WordPiece WordPieceFactory::CreateWordPieceModel() {
 }
 
 void WordPieceFactory::GetVocabFromFiles(const std::string& files) {
-  std::ifstream fin(files);
-  config_.vocab_.clear();
-  int i = 0;
-  constexpr int MAX_BUFFER_SIZE = 256;
-  char word[MAX_BUFFER_SIZE];
-  while (fin.getline(word, MAX_BUFFER_SIZE)) {
-    std::string word_str = word;
-    auto leading_spaces = word_str.find_first_not_of(WHITESPACE);
-    if (leading_spaces != std::string::npos) {
-      leading_spaces = (std::min)(leading_spaces, word_str.length() - 1);
-      word_str = word_str.substr(leading_spaces);
-    }
-    auto trailing_spaces = word_str.find_last_not_of(WHITESPACE);
-    if (trailing_spaces != std::string::npos) {
-      word_str = word_str.substr(0, trailing_spaces + 1);
-    }
-    if (word_str != "") {
-      config_.vocab_[word_str] = i++;
-    }
-  }
+  config_.vocab_ = WordPiece::GetVocabFromFile(files);
 }
 
 }  // namespace model
@@ -14,7 +14,11 @@ limitations under the License. */
 
 #pragma once
 
+#include <memory>
+
+#include "darts.h"
 #include "fast_tokenizer/models/model.h"
+#include "fast_tokenizer/utils/flat_vocab.h"
 #include "nlohmann/json.hpp"
 
 namespace paddlenlp {
@@ -40,6 +44,7 @@ struct FASTTOKENIZER_DECL WordPiece : public Model {
   virtual bool IdToToken(uint32_t id, std::string* token) const override;
   virtual core::Vocab GetVocab() const override;
   virtual size_t GetVocabSize() const override;
+  virtual ModelMemoryUsage GetMemoryUsage() const override;
   // Return the saved voacb full path
   virtual std::vector<std::string> Save(
       const std::string& folder,
@@ -52,13 +57,35 @@ struct FASTTOKENIZER_DECL WordPiece : public Model {
       const std::string& continuing_subword_prefix = "##");
 
 protected:
-  core::Vocab vocab_;
-  core::VocabReversed vocab_reversed_;
+  // Init the unk token id and the trie of the vocab.
+  void Init();
+  // Find the longest token that starts at `start`, return false if there is
+  // none. The token is prefixed by continuing_subword_prefix_ if
+  // `with_prefix` is true.
+  bool MatchLongestToken(const std::string& sequence,
+                         uint32_t start,
+                         uint32_t* end,
+                         uint32_t* id,
+                         bool* with_prefix) const;
+  bool MatchLongestTokenFromNode(const std::string& sequence,
+                                 size_t node_pos,
+                                 uint32_t start,
+                                 uint32_t limit,
+                                 uint32_t min_end,
+                                 uint32_t* end,
+                                 uint32_t* id) const;
+  utils::FlatVocab vocab_;
   std::string unk_token_;
   uint32_t unk_token_id_;
   size_t max_input_chars_per_word_;
   std::string continuing_subword_prefix_;
   bool handle_chinese_chars_;
+  // The trie of all the tokens, it's shared by the copies of the model since
+  // it's never modified after being built.
+  std::shared_ptr<Darts::DoubleArray> trie_;
+  // The node of continuing_subword_prefix_ in the trie
+  size_t prefix_node_pos_;
+  bool has_prefix_node_;
   friend void to_json(nlohmann::json& j, const WordPiece& model);
   friend void from_json(const nlohmann::json& j, WordPiece& model);
 };
@@ -0,0 +1,171 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <limits>
+
+#include "fast_tokenizer/normalizers/alignments.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace normalizers {
+
+Alignments::Alignments() : size_(0) {}
+
+void Alignments::Clear() {
+  runs_.clear();
+  size_ = 0;
+}
+
+void Alignments::AppendGroups(uint32_t first,
+                              uint32_t group,
+                              uint32_t span,
+                              uint32_t len) {
+  if (len == 0) {
+    return;
+  }
+  if (!runs_.empty()) {
+    auto& last = runs_.back();
+    uint32_t last_len = size_ - last.start_;
+    uint32_t num_groups = GetGroupsNum(last, last_len);
+    uint32_t last_first = last.first_ + (num_groups - 1) * last.span_;
+    if (num_groups == 1 && len <= group && first == last.first_ &&
+        span == last.span_) {
+      // Both of them have only one group with the same range
+      last.group_ = last_len + len;
+      size_ += len;
+      return;
+    }
+    if (group == last.group_ && span == last.span_ &&
+        first == last_first + span && num_groups * group == last_len) {
+      size_ += len;
+      return;
+    }
+  }
+  runs_.push_back({size_, first, group, span});
+  size_ += len;
+}
+
+void Alignments::Append(const core::Range& range, uint32_t count) {
+  AppendGroups(range.first, count, range.second - range.first, count);
+}
+
+void Alignments::Append(const Alignments& other,
+                        uint32_t begin,
+                        uint32_t end,
+                        uint32_t shift) {
+  end = (std::min)(end, other.size_);
+  if (begin >= end) {
+    return;
+  }
+  auto it = std::upper_bound(
+      other.runs_.begin(),
+      other.runs_.end(),
+      begin,
+      [](uint32_t idx, const Run& run) { return idx < run.start_; });
+  for (size_t i = it - other.runs_.begin() - 1; i < other.runs_.size(); ++i) {
+    const auto& run = other.runs_[i];
+    if (run.start_ >= end) {
+      break;
+    }
+    uint32_t run_begin = (std::max)(run.start_, begin);
+    uint32_t run_end = (std::min)(other.GetRunEnd(i), end);
+    uint32_t offset = run_begin - run.start_;
+    // The ranges are moved left by shift, the arithmetic wraps around like
+    // the one of the ranges
+    uint32_t first = run.first_ + offset / run.group_ * run.span_ - shift;
+    uint32_t in_group = offset % run.group_;
+    if (in_group > 0) {
+      // The first group is partial
+      uint32_t len = (std::min)(run.group_ - in_group, run_end - run_begin);
+      AppendGroups(first, len, run.span_, len);
+      run_begin += len;
+      first += run.span_;
+    }
+    AppendGroups(first, run.group_, run.span_, run_end - run_begin);
+  }
+}
+
+void Alignments::Replace(uint32_t begin,
+                         uint32_t end,
+                         const Alignments& alignments) {
+  begin = (std::min)(begin, size_);
+  Alignments suffix;
+  suffix.Append(*this, end, size_);
+  // Remove the bytes after begin
+  auto it = std::lower_bound(
+      runs_.begin(), runs_.end(), begin, [](const Run& run, uint32_t idx) {
+        return run.start_ < idx;
+      });
+  runs_.erase(it, runs_.end());
+  size_ = begin;
+  Append(alignments, 0, alignments.size_);
+  Append(suffix, 0, suffix.size_);
+}
+
+void Alignments::FindOriginalRange(const core::Range& range,
+                                   int* start,
+                                   int* end) const {
+  *start = -1;
+  *end = -1;
+  for (size_t i = 0; i < runs_.size(); ++i) {
+    const auto& run = runs_[i];
+    uint32_t run_end = GetRunEnd(i);
+    uint64_t num_groups = GetGroupsNum(run, run_end - run.start_);
+    uint64_t last_second =
+        run.first_ + static_cast<uint64_t>(num_groups) * run.span_;
+    if (last_second > (std::numeric_limits<uint32_t>::max)()) {
+      // The ranges have been wrapped around, check the groups one by one.
+      for (uint64_t g = 0; g < num_groups; ++g) {
+        uint32_t first = run.first_ + g * run.span_;
+        uint32_t second = first + run.span_;
+        if (range.second >= second) {
+          uint32_t group_start = run.start_ + g * run.group_;
+          if (*start < 0 && range.first <= first && first != second) {
+            *start = group_start;
+          }
+          *end = (std::min)(group_start + run.group_, run_end);
+        }
+      }
+      continue;
+    }
+    if (range.second < static_cast<uint64_t>(run.first_) + run.span_) {
+      continue;
+    }
+    if (run.span_ == 0) {
+      // The ranges are all empty
+      *end = run_end;
+      continue;
+    }
+    // The groups [0, last_group] end before range.second
+    uint64_t last_group = (std::min)(
+        static_cast<uint64_t>(range.second - run.first_ - run.span_) /
+            run.span_,
+        num_groups - 1);
+    uint64_t first_group = 0;
+    if (range.first > run.first_) {
+      first_group = (range.first - run.first_ + run.span_ - 1) / run.span_;
+    }
+    if (*start < 0 && first_group <= last_group) {
+      *start = run.start_ + first_group * run.group_;
+    }
+    *end = (std::min)(
+        static_cast<uint64_t>(run.start_) + (last_group + 1) * run.group_,
+        static_cast<uint64_t>(run_end));
+  }
+}
+
+}  // namespace normalizers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
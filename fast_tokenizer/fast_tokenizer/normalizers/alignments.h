@@ -0,0 +1,105 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace normalizers {
+
+// The alignments of a normalized string, i.e. the range of the original
+// string that every normalized byte comes from. The bytes are stored as runs
+// of groups: the bytes of a group share one range, and the ranges of the
+// consecutive groups of a run are adjacent and have the same length. So an
+// unchanged string takes one run every time the width of its UTF-8 chars
+// changes instead of one range per byte.
+class FASTTOKENIZER_DECL Alignments {
+public:
+  Alignments();
+  // Append `count` bytes that are aligned to `range`.
+  void Append(const core::Range& range, uint32_t count = 1);
+  // Append the bytes [begin, end) of `other`, whose ranges are moved left by
+  // `shift`.
+  void Append(const Alignments& other,
+              uint32_t begin,
+              uint32_t end,
+              uint32_t shift = 0);
+  // Replace the bytes [begin, end) by the bytes of `alignments`.
+  void Replace(uint32_t begin, uint32_t end, const Alignments& alignments);
+  core::Range operator[](uint32_t idx) const {
+    if (runs_.empty()) {
+      return {0, 0};
+    }
+    auto it = runs_.begin();
+    if (runs_.size() > 1) {
+      it = std::upper_bound(
+          runs_.begin(), runs_.end(), idx, [](uint32_t idx, const Run& run) {
+            return idx < run.start_;
+          });
+      if (it == runs_.begin()) {
+        return {0, 0};
+      }
+      --it;
+    }
+    uint32_t offset = idx - it->start_;
+    if (it->group_ > 1) {
+      offset /= it->group_;
+    }
+    uint32_t first = it->first_ + offset * it->span_;
+    return {first, first + it->span_};
+  }
+  // Find the bytes that are aligned inside the original `range`. `start` is
+  // the first byte with a non-empty range, `end` is the one after the last
+  // byte, they are -1 if there is no such byte.
+  void FindOriginalRange(const core::Range& range, int* start, int* end) const;
+
+  uint32_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  void Clear();
+  size_t GetRunsNum() const { return runs_.size(); }
+  // The bytes allocated by the alignments, excluding sizeof(Alignments).
+  size_t GetMemoryUsage() const { return runs_.capacity() * sizeof(Run); }
+
+private:
+  struct Run {
+    // The first byte of the run
+    uint32_t start_;
+    // The start of the range of the first group
+    uint32_t first_;
+    // The number of bytes of a group
+    uint32_t group_;
+    // The length of the range of a group
+    uint32_t span_;
+  };
+  uint32_t GetRunEnd(size_t run_idx) const {
+    return run_idx + 1 < runs_.size() ? runs_[run_idx + 1].start_ : size_;
+  }
+  static uint32_t GetGroupsNum(const Run& run, uint32_t len) {
+    return run.group_ == 1 ? len : (len + run.group_ - 1) / run.group_;
+  }
+  // Append `len` bytes of groups starting at a group boundary, the last group
+  // may be partial.
+  void AppendGroups(uint32_t first, uint32_t group, uint32_t span, uint32_t len);
+  std::vector<Run> runs_;
+  uint32_t size_;
+};
+
+}  // namespace normalizers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -15,6 +15,7 @@ limitations under the License. */
 #include <algorithm>
 #include <codecvt>
 #include <locale>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -36,20 +37,17 @@ namespace normalizers {
 
 NormalizedString::NormalizedString(const std::string& original)
     : original_(original), normalized_(original), original_shift_(0) {
-  // calculate alignments
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> conv;
-  std::u32string u32normalized = conv.from_bytes(normalized_);
-  for (int i = 0; i < u32normalized.length(); ++i) {
-    auto new_normalized_char_len = utils::GetUTF8CharLen(u32normalized[i]);
-    uint32_t start = 0;
-    uint32_t end = 0;
-    if (i != 0) {
-      start = alignments_.back().second;
-    }
-    end = start + new_normalized_char_len;
-    for (int j = 0; j < new_normalized_char_len; ++j) {
-      alignments_.push_back({start, end});
+  // calculate alignments, all the bytes of a char are aligned to the char
+  const char* begin = normalized_.data();
+  const char* end = begin + normalized_.length();
+  uint32_t utf8_len = 0;
+  while (utf8_len < normalized_.length()) {
+    size_t chwidth;
+    if (!utils::IsValidDecodeUTF8(begin + utf8_len, end, &chwidth)) {
+      throw std::range_error("The string is not a valid UTF-8 string.");
     }
+    alignments_.Append({utf8_len, utf8_len + chwidth}, chwidth);
+    utf8_len += chwidth;
   }
 }
 
@@ -83,6 +81,10 @@ bool NormalizedString::IsEmpty() const { return normalized_.empty(); }
 
 bool NormalizedString::IsOriginalEmpty() const { return original_.empty(); }
 
+const Alignments& NormalizedString::GetAlignments() const {
+  return alignments_;
+}
+
 void NormalizedString::UpdateNormalized(const OffsetMapping& new_normalized,
                                         uint32_t initial_offset) {
   UpdateNormalizedRange(new_normalized, initial_offset, {0, GetLen()}, true);
@@ -112,8 +114,7 @@ void NormalizedString::UpdateNormalizedRange(
   }
 
   uint32_t offset = initial_removed + n_range.first;
-  std::vector<core::Range> alignments;
-  alignments.reserve(n_range.second - n_range.first);
+  Alignments alignments;
 
   int replaced_normalized_idx = initial_removed;
   // Calculate the new alignments
@@ -148,35 +149,10 @@ void NormalizedString::UpdateNormalizedRange(
       }
     }
     offset += replaced_char_size + total_bytes_to_remove;
-    alignments.insert(alignments.end(), new_normalized_char_len, align);
+    alignments.Append(align, new_normalized_char_len);
   }
   // Replace the old alignments in n_range
-  if (n_range.second - n_range.first >= alignments.size()) {
-    std::memcpy(alignments_.data() + n_range.first,
-                alignments.data(),
-                alignments.size() * sizeof(core::Range));
-    alignments_.erase(alignments_.begin() + n_range.first + alignments.size(),
-                      alignments_.begin() + n_range.second);
-  } else {
-    std::vector<core::Range> new_alignments;
-    auto third_len = 0;
-    if (alignments_.size() > n_range.second) {
-      third_len = alignments_.size() - n_range.second;
-    }
-    new_alignments.resize(n_range.first + alignments.size() + third_len);
-    if (n_range.first > 0) {
-      std::copy_n(alignments_.begin(), n_range.first, new_alignments.begin());
-    }
-    std::copy_n(alignments.begin(),
-                alignments.size(),
-                new_alignments.begin() + n_range.first);
-    if (third_len > 0) {
-      std::copy_n(alignments_.begin() + n_range.second,
-                  third_len,
-                  new_alignments.begin() + n_range.first + alignments.size());
-    }
-    alignments_ = std::move(new_alignments);
-  }
+  alignments_.Replace(n_range.first, n_range.second, alignments);
   // Unicode -> UTF8
   uint32_t normalized_utf8_size = 0;
   for (auto& ch : new_normalized.u32normalized) {
@@ -218,18 +194,7 @@ bool NormalizedString::ConvertOffsets(core::Range* range,
   if (origin_range) {
     int start = -1;
     int end = -1;
-    for (int i = 0; i < alignments_.size(); ++i) {
-      if (range->second >= alignments_[i].second) {
-        if (start < 0 && range->first <= alignments_[i].first) {
-          if (alignments_[i].first != alignments_[i].second) {
-            start = i;
-          }
-        }
-        if (range->second >= alignments_[i].second) {
-          end = i + 1;
-        }
-      }
-    }
+    alignments_.FindOriginalRange(*range, &start, &end);
     if (start > 0 && end < 0) {
       *range = {start, start};
     } else if (start < 0 && end > 0) {
@@ -551,14 +516,11 @@ bool NormalizedString::Slice(core::Range range,
     normalized->normalized_ = this->normalized_.substr(
         normalized_range.first,
         normalized_range.second - normalized_range.first);
-    normalized->alignments_.reserve(normalized_range.second -
-                                    normalized_range.first);
-    for (uint32_t i = normalized_range.first; i < normalized_range.second;
-         ++i) {
-      normalized->alignments_.emplace_back(
-          this->alignments_[i].first - n_shift,
-          this->alignments_[i].second - n_shift);
-    }
+    normalized->alignments_.Clear();
+    normalized->alignments_.Append(this->alignments_,
+                                   normalized_range.first,
+                                   normalized_range.second,
+                                   n_shift);
 
     normalized->original_shift_ = this->original_shift_ + original_range.first;
     return true;
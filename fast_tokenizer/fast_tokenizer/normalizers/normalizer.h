@@ -18,6 +18,7 @@ limitations under the License. */
 #include <string>
 #include <vector>
 #include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/normalizers/alignments.h"
 #include "fast_tokenizer/utils/utils.h"
 
 namespace re2 {
@@ -47,6 +48,7 @@ public:
   core::Offset GetOrginalOffset() const;
   bool IsEmpty() const;
   bool IsOriginalEmpty() const;
+  const Alignments& GetAlignments() const;
 
   // Unicode Normalization
   NormalizedString& NFD();
@@ -175,7 +177,7 @@ private:
   std::string normalized_;
   // In order to keep track of the offset mapping from
   // original_ to normalized_
-  std::vector<core::Range> alignments_;
+  Alignments alignments_;
   uint32_t original_shift_;
 
   void UpdateNormalizedRange(const OffsetMapping& new_normalized,
@@ -23,11 +23,15 @@ namespace fast_tokenizer {
 namespace postprocessors {
 
 BertPostProcessor::BertPostProcessor()
-    : sep_({"[SEP]", 102}), cls_({"[CLS]", 101}) {}
+    : sep_({"[SEP]", 102}), cls_({"[CLS]", 101}) {
+  UpdatePlans();
+}
 BertPostProcessor::BertPostProcessor(
     const std::pair<std::string, uint32_t>& sep,
     const std::pair<std::string, uint32_t>& cls)
-    : sep_(sep), cls_(cls) {}
+    : sep_(sep), cls_(cls) {
+  UpdatePlans();
+}
 size_t BertPostProcessor::AddedTokensNum(bool is_pair) const {
   if (is_pair) {
     // [CLS] A [SEP] B [SEP]
@@ -37,157 +41,49 @@ size_t BertPostProcessor::AddedTokensNum(bool is_pair) const {
   return 2;
 }
 
+void BertPostProcessor::UpdatePlans() {
+  // [CLS] A [SEP]
+  single_plan_.Clear();
+  single_plan_.AddSpecialToken(cls_.second, cls_.first, 0);
+  single_plan_.AddSequence(SequenceType::SEQ_A, 0, true);
+  single_plan_.AddSpecialToken(sep_.second, sep_.first, 0);
+  // [CLS] A [SEP] B [SEP]
+  pair_plan_ = single_plan_;
+  pair_plan_.AddSequence(SequenceType::SEQ_B, 1, true);
+  pair_plan_.AddSpecialToken(sep_.second, sep_.first, 1);
+}
+
 void BertPostProcessor::operator()(core::Encoding* encoding,
                                    core::Encoding* pair_encoding,
                                    bool add_special_tokens,
                                    core::Encoding* result_encoding) const {
+  BertPostProcessor::ProcessAndPad(encoding,
+                                   pair_encoding,
+                                   add_special_tokens,
+                                   core::PadMethod(),
+                                   0,
+                                   result_encoding);
+}
+
+void BertPostProcessor::ProcessAndPad(core::Encoding* encoding,
+                                      core::Encoding* pair_encoding,
+                                      bool add_special_tokens,
+                                      const core::PadMethod& pad_method,
+                                      uint32_t pad_len,
+                                      core::Encoding* result_encoding) const {
   if (!add_special_tokens) {
-    DefaultProcess(encoding, pair_encoding, result_encoding);
+    DefaultProcessAndPad(
+        encoding, pair_encoding, pad_method, pad_len, result_encoding);
     return;
   }
-// Construct the sequence as: [CLS] A [SEP]
-#define CREATE_PROCESSED_ENCODING_SEQ(                                         \
-    encoding_ptr, attr, name, head_value, back_value)                          \
-  auto encoding_##name = encoding_ptr->Get##attr();                            \
-  decltype(encoding_##name) name(encoding_##name.size() + 2);                  \
-  std::copy(encoding_##name.begin(), encoding_##name.end(), name.begin() + 1); \
-  name.front() = head_value;                                                   \
-  name.back() = back_value
-  // ids
-  CREATE_PROCESSED_ENCODING_SEQ(encoding, Ids, ids, cls_.second, sep_.second);
-  // type_ids
-  CREATE_PROCESSED_ENCODING_SEQ(encoding, TypeIds, type_ids, 0, 0);
-  // tokens
-  CREATE_PROCESSED_ENCODING_SEQ(
-      encoding, Tokens, tokens, cls_.first, sep_.first);
-  // word_idx
-  CREATE_PROCESSED_ENCODING_SEQ(encoding, WordsIdx, word_idx, -1, -1);
-  // offsets
-  core::Offset empty_offsets = {0, 0};
-  CREATE_PROCESSED_ENCODING_SEQ(
-      encoding, Offsets, offsets, empty_offsets, empty_offsets);
-  // special_tokens_mask
-  std::vector<uint32_t> special_tokens_mask(ids.size(), 0);
-  special_tokens_mask.front() = special_tokens_mask.back() = 1;
-  // attention_mask
-  std::vector<uint32_t> attention_mask(ids.size(), 1);
-  // sequence_ranges
-  std::unordered_map<uint32_t, core::Range> sequence_ranges;
-  sequence_ranges[0] = {1, ids.size() - 1};
-  // overflowing
-  auto& overflowings = encoding->GetMutableOverflowing();
-  for (auto& overflow_encoding : overflowings) {
-    CREATE_PROCESSED_ENCODING_SEQ(
-        (&overflow_encoding), Ids, ids, cls_.second, sep_.second);
-    CREATE_PROCESSED_ENCODING_SEQ(
-        (&overflow_encoding), TypeIds, type_ids, 0, 0);
-    CREATE_PROCESSED_ENCODING_SEQ(
-        (&overflow_encoding), Tokens, tokens, cls_.first, sep_.first);
-    CREATE_PROCESSED_ENCODING_SEQ(
-        (&overflow_encoding), WordsIdx, word_idx, -1, -1);
-    CREATE_PROCESSED_ENCODING_SEQ(
-        (&overflow_encoding), Offsets, offsets, empty_offsets, empty_offsets);
-
-    std::vector<uint32_t> special_tokens_mask(ids.size(), 0);
-    special_tokens_mask.front() = special_tokens_mask.back() = 1;
-
-    std::vector<uint32_t> attention_mask(ids.size(), 1);
-
-    std::unordered_map<uint32_t, core::Range> sequence_ranges;
-    sequence_ranges[0] = {1, ids.size() - 1};
-
-    overflow_encoding = std::move(
-        core::Encoding(std::move(ids),
-                       std::move(type_ids),
-                       std::move(tokens),
-                       std::move(word_idx),
-                       std::move(offsets),
-                       std::move(special_tokens_mask),
-                       std::move(attention_mask),
-                       std::vector<core::Encoding>(),  // No overflowing
-                       std::move(sequence_ranges)));
-  }
-
-  core::Encoding new_encoding(std::move(ids),
-                              std::move(type_ids),
-                              std::move(tokens),
-                              std::move(word_idx),
-                              std::move(offsets),
-                              std::move(special_tokens_mask),
-                              std::move(attention_mask),
-                              std::move(overflowings),
-                              std::move(sequence_ranges));
-  if (pair_encoding != nullptr) {
-#define CREATE_PROCESSED_PARI_ENCODING_SEQ(                                \
-    encoding_ptr, attr, name, back_value)                                  \
-  auto encoding_##name = encoding_ptr->Get##attr();                        \
-  decltype(encoding_##name) name(encoding_##name.size() + 1);              \
-  std::copy(encoding_##name.begin(), encoding_##name.end(), name.begin()); \
-  name.back() = back_value
-
-    CREATE_PROCESSED_PARI_ENCODING_SEQ(pair_encoding, Ids, ids, sep_.second);
-    CREATE_PROCESSED_PARI_ENCODING_SEQ(pair_encoding, TypeIds, type_ids, 1);
-    CREATE_PROCESSED_PARI_ENCODING_SEQ(
-        pair_encoding, Tokens, tokens, sep_.first);
-    CREATE_PROCESSED_PARI_ENCODING_SEQ(pair_encoding, WordsIdx, word_idx, -1);
-    core::Offset empty_offsets = {0, 0};
-    CREATE_PROCESSED_PARI_ENCODING_SEQ(
-        pair_encoding, Offsets, offsets, empty_offsets);
-
-    std::vector<uint32_t> special_tokens_mask(ids.size(), 0);
-    special_tokens_mask.back() = 1;
-
-    std::vector<uint32_t> attention_mask(ids.size(), 1);
-    std::unordered_map<uint32_t, core::Range> sequence_ranges;
-    sequence_ranges[1] = {0, ids.size() - 1};
-    // overflowing
-    auto& overflowings = pair_encoding->GetMutableOverflowing();
-    for (auto& overflow_pair_encoding : overflowings) {
-      CREATE_PROCESSED_PARI_ENCODING_SEQ(
-          (&overflow_pair_encoding), Ids, ids, sep_.second);
-      CREATE_PROCESSED_PARI_ENCODING_SEQ(
-          (&overflow_pair_encoding), TypeIds, type_ids, 1);
-      CREATE_PROCESSED_PARI_ENCODING_SEQ(
-          (&overflow_pair_encoding), Tokens, tokens, sep_.first);
-      CREATE_PROCESSED_PARI_ENCODING_SEQ(
-          (&overflow_pair_encoding), WordsIdx, word_idx, -1);
-      core::Offset empty_offsets = {0, 0};
-      CREATE_PROCESSED_PARI_ENCODING_SEQ(
-          (&overflow_pair_encoding), Offsets, offsets, empty_offsets);
-
-      std::vector<uint32_t> special_tokens_mask(ids.size(), 0);
-      special_tokens_mask.back() = 1;
-
-      std::vector<uint32_t> attention_mask(ids.size(), 1);
-      std::unordered_map<uint32_t, core::Range> sequence_ranges;
-      sequence_ranges[0] = {1, ids.size() - 1};
-
-      overflow_pair_encoding = std::move(
-          core::Encoding(std::move(ids),
-                         std::move(type_ids),
-                         std::move(tokens),
-                         std::move(word_idx),
-                         std::move(offsets),
-                         std::move(special_tokens_mask),
-                         std::move(attention_mask),
-                         std::vector<core::Encoding>(),  // No overflowing
-                         std::move(sequence_ranges)));
-    }
-
-    core::Encoding new_pair_encoding(std::move(ids),
-                                     std::move(type_ids),
-                                     std::move(tokens),
-                                     std::move(word_idx),
-                                     std::move(offsets),
-                                     std::move(special_tokens_mask),
-                                     std::move(attention_mask),
-                                     std::move(overflowings),
-                                     std::move(sequence_ranges));
-    new_encoding.MergeWith(new_pair_encoding, false);
-  }
-#undef CREATE_PROCESSED_ENCODING_SEQ
-#undef CREATE_PROCESSED_PARI_ENCODING_SEQ
-  *result_encoding = std::move(new_encoding);
+  const TemplatePlan& plan =
+      (pair_encoding != nullptr) ? pair_plan_ : single_plan_;
+  plan(encoding,
+       pair_encoding,
+       add_special_tokens,
+       pad_method,
+       pad_len,
+       result_encoding);
 }
 
 void to_json(nlohmann::json& j, const BertPostProcessor& bert_postprocessor) {
@@ -201,6 +97,7 @@ void to_json(nlohmann::json& j, const BertPostProcessor& bert_postprocessor) {
 void from_json(const nlohmann::json& j, BertPostProcessor& bert_postprocessor) {
   j["cls"].get_to(bert_postprocessor.cls_);
   j["sep"].get_to(bert_postprocessor.sep_);
+  bert_postprocessor.UpdatePlans();
 }
 
 }  // namespace postprocessors
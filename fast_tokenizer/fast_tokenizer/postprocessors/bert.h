@@ -15,6 +15,7 @@
 #pragma once
 
 #include "fast_tokenizer/postprocessors/postprocessor.h"
+#include "fast_tokenizer/postprocessors/template.h"
 #include "fast_tokenizer/utils/utils.h"
 #include "nlohmann/json.hpp"
 
@@ -31,8 +32,19 @@ struct FASTTOKENIZER_DECL BertPostProcessor : public PostProcessor {
                           core::Encoding* pair_encoding,
                           bool add_special_tokens,
                           core::Encoding* result_encoding) const override;
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override;
+  // Compile [CLS] A [SEP] and [CLS] A [SEP] B [SEP] from sep_ and cls_. Need to
+  // be called again after sep_ or cls_ is modified.
+  void UpdatePlans();
   std::pair<std::string, uint32_t> sep_;
   std::pair<std::string, uint32_t> cls_;
+  TemplatePlan single_plan_;
+  TemplatePlan pair_plan_;
   friend void to_json(nlohmann::json& j,
                       const BertPostProcessor& bert_postprocessor);
   friend void from_json(const nlohmann::json& j,
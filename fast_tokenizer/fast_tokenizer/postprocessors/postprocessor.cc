@@ -32,6 +32,37 @@ void PostProcessor::DefaultProcess(core::Encoding* encoding,
   }
 }
 
+void PostProcessor::DefaultProcessAndPad(core::Encoding* encoding,
+                                         core::Encoding* pair_encoding,
+                                         const core::PadMethod& pad_method,
+                                         uint32_t pad_len,
+                                         core::Encoding* result_encoding) {
+  DefaultProcess(encoding, pair_encoding, result_encoding);
+  if (pad_len > 0) {
+    result_encoding->Pad(pad_len,
+                         pad_method.pad_id_,
+                         pad_method.pad_token_type_id_,
+                         pad_method.pad_token_,
+                         pad_method.direction_);
+  }
+}
+
+void PostProcessor::ProcessAndPad(core::Encoding* encoding,
+                                  core::Encoding* pair_encoding,
+                                  bool add_special_tokens,
+                                  const core::PadMethod& pad_method,
+                                  uint32_t pad_len,
+                                  core::Encoding* result_encoding) const {
+  (*this)(encoding, pair_encoding, add_special_tokens, result_encoding);
+  if (pad_len > 0) {
+    result_encoding->Pad(pad_len,
+                         pad_method.pad_id_,
+                         pad_method.pad_token_type_id_,
+                         pad_method.pad_token_,
+                         pad_method.direction_);
+  }
+}
+
 }  // namespace postprocessors
 }  // namespace fast_tokenizer
 }  // namespace paddlenlp
@@ -15,6 +15,7 @@ limitations under the License. */
 #pragma once
 
 #include <string>
+#include "fast_tokenizer/core/base.h"
 #include "fast_tokenizer/utils/utils.h"
 
 namespace paddlenlp {
@@ -32,9 +33,23 @@ struct FASTTOKENIZER_DECL PostProcessor {
                           core::Encoding* pair_encoding,
                           bool add_special_tokens,
                           core::Encoding* result_encoding) const = 0;
+  // Post process and pad the result to pad_len in one pass. The result is not
+  // padded if pad_len is 0. By default the result of operator() is padded
+  // afterwards.
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const;
   static void DefaultProcess(core::Encoding* encoding,
                              core::Encoding* pair_encoding,
                              core::Encoding* result_encoding);
+  static void DefaultProcessAndPad(core::Encoding* encoding,
+                                   core::Encoding* pair_encoding,
+                                   const core::PadMethod& pad_method,
+                                   uint32_t pad_len,
+                                   core::Encoding* result_encoding);
 };
 }  // namespace postprocessors
 }  // namespace fast_tokenizer
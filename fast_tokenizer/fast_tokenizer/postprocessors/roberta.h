@@ -15,6 +15,7 @@
 #pragma once
 
 #include "fast_tokenizer/postprocessors/postprocessor.h"
+#include "fast_tokenizer/postprocessors/template.h"
 #include "fast_tokenizer/utils/utils.h"
 #include "nlohmann/json.hpp"
 
@@ -33,10 +34,21 @@ struct FASTTOKENIZER_DECL RobertaPostProcessor : public PostProcessor {
                           core::Encoding* pair_encoding,
                           bool add_special_tokens,
                           core::Encoding* result_encoding) const override;
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override;
+  // Compile <s> A </s> and <s> A </s> </s> B </s> from sep_ and cls_. Need to
+  // be called again after sep_ or cls_ is modified.
+  void UpdatePlans();
   std::pair<std::string, uint32_t> sep_;
   std::pair<std::string, uint32_t> cls_;
   bool trim_offsets_;
   bool add_prefix_space_;
+  TemplatePlan single_plan_;
+  TemplatePlan pair_plan_;
   friend void to_json(nlohmann::json& j,
                       const RobertaPostProcessor& roberta_postprocessor);
   friend void from_json(const nlohmann::json& j,
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <string>
 
 #include "fast_tokenizer/core/encoding.h"
@@ -131,6 +133,320 @@ void from_json(const nlohmann::json& j, SpecialToken& special_token) {
   j["tokens"].get_to(special_token.tokens_);
 }
 
+TemplatePlan::TemplatePlan(const Template& template_,
+                           const SpecialTokensMap& special_tokens_map)
+    : has_pair_(false) {
+  for (auto& piece : template_.pieces_) {
+    if (paddlenlp::get_if<TemplateSequence>(&piece) != nullptr) {
+      auto& template_sequence = paddlenlp::get<TemplateSequence>(piece);
+      AddSequence(template_sequence.first, template_sequence.second);
+    } else {
+      auto& template_special_token =
+          paddlenlp::get<TemplateSpecialToken>(piece);
+      auto token_iter =
+          special_tokens_map.tokens_map_.find(template_special_token.first);
+      if (token_iter != special_tokens_map.tokens_map_.end()) {
+        AddSpecialToken(token_iter->second, template_special_token.second);
+      } else {
+        missing_special_tokens_.push_back(template_special_token.first);
+      }
+    }
+  }
+}
+
+void TemplatePlan::Clear() {
+  steps_.clear();
+  special_ids_.clear();
+  special_type_ids_.clear();
+  special_tokens_.clear();
+  missing_special_tokens_.clear();
+  has_pair_ = false;
+}
+
+void TemplatePlan::AddSequence(SequenceType seq_type,
+                               uint32_t type_id,
+                               bool keep_type_ids) {
+  Step step;
+  step.type_ = SEQUENCE_STEP;
+  step.seq_type_ = seq_type;
+  step.type_id_ = type_id;
+  step.keep_type_ids_ = keep_type_ids;
+  step.start_ = step.end_ = special_ids_.size();
+  steps_.push_back(step);
+  if (seq_type == SequenceType::SEQ_B) {
+    has_pair_ = true;
+  }
+}
+
+void TemplatePlan::AddSpecialToken(uint32_t id,
+                                   const std::string& token,
+                                   uint32_t type_id) {
+  AddSpecialToken(SpecialToken(token, id), type_id);
+}
+
+void TemplatePlan::AddSpecialToken(const SpecialToken& special_token,
+                                   uint32_t type_id) {
+  // Adjacent special tokens are merged into one run.
+  if (steps_.empty() || steps_.back().type_ != SPECIAL_STEP) {
+    Step step;
+    step.type_ = SPECIAL_STEP;
+    step.seq_type_ = SequenceType::SEQ_A;
+    step.type_id_ = type_id;
+    step.keep_type_ids_ = false;
+    step.start_ = step.end_ = special_ids_.size();
+    steps_.push_back(step);
+  }
+  special_ids_.insert(
+      special_ids_.end(), special_token.ids_.begin(), special_token.ids_.end());
+  special_tokens_.insert(special_tokens_.end(),
+                         special_token.tokens_.begin(),
+                         special_token.tokens_.end());
+  special_type_ids_.insert(
+      special_type_ids_.end(), special_token.ids_.size(), type_id);
+  steps_.back().end_ = special_ids_.size();
+}
+
+void TemplatePlan::ApplyWindow(const core::Encoding& encoding,
+                               const core::Encoding* pair_encoding,
+                               bool add_special_tokens,
+                               const core::PadMethod& pad_method,
+                               uint32_t pad_len,
+                               core::Encoding* result_encoding) const {
+  if (has_pair_ && pair_encoding == nullptr) {
+    throw std::runtime_error(
+        "Template expected a pair sequence, but none provided");
+  }
+  if (add_special_tokens && !missing_special_tokens_.empty()) {
+    throw std::runtime_error("The special token " +
+                             missing_special_tokens_.front() +
+                             " of template is not in the special tokens map");
+  }
+  // 1. Compute the final length, including the padding
+  size_t new_size = 0;
+  for (auto& step : steps_) {
+    if (step.type_ == SEQUENCE_STEP) {
+      new_size += (step.seq_type_ == SequenceType::SEQ_A)
+                      ? encoding.GetLen()
+                      : pair_encoding->GetLen();
+    } else if (add_special_tokens) {
+      new_size += step.end_ - step.start_;
+    }
+  }
+  size_t content_size = new_size;
+  if (new_size < pad_len) {
+    new_size = pad_len;
+  }
+  // Only the fields that both of the inputs contain are written.
+  uint32_t fields = encoding.GetFields();
+  if (pair_encoding != nullptr) {
+    fields &= pair_encoding->GetFields();
+  }
+  auto field_size = [&](core::EncodeField field) -> size_t {
+    return (fields & field) ? new_size : 0;
+  };
+  bool with_type_ids = (fields & core::TYPE_IDS_FIELD) != 0;
+  bool with_tokens = (fields & core::TOKENS_FIELD) != 0;
+  bool with_words_idx = (fields & core::WORDS_IDX_FIELD) != 0;
+  bool with_offsets = (fields & core::OFFSETS_FIELD) != 0;
+  bool with_special_tokens_mask =
+      (fields & core::SPECIAL_TOKENS_MASK_FIELD) != 0;
+  bool with_attention_mask = (fields & core::ATTENTION_MASK_FIELD) != 0;
+  std::vector<uint32_t> ids(new_size);
+  std::vector<uint32_t> type_ids(field_size(core::TYPE_IDS_FIELD));
+  std::vector<std::string> tokens(field_size(core::TOKENS_FIELD));
+  std::vector<uint32_t> words_idx(field_size(core::WORDS_IDX_FIELD));
+  std::vector<core::Offset> offsets(field_size(core::OFFSETS_FIELD));
+  std::vector<uint32_t> special_tokens_mask(
+      field_size(core::SPECIAL_TOKENS_MASK_FIELD));
+  std::vector<uint32_t> attention_mask(field_size(core::ATTENTION_MASK_FIELD));
+  std::unordered_map<uint32_t, core::Range> sequence_ranges;
+
+  // 2. Fill the padding region
+  size_t pad_size = new_size - content_size;
+  size_t pad_start = content_size;
+  if (pad_method.direction_ == core::Direction::LEFT) {
+    pad_start = 0;
+  }
+  if (pad_size > 0) {
+    std::fill_n(ids.begin() + pad_start, pad_size, pad_method.pad_id_);
+    if (with_type_ids) {
+      std::fill_n(type_ids.begin() + pad_start,
+                  pad_size,
+                  pad_method.pad_token_type_id_);
+    }
+    if (with_tokens) {
+      std::fill_n(tokens.begin() + pad_start, pad_size, pad_method.pad_token_);
+    }
+    if (with_words_idx) {
+      std::fill_n(words_idx.begin() + pad_start,
+                  pad_size,
+                  std::numeric_limits<uint32_t>::max());
+    }
+    if (with_offsets) {
+      std::fill_n(offsets.begin() + pad_start, pad_size, core::Offset(0, 0));
+    }
+    if (with_special_tokens_mask) {
+      std::fill_n(special_tokens_mask.begin() + pad_start, pad_size, 1);
+    }
+    if (with_attention_mask) {
+      std::fill_n(attention_mask.begin() + pad_start, pad_size, 0);
+    }
+  }
+
+  // 3. Copy each step into its position
+  size_t pos = (pad_start == 0) ? pad_size : 0;
+  for (auto& step : steps_) {
+    if (step.type_ == SEQUENCE_STEP) {
+      const core::Encoding* src = &encoding;
+      uint32_t seq_id = 0;
+      if (step.seq_type_ == SequenceType::SEQ_B) {
+        src = pair_encoding;
+        seq_id = 1;
+      }
+      size_t len = src->GetLen();
+      std::copy(src->GetIds().begin(), src->GetIds().end(), ids.begin() + pos);
+      if (with_type_ids) {
+        if (step.keep_type_ids_) {
+          std::copy(src->GetTypeIds().begin(),
+                    src->GetTypeIds().end(),
+                    type_ids.begin() + pos);
+        } else {
+          std::fill_n(type_ids.begin() + pos, len, step.type_id_);
+        }
+      }
+      if (with_tokens) {
+        std::copy(src->GetTokens().begin(),
+                  src->GetTokens().end(),
+                  tokens.begin() + pos);
+      }
+      if (with_words_idx) {
+        std::copy(src->GetWordsIdx().begin(),
+                  src->GetWordsIdx().end(),
+                  words_idx.begin() + pos);
+      }
+      if (with_offsets) {
+        std::copy(src->GetOffsets().begin(),
+                  src->GetOffsets().end(),
+                  offsets.begin() + pos);
+      }
+      if (with_special_tokens_mask) {
+        std::copy(src->GetSpecialTokensMask().begin(),
+                  src->GetSpecialTokensMask().end(),
+                  special_tokens_mask.begin() + pos);
+      }
+      if (with_attention_mask) {
+        std::copy(src->GetAttentionMask().begin(),
+                  src->GetAttentionMask().end(),
+                  attention_mask.begin() + pos);
+      }
+      sequence_ranges[seq_id] = {pos, pos + len};
+      pos += len;
+    } else if (add_special_tokens) {
+      size_t len = step.end_ - step.start_;
+      std::copy(special_ids_.begin() + step.start_,
+                special_ids_.begin() + step.end_,
+                ids.begin() + pos);
+      if (with_type_ids) {
+        std::copy(special_type_ids_.begin() + step.start_,
+                  special_type_ids_.begin() + step.end_,
+                  type_ids.begin() + pos);
+      }
+      if (with_tokens) {
+        std::copy(special_tokens_.begin() + step.start_,
+                  special_tokens_.begin() + step.end_,
+                  tokens.begin() + pos);
+      }
+      if (with_words_idx) {
+        std::fill_n(words_idx.begin() + pos,
+                    len,
+                    std::numeric_limits<uint32_t>::max());
+      }
+      if (with_offsets) {
+        std::fill_n(offsets.begin() + pos, len, core::Offset(0, 0));
+      }
+      if (with_special_tokens_mask) {
+        std::fill_n(special_tokens_mask.begin() + pos, len, 1);
+      }
+      if (with_attention_mask) {
+        std::fill_n(attention_mask.begin() + pos, len, 1);
+      }
+      pos += len;
+    }
+  }
+  *result_encoding = core::Encoding(std::move(ids),
+                                    std::move(type_ids),
+                                    std::move(tokens),
+                                    std::move(words_idx),
+                                    std::move(offsets),
+                                    std::move(special_tokens_mask),
+                                    std::move(attention_mask),
+                                    std::vector<core::Encoding>(),
+                                    std::move(sequence_ranges));
+  result_encoding->SetFields(fields);
+}
+
+void TemplatePlan::operator()(core::Encoding* encoding,
+                              core::Encoding* pair_encoding,
+                              bool add_special_tokens,
+                              core::Encoding* result_encoding) const {
+  (*this)(encoding,
+          pair_encoding,
+          add_special_tokens,
+          core::PadMethod(),
+          0,
+          result_encoding);
+}
+
+void TemplatePlan::operator()(core::Encoding* encoding,
+                              core::Encoding* pair_encoding,
+                              bool add_special_tokens,
+                              const core::PadMethod& pad_method,
+                              uint32_t pad_len,
+                              core::Encoding* result_encoding) const {
+  // The overflowing windows are combined as:
+  // (A_o, B), (A_o, B_o) for each A_o, then (A, B_o) for each B_o.
+  const auto& overflowings = encoding->GetOverflowing();
+  size_t pair_overflowings_num = 0;
+  if (pair_encoding != nullptr) {
+    pair_overflowings_num = pair_encoding->GetOverflowing().size();
+  }
+  std::vector<core::Encoding> result_overflowings(
+      overflowings.size() * (pair_overflowings_num + 1) +
+      pair_overflowings_num);
+  size_t idx = 0;
+  for (auto& overflow_encoding : overflowings) {
+    ApplyWindow(overflow_encoding,
+                pair_encoding,
+                add_special_tokens,
+                pad_method,
+                pad_len,
+                &result_overflowings[idx++]);
+    for (size_t i = 0; i < pair_overflowings_num; ++i) {
+      ApplyWindow(overflow_encoding,
+                  &pair_encoding->GetOverflowing()[i],
+                  add_special_tokens,
+                  pad_method,
+                  pad_len,
+                  &result_overflowings[idx++]);
+    }
+  }
+  for (size_t i = 0; i < pair_overflowings_num; ++i) {
+    ApplyWindow(*encoding,
+                &pair_encoding->GetOverflowing()[i],
+                add_special_tokens,
+                pad_method,
+                pad_len,
+                &result_overflowings[idx++]);
+  }
+  ApplyWindow(*encoding,
+              pair_encoding,
+              add_special_tokens,
+              pad_method,
+              pad_len,
+              result_encoding);
+  result_encoding->GetMutableOverflowing() = std::move(result_overflowings);
+}
+
 size_t TemplatePostProcessor::CountAdded(
     Template* template_, const SpecialTokensMap& special_tokens_map) {
   size_t count = 0;
@@ -187,6 +503,8 @@ size_t TemplatePostProcessor::DefaultAdded(bool is_single) {
 }
 
 void TemplatePostProcessor::UpdateAddedTokensNum() {
+  single_plan_ = TemplatePlan(single_, special_tokens_map_);
+  pair_plan_ = TemplatePlan(pair_, special_tokens_map_);
   added_single_ = DefaultAdded(true);
   added_pair_ = DefaultAdded(false);
 }
@@ -194,23 +512,27 @@ void TemplatePostProcessor::UpdateAddedTokensNum() {
 void TemplatePostProcessor::UpdateSinglePieces(
     const std::string& template_str) {
   single_.GetPiecesFromStr(template_str);
+  single_plan_ = TemplatePlan(single_, special_tokens_map_);
   added_single_ = DefaultAdded(true);
 }
 
 void TemplatePostProcessor::UpdateSinglePieces(
     const std::vector<std::string>& pieces) {
   single_.GetPiecesFromVec(pieces);
+  single_plan_ = TemplatePlan(single_, special_tokens_map_);
   added_single_ = DefaultAdded(true);
 }
 
 void TemplatePostProcessor::UpdatePairPieces(const std::string& template_str) {
   pair_.GetPiecesFromStr(template_str);
+  pair_plan_ = TemplatePlan(pair_, special_tokens_map_);
   added_pair_ = DefaultAdded(false);
 }
 
 void TemplatePostProcessor::UpdatePairPieces(
     const std::vector<std::string>& pieces) {
   pair_.GetPiecesFromVec(pieces);
+  pair_plan_ = TemplatePlan(pair_, special_tokens_map_);
   added_pair_ = DefaultAdded(false);
 }
 
@@ -243,176 +565,8 @@ void TemplatePostProcessor::ApplyTemplate(
     core::Encoding* pair_encoding,
     bool add_special_tokens,
     core::Encoding* result_encoding) const {
-  size_t new_size = 0;
-  for (auto&& piece : pieces.pieces_) {
-    if (paddlenlp::get_if<TemplateSequence>(&piece) != nullptr) {
-      auto seq_type = paddlenlp::get<TemplateSequence>(piece).first;
-      if (seq_type == SequenceType::SEQ_A) {
-        new_size += encoding->GetLen();
-      } else {
-        if (pair_encoding == nullptr) {
-          throw std::runtime_error(
-              "Template expected a pair sequence, but none provided");
-        }
-        new_size += pair_encoding->GetLen();
-      }
-    } else {
-      if (add_special_tokens) {
-        auto&& special_token =
-            paddlenlp::get<TemplateSpecialToken>(piece).first;
-        if (special_tokens_map_.tokens_map_.find(special_token) !=
-            special_tokens_map_.tokens_map_.end()) {
-          new_size +=
-              special_tokens_map_.tokens_map_.at(special_token).ids_.size();
-        }
-      }
-    }
-  }
-  std::vector<uint32_t> ids;
-  ids.reserve(new_size);
-  std::vector<uint32_t> type_ids;
-  type_ids.reserve(new_size);
-  std::vector<std::string> tokens;
-  tokens.reserve(new_size);
-  std::vector<uint32_t> words_idx;
-  words_idx.reserve(new_size);
-  std::vector<core::Offset> offsets;
-  offsets.reserve(new_size);
-  std::vector<uint32_t> special_tokens_mask;
-  special_tokens_mask.reserve(new_size);
-  std::vector<uint32_t> attention_mask;
-  attention_mask.reserve(new_size);
-  std::unordered_map<uint32_t, core::Range> sequence_ranges;
-  std::vector<core::Encoding> result_overflowings;
-  auto& overflowings = encoding->GetMutableOverflowing();
-
-  core::Encoding result_overflowing_encoding;
-  for (auto& overflow_encoding : overflowings) {
-    core::Encoding encoding_copy = overflow_encoding;
-    core::Encoding pair_encoding_copy;
-    if (pair_encoding != nullptr) {
-      pair_encoding_copy = *pair_encoding;
-      ApplyTemplate(pieces,
-                    &encoding_copy,
-                    &pair_encoding_copy,
-                    add_special_tokens,
-                    &result_overflowing_encoding);
-      result_overflowings.push_back(result_overflowing_encoding);
-      for (auto& pair_overflow_encoding :
-           pair_encoding->GetMutableOverflowing()) {
-        core::Encoding pair_encoding_copy = pair_overflow_encoding;
-        ApplyTemplate(pieces,
-                      &encoding_copy,
-                      &pair_encoding_copy,
-                      add_special_tokens,
-                      &result_overflowing_encoding);
-        result_overflowings.push_back(result_overflowing_encoding);
-      }
-    } else {
-      ApplyTemplate(pieces,
-                    &encoding_copy,
-                    pair_encoding,
-                    add_special_tokens,
-                    &result_overflowing_encoding);
-      result_overflowings.push_back(result_overflowing_encoding);
-    }
-  }
-  if (pair_encoding != nullptr) {
-    for (auto& pair_overflow_encoding :
-         pair_encoding->GetMutableOverflowing()) {
-      core::Encoding encoding_copy = *encoding;
-      core::Encoding pair_encoding_copy = pair_overflow_encoding;
-      ApplyTemplate(pieces,
-                    &encoding_copy,
-                    &pair_encoding_copy,
-                    add_special_tokens,
-                    &result_overflowing_encoding);
-      result_overflowings.push_back(result_overflowing_encoding);
-    }
-  }
-  VLOG(6) << "Template pieces num: " << pieces.pieces_.size();
-  for (auto& piece : pieces.pieces_) {
-    if (paddlenlp::get_if<TemplateSequence>(&piece) != nullptr) {
-      auto& template_sequence = paddlenlp::get<TemplateSequence>(piece);
-      if (template_sequence.first == SequenceType::SEQ_A) {
-        auto seq_start = ids.size();
-        auto seq_end = seq_start + encoding->GetLen();
-        sequence_ranges[0] = {seq_start, seq_end};
-        ids.insert(
-            ids.end(), encoding->GetIds().begin(), encoding->GetIds().end());
-        type_ids.insert(
-            type_ids.end(), encoding->GetLen(), template_sequence.second);
-        tokens.insert(tokens.end(),
-                      encoding->GetTokens().begin(),
-                      encoding->GetTokens().end());
-        words_idx.insert(words_idx.end(),
-                         encoding->GetWordsIdx().begin(),
-                         encoding->GetWordsIdx().end());
-        offsets.insert(offsets.end(),
-                       encoding->GetOffsets().begin(),
-                       encoding->GetOffsets().end());
-        special_tokens_mask.insert(special_tokens_mask.end(),
-                                   encoding->GetSpecialTokensMask().begin(),
-                                   encoding->GetSpecialTokensMask().end());
-        attention_mask.insert(attention_mask.end(),
-                              encoding->GetAttentionMask().begin(),
-                              encoding->GetAttentionMask().end());
-      } else if (template_sequence.first == SequenceType::SEQ_B) {
-        if (pair_encoding == nullptr) {
-          throw std::runtime_error("Missing pair sequence, checked above");
-        }
-        auto seq_start = ids.size();
-        auto seq_end = seq_start + pair_encoding->GetLen();
-        sequence_ranges[0] = {seq_start, seq_end};
-        ids.insert(ids.end(),
-                   pair_encoding->GetIds().begin(),
-                   pair_encoding->GetIds().end());
-        type_ids.insert(
-            type_ids.end(), pair_encoding->GetLen(), template_sequence.second);
-        tokens.insert(tokens.end(),
-                      pair_encoding->GetTokens().begin(),
-                      pair_encoding->GetTokens().end());
-        words_idx.insert(words_idx.end(),
-                         pair_encoding->GetWordsIdx().begin(),
-                         pair_encoding->GetWordsIdx().end());
-        offsets.insert(offsets.end(),
-                       pair_encoding->GetOffsets().begin(),
-                       pair_encoding->GetOffsets().end());
-        special_tokens_mask.insert(
-            special_tokens_mask.end(),
-            pair_encoding->GetSpecialTokensMask().begin(),
-            pair_encoding->GetSpecialTokensMask().end());
-        attention_mask.insert(attention_mask.end(),
-                              pair_encoding->GetAttentionMask().begin(),
-                              pair_encoding->GetAttentionMask().end());
-      }
-    } else {
-      auto& special_token = paddlenlp::get<TemplateSpecialToken>(piece);
-      if (add_special_tokens) {
-        const std::string& id = special_token.first;
-        uint32_t type_id = special_token.second;
-        auto& tok = special_tokens_map_.tokens_map_.at(
-            id);  // We already checked existance above
-        auto size = tok.ids_.size();
-        ids.insert(ids.end(), tok.ids_.begin(), tok.ids_.end());
-        type_ids.insert(type_ids.end(), size, type_id);
-        tokens.insert(tokens.end(), tok.tokens_.begin(), tok.tokens_.end());
-        words_idx.insert(words_idx.end(), size, -1 /* 2^32 */);
-        offsets.insert(offsets.end(), size, {0, 0});
-        special_tokens_mask.insert(special_tokens_mask.end(), size, 1);
-        attention_mask.insert(attention_mask.end(), size, 1);
-      }
-    }
-  }
-  *result_encoding = core::Encoding(std::move(ids),
-                                    std::move(type_ids),
-                                    std::move(tokens),
-                                    std::move(words_idx),
-                                    std::move(offsets),
-                                    std::move(special_tokens_mask),
-                                    std::move(attention_mask),
-                                    std::move(result_overflowings),
-                                    std::move(sequence_ranges));
+  TemplatePlan plan(pieces, special_tokens_map_);
+  plan(encoding, pair_encoding, add_special_tokens, result_encoding);
 }
 
 void TemplatePostProcessor::operator()(core::Encoding* encoding,
@@ -420,14 +574,28 @@ void TemplatePostProcessor::operator()(core::Encoding* encoding,
                                        bool add_special_tokens,
                                        core::Encoding* result_encoding) const {
   if (pair_encoding != nullptr) {
-    ApplyTemplate(
-        pair_, encoding, pair_encoding, add_special_tokens, result_encoding);
+    pair_plan_(encoding, pair_encoding, add_special_tokens, result_encoding);
   } else {
-    ApplyTemplate(
-        single_, encoding, pair_encoding, add_special_tokens, result_encoding);
+    single_plan_(encoding, pair_encoding, add_special_tokens, result_encoding);
   }
 }
 
+void TemplatePostProcessor::ProcessAndPad(core::Encoding* encoding,
+                                          core::Encoding* pair_encoding,
+                                          bool add_special_tokens,
+                                          const core::PadMethod& pad_method,
+                                          uint32_t pad_len,
+                                          core::Encoding* result_encoding) const {
+  const TemplatePlan& plan =
+      (pair_encoding != nullptr) ? pair_plan_ : single_plan_;
+  plan(encoding,
+       pair_encoding,
+       add_special_tokens,
+       pad_method,
+       pad_len,
+       result_encoding);
+}
+
 void to_json(nlohmann::json& j,
              const TemplatePostProcessor& template_postprocessor) {
   j = {
@@ -443,10 +611,7 @@ void from_json(const nlohmann::json& j,
   j["single"].get_to(template_postprocessor.single_);
   j["pair"].get_to(template_postprocessor.pair_);
   j["special_tokens"].get_to(template_postprocessor.special_tokens_map_);
-  template_postprocessor.added_single_ =
-      template_postprocessor.DefaultAdded(true);
-  template_postprocessor.added_pair_ =
-      template_postprocessor.DefaultAdded(false);
+  template_postprocessor.UpdateAddedTokensNum();
 }
 
 }  // namespace postprocessors
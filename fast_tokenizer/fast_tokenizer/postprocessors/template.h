@@ -147,6 +147,65 @@ struct FASTTOKENIZER_DECL SpecialTokensMap {
   friend void from_json(const nlohmann::json& j, SpecialTokensMap& tokens_map);
 };
 
+// A template compiled into a flat list of steps. The special tokens are
+// resolved once into contiguous id/token runs, so that applying the plan only
+// sizes the output once and copies the input sequences and the special runs
+// into it.
+struct FASTTOKENIZER_DECL TemplatePlan {
+  enum StepType { SEQUENCE_STEP, SPECIAL_STEP };
+  struct Step {
+    StepType type_;
+    // Used by SEQUENCE_STEP
+    SequenceType seq_type_;
+    uint32_t type_id_;
+    bool keep_type_ids_;
+    // Used by SPECIAL_STEP: the range of the special run in special_ids_
+    size_t start_;
+    size_t end_;
+  };
+  TemplatePlan() : has_pair_(false) {}
+  TemplatePlan(const Template& template_,
+               const SpecialTokensMap& special_tokens_map);
+
+  void Clear();
+  // If keep_type_ids is true, the type ids of the input sequence are copied
+  // instead of being filled with type_id.
+  void AddSequence(SequenceType seq_type,
+                   uint32_t type_id,
+                   bool keep_type_ids = false);
+  void AddSpecialToken(uint32_t id, const std::string& token, uint32_t type_id);
+  void AddSpecialToken(const SpecialToken& special_token, uint32_t type_id);
+  size_t AddedTokensNum() const { return special_ids_.size(); }
+  // Apply the plan to the encodings and all their overflowing windows.
+  void operator()(core::Encoding* encoding,
+                  core::Encoding* pair_encoding,
+                  bool add_special_tokens,
+                  core::Encoding* result_encoding) const;
+  // Same as above, but every window is written padded to pad_len.
+  void operator()(core::Encoding* encoding,
+                  core::Encoding* pair_encoding,
+                  bool add_special_tokens,
+                  const core::PadMethod& pad_method,
+                  uint32_t pad_len,
+                  core::Encoding* result_encoding) const;
+  // Apply the plan to a single window, the overflowing encodings are ignored.
+  // The window is padded to pad_len if it's shorter.
+  void ApplyWindow(const core::Encoding& encoding,
+                   const core::Encoding* pair_encoding,
+                   bool add_special_tokens,
+                   const core::PadMethod& pad_method,
+                   uint32_t pad_len,
+                   core::Encoding* result_encoding) const;
+
+  std::vector<Step> steps_;
+  std::vector<uint32_t> special_ids_;
+  std::vector<uint32_t> special_type_ids_;
+  std::vector<std::string> special_tokens_;
+  // The special tokens of the template that are missing in the tokens map.
+  std::vector<std::string> missing_special_tokens_;
+  bool has_pair_;
+};
+
 struct FASTTOKENIZER_DECL TemplatePostProcessor : public PostProcessor {
   TemplatePostProcessor();
   TemplatePostProcessor(const Template&,
@@ -158,6 +217,12 @@ struct FASTTOKENIZER_DECL TemplatePostProcessor : public PostProcessor {
                           bool add_special_tokens,
                           core::Encoding* result_encoding) const override;
   virtual size_t AddedTokensNum(bool is_pair) const override;
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override;
 
   void UpdateSinglePieces(const std::string& template_str);
   void UpdateSinglePieces(const std::vector<std::string>& pieces);
@@ -184,6 +249,10 @@ struct FASTTOKENIZER_DECL TemplatePostProcessor : public PostProcessor {
   size_t added_single_;
   size_t added_pair_;
   SpecialTokensMap special_tokens_map_;
+  // Compiled from single_, pair_ and special_tokens_map_ whenever one of them
+  // is updated.
+  TemplatePlan single_plan_;
+  TemplatePlan pair_plan_;
 };
 
 }  // namespace postprocessors
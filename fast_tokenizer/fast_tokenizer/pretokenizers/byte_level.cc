@@ -13,8 +13,6 @@
 // limitations under the License.
 
 #include "fast_tokenizer/pretokenizers/byte_level.h"
-#include <codecvt>
-#include <locale>
 #include "fast_tokenizer/utils/utf8.h"
 #include "fast_tokenizer/utils/utils.h"
 #include "glog/logging.h"
@@ -34,8 +32,11 @@ static re2::RE2 pattern(
 static std::unordered_map<uint8_t, uint32_t> BYTES_TO_CHARS =
     utils::CreateBytesToChars();
 ByteLevelPreTokenizer::ByteLevelPreTokenizer(bool add_prefix_space,
-                                             bool use_regex)
-    : add_prefix_space_(add_prefix_space), use_regex_(use_regex) {}
+                                             bool use_regex,
+                                             bool remap_bytes)
+    : add_prefix_space_(add_prefix_space),
+      use_regex_(use_regex),
+      remap_bytes_(remap_bytes) {}
 
 
 void ByteLevelPreTokenizer::operator()(PreTokenizedString* pretokenized) const {
@@ -58,6 +59,9 @@ void ByteLevelPreTokenizer::operator()(PreTokenizedString* pretokenized) const {
       string_splits->emplace_back(*normalized);
     }
   });
+  if (!remap_bytes_) {
+    return;
+  }
   pretokenized->Normalize([](normalizers::NormalizedString* normalized) {
     const std::string& str = normalized->GetStr();
     std::u32string u32normalized;
@@ -89,6 +93,7 @@ void to_json(nlohmann::json& j,
       {"type", "ByteLevelPreTokenizer"},
       {"add_prefix_space", byte_pre_tokenizer.add_prefix_space_},
       {"use_regex", byte_pre_tokenizer.use_regex_},
+      {"remap_bytes", byte_pre_tokenizer.remap_bytes_},
   };
 }
 
@@ -96,32 +101,36 @@ void to_json(nlohmann::json& j,
 void from_json(const nlohmann::json& j,
                ByteLevelPreTokenizer& byte_pre_tokenizer) {
   j.at("add_prefix_space").get_to(byte_pre_tokenizer.add_prefix_space_);
-  j.at("use_regex").get_to(byte_pre_tokenizer.add_prefix_space_);
+  j.at("use_regex").get_to(byte_pre_tokenizer.use_regex_);
+  byte_pre_tokenizer.remap_bytes_ = true;
+  if (j.find("remap_bytes") != j.end()) {
+    j.at("remap_bytes").get_to(byte_pre_tokenizer.remap_bytes_);
+  }
 }
 
 void ProcessOffsets(core::Encoding* encoding, bool add_prefix_space) {
+  // Nothing to trim if the offsets are skipped
+  if (!encoding->HasField(core::OFFSETS_FIELD)) {
+    return;
+  }
+  const uint32_t space_char = BYTES_TO_CHARS.at(' ');
   auto process_token_fn = [&](
       uint32_t i, const std::string& token, core::Offset* offset) -> void {
     uint32_t leading_spaces = 0;
     uint32_t trailing_spaces = 0;
-
-    std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> conv;
-    std::u32string u32token = conv.from_bytes(token);
-    for (int i = 0; i < u32token.size(); ++i) {
-      if (utils::IsWhiteSpace(u32token[i]) ||
-          u32token[i] == BYTES_TO_CHARS.at(' ')) {
-        ++leading_spaces;
-      } else {
-        break;
-      }
-    }
-
-    for (int i = u32token.size() - 1; i >= 0; --i) {
-      if (utils::IsWhiteSpace(u32token[i]) ||
-          u32token[i] == BYTES_TO_CHARS.at(' ')) {
+    bool is_leading = true;
+    // Count the spaces of both ends in one pass over the chars of the token.
+    size_t pos = 0;
+    while (pos < token.length()) {
+      uint32_t chr;
+      pos += utils::UTF8ToUInt32(token.data() + pos, &chr);
+      chr = utils::UTF8ToUnicode(chr);
+      if (utils::IsWhiteSpace(chr) || chr == space_char) {
+        leading_spaces += is_leading;
         ++trailing_spaces;
       } else {
-        break;
+        is_leading = false;
+        trailing_spaces = 0;
       }
     }
 
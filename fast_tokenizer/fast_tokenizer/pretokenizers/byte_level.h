@@ -23,8 +23,14 @@ namespace paddlenlp {
 namespace fast_tokenizer {
 namespace pretokenizers {
 
+// Split the text like GPT-2, and map every byte of the splits to a visible
+// char. If remap_bytes is false, the bytes are kept as they are, and should
+// be tokenized by a byte level BPE, which saves mapping the bytes and their
+// offsets.
 struct FASTTOKENIZER_DECL ByteLevelPreTokenizer : public PreTokenizer {
-  ByteLevelPreTokenizer(bool add_prefix_space = true, bool use_regex = true);
+  ByteLevelPreTokenizer(bool add_prefix_space = true,
+                        bool use_regex = true,
+                        bool remap_bytes = true);
   virtual void operator()(PreTokenizedString* pretokenized) const override;
   friend void to_json(nlohmann::json& j,
                       const ByteLevelPreTokenizer& byte_pre_tokenizer);
@@ -34,6 +40,7 @@ struct FASTTOKENIZER_DECL ByteLevelPreTokenizer : public PreTokenizer {
 private:
   bool add_prefix_space_;
   bool use_regex_;
+  bool remap_bytes_;
 };
 
 void FASTTOKENIZER_DECL ProcessOffsets(core::Encoding* encoding,
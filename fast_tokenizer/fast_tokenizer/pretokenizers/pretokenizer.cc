@@ -150,9 +150,11 @@ bool PreTokenizedString::TransformToEncoding(
     const std::vector<uint32_t>& input_word_idx,
     uint32_t type_id,
     core::OffsetType offset_type,
-    core::Encoding* encoding) const {
+    core::Encoding* encoding,
+    uint32_t fields) const {
   if (splits_.empty()) {
     *encoding = core::Encoding();
+    encoding->SetFields(fields);
     return true;
   }
   for (const auto& split : splits_) {
@@ -166,73 +168,87 @@ bool PreTokenizedString::TransformToEncoding(
 
   if (offset_type == core::OffsetType::CHAR) {
     return TransformToEncodingUseConvertor<BytesToCharOffsetConverter>(
-        input_word_idx, type_id, encoding);
+        input_word_idx, type_id, encoding, fields);
   }
   return TransformToEncodingUseConvertor<OffsetConverter>(
-      input_word_idx, type_id, encoding);
+      input_word_idx, type_id, encoding, fields);
 }
 
 template <typename Convertor>
 bool PreTokenizedString::TransformToEncodingUseConvertor(
     const std::vector<uint32_t>& input_word_idx,
     uint32_t type_id,
-    core::Encoding* encoding) const {
-  Convertor converter(original_);
+    core::Encoding* encoding,
+    uint32_t fields) const {
+  bool with_tokens = (fields & core::TOKENS_FIELD) != 0;
+  bool with_offsets = (fields & core::OFFSETS_FIELD) != 0;
+  // Building the converter is expensive for the char offsets, skip it if the
+  // offsets are not needed.
+  std::unique_ptr<Convertor> converter;
+  if (with_offsets) {
+    converter = utils::make_unique<Convertor>(original_);
+  }
   uint32_t tokens_size = 0;
   for (int i = 0; i < splits_.size(); ++i) {
     tokens_size += splits_[i].tokens_.size();
   }
 
   std::vector<uint32_t> token_ids(tokens_size);
-  std::vector<std::string> tokens(tokens_size);
-  std::vector<core::Offset> offsets(tokens_size);
+  std::vector<std::string> tokens(with_tokens ? tokens_size : 0);
+  std::vector<core::Offset> offsets(with_offsets ? tokens_size : 0);
   uint32_t curr_idx = 0;
   for (int i = 0; i < splits_.size(); ++i) {
     const auto& split = splits_[i];
     const auto& normalized = split.normalized_;
     auto offset = normalized.GetOrginalOffset();
     core::Offset tmp_offset;
-    bool has_set_offset = false;
     for (const auto& token : split.tokens_) {
-      auto token_offset = token.offset_;
-      bool flag = normalized.ConvertOffsets(&token_offset, false);
-      if (flag) {
-        token_offset.first += offset.first;
-        token_offset.second += offset.first;
+      token_ids[curr_idx] = token.id_;
+      if (with_tokens) {
+        tokens[curr_idx] = token.value_;
       }
-      if (has_set_offset) {
-        offset = token_offset;
-        has_set_offset = true;
+      if (with_offsets) {
+        auto token_offset = token.offset_;
+        bool flag = normalized.ConvertOffsets(&token_offset, false);
+        if (flag) {
+          token_offset.first += offset.first;
+          token_offset.second += offset.first;
+        }
+        converter->convert(token_offset, &tmp_offset);
+        offsets[curr_idx] = tmp_offset;
       }
-      converter.convert(token_offset, &tmp_offset);
-      token_ids[curr_idx] = token.id_;
-      tokens[curr_idx] = token.value_;
-      offsets[curr_idx] = tmp_offset;
       ++curr_idx;
     }
   }
   // Setting words_idx
-  std::vector<uint32_t> words_idx(tokens_size);
-  if (input_word_idx.size() == 0) {
-    uint32_t word_offset = 0;
-    for (uint32_t i = 0; i < splits_.size(); ++i) {
-      std::fill_n(
-          words_idx.begin() + word_offset, splits_[i].tokens_.size(), i);
-      word_offset += splits_[i].tokens_.size();
+  std::vector<uint32_t> words_idx;
+  if (fields & core::WORDS_IDX_FIELD) {
+    words_idx.resize(tokens_size);
+    if (input_word_idx.size() == 0) {
+      uint32_t word_offset = 0;
+      for (uint32_t i = 0; i < splits_.size(); ++i) {
+        std::fill_n(
+            words_idx.begin() + word_offset, splits_[i].tokens_.size(), i);
+        word_offset += splits_[i].tokens_.size();
+      }
+    } else {
+      std::fill(words_idx.begin(), words_idx.end(), input_word_idx[0]);
     }
-  } else {
-    std::fill(words_idx.begin(), words_idx.end(), input_word_idx[0]);
   }
+  auto field_size = [&](core::EncodeField field) -> size_t {
+    return (fields & field) ? tokens_size : 0;
+  };
   *encoding = std::move(core::Encoding(
       std::move(token_ids),
-      std::vector<uint32_t>(tokens_size, type_id),  // type_ids
+      std::vector<uint32_t>(field_size(core::TYPE_IDS_FIELD), type_id),
       std::move(tokens),
       std::move(words_idx),
       std::move(offsets),
-      std::vector<uint32_t>(tokens_size, 0), /* special_tokens_mask */
-      std::vector<uint32_t>(tokens_size, 1), /* attention_mask */
-      std::vector<core::Encoding>(),         /* overflowing */
+      std::vector<uint32_t>(field_size(core::SPECIAL_TOKENS_MASK_FIELD), 0),
+      std::vector<uint32_t>(field_size(core::ATTENTION_MASK_FIELD), 1),
+      std::vector<core::Encoding>(),              /* overflowing */
       std::unordered_map<uint32_t, core::Range>() /* sequence_ranges */));
+  encoding->SetFields(fields);
   return true;
 }
 
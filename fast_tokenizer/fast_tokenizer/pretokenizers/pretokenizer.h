@@ -67,14 +67,18 @@ public:
   // For wordpiece, bpe ......
   void Tokenize(std::function<std::vector<core::Token>(
                     normalizers::NormalizedString*)> tokenize_fn);
+  // fields is a mask of core::EncodeField, the offsets are not converted if
+  // they are skipped.
   bool TransformToEncoding(const std::vector<uint32_t>& word_idx,
                            uint32_t type_id,
                            core::OffsetType offset_type,
-                           core::Encoding* encodings) const;
+                           core::Encoding* encodings,
+                           uint32_t fields = core::ALL_FIELDS) const;
   template <typename Convertor>
   bool TransformToEncodingUseConvertor(const std::vector<uint32_t>& word_idx,
                                        uint32_t type_id,
-                                       core::Encoding* encodings) const;
+                                       core::Encoding* encodings,
+                                       uint32_t fields) const;
   size_t GetSplitsSize() const;
   StringSplit GetSplit(int idx) const;
   const std::string& GetOriginStr() const;
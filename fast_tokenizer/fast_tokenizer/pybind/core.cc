@@ -141,26 +141,62 @@ void BindCore(pybind11::module* m) {
            [](const core::Encoding& self,
               uint32_t char_pos,
               uint32_t seq_id) -> py::object {
-             auto token_idxs = self.CharOffsetsToTokenIdx(char_pos, seq_id);
-             if (token_idxs.size() == 0) {
+             uint32_t token_idx;
+             if (!self.CharOffsetToTokenIdx(char_pos, seq_id, &token_idx)) {
                return py::none();
              }
-             return py::cast(token_idxs[0]);
+             return py::cast(token_idx);
            },
            py::arg("char_pos"),
            py::arg("sequence_index") = 0)
+      .def("char_to_token_batch",
+           [](const core::Encoding& self,
+              const std::vector<uint32_t>& char_positions,
+              uint32_t seq_id) {
+             py::list results(char_positions.size());
+             uint32_t token_idx;
+             for (size_t i = 0; i < char_positions.size(); ++i) {
+               if (self.CharOffsetToTokenIdx(
+                       char_positions[i], seq_id, &token_idx)) {
+                 results[i] = py::cast(token_idx);
+               } else {
+                 results[i] = py::none();
+               }
+             }
+             return results;
+           },
+           py::arg("char_positions"),
+           py::arg("sequence_index") = 0)
       .def("char_to_word",
            [](const core::Encoding& self,
               uint32_t char_pos,
               uint32_t seq_id) -> py::object {
-             auto word_idxs = self.CharOffsetsToWordIdx(char_pos, seq_id);
-             if (word_idxs.size() == 0) {
+             uint32_t word_idx;
+             if (!self.CharOffsetToWordIdx(char_pos, seq_id, &word_idx)) {
                return py::none();
              }
-             return py::cast(word_idxs[0]);
+             return py::cast(word_idx);
            },
            py::arg("char_pos"),
            py::arg("sequence_index") = 0)
+      .def("char_to_word_batch",
+           [](const core::Encoding& self,
+              const std::vector<uint32_t>& char_positions,
+              uint32_t seq_id) {
+             py::list results(char_positions.size());
+             uint32_t word_idx;
+             for (size_t i = 0; i < char_positions.size(); ++i) {
+               if (self.CharOffsetToWordIdx(
+                       char_positions[i], seq_id, &word_idx)) {
+                 results[i] = py::cast(word_idx);
+               } else {
+                 results[i] = py::none();
+               }
+             }
+             return results;
+           },
+           py::arg("char_positions"),
+           py::arg("sequence_index") = 0)
       .def_static("merge",
                   &core::Encoding::Merge,
                   py::arg("encodings"),
@@ -187,56 +223,95 @@ void BindCore(pybind11::module* m) {
            py::arg("pad_token") = "[PAD]")
       .def("token_to_chars",
            [](const core::Encoding& self, uint32_t token_index) -> py::object {
-             auto offsets = self.TokenIdxToCharOffsets(token_index);
-             if (offsets.size() == 0) {
+             uint32_t seq_id;
+             core::Offset offset;
+             if (!self.TokenIdxToCharOffset(token_index, &seq_id, &offset)) {
                return py::none();
              }
-             return py::cast(offsets[0]);
+             return py::cast(std::make_pair(seq_id, offset));
            },
            py::arg("token_index"))
       .def("token_to_sequence",
            [](const core::Encoding& self, uint32_t token_index) -> py::object {
-             auto seq_ids = self.TokenIdxToSequenceIds(token_index);
-             if (seq_ids.size() == 0) {
+             uint32_t seq_id;
+             if (!self.TokenIdxToSequenceId(token_index, &seq_id)) {
                return py::none();
              }
-             return py::cast(seq_ids[0]);
+             return py::cast(seq_id);
            },
            py::arg("token_index"))
       .def("token_to_word",
            [](const core::Encoding& self, uint32_t token_index) -> py::object {
-             auto word_idx = self.TokenIdxToWordIdx(token_index);
-             if (word_idx.size() == 0) {
+             uint32_t seq_id;
+             uint32_t word_idx;
+             if (!self.TokenIdxToWordIdx(token_index, &seq_id, &word_idx)) {
                return py::none();
              }
-             return py::cast(word_idx[0].second);
+             return py::cast(word_idx);
            },
            py::arg("token_index"))
       .def("word_to_chars",
            [](const core::Encoding& self,
               uint32_t word_index,
               uint32_t sequence_index) -> py::object {
-             auto ranges =
-                 self.WordIdxToCharOffsets(word_index, sequence_index);
-             if (ranges.size() == 0) {
+             core::Offset offset;
+             if (!self.WordIdxToCharOffset(
+                     word_index, sequence_index, &offset)) {
                return py::none();
              }
-             return py::cast(ranges[0]);
+             return py::cast(offset);
            },
            py::arg("word_index"),
            py::arg("sequence_index") = 0)
+      .def("word_to_chars_batch",
+           [](const core::Encoding& self,
+              const std::vector<uint32_t>& word_indices,
+              uint32_t sequence_index) {
+             py::list results(word_indices.size());
+             core::Offset offset;
+             for (size_t i = 0; i < word_indices.size(); ++i) {
+               if (self.WordIdxToCharOffset(
+                       word_indices[i], sequence_index, &offset)) {
+                 results[i] = py::cast(offset);
+               } else {
+                 results[i] = py::none();
+               }
+             }
+             return results;
+           },
+           py::arg("word_indices"),
+           py::arg("sequence_index") = 0)
       .def("word_to_tokens",
            [](const core::Encoding& self,
               uint32_t word_index,
               uint32_t sequence_index) -> py::object {
-             auto ranges = self.WordIdxToTokensIdx(word_index, sequence_index);
-             if (ranges.size() == 0) {
+             core::Range token_range;
+             if (!self.WordIdxToTokenRange(
+                     word_index, sequence_index, &token_range)) {
                return py::none();
              }
-             return py::cast(ranges[0]);
+             return py::cast(token_range);
            },
            py::arg("word_index"),
            py::arg("sequence_index") = 0)
+      .def("word_to_tokens_batch",
+           [](const core::Encoding& self,
+              const std::vector<uint32_t>& word_indices,
+              uint32_t sequence_index) {
+             py::list results(word_indices.size());
+             core::Range token_range;
+             for (size_t i = 0; i < word_indices.size(); ++i) {
+               if (self.WordIdxToTokenRange(
+                       word_indices[i], sequence_index, &token_range)) {
+                 results[i] = py::cast(token_range);
+               } else {
+                 results[i] = py::none();
+               }
+             }
+             return results;
+           },
+           py::arg("word_indices"),
+           py::arg("sequence_index") = 0)
       .def("truncate",
            [](core::Encoding& self,
               size_t max_length,
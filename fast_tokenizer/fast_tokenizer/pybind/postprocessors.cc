@@ -25,6 +25,14 @@ namespace paddlenlp {
 namespace fast_tokenizer {
 namespace pybind {
 
+// Return true if the python object overrides __call__, in which case the
+// fused ProcessAndPad of the builtin post-processors must not be used.
+template <typename T>
+static bool HasCallOverride(const T* this_ptr) {
+  py::gil_scoped_acquire gil;
+  return static_cast<bool>(py::get_overload(this_ptr, "__call__"));
+}
+
 class PyPostProcessor : public postprocessors::PostProcessor {
 public:
   using PostProcessor::PostProcessor;
@@ -73,6 +81,28 @@ public:
                            AddedTokensNum,
                            is_pair);
   }
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override {
+    if (HasCallOverride(this)) {
+      PostProcessor::ProcessAndPad(encoding,
+                                   pair_encoding,
+                                   add_special_tokens,
+                                   pad_method,
+                                   pad_len,
+                                   result_encoding);
+    } else {
+      BertPostProcessor::ProcessAndPad(encoding,
+                                       pair_encoding,
+                                       add_special_tokens,
+                                       pad_method,
+                                       pad_len,
+                                       result_encoding);
+    }
+  }
 };
 
 class PyTemplatePostProcessor : public postprocessors::TemplatePostProcessor {
@@ -98,6 +128,28 @@ public:
                            AddedTokensNum,
                            is_pair);
   }
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override {
+    if (HasCallOverride(this)) {
+      PostProcessor::ProcessAndPad(encoding,
+                                   pair_encoding,
+                                   add_special_tokens,
+                                   pad_method,
+                                   pad_len,
+                                   result_encoding);
+    } else {
+      TemplatePostProcessor::ProcessAndPad(encoding,
+                                           pair_encoding,
+                                           add_special_tokens,
+                                           pad_method,
+                                           pad_len,
+                                           result_encoding);
+    }
+  }
 };
 
 class PyRobertaPostProcessor : public postprocessors::RobertaPostProcessor {
@@ -123,6 +175,28 @@ public:
                            AddedTokensNum,
                            is_pair);
   }
+  virtual void ProcessAndPad(core::Encoding* encoding,
+                             core::Encoding* pair_encoding,
+                             bool add_special_tokens,
+                             const core::PadMethod& pad_method,
+                             uint32_t pad_len,
+                             core::Encoding* result_encoding) const override {
+    if (HasCallOverride(this)) {
+      PostProcessor::ProcessAndPad(encoding,
+                                   pair_encoding,
+                                   add_special_tokens,
+                                   pad_method,
+                                   pad_len,
+                                   result_encoding);
+    } else {
+      RobertaPostProcessor::ProcessAndPad(encoding,
+                                          pair_encoding,
+                                          add_special_tokens,
+                                          pad_method,
+                                          pad_len,
+                                          result_encoding);
+    }
+  }
 };
 
 class PyByteLevelPostProcessor : public postprocessors::ByteLevelPostProcessor {
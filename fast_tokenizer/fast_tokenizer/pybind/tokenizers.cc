@@ -741,6 +741,85 @@ static PyObject* DisableTruncation(TokenizerObject* self,
   TOKENIZERS_CATCH_AND_THROW_RETURN_NULL
 }
 
+// def enable_stats(enable=True)
+static PyObject* EnableStats(TokenizerObject* self,
+                             PyObject* args,
+                             PyObject* kwargs) {
+  TOKENIZERS_TRY
+  PyObject* kw_enable = NULL;
+  static char* kwlist[] = {const_cast<char*>("enable"), NULL};
+  bool flag_ =
+      PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &kw_enable);
+  Py_ssize_t args_num = PyTuple_Size(args);
+  bool enable = true;
+  if (args_num <= (Py_ssize_t)1) {
+    if (kw_enable != NULL) {
+      enable = CastPyArg2AttrBoolean(kw_enable, 0);
+    }
+    self->tokenizer.EnableStats(enable);
+  } else {
+    std::ostringstream oss;
+    oss << "Expected number of arguments is from 0 to 1, but recive "
+        << args_num;
+    throw std::runtime_error(oss.str());
+  }
+  Py_RETURN_NONE;
+  TOKENIZERS_CATCH_AND_THROW_RETURN_NULL
+}
+
+// def reset_stats()
+static PyObject* ResetStats(TokenizerObject* self,
+                            PyObject* args,
+                            PyObject* kwargs) {
+  TOKENIZERS_TRY
+  Py_ssize_t args_num = PyTuple_Size(args);
+  if (args_num == (Py_ssize_t)0) {
+    self->tokenizer.ResetStats();
+    Py_RETURN_NONE;
+  } else {
+    std::ostringstream oss;
+    oss << "Expected number of arguments is 0, but recive " << args_num;
+    throw std::runtime_error(oss.str());
+  }
+  Py_RETURN_NONE;
+  TOKENIZERS_CATCH_AND_THROW_RETURN_NULL
+}
+
+// def get_stats()
+static PyObject* GetStats(TokenizerObject* self,
+                          PyObject* args,
+                          PyObject* kwargs) {
+  TOKENIZERS_TRY
+  Py_ssize_t args_num = PyTuple_Size(args);
+  if (args_num != (Py_ssize_t)0) {
+    std::ostringstream oss;
+    oss << "Expected number of arguments is 0, but recive " << args_num;
+    throw std::runtime_error(oss.str());
+  }
+  auto stats = self->tokenizer.GetStats();
+  py::dict stages;
+  for (int i = 0; i < core::STAGE_NUM; ++i) {
+    const auto& stage_stats = stats.stages_[i];
+    py::dict stage;
+    stage["calls"] = stage_stats.calls_;
+    stage["time_ns"] = stage_stats.time_ns_;
+    stage["bytes_in"] = stage_stats.bytes_in_;
+    stage["tokens_out"] = stage_stats.tokens_out_;
+    stages[core::GetStageName(static_cast<core::Stage>(i))] = stage;
+  }
+  py::dict py_stats;
+  py_stats["stages"] = stages;
+  py_stats["cache_hits"] = stats.cache_hits_;
+  py_stats["cache_misses"] = stats.cache_misses_;
+  py_stats["cache_hit_rate"] = stats.GetCacheHitRate();
+  py_stats["parallel_calls"] = stats.parallel_calls_;
+  py_stats["parallel_wall_ns"] = stats.parallel_wall_ns_;
+  py_stats["thread_utilization"] = stats.GetThreadUtilization();
+  py_stats.inc_ref();
+  return py_stats.ptr();
+  TOKENIZERS_CATCH_AND_THROW_RETURN_NULL
+}
+
 // def get_vocab(with_added_vocabulary=True)
 static PyObject* GetVocab(TokenizerObject* self,
                           PyObject* args,
@@ -911,7 +990,43 @@ static PyObject* Encode(TokenizerObject* self,
   TOKENIZERS_CATCH_AND_THROW_RETURN_NULL
 }
 
-// def encode(input, add_special_tokens=True, is_pretokenized=False)
+// Convert the list of the encoding attribute names to a mask of EncodeField,
+// None means all the fields.
+static uint32_t CastPyArg2EncodeFields(PyObject* obj, ssize_t arg_pos) {
+  if (obj == NULL || obj == Py_None) {
+    return core::ALL_FIELDS;
+  }
+  static const std::unordered_map<std::string, uint32_t> fields_map = {
+      {"ids", 0},
+      {"type_ids", core::TYPE_IDS_FIELD},
+      {"tokens", core::TOKENS_FIELD},
+      {"word_ids", core::WORDS_IDX_FIELD},
+      {"offsets", core::OFFSETS_FIELD},
+      {"special_tokens_mask", core::SPECIAL_TOKENS_MASK_FIELD},
+      {"attention_mask", core::ATTENTION_MASK_FIELD}};
+  if (!PyList_Check(obj) && !PyTuple_Check(obj)) {
+    std::ostringstream oss;
+    oss << "argument (position " << arg_pos + 1
+        << ") must be a list of the encoding fields";
+    throw std::runtime_error(oss.str());
+  }
+  uint32_t fields = 0;
+  Py_ssize_t size = PySequence_Size(obj);
+  for (Py_ssize_t i = 0; i < size; ++i) {
+    PyObject* item = PySequence_GetItem(obj, i);
+    std::string field = CastPyArg2AttrString(item, arg_pos);
+    Py_DECREF(item);
+    auto it = fields_map.find(field);
+    if (it == fields_map.end()) {
+      throw std::runtime_error("Unknown encoding field " + field);
+    }
+    fields |= it->second;
+  }
+  return fields;
+}
+
+// def encode(input, add_special_tokens=True, is_pretokenized=False,
+// output_fields=None)
 static PyObject* EncodeBatch(TokenizerObject* self,
                              PyObject* args,
                              PyObject* kwargs) {
@@ -919,33 +1034,41 @@ static PyObject* EncodeBatch(TokenizerObject* self,
   PyObject* kw_input = NULL;
   PyObject* kw_special_tokens = NULL;
   PyObject* kw_is_pretokenized = NULL;
+  PyObject* kw_output_fields = NULL;
   bool flag_kwargs = false;
   if (kwargs) flag_kwargs = true;
   static char* kwlist[] = {const_cast<char*>("input"),
                            const_cast<char*>("add_special_tokens"),
                            const_cast<char*>("is_pretokenized"),
+                           const_cast<char*>("output_fields"),
                            NULL};
   bool flag_ = PyArg_ParseTupleAndKeywords(args,
                                            kwargs,
-                                           "|OOO",
+                                           "|OOOO",
                                            kwlist,
                                            &kw_input,
                                            &kw_special_tokens,
-                                           &kw_is_pretokenized);
+                                           &kw_is_pretokenized,
+                                           &kw_output_fields);
   bool add_special_tokens = true;
   bool is_pretokenized = false;
+  uint32_t output_fields = core::ALL_FIELDS;
   Py_ssize_t args_num = PyTuple_Size(args);
   VLOG(6) << " args_num: " << args_num << ", flag_kwargs: " << flag_kwargs
           << ", flag_: " << flag_;
   std::vector<core::EncodeInput> batch_encode_input;
-  if (args_num >= (Py_ssize_t)1 && args_num <= (Py_ssize_t)3) {
+  if (args_num >= (Py_ssize_t)1 && args_num <= (Py_ssize_t)4) {
     if ((args_num <= 1 && flag_kwargs && kw_special_tokens) ||
         (args_num >= 2)) {
       add_special_tokens = CastPyArg2AttrBoolean(kw_special_tokens, 1);
     }
-    if ((args_num <= 2 && kw_is_pretokenized && flag_kwargs) || args_num == 3) {
+    if ((args_num <= 2 && kw_is_pretokenized && flag_kwargs) ||
+        args_num >= 3) {
       is_pretokenized = CastPyArg2AttrBoolean(kw_is_pretokenized, 2);
     }
+    if ((args_num <= 3 && kw_output_fields && flag_kwargs) || args_num == 4) {
+      output_fields = CastPyArg2EncodeFields(kw_output_fields, 3);
+    }
     if (PyList_Check(kw_input)) {
       Py_ssize_t list_size = PyList_Size(kw_input);
       for (Py_ssize_t i = 0; i < list_size; ++i) {
@@ -995,8 +1118,10 @@ static PyObject* EncodeBatch(TokenizerObject* self,
       throw std::runtime_error(oss.str());
     }
     std::vector<core::Encoding> result_encodings;
-    self->tokenizer.EncodeBatchStrings(
-        batch_encode_input, &result_encodings, add_special_tokens);
+    self->tokenizer.EncodeBatchStrings(batch_encode_input,
+                                       &result_encodings,
+                                       add_special_tokens,
+                                       output_fields);
     py::object py_obj = py::cast(result_encodings);
     py_obj.inc_ref();
     return py_obj.ptr();
@@ -1309,6 +1434,18 @@ PyMethodDef tokenizer_variable_methods[] = {
      (PyCFunction)(void (*)(void))DisableTruncation,
      METH_VARARGS | METH_KEYWORDS,
      NULL},
+    {"enable_stats",
+     (PyCFunction)(void (*)(void))EnableStats,
+     METH_VARARGS | METH_KEYWORDS,
+     NULL},
+    {"reset_stats",
+     (PyCFunction)(void (*)(void))ResetStats,
+     METH_VARARGS | METH_KEYWORDS,
+     NULL},
+    {"get_stats",
+     (PyCFunction)(void (*)(void))GetStats,
+     METH_VARARGS | METH_KEYWORDS,
+     NULL},
     {"get_vocab",
      (PyCFunction)(void (*)(void))GetVocab,
      METH_VARARGS | METH_KEYWORDS,
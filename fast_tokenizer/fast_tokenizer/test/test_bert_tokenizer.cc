@@ -113,6 +113,62 @@ TEST(tokenizer, bert_tokenizer) {
     CheckVectorEqual(expected_ids[i], encodings[i].GetIds());
     CheckVectorEqual(expected_type_ids[i], encodings[i].GetTypeIds());
   }
+
+  // Batch encoding pads every encoding to the longest one, rounded up to
+  // pad_to_multiple_of.
+  pad_method.pad_id_ = 0;
+  pad_method.pad_token_ = "[PAD]";
+  pad_method.pad_to_multiple_of_ = 4;
+  tokenizer.SetPadMethod(pad_method);
+  std::vector<std::string> texts = {
+      "今天天气真好", "don't know how this missed award nominations."};
+  std::vector<core::Encoding> batch_encodings;
+  tokenizer.EncodeBatchStrings(texts, &batch_encodings);
+  for (int i = 0; i < batch_encodings.size(); ++i) {
+    ASSERT_EQ(batch_encodings[i].GetLen(), 16);
+    auto expected_ids_i = expected_ids[i];
+    expected_ids_i.resize(16, 0);
+    CheckVectorEqual(expected_ids_i, batch_encodings[i].GetIds());
+    ASSERT_EQ(batch_encodings[i].GetTokens().back(), "[PAD]");
+    ASSERT_EQ(batch_encodings[i].GetAttentionMask().back(), 0);
+  }
+
+  // The stats are only collected after they are enabled.
+  ASSERT_FALSE(tokenizer.GetEnableStats());
+  ASSERT_EQ(tokenizer.GetStats().stages_[core::TOKENIZE].calls_, 0);
+  tokenizer.EnableStats();
+  tokenizer.EncodeBatchStrings(texts, &batch_encodings);
+  auto stats = tokenizer.GetStats();
+  const auto& normalize_stats = stats.stages_[core::EXTRACT_AND_NORMALIZE];
+  ASSERT_EQ(normalize_stats.calls_, 2);
+  ASSERT_EQ(normalize_stats.bytes_in_, texts[0].length() + texts[1].length());
+  ASSERT_EQ(stats.stages_[core::TOKENIZE].tokens_out_, 6 + 13);
+  ASSERT_EQ(stats.stages_[core::POST_PROCESS].calls_, 2);
+  ASSERT_EQ(stats.stages_[core::POST_PROCESS].tokens_out_, 32);
+  ASSERT_EQ(stats.stages_[core::PAD].calls_, 0);
+  ASSERT_EQ(stats.parallel_calls_, 2);
+  tokenizer.ResetStats();
+  ASSERT_EQ(tokenizer.GetStats().stages_[core::TOKENIZE].calls_, 0);
+  tokenizer.EnableStats(false);
+  ASSERT_FALSE(tokenizer.GetEnableStats());
+
+  // Only the model inputs are generated, the other fields are left empty.
+  std::vector<core::Encoding> ids_only_encodings;
+  tokenizer.EncodeBatchStrings(
+      texts, &ids_only_encodings, true, core::MODEL_INPUT_FIELDS);
+  for (int i = 0; i < ids_only_encodings.size(); ++i) {
+    const auto& encoding = ids_only_encodings[i];
+    ASSERT_EQ(encoding.GetFields(), core::MODEL_INPUT_FIELDS);
+    CheckVectorEqual(batch_encodings[i].GetIds(), encoding.GetIds());
+    CheckVectorEqual(batch_encodings[i].GetTypeIds(), encoding.GetTypeIds());
+    CheckVectorEqual(batch_encodings[i].GetAttentionMask(),
+                     encoding.GetAttentionMask());
+    ASSERT_TRUE(encoding.GetTokens().empty());
+    ASSERT_TRUE(encoding.GetOffsets().empty());
+    ASSERT_TRUE(encoding.GetWordsIdx().empty());
+    ASSERT_TRUE(encoding.GetSpecialTokensMask().empty());
+    ASSERT_THROW(encoding.TokenIdxToCharOffsets(0), std::runtime_error);
+  }
 }
 
 }  // namespace tests
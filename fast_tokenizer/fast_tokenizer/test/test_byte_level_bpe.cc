@@ -0,0 +1,150 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/tokenizer.h"
+#include "fast_tokenizer/models/bpe.h"
+#include "fast_tokenizer/normalizers/unicode.h"
+#include "fast_tokenizer/postprocessors/byte_level.h"
+#include "fast_tokenizer/pretokenizers/byte_level.h"
+#include "fast_tokenizer/pretokenizers/sequence.h"
+#include "fast_tokenizer/pretokenizers/split.h"
+#include "fast_tokenizer/trainers/bpe_trainer.h"
+#include "fast_tokenizer/trainers/word_counter.h"
+#include "fast_tokenizer/utils/utf8.h"
+#include "fast_tokenizer/utils/utils.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "re2/re2.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace tests {
+
+static const std::vector<std::string> kTexts = {
+    "Hello world! It's a test of the byte level BPE.",
+    "  leading and trailing spaces   ",
+    "tabs\tand\nnew lines\r\n",
+    "naïve café, Ünïcödé and ß",
+    "中文测试，今天天气真好。",
+    "emoji 😀👍🏽 and symbols ∑∫√ €100",
+    "numbers 1234567890 3.14159",
+    "don't won't I'm we'll they'd you've",
+    "",
+};
+
+// Train a small byte level vocab instead of downloading one. Every byte is
+// in the alphabet like GPT-2 and CLIP.
+static void TrainByteLevelVocab(const std::string& end_of_word_suffix,
+                                const pretokenizers::PreTokenizer& pretokenizer,
+                                core::Vocab* vocab,
+                                core::Merges* merges) {
+  std::vector<std::string> alphabet;
+  for (const auto& item : utils::CreateBytesToChars()) {
+    char chr[4];
+    auto len = utils::UnicodeToUTF8Char(utils::UnicodeToUTF8(item.second), chr);
+    alphabet.emplace_back(chr, len);
+  }
+  std::vector<std::string> corpus;
+  for (int i = 0; i < 10; ++i) {
+    corpus.insert(corpus.end(), kTexts.begin(), kTexts.end());
+  }
+  trainers::WordCounter counter(nullptr, &pretokenizer);
+  counter.Feed(corpus);
+  trainers::BPETrainer trainer(
+      400, 0, {"<unk>"}, 0, alphabet, "", end_of_word_suffix);
+  trainer.Train(counter.GetWordCounts(), vocab, merges);
+}
+
+static void ExpectSameEncodings(const core::Tokenizer& expected_tokenizer,
+                                const core::Tokenizer& tokenizer) {
+  std::vector<core::Encoding> expected, result;
+  expected_tokenizer.EncodeBatchStrings(kTexts, &expected);
+  tokenizer.EncodeBatchStrings(kTexts, &result);
+  ASSERT_EQ(expected.size(), result.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(result[i].GetIds(), expected[i].GetIds()) << kTexts[i];
+    EXPECT_EQ(result[i].GetTokens(), expected[i].GetTokens()) << kTexts[i];
+    EXPECT_EQ(result[i].GetOffsets(), expected[i].GetOffsets()) << kTexts[i];
+  }
+}
+
+TEST(model, byte_level_bpe_gpt2) {
+  pretokenizers::ByteLevelPreTokenizer pretokenizer(true, true);
+  core::Vocab vocab;
+  core::Merges merges;
+  TrainByteLevelVocab("", pretokenizer, &vocab, &merges);
+
+  core::Tokenizer tokenizer(
+      models::BPE(vocab, merges, 10000, {}, {"<unk>"}, {}, {}, false));
+  tokenizer.SetPreTokenizer(pretokenizer);
+  tokenizer.SetPostProcessor(postprocessors::ByteLevelPostProcessor());
+  tokenizer.DisablePadMethod();
+
+  core::Tokenizer byte_level_tokenizer(
+      models::BPE(vocab, merges, 10000, {}, {"<unk>"}, {}, {}, false, true));
+  byte_level_tokenizer.SetPreTokenizer(
+      pretokenizers::ByteLevelPreTokenizer(true, true, false));
+  byte_level_tokenizer.SetPostProcessor(
+      postprocessors::ByteLevelPostProcessor());
+  byte_level_tokenizer.DisablePadMethod();
+  ExpectSameEncodings(tokenizer, byte_level_tokenizer);
+
+  // The mode is kept by the serialization.
+  std::string json_str;
+  byte_level_tokenizer.ToJsonStr(&json_str);
+  auto loaded_tokenizer = core::Tokenizer::LoadFromStr(json_str);
+  EXPECT_TRUE(dynamic_cast<models::BPE*>(loaded_tokenizer.GetModelPtr())
+                  ->GetByteLevel());
+  ExpectSameEncodings(tokenizer, loaded_tokenizer);
+}
+
+TEST(model, byte_level_bpe_clip) {
+  // The pretokenizers of CLIPFastTokenizer
+  pretokenizers::SplitPreTokenizer split_pretokenizer(
+      R"('s|'t|'re|'ve|'m|'ll|'d|[\p{L}]+|[\p{N}]|[^\s\p{L}\p{N}]+)",
+      core::SplitMode::REMOVED,
+      true);
+  pretokenizers::ByteLevelPreTokenizer byte_level(false, true);
+  pretokenizers::ByteLevelPreTokenizer raw_byte_level(false, true, false);
+  pretokenizers::SequencePreTokenizer pretokenizer, raw_pretokenizer;
+  pretokenizer.AppendPreTokenizer(&split_pretokenizer);
+  pretokenizer.AppendPreTokenizer(&byte_level);
+  raw_pretokenizer.AppendPreTokenizer(&split_pretokenizer);
+  raw_pretokenizer.AppendPreTokenizer(&raw_byte_level);
+  core::Vocab vocab;
+  core::Merges merges;
+  TrainByteLevelVocab("</w>", pretokenizer, &vocab, &merges);
+
+  core::Tokenizer tokenizer(
+      models::BPE(vocab, merges, 10000, {}, {"<unk>"}, {""}, {"</w>"}));
+  tokenizer.SetNormalizer(normalizers::NFCNormalizer());
+  tokenizer.SetPreTokenizer(pretokenizer);
+  tokenizer.DisablePadMethod();
+
+  core::Tokenizer byte_level_tokenizer(models::BPE(
+      vocab, merges, 10000, {}, {"<unk>"}, {""}, {"</w>"}, false, true));
+  byte_level_tokenizer.SetNormalizer(normalizers::NFCNormalizer());
+  byte_level_tokenizer.SetPreTokenizer(raw_pretokenizer);
+  byte_level_tokenizer.DisablePadMethod();
+  ExpectSameEncodings(tokenizer, byte_level_tokenizer);
+}
+
+}  // namespace tests
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,206 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/c_api/c_api.h"
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/tokenizers/ernie_fast_tokenizer.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace tests {
+
+class CApiTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ernie_tokenizer_.reset(
+        new tokenizers_impl::ErnieFastTokenizer("ernie_vocab.txt"));
+    std::string json_str;
+    ernie_tokenizer_->ToJsonStr(&json_str);
+    tokenizer_ = ft_tokenizer_load_from_str(json_str.data(), json_str.size());
+    ASSERT_NE(tokenizer_, nullptr);
+  }
+  void TearDown() override { ft_tokenizer_free(tokenizer_); }
+
+  std::unique_ptr<tokenizers_impl::ErnieFastTokenizer> ernie_tokenizer_;
+  ft_tokenizer* tokenizer_;
+  std::vector<std::string> texts_ = {
+      "今天天气真好", "don't know how this missed award nominations.", ""};
+  std::vector<std::string> text_pairs_ = {"是的", "I know", "pair only"};
+};
+
+TEST_F(CApiTest, encode_batch) {
+  std::vector<const char*> texts;
+  for (const auto& text : texts_) texts.push_back(text.c_str());
+  const size_t max_len = 20;
+  const size_t batch_size = texts.size();
+  std::vector<int32_t> ids(batch_size * max_len, -1);
+  std::vector<int32_t> type_ids(batch_size * max_len, -1);
+  std::vector<int32_t> mask(batch_size * max_len, -1);
+  std::vector<int32_t> offsets(batch_size * max_len * 2, -1);
+  std::vector<int32_t> lengths(batch_size);
+  ft_encode_output output = {FT_INT32,
+                             max_len,
+                             ids.data(),
+                             type_ids.data(),
+                             mask.data(),
+                             nullptr,
+                             offsets.data(),
+                             lengths.data(),
+                             0};
+  ASSERT_EQ(ft_encode_batch(tokenizer_,
+                            texts.data(),
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            batch_size,
+                            1,
+                            &output),
+            FT_OK);
+
+  std::vector<core::Encoding> encodings;
+  ernie_tokenizer_->EncodeBatchStrings(texts_, &encodings);
+  EXPECT_EQ(output.seq_len, encodings[0].GetLen());
+  for (size_t i = 0; i < batch_size; ++i) {
+    const auto& expected_ids = encodings[i].GetIds();
+    const auto& expected_mask = encodings[i].GetAttentionMask();
+    const auto& expected_offsets = encodings[i].GetOffsets();
+    ASSERT_EQ(lengths[i],
+              std::count(expected_mask.begin(), expected_mask.end(), 1));
+    for (size_t j = 0; j < max_len; ++j) {
+      size_t idx = i * max_len + j;
+      if (j < expected_ids.size()) {
+        EXPECT_EQ(ids[idx], expected_ids[j]);
+        EXPECT_EQ(type_ids[idx], 0);
+        EXPECT_EQ(mask[idx], expected_mask[j]);
+        EXPECT_EQ(offsets[idx * 2], expected_offsets[j].first);
+        EXPECT_EQ(offsets[idx * 2 + 1], expected_offsets[j].second);
+      } else {
+        EXPECT_EQ(ids[idx], 0);
+        EXPECT_EQ(mask[idx], 0);
+      }
+    }
+  }
+}
+
+TEST_F(CApiTest, encode_pair_batch_int64) {
+  std::vector<const char*> texts, text_pairs;
+  std::vector<size_t> text_lens, text_pair_lens;
+  for (size_t i = 0; i < texts_.size(); ++i) {
+    texts.push_back(texts_[i].data());
+    text_lens.push_back(texts_[i].size());
+    text_pairs.push_back(text_pairs_[i].data());
+    text_pair_lens.push_back(text_pairs_[i].size());
+  }
+  const size_t max_len = 24;
+  const size_t batch_size = texts.size();
+  std::vector<int64_t> ids(batch_size * max_len);
+  std::vector<int64_t> type_ids(batch_size * max_len);
+  ft_encode_output output = {FT_INT64,
+                             max_len,
+                             ids.data(),
+                             type_ids.data(),
+                             nullptr,
+                             nullptr,
+                             nullptr,
+                             nullptr,
+                             0};
+  ASSERT_EQ(ft_encode_batch(tokenizer_,
+                            texts.data(),
+                            text_lens.data(),
+                            text_pairs.data(),
+                            text_pair_lens.data(),
+                            batch_size,
+                            1,
+                            &output),
+            FT_OK);
+  std::vector<core::Encoding> encodings;
+  ernie_tokenizer_->EncodeBatchStrings(texts_, text_pairs_, &encodings);
+  for (size_t i = 0; i < batch_size; ++i) {
+    const auto& expected_ids = encodings[i].GetIds();
+    const auto& expected_type_ids = encodings[i].GetTypeIds();
+    for (size_t j = 0; j < expected_ids.size(); ++j) {
+      EXPECT_EQ(ids[i * max_len + j], expected_ids[j]);
+      EXPECT_EQ(type_ids[i * max_len + j], expected_type_ids[j]);
+    }
+  }
+}
+
+TEST_F(CApiTest, left_padding) {
+  ernie_tokenizer_->EnablePadMethod(
+      core::LEFT, 0, 0, "[PAD]", nullptr, nullptr);
+  std::string json_str;
+  ernie_tokenizer_->ToJsonStr(&json_str);
+  ft_tokenizer* tokenizer =
+      ft_tokenizer_load_from_str(json_str.data(), json_str.size());
+  ASSERT_NE(tokenizer, nullptr);
+  const char* text = "今天天气真好";
+  const size_t max_len = 10;
+  std::vector<int32_t> ids(max_len), mask(max_len);
+  ft_encode_output output = {FT_INT32,
+                             max_len,
+                             ids.data(),
+                             nullptr,
+                             mask.data(),
+                             nullptr,
+                             nullptr,
+                             nullptr,
+                             0};
+  ASSERT_EQ(ft_encode_batch(
+                tokenizer, &text, nullptr, nullptr, nullptr, 1, 1, &output),
+            FT_OK);
+  std::vector<int32_t> expected_mask = {0, 0, 1, 1, 1, 1, 1, 1, 1, 1};
+  EXPECT_EQ(mask, expected_mask);
+  EXPECT_EQ(ids[0], 0);
+  EXPECT_EQ(ids[2], ft_tokenizer_token_to_id(tokenizer, "[CLS]", 5));
+  ft_tokenizer_free(tokenizer);
+}
+
+TEST_F(CApiTest, errors) {
+  const char* text = "don't know how this missed award nominations.";
+  const size_t max_len = 4;
+  std::vector<int32_t> ids(max_len);
+  int32_t length = 0;
+  ft_encode_output output = {FT_INT32,
+                             max_len,
+                             ids.data(),
+                             nullptr,
+                             nullptr,
+                             nullptr,
+                             nullptr,
+                             &length,
+                             0};
+  EXPECT_EQ(ft_encode_batch(
+                tokenizer_, &text, nullptr, nullptr, nullptr, 1, 1, &output),
+            FT_BUFFER_TOO_SMALL);
+  EXPECT_EQ(length, 15);
+  EXPECT_EQ(output.seq_len, 15);
+  EXPECT_EQ(ft_encode_batch(
+                nullptr, &text, nullptr, nullptr, nullptr, 1, 1, &output),
+            FT_INVALID_ARGUMENT);
+  EXPECT_EQ(ft_tokenizer_load_from_str("{", 1), nullptr);
+  EXPECT_NE(std::string(ft_last_error()), "");
+  EXPECT_EQ(ft_tokenizer_token_to_id(tokenizer_, "not_a_token", 11), -1);
+  EXPECT_GT(ft_tokenizer_vocab_size(tokenizer_), 0);
+}
+
+}  // namespace tests
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
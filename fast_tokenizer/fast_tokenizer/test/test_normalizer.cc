@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <string>
+#include <vector>
+#include "fast_tokenizer/normalizers/alignments.h"
 #include "fast_tokenizer/normalizers/bert.h"
 #include "fast_tokenizer/normalizers/replace.h"
 #include "fast_tokenizer/normalizers/strip.h"
@@ -50,6 +52,68 @@ TEST(normalizers, split) {
              {"The", "-final", "-", "-countdown"});
 }
 
+TEST(normalizers, alignments) {
+  normalizers::NormalizedString unchanged("Hello 世界");
+  // One run for the ascii chars, one run for the chinese chars
+  ASSERT_EQ(unchanged.GetAlignments().GetRunsNum(), 2);
+  ASSERT_EQ(unchanged.GetAlignments().Size(), unchanged.GetLen());
+  ASSERT_EQ(unchanged.GetAlignments()[4], core::Range(4, 5));
+  ASSERT_EQ(unchanged.GetAlignments()[7], core::Range(6, 9));
+  ASSERT_EQ(unchanged.GetAlignments()[11], core::Range(9, 12));
+
+  // Compare with the alignments that keep one range per byte
+  std::vector<core::Range> expected = {
+      {0, 0}, {0, 0}, {0, 1}, {1, 2}, {2, 3}, {3, 6}, {3, 6},
+      {3, 6}, {6, 9}, {6, 9}, {6, 9}, {6, 9}, {9, 9}, {9, 10}};
+  normalizers::Alignments alignments;
+  for (const auto& range : expected) {
+    alignments.Append(range);
+  }
+  ASSERT_EQ(alignments.Size(), expected.size());
+  ASSERT_LT(alignments.GetRunsNum(), expected.size());
+  for (uint32_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(alignments[i], expected[i]);
+  }
+  for (uint32_t first = 0; first <= 10; ++first) {
+    for (uint32_t second = first; second <= 10; ++second) {
+      int start = -1;
+      int end = -1;
+      for (int i = 0; i < expected.size(); ++i) {
+        if (second >= expected[i].second) {
+          if (start < 0 && first <= expected[i].first &&
+              expected[i].first != expected[i].second) {
+            start = i;
+          }
+          end = i + 1;
+        }
+      }
+      int result_start;
+      int result_end;
+      alignments.FindOriginalRange({first, second}, &result_start, &result_end);
+      ASSERT_EQ(result_start, start);
+      ASSERT_EQ(result_end, end);
+    }
+  }
+
+  // Slice in the middle of the groups
+  normalizers::Alignments sliced;
+  sliced.Append(alignments, 6, 10, 3);
+  ASSERT_EQ(sliced.Size(), 4);
+  ASSERT_EQ(sliced[0], core::Range(0, 3));
+  ASSERT_EQ(sliced[1], core::Range(0, 3));
+  ASSERT_EQ(sliced[2], core::Range(3, 6));
+  ASSERT_EQ(sliced[3], core::Range(3, 6));
+
+  alignments.Replace(2, 8, sliced);
+  expected.erase(expected.begin() + 2, expected.begin() + 8);
+  expected.insert(expected.begin() + 2,
+                  {{0, 3}, {0, 3}, {3, 6}, {3, 6}});
+  ASSERT_EQ(alignments.Size(), expected.size());
+  for (uint32_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(alignments[i], expected[i]);
+  }
+}
+
 }  // namespace tests
 }  // namespace fast_tokenizer
 }  // namespace paddlenlp
\ No newline at end of file
@@ -0,0 +1,213 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <string>
+
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/postprocessors/bert.h"
+#include "fast_tokenizer/postprocessors/template.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace tests {
+
+TEST(postprocessors, template_single_and_pair) {
+  postprocessors::TemplatePostProcessor postprocessor;
+  postprocessor.UpdateSinglePieces("[CLS] $A [SEP]");
+  postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  postprocessor.SetTokensMap({postprocessors::SpecialToken("[CLS]", 1),
+                              postprocessors::SpecialToken("[SEP]", 0)});
+  ASSERT_EQ(postprocessor.AddedTokensNum(false), 2);
+  ASSERT_EQ(postprocessor.AddedTokensNum(true), 3);
+
+  core::Encoding encoding(
+      {core::Token(12, "Hello", {0, 5}), core::Token(14, "there", {6, 11})}, 0);
+  core::Encoding pair_encoding({core::Token(15, "pair", {0, 4})}, 0);
+  core::Encoding result_encoding;
+  uint32_t special_word_idx = std::numeric_limits<uint32_t>::max();
+
+  postprocessor(&encoding, nullptr, true, &result_encoding);
+  ASSERT_EQ(result_encoding,
+            core::Encoding({1, 12, 14, 0},
+                           {0, 0, 0, 0},
+                           {"[CLS]", "Hello", "there", "[SEP]"},
+                           std::vector<uint32_t>(4, special_word_idx),
+                           {{0, 0}, {0, 5}, {6, 11}, {0, 0}},
+                           {1, 0, 0, 1},
+                           {1, 1, 1, 1},
+                           {},
+                           {{0, {1, 3}}}));
+
+  postprocessor(&encoding, &pair_encoding, true, &result_encoding);
+  ASSERT_EQ(result_encoding,
+            core::Encoding({1, 12, 14, 0, 15, 0},
+                           {0, 0, 0, 0, 1, 1},
+                           {"[CLS]", "Hello", "there", "[SEP]", "pair", "[SEP]"},
+                           std::vector<uint32_t>(6, special_word_idx),
+                           {{0, 0}, {0, 5}, {6, 11}, {0, 0}, {0, 4}, {0, 0}},
+                           {1, 0, 0, 1, 0, 1},
+                           {1, 1, 1, 1, 1, 1},
+                           {},
+                           {{0, {1, 3}}, {1, {4, 5}}}));
+  ASSERT_EQ(result_encoding.TokenIdxToSequenceIds(4), std::vector<uint32_t>{1});
+
+  postprocessor(&encoding, &pair_encoding, false, &result_encoding);
+  ASSERT_EQ(result_encoding.GetIds(), std::vector<uint32_t>({12, 14, 15}));
+  ASSERT_EQ(result_encoding.GetTypeIds(), std::vector<uint32_t>({0, 0, 1}));
+}
+
+TEST(postprocessors, template_overflowing) {
+  postprocessors::TemplatePostProcessor postprocessor;
+  postprocessor.UpdateSinglePieces("[CLS] $A [SEP]");
+  postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  postprocessor.SetTokensMap({postprocessors::SpecialToken("[CLS]", 1),
+                              postprocessors::SpecialToken("[SEP]", 0)});
+
+  core::Encoding encoding({core::Token(12, "Hello", {0, 5})}, 0);
+  encoding.GetMutableOverflowing().emplace_back(
+      std::vector<core::Token>{core::Token(14, "there", {6, 11})}, 0);
+  core::Encoding pair_encoding({core::Token(15, "pair", {0, 4})}, 1);
+  pair_encoding.GetMutableOverflowing().emplace_back(
+      std::vector<core::Token>{core::Token(16, "more", {5, 9})}, 1);
+  core::Encoding result_encoding;
+  postprocessor(&encoding, &pair_encoding, true, &result_encoding);
+
+  ASSERT_EQ(result_encoding.GetIds(),
+            std::vector<uint32_t>({1, 12, 0, 15, 0}));
+  // (A_o, B), (A_o, B_o), (A, B_o)
+  auto& overflowings = result_encoding.GetOverflowing();
+  ASSERT_EQ(overflowings.size(), 3);
+  ASSERT_EQ(overflowings[0].GetIds(), std::vector<uint32_t>({1, 14, 0, 15, 0}));
+  ASSERT_EQ(overflowings[1].GetIds(), std::vector<uint32_t>({1, 14, 0, 16, 0}));
+  ASSERT_EQ(overflowings[2].GetIds(), std::vector<uint32_t>({1, 12, 0, 16, 0}));
+  for (auto& overflowing : overflowings) {
+    ASSERT_EQ(overflowing.GetTypeIds(), std::vector<uint32_t>({0, 0, 0, 1, 1}));
+    ASSERT_EQ(overflowing.GetSequenceRange(1), core::Range(3, 4));
+    ASSERT_TRUE(overflowing.GetOverflowing().empty());
+  }
+}
+
+TEST(postprocessors, bert_plan_matches_template) {
+  postprocessors::BertPostProcessor bert_postprocessor({"[SEP]", 0},
+                                                       {"[CLS]", 1});
+  postprocessors::TemplatePostProcessor template_postprocessor;
+  template_postprocessor.UpdateSinglePieces("[CLS]:0 $A:0 [SEP]:0");
+  template_postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  template_postprocessor.SetTokensMap(
+      {postprocessors::SpecialToken("[CLS]", 1),
+       postprocessors::SpecialToken("[SEP]", 0)});
+
+  core::Encoding encoding(
+      {core::Token(12, "Hello", {0, 5}), core::Token(14, "there", {6, 11})}, 0);
+  core::Encoding pair_encoding({core::Token(15, "pair", {0, 4})}, 1);
+  core::Encoding bert_result, template_result;
+  bert_postprocessor(&encoding, &pair_encoding, true, &bert_result);
+  template_postprocessor(&encoding, &pair_encoding, true, &template_result);
+  ASSERT_EQ(bert_result, template_result);
+}
+
+TEST(postprocessors, template_process_and_pad) {
+  postprocessors::TemplatePostProcessor postprocessor;
+  postprocessor.UpdateSinglePieces("[CLS] $A [SEP]");
+  postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  postprocessor.SetTokensMap({postprocessors::SpecialToken("[CLS]", 1),
+                              postprocessors::SpecialToken("[SEP]", 0)});
+  core::PadMethod pad_method;
+  pad_method.pad_id_ = 9;
+  pad_method.pad_token_ = "[PAD]";
+
+  core::Encoding encoding(
+      {core::Token(12, "Hello", {0, 5}), core::Token(14, "there", {6, 11})}, 0);
+  core::Encoding pair_encoding({core::Token(15, "pair", {0, 4})}, 1);
+  // The fused result should equal to post processing and then padding.
+  for (auto direction : {core::Direction::RIGHT, core::Direction::LEFT}) {
+    pad_method.direction_ = direction;
+    core::Encoding fused, expected;
+    postprocessor.ProcessAndPad(
+        &encoding, &pair_encoding, true, pad_method, 8, &fused);
+    postprocessor(&encoding, &pair_encoding, true, &expected);
+    expected.Pad(8,
+                 pad_method.pad_id_,
+                 pad_method.pad_token_type_id_,
+                 pad_method.pad_token_,
+                 pad_method.direction_);
+    ASSERT_EQ(fused, expected);
+    ASSERT_EQ(fused.GetLen(), 8);
+    ASSERT_EQ(fused.GetAttentionMask(),
+              direction == core::Direction::RIGHT
+                  ? std::vector<uint32_t>({1, 1, 1, 1, 1, 1, 0, 0})
+                  : std::vector<uint32_t>({0, 0, 1, 1, 1, 1, 1, 1}));
+    ASSERT_EQ(fused.GetSequenceRange(1),
+              direction == core::Direction::RIGHT ? core::Range(4, 5)
+                                                  : core::Range(6, 7));
+  }
+}
+
+TEST(postprocessors, template_alignment) {
+  postprocessors::TemplatePostProcessor postprocessor;
+  postprocessor.UpdatePairPieces("[CLS]:0 $A:0 [SEP]:0 $B:1 [SEP]:1");
+  postprocessor.SetTokensMap({postprocessors::SpecialToken("[CLS]", 1),
+                              postprocessors::SpecialToken("[SEP]", 0)});
+  // "Hello there": "Hel", "##lo" and "there" belong to the words 0 and 1.
+  core::Encoding encoding({core::Token(12, "Hel", {0, 3}),
+                           core::Token(13, "##lo", {3, 5}),
+                           core::Token(14, "there", {6, 11})},
+                          0);
+  encoding.GetMutableWordsIdx() = {0, 0, 1};
+  core::Encoding pair_encoding({core::Token(15, "pair", {0, 4})}, 1);
+  pair_encoding.GetMutableWordsIdx() = {0};
+  core::Encoding result_encoding;
+  postprocessor(&encoding, &pair_encoding, true, &result_encoding);
+
+  uint32_t token_idx, word_idx, seq_id;
+  core::Range token_range;
+  core::Offset offset;
+  ASSERT_TRUE(result_encoding.CharOffsetToTokenIdx(4, 0, &token_idx));
+  ASSERT_EQ(token_idx, 2);
+  ASSERT_TRUE(result_encoding.CharOffsetToTokenIdx(2, 1, &token_idx));
+  ASSERT_EQ(token_idx, 5);
+  ASSERT_FALSE(result_encoding.CharOffsetToTokenIdx(5, 0, &token_idx));
+  ASSERT_FALSE(result_encoding.CharOffsetToTokenIdx(0, 2, &token_idx));
+  ASSERT_TRUE(result_encoding.CharOffsetToWordIdx(7, 0, &word_idx));
+  ASSERT_EQ(word_idx, 1);
+
+  ASSERT_TRUE(result_encoding.WordIdxToTokenRange(0, 0, &token_range));
+  ASSERT_EQ(token_range, core::Range(1, 3));
+  ASSERT_TRUE(result_encoding.WordIdxToTokenRange(0, 1, &token_range));
+  ASSERT_EQ(token_range, core::Range(5, 6));
+  ASSERT_FALSE(result_encoding.WordIdxToTokenRange(2, 0, &token_range));
+  ASSERT_TRUE(result_encoding.WordIdxToCharOffset(0, 0, &offset));
+  ASSERT_EQ(offset, core::Offset(0, 5));
+  ASSERT_EQ(result_encoding.WordIdxToCharOffsets(1, 0),
+            std::vector<core::Offset>({{6, 11}}));
+
+  ASSERT_TRUE(result_encoding.TokenIdxToWordIdx(5, &seq_id, &word_idx));
+  ASSERT_EQ(seq_id, 1);
+  ASSERT_EQ(word_idx, 0);
+  ASSERT_FALSE(result_encoding.TokenIdxToSequenceId(0, &seq_id));
+
+  // The index is rebuilt after the encoding is modified.
+  result_encoding.Pad(10, 0, 0, "[PAD]", core::Direction::LEFT);
+  ASSERT_TRUE(result_encoding.WordIdxToTokenRange(0, 0, &token_range));
+  ASSERT_EQ(token_range, core::Range(4, 6));
+  ASSERT_TRUE(result_encoding.CharOffsetToTokenIdx(1, 1, &token_idx));
+  ASSERT_EQ(token_idx, 8);
+}
+
+}  // namespace tests
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
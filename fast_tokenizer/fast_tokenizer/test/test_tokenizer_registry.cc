@@ -0,0 +1,107 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/tokenizer_registry.h"
+#include "fast_tokenizer/models/wordpiece.h"
+#include "fast_tokenizer/tokenizers/ernie_fast_tokenizer.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace tests {
+
+TEST(tokenizer, tokenizer_registry) {
+  std::string vocab_file = "ernie_vocab.txt";
+  tokenizers_impl::ErnieFastTokenizer ernie_tokenizer(vocab_file);
+  // Another tokenizer of the same vocab, with different settings.
+  tokenizers_impl::ErnieFastTokenizer ernie_tokenizer_uncased(vocab_file,
+                                                              "[UNK]",
+                                                              "[SEP]",
+                                                              "[CLS]",
+                                                              "[PAD]",
+                                                              "[MASK]",
+                                                              true,
+                                                              true,
+                                                              true,
+                                                              false,
+                                                              "##",
+                                                              16);
+  std::string ernie_json, ernie_uncased_json;
+  ernie_tokenizer.ToJsonStr(&ernie_json);
+  ernie_tokenizer_uncased.ToJsonStr(&ernie_uncased_json);
+
+  core::TokenizerRegistry registry;
+  auto ernie = registry.LoadFromStr("ernie", ernie_json);
+  auto ernie_uncased = registry.LoadFromStr("ernie_uncased", ernie_uncased_json);
+  core::Vocab vocab = {{"[UNK]", 0}, {"a", 1}, {"##b", 2}};
+  auto wordpiece = registry.Register(
+      "wordpiece", core::Tokenizer(models::WordPiece(vocab)));
+  EXPECT_EQ(registry.Size(), 3);
+  EXPECT_EQ(registry.Get("ernie"), ernie);
+  EXPECT_EQ(registry.Get("bert"), nullptr);
+  std::vector<std::string> expected_names = {
+      "ernie", "ernie_uncased", "wordpiece"};
+  EXPECT_EQ(registry.GetNames(), expected_names);
+  EXPECT_EQ(ernie->GetModelPtr(), ernie_uncased->GetModelPtr());
+  EXPECT_NE(ernie->GetModelPtr(), wordpiece->GetModelPtr());
+
+  // The settings of the tokenizers are still separated.
+  std::vector<std::string> texts = {"Today is a Good Day, 今天天气真好，明天也是好天气"};
+  std::vector<core::Encoding> expected, result;
+  ernie_tokenizer.EncodeBatchStrings(texts, &expected);
+  ernie->EncodeBatchStrings(texts, &result);
+  EXPECT_EQ(result[0].GetIds(), expected[0].GetIds());
+  size_t len = result[0].GetLen();
+  ernie_tokenizer_uncased.EncodeBatchStrings(texts, &expected);
+  ernie_uncased->EncodeBatchStrings(texts, &result);
+  EXPECT_EQ(result[0].GetIds(), expected[0].GetIds());
+  EXPECT_LT(result[0].GetLen(), len);
+
+  auto usage = registry.GetMemoryUsage();
+  ASSERT_EQ(usage.models_.size(), 2);
+  size_t ernie_model_bytes = 0;
+  for (const auto& model_usage : usage.models_) {
+    EXPECT_GT(model_usage.memory_.vocab_bytes_, 0);
+    EXPECT_GT(model_usage.memory_.index_bytes_, 0);
+    if (model_usage.type_ == "FastWordPiece") {
+      EXPECT_EQ(model_usage.num_tokenizers_, 2);
+      ernie_model_bytes = model_usage.memory_.GetTotalBytes();
+    } else {
+      EXPECT_EQ(model_usage.type_, "WordPiece");
+      EXPECT_EQ(model_usage.num_tokenizers_, 1);
+    }
+  }
+  EXPECT_EQ(usage.saved_bytes_, ernie_model_bytes);
+  EXPECT_GT(usage.total_bytes_, ernie_model_bytes);
+
+  // The model is released after the tokenizers that use it are removed.
+  EXPECT_TRUE(registry.Remove("ernie"));
+  EXPECT_FALSE(registry.Remove("ernie"));
+  EXPECT_EQ(registry.GetMemoryUsage().models_.size(), 2);
+  EXPECT_TRUE(registry.Remove("ernie_uncased"));
+  usage = registry.GetMemoryUsage();
+  ASSERT_EQ(usage.models_.size(), 1);
+  EXPECT_EQ(usage.models_[0].type_, "WordPiece");
+  EXPECT_EQ(usage.saved_bytes_, 0);
+}
+
+}  // namespace tests
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
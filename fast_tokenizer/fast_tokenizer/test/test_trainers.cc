@@ -0,0 +1,177 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/normalizers/bert.h"
+#include "fast_tokenizer/pretokenizers/bert.h"
+#include "fast_tokenizer/trainers/trainers.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace tests {
+
+static std::vector<std::string> GetTokens(models::Model* model,
+                                          const std::string& word) {
+  std::vector<std::string> tokens;
+  for (const auto& token : model->Tokenize(word)) {
+    tokens.push_back(token.value_);
+  }
+  return tokens;
+}
+
+static trainers::WordCounts GetHuggingWordCounts() {
+  return {{"hug", 10}, {"pug", 5}, {"pun", 12}, {"bun", 4}, {"hugs", 5}};
+}
+
+TEST(trainers, word_counter) {
+  normalizers::BertNormalizer normalizer;
+  pretokenizers::BertPreTokenizer pretokenizer;
+  std::vector<std::string> texts = {
+      "Hello, world!", "hello WORLD", "", "The world is big."};
+  trainers::WordCounter counter(&normalizer, &pretokenizer);
+  counter.Feed(texts);
+  trainers::WordCounts expected = {{"hello", 2},
+                                   {",", 1},
+                                   {"world", 3},
+                                   {"!", 1},
+                                   {"the", 1},
+                                   {"is", 1},
+                                   {"big", 1},
+                                   {".", 1}};
+  ASSERT_EQ(counter.GetWordCounts(), expected);
+
+  // The counts of the files are the same as the texts, whatever the number of
+  // threads is.
+  std::string path = "trainers_corpus.txt";
+  {
+    std::ofstream fout(path);
+    for (int i = 0; i < 100; ++i) {
+      for (const auto& text : texts) {
+        fout << text << "\r\n";
+      }
+    }
+  }
+  for (int thread_num : {1, 3}) {
+    core::SetThreadNum(thread_num);
+    trainers::WordCounter file_counter(&normalizer, &pretokenizer);
+    file_counter.FeedFiles({path});
+    ASSERT_EQ(file_counter.GetWordCounts().size(), expected.size());
+    for (const auto& item : expected) {
+      ASSERT_EQ(file_counter.GetWordCounts().at(item.first), 100 * item.second);
+    }
+  }
+  core::SetThreadNum(1);
+  std::remove(path.c_str());
+}
+
+TEST(trainers, bpe_trainer) {
+  trainers::BPETrainer trainer(10);
+  core::Vocab vocab;
+  core::Merges merges;
+  trainer.Train(GetHuggingWordCounts(), &vocab, &merges);
+  core::Merges expected_merges = {{"u", "g"}, {"u", "n"}, {"h", "ug"}};
+  ASSERT_EQ(merges, expected_merges);
+  ASSERT_EQ(vocab.size(), 10);
+  // The alphabet is sorted, then the tokens of the merges.
+  ASSERT_EQ(vocab.at("b"), 0);
+  ASSERT_EQ(vocab.at("u"), 6);
+  ASSERT_EQ(vocab.at("ug"), 7);
+  ASSERT_EQ(vocab.at("hug"), 9);
+
+  auto bpe = trainer.TrainModel(GetHuggingWordCounts());
+  ASSERT_EQ(GetTokens(&bpe, "hugs"), std::vector<std::string>({"hug", "s"}));
+  ASSERT_EQ(GetTokens(&bpe, "bun"), std::vector<std::string>({"b", "un"}));
+
+  // The merges don't depend on the number of threads.
+  trainers::WordCounts word_counts;
+  const std::string chars = "abcdefgh";
+  for (int i = 0; i < 20000; ++i) {
+    std::string word;
+    for (int j = i; j > 0; j /= chars.length()) {
+      word += chars[(j * 7 + word.length()) % chars.length()];
+    }
+    word_counts[word] += i % 13 + 1;
+  }
+  trainers::BPETrainer large_trainer(300, 2, {"<unk>"}, 0, {}, "", "</w>");
+  core::Merges single_thread_merges;
+  large_trainer.Train(word_counts, &vocab, &single_thread_merges);
+  core::SetThreadNum(4);
+  large_trainer.Train(word_counts, &vocab, &merges);
+  core::SetThreadNum(1);
+  ASSERT_EQ(merges, single_thread_merges);
+  ASSERT_EQ(vocab.size(), 300);
+  ASSERT_EQ(vocab.at("<unk>"), 0);
+}
+
+TEST(trainers, wordpiece_trainer) {
+  trainers::WordPieceTrainer trainer(17);
+  core::Vocab vocab;
+  trainer.Train(GetHuggingWordCounts(), &vocab);
+  ASSERT_EQ(vocab.size(), 17);
+  ASSERT_EQ(vocab.at("[UNK]"), 1);
+  ASSERT_EQ(vocab.at("##u"), 12);
+  // "##g" and "##s" have the highest likelihood though they are rare.
+  ASSERT_EQ(vocab.at("##gs"), 16);
+
+  auto wordpiece = trainer.TrainModel(GetHuggingWordCounts());
+  ASSERT_EQ(GetTokens(&wordpiece, "hugs"),
+            std::vector<std::string>({"h", "##u", "##gs"}));
+  ASSERT_EQ(GetTokens(&wordpiece, "xyz"), std::vector<std::string>({"[UNK]"}));
+}
+
+TEST(trainers, unigram_trainer) {
+  trainers::WordCounts word_counts = {{"hello", 100},
+                                      {"help", 50},
+                                      {"world", 80},
+                                      {"hell", 20},
+                                      {"low", 30},
+                                      {"wordy", 10},
+                                      {"old", 40}};
+  trainers::UnigramTrainer trainer(
+      20, 2, 0.75, {"<s>", "</s>"}, {"z"}, "<unk>");
+  core::VocabList vocab;
+  std::vector<size_t> unk_id;
+  trainer.Train(word_counts, &vocab, &unk_id);
+  ASSERT_EQ(vocab.size(), 20);
+  ASSERT_EQ(unk_id, std::vector<size_t>({0}));
+  ASSERT_EQ(vocab[0].first, "<unk>");
+  ASSERT_EQ(vocab[1].first, "<s>");
+  // All the chars are kept, and the pieces are sorted by scores.
+  std::unordered_map<std::string, float> scores(vocab.begin(), vocab.end());
+  for (const auto& chr : {"h", "e", "l", "o", "p", "w", "r", "d", "y", "z"}) {
+    ASSERT_EQ(scores.count(chr), 1) << chr;
+  }
+  for (size_t i = 4; i < vocab.size(); ++i) {
+    ASSERT_LE(vocab[i].second, vocab[i - 1].second);
+  }
+
+  auto unigram = trainer.TrainModel(word_counts);
+  ASSERT_EQ(GetTokens(&unigram, "hello"), std::vector<std::string>({"hello"}));
+  ASSERT_EQ(GetTokens(&unigram, "world"), std::vector<std::string>({"world"}));
+  std::string joined;
+  for (const auto& token : GetTokens(&unigram, "yellow")) {
+    joined += token;
+  }
+  ASSERT_EQ(joined, "yellow");
+}
+
+}  // namespace tests
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -12,11 +12,16 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <cstdio>
+#include <fstream>
 #include <string>
+#include "fast_tokenizer/core/base.h"
 #include "fast_tokenizer/normalizers/bert.h"
 #include "fast_tokenizer/normalizers/replace.h"
 #include "fast_tokenizer/normalizers/strip.h"
 #include "fast_tokenizer/normalizers/unicode.h"
+#include "fast_tokenizer/utils/flat_vocab.h"
+#include "fast_tokenizer/utils/utils.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
@@ -32,6 +37,68 @@ TEST(normalizers, utils) {
   ASSERT_EQ(expected_output, lower_input.GetStr());
 }
 
+TEST(utils, get_vocab_from_files) {
+  std::string long_token(1000, 'a');
+  std::string vocab_file = "test_utils_vocab.txt";
+  {
+    std::ofstream fout(vocab_file, std::ios::binary);
+    fout << "[PAD]\r\n  [UNK] \n\n" << long_token << "\n##ing\t\nend";
+  }
+  std::unordered_map<std::string, uint32_t> vocab;
+  utils::GetVocabFromFiles(vocab_file, &vocab);
+  std::remove(vocab_file.c_str());
+  ASSERT_EQ(vocab.size(), 5);
+  ASSERT_EQ(vocab.at("[PAD]"), 0);
+  ASSERT_EQ(vocab.at("[UNK]"), 1);
+  // The tokens longer than the old line buffer are kept.
+  ASSERT_EQ(vocab.at(long_token), 2);
+  ASSERT_EQ(vocab.at("##ing"), 3);
+  // The last line doesn't end with a newline.
+  ASSERT_EQ(vocab.at("end"), 4);
+}
+
+TEST(utils, flat_vocab) {
+  core::Vocab vocab;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    vocab["token" + std::to_string(i)] = i;
+  }
+  vocab[""] = 1000;
+  vocab["a much longer token than the others"] = 1001;
+  utils::FlatVocab flat_vocab(vocab);
+  ASSERT_EQ(flat_vocab.Size(), vocab.size());
+  for (const auto& item : vocab) {
+    uint32_t id;
+    ASSERT_TRUE(flat_vocab.Find(item.first, &id));
+    ASSERT_EQ(id, item.second);
+    std::string token;
+    ASSERT_TRUE(flat_vocab.FindToken(item.second, &token));
+    ASSERT_EQ(token, item.first);
+  }
+  // Look up a part of a string without copying it.
+  std::string text = "xtoken42x";
+  uint32_t id;
+  ASSERT_TRUE(flat_vocab.Find(text.data() + 1, 7, &id));
+  ASSERT_EQ(id, 42);
+  ASSERT_FALSE(flat_vocab.Find(text.data() + 1, 8, &id));
+  ASSERT_FALSE(flat_vocab.Contains("token1000"));
+  ASSERT_FALSE(flat_vocab.FindToken(1002, &text));
+  ASSERT_EQ(flat_vocab.ToMap(), vocab);
+
+  // The first token of the same id is kept, and the large ids are supported.
+  utils::FlatVocab sparse_vocab;
+  ASSERT_TRUE(sparse_vocab.Insert("a", 3));
+  ASSERT_FALSE(sparse_vocab.Insert("a", 4));
+  ASSERT_TRUE(sparse_vocab.Insert("b", 3));
+  ASSERT_TRUE(sparse_vocab.Insert("c", 4000000000u));
+  ASSERT_TRUE(sparse_vocab.FindToken(3, &text));
+  ASSERT_EQ(text, "a");
+  ASSERT_TRUE(sparse_vocab.FindToken(4000000000u, &text));
+  ASSERT_EQ(text, "c");
+  ASSERT_FALSE(sparse_vocab.FindToken(4, &text));
+  ASSERT_TRUE(sparse_vocab.Find("b", &id));
+  ASSERT_EQ(id, 3);
+}
+
 }  // namespace tests
 }  // namespace fast_tokenizer
 }  // namespace paddlenlp
\ No newline at end of file
@@ -91,6 +91,46 @@ TEST(model, wordpiece_model) {
   check_token(chinese_tokens[5], "##好", 12217, {15, 18});
 }
 
+TEST(model, wordpiece_longest_match) {
+  core::Vocab vocab = {{"[UNK]", 0},
+                       {"un", 1},
+                       {"##aff", 2},
+                       {"##able", 3},
+                       {"##a", 4},
+                       {"-", 5},
+                       {"##-", 6},
+                       {"x-y", 7},
+                       {"##b", 8}};
+  auto check_tokens = [](const std::vector<core::Token>& tokens,
+                         const std::vector<std::string>& expected_values,
+                         const std::vector<uint32_t>& expected_ids) {
+    ASSERT_EQ(tokens.size(), expected_values.size());
+    uint32_t start = 0;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      ASSERT_EQ(tokens[i].value_, expected_values[i]);
+      ASSERT_EQ(tokens[i].id_, expected_ids[i]);
+      ASSERT_EQ(tokens[i].offset_.first, start);
+      start = tokens[i].offset_.second;
+    }
+  };
+  models::WordPiece model(vocab, "[UNK]", 100, "##", true);
+  check_tokens(
+      model.Tokenize("unaffable"), {"un", "##aff", "##able"}, {1, 2, 3});
+  check_tokens(model.Tokenize("un-b"), {"un", "##-", "##b"}, {1, 6, 8});
+  check_tokens(model.Tokenize("unx"), {"[UNK]"}, {0});
+  ASSERT_EQ(model.Tokenize("unx")[0].offset_, core::Offset(0, 3));
+  ASSERT_TRUE(model.Tokenize("").empty());
+
+  // Only the alphanumeric subwords are prefixed without handling the chinese
+  // chars, and the longer subwords are preferred.
+  models::WordPiece alnum_model(vocab, "[UNK]", 100, "##", false);
+  check_tokens(alnum_model.Tokenize("un-b"), {"un", "-", "##b"}, {1, 5, 8});
+  check_tokens(alnum_model.Tokenize("unx-y"), {"un", "x-y"}, {1, 7});
+
+  models::WordPiece short_model(vocab, "[UNK]", 3, "##", true);
+  check_tokens(short_model.Tokenize("unaffable"), {"[UNK]"}, {0});
+}
+
 }  // namespace tests
 }  // namespace fast_tokenizer
 }  // namespace paddlenlp
\ No newline at end of file
@@ -49,7 +49,8 @@ ClipFastTokenizer::ClipFastTokenizer(
                   {unk_token},
                   {continuing_subword_prefix},
                   {end_of_word_suffix},
-                  false);
+                  false,
+                  /* byte_level= */ true);
   // Set tokenizer model
   this->SetModel(bpe);
 
@@ -88,8 +89,9 @@ ClipFastTokenizer::ClipFastTokenizer(
   this->SetNormalizer(seq_normalizer);
 
   // Set pretokenizers
-  pretokenizers::ByteLevelPreTokenizer byte_level_pretokenizer(add_prefix_space,
-                                                               true);
+  // The bytes are tokenized by the byte level BPE directly.
+  pretokenizers::ByteLevelPreTokenizer byte_level_pretokenizer(
+      add_prefix_space, true, /* remap_bytes= */ false);
   pretokenizers::SplitPreTokenizer split_pretokenizer(
       R"('s|'t|'re|'ve|'m|'ll|'d|[\p{L}]+|[\p{N}]|[^\s\p{L}\p{N}]+)",
       core::SplitMode::REMOVED,
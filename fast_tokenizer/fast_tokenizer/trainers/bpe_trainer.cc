@@ -0,0 +1,485 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/trainers/bpe_trainer.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <unordered_set>
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+namespace {
+
+// The merges are applied by several threads only if the merged pair appears in
+// so many words, otherwise creating the threads costs more than the merge.
+constexpr size_t kParallelMergeWords = 4096;
+
+// The hash of core::Pair in base.h collides a lot when the ids are small,
+// which are the most frequent symbols here.
+struct PairHash {
+  size_t operator()(const core::Pair& pair) const {
+    uint64_t h = (static_cast<uint64_t>(pair.first) << 32) | pair.second;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+};
+
+template <typename T>
+using PairMap = std::unordered_map<core::Pair, T, PairHash>;
+
+struct TrainWord {
+  std::vector<uint32_t> symbols_;
+  uint64_t count_;
+};
+
+// The count of the pair changes by delta_ in the word.
+struct PairChange {
+  core::Pair pair_;
+  int64_t delta_;
+  uint32_t word_idx_;
+};
+
+struct MergeCandidate {
+  double score_;
+  core::Pair pair_;
+  // The candidate with the highest score is at the top of the heap, and the
+  // smaller pair wins the ties so that the result is deterministic.
+  bool operator<(const MergeCandidate& other) const {
+    if (score_ != other.score_) {
+      return score_ < other.score_;
+    }
+    return pair_ > other.pair_;
+  }
+};
+
+class MergeLearner {
+public:
+  MergeLearner(MergeScore merge_score,
+               uint64_t min_frequency,
+               size_t prefix_len,
+               std::vector<TrainWord>* words,
+               std::vector<std::string>* id_to_token,
+               core::Vocab* vocab)
+      : merge_score_(merge_score),
+        min_frequency_(min_frequency),
+        prefix_len_(prefix_len),
+        words_(words),
+        id_to_token_(id_to_token),
+        vocab_(vocab) {}
+
+  void Learn(size_t vocab_size, core::Merges* merges) {
+    if (id_to_token_->size() >= vocab_size) {
+      return;
+    }
+    CountPairs();
+    while (id_to_token_->size() < vocab_size && !heap_.empty()) {
+      MergeCandidate top = heap_.top();
+      heap_.pop();
+      int64_t count = pair_counts_[top.pair_];
+      // The count of the pair has changed since it's pushed, a newer
+      // candidate of the pair is in the heap already.
+      if (count <= 0 || GetScore(top.pair_, count) != top.score_) {
+        continue;
+      }
+      if (static_cast<uint64_t>(count) < min_frequency_) {
+        if (merge_score_ == FREQUENCY) {
+          break;
+        }
+        continue;
+      }
+      const std::string& first = (*id_to_token_)[top.pair_.first];
+      const std::string& second = (*id_to_token_)[top.pair_.second];
+      // Same as models::BPE, the prefix of the second token is removed.
+      std::string new_token = first + second.substr(prefix_len_);
+      merges->emplace_back(first, second);
+      uint32_t new_id;
+      auto it = vocab_->find(new_token);
+      if (it != vocab_->end()) {
+        new_id = it->second;
+      } else {
+        new_id = id_to_token_->size();
+        vocab_->emplace(new_token, new_id);
+        id_to_token_->push_back(std::move(new_token));
+      }
+      MergePair(top.pair_, new_id);
+    }
+  }
+
+private:
+  double GetScore(const core::Pair& pair, int64_t count) const {
+    if (merge_score_ == FREQUENCY) {
+      return static_cast<double>(count);
+    }
+    return static_cast<double>(count) /
+           (static_cast<double>(symbol_counts_[pair.first]) *
+            static_cast<double>(symbol_counts_[pair.second]));
+  }
+
+  void EnsureSymbol(uint32_t id) {
+    if (id >= symbol_counts_.size()) {
+      symbol_counts_.resize(id + 1, 0);
+      if (merge_score_ == LIKELIHOOD) {
+        symbol_pairs_.resize(id + 1);
+      }
+    }
+  }
+
+  void AddPairCount(const core::Pair& pair, int64_t delta) {
+    auto it = pair_counts_.find(pair);
+    if (it == pair_counts_.end()) {
+      it = pair_counts_.emplace(pair, 0).first;
+      // The entries of pair_counts_ are never erased, so a pair is added to
+      // the lists of its symbols only once.
+      if (merge_score_ == LIKELIHOOD) {
+        symbol_pairs_[pair.first].push_back(pair);
+        if (pair.second != pair.first) {
+          symbol_pairs_[pair.second].push_back(pair);
+        }
+      }
+    }
+    it->second += delta;
+  }
+
+  void Push(const core::Pair& pair) {
+    int64_t count = pair_counts_[pair];
+    if (count > 0) {
+      heap_.push({GetScore(pair, count), pair});
+    }
+  }
+
+  void CountPairs() {
+    auto& words = *words_;
+    for (const auto& word : words) {
+      for (auto symbol : word.symbols_) {
+        EnsureSymbol(symbol);
+        symbol_counts_[symbol] += word.count_;
+      }
+    }
+    size_t shard_num = GetShardNum();
+    std::vector<PairMap<int64_t>> shard_counts(shard_num);
+    std::vector<PairMap<std::vector<uint32_t>>> shard_words(shard_num);
+    RunShards(words.size(), [&](size_t shard_idx, size_t begin, size_t end) {
+      auto& counts = shard_counts[shard_idx];
+      auto& where = shard_words[shard_idx];
+      for (size_t i = begin; i < end; ++i) {
+        const auto& symbols = words[i].symbols_;
+        for (size_t j = 0; j + 1 < symbols.size(); ++j) {
+          core::Pair pair(symbols[j], symbols[j + 1]);
+          counts[pair] += words[i].count_;
+          where[pair].push_back(i);
+        }
+      }
+    });
+    // The shards are in the order of words, so are the merged indices.
+    for (size_t i = 0; i < shard_num; ++i) {
+      for (const auto& item : shard_counts[i]) {
+        AddPairCount(item.first, item.second);
+      }
+      PairMap<int64_t>().swap(shard_counts[i]);
+      for (auto& item : shard_words[i]) {
+        auto& where = pair_words_[item.first];
+        if (where.empty()) {
+          where.swap(item.second);
+        } else {
+          where.insert(where.end(), item.second.begin(), item.second.end());
+        }
+      }
+      PairMap<std::vector<uint32_t>>().swap(shard_words[i]);
+    }
+    for (const auto& item : pair_counts_) {
+      Push(item.first);
+    }
+  }
+
+  // Replace the pair by new_id from left to right in the word, and record
+  // how the counts of the neighbouring pairs change.
+  static int64_t MergeWord(uint32_t word_idx,
+                           const core::Pair& pair,
+                           uint32_t new_id,
+                           TrainWord* word,
+                           std::vector<PairChange>* changes) {
+    const auto& symbols = word->symbols_;
+    int64_t count = static_cast<int64_t>(word->count_);
+    std::vector<uint32_t> merged;
+    merged.reserve(symbols.size());
+    int64_t merged_num = 0;
+    for (size_t i = 0; i < symbols.size();) {
+      if (i + 1 < symbols.size() && symbols[i] == pair.first &&
+          symbols[i + 1] == pair.second) {
+        if (!merged.empty()) {
+          uint32_t prev = merged.back();
+          changes->push_back({{prev, pair.first}, -count, word_idx});
+          changes->push_back({{prev, new_id}, count, word_idx});
+        }
+        if (i + 2 < symbols.size()) {
+          uint32_t next = symbols[i + 2];
+          changes->push_back({{pair.second, next}, -count, word_idx});
+          changes->push_back({{new_id, next}, count, word_idx});
+        }
+        merged.push_back(new_id);
+        ++merged_num;
+        i += 2;
+      } else {
+        merged.push_back(symbols[i]);
+        ++i;
+      }
+    }
+    if (merged_num > 0) {
+      word->symbols_.swap(merged);
+    }
+    return merged_num * count;
+  }
+
+  void MergePair(const core::Pair& pair, uint32_t new_id) {
+    std::vector<uint32_t> word_indices;
+    auto where = pair_words_.find(pair);
+    if (where != pair_words_.end()) {
+      word_indices.swap(where->second);
+      pair_words_.erase(where);
+    }
+    std::sort(word_indices.begin(), word_indices.end());
+    word_indices.erase(std::unique(word_indices.begin(), word_indices.end()),
+                       word_indices.end());
+    // Every occurrence of the pair is merged.
+    pair_counts_[pair] = 0;
+    EnsureSymbol(new_id);
+
+    size_t shard_num = GetShardNum();
+    std::vector<std::vector<PairChange>> shard_changes(shard_num);
+    std::vector<int64_t> shard_merged(shard_num, 0);
+    auto merge_words = [&](size_t shard_idx, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        shard_merged[shard_idx] += MergeWord(word_indices[i],
+                                             pair,
+                                             new_id,
+                                             &(*words_)[word_indices[i]],
+                                             &shard_changes[shard_idx]);
+      }
+    };
+    if (word_indices.size() >= kParallelMergeWords && shard_num > 1) {
+      RunShards(word_indices.size(), merge_words);
+    } else {
+      merge_words(0, 0, word_indices.size());
+    }
+
+    std::vector<core::Pair> touched_pairs;
+    for (size_t i = 0; i < shard_num; ++i) {
+      symbol_counts_[pair.first] -= shard_merged[i];
+      symbol_counts_[pair.second] -= shard_merged[i];
+      symbol_counts_[new_id] += shard_merged[i];
+      for (const auto& change : shard_changes[i]) {
+        // The overlapping occurrences of the pair, e.g. "a a a", are gone.
+        if (change.pair_ == pair) {
+          continue;
+        }
+        AddPairCount(change.pair_, change.delta_);
+        if (change.delta_ > 0) {
+          pair_words_[change.pair_].push_back(change.word_idx_);
+        }
+        if (merge_score_ == FREQUENCY) {
+          touched_pairs.push_back(change.pair_);
+        }
+      }
+    }
+    if (merge_score_ == LIKELIHOOD) {
+      // The counts of the merged symbols change, so do the scores of all the
+      // pairs containing them.
+      std::unordered_set<uint32_t> symbols = {pair.first, pair.second, new_id};
+      for (auto symbol : symbols) {
+        touched_pairs.insert(touched_pairs.end(),
+                             symbol_pairs_[symbol].begin(),
+                             symbol_pairs_[symbol].end());
+      }
+    }
+    std::sort(touched_pairs.begin(), touched_pairs.end());
+    touched_pairs.erase(std::unique(touched_pairs.begin(), touched_pairs.end()),
+                        touched_pairs.end());
+    for (const auto& touched_pair : touched_pairs) {
+      Push(touched_pair);
+    }
+  }
+
+  MergeScore merge_score_;
+  uint64_t min_frequency_;
+  size_t prefix_len_;
+  std::vector<TrainWord>* words_;
+  std::vector<std::string>* id_to_token_;
+  core::Vocab* vocab_;
+
+  PairMap<int64_t> pair_counts_;
+  // The indices of the words containing the pair, which may be duplicated. A
+  // word may stay in the list after the pair is gone from it.
+  PairMap<std::vector<uint32_t>> pair_words_;
+  std::vector<int64_t> symbol_counts_;
+  // The pairs containing the symbol, only used by LIKELIHOOD.
+  std::vector<std::vector<core::Pair>> symbol_pairs_;
+  std::priority_queue<MergeCandidate> heap_;
+};
+
+}  // namespace
+
+BPETrainer::BPETrainer(size_t vocab_size,
+                       uint64_t min_frequency,
+                       const std::vector<std::string>& special_tokens,
+                       size_t limit_alphabet,
+                       const std::vector<std::string>& initial_alphabet,
+                       const std::string& continuing_subword_prefix,
+                       const std::string& end_of_word_suffix,
+                       MergeScore merge_score)
+    : vocab_size_(vocab_size),
+      min_frequency_(min_frequency),
+      special_tokens_(special_tokens),
+      limit_alphabet_(limit_alphabet),
+      initial_alphabet_(initial_alphabet),
+      continuing_subword_prefix_(continuing_subword_prefix),
+      end_of_word_suffix_(end_of_word_suffix),
+      merge_score_(merge_score) {}
+
+std::vector<std::string> BPETrainer::ComputeAlphabet(
+    const WordCounts& word_counts) const {
+  std::unordered_map<std::string, uint64_t> char_counts;
+  for (const auto& item : word_counts) {
+    ForEachChar(item.first,
+                [&](const char* chr, size_t len, bool, bool) {
+                  char_counts[std::string(chr, len)] += item.second;
+                });
+  }
+  // The initial alphabet is always kept.
+  for (const auto& chr : initial_alphabet_) {
+    char_counts[chr] = std::numeric_limits<uint64_t>::max();
+  }
+  std::vector<std::pair<std::string, uint64_t>> alphabet(char_counts.begin(),
+                                                         char_counts.end());
+  if (limit_alphabet_ > 0 && alphabet.size() > limit_alphabet_) {
+    size_t kept = std::max(limit_alphabet_, initial_alphabet_.size());
+    std::sort(alphabet.begin(),
+              alphabet.end(),
+              [](const std::pair<std::string, uint64_t>& a,
+                 const std::pair<std::string, uint64_t>& b) {
+                return a.second > b.second ||
+                       (a.second == b.second && a.first < b.first);
+              });
+    alphabet.resize(std::min(kept, alphabet.size()));
+  }
+  std::vector<std::string> result;
+  result.reserve(alphabet.size());
+  for (auto& item : alphabet) {
+    result.push_back(std::move(item.first));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void BPETrainer::Train(const WordCounts& word_counts,
+                       core::Vocab* vocab,
+                       core::Merges* merges) const {
+  vocab->clear();
+  merges->clear();
+  std::vector<std::string> id_to_token;
+  auto add_token = [&](const std::string& token) {
+    auto it = vocab->find(token);
+    if (it != vocab->end()) {
+      return it->second;
+    }
+    uint32_t id = id_to_token.size();
+    vocab->emplace(token, id);
+    id_to_token.push_back(token);
+    return id;
+  };
+  for (const auto& token : special_tokens_) {
+    add_token(token);
+  }
+  auto alphabet = ComputeAlphabet(word_counts);
+  for (const auto& chr : alphabet) {
+    add_token(chr);
+  }
+  std::unordered_set<std::string> alphabet_set(alphabet.begin(),
+                                               alphabet.end());
+
+  // Visit the words in order, so that the ids don't depend on the order of
+  // the hash map.
+  std::vector<const WordCounts::value_type*> sorted_words;
+  sorted_words.reserve(word_counts.size());
+  for (const auto& item : word_counts) {
+    sorted_words.push_back(&item);
+  }
+  std::sort(sorted_words.begin(),
+            sorted_words.end(),
+            [](const WordCounts::value_type* a,
+               const WordCounts::value_type* b) { return a->first < b->first; });
+  std::vector<TrainWord> words;
+  words.reserve(sorted_words.size());
+  std::string chr;
+  for (auto item : sorted_words) {
+    TrainWord word;
+    word.count_ = item->second;
+    ForEachChar(
+        item->first,
+        [&](const char* data, size_t len, bool is_first, bool is_last) {
+          chr.assign(data, len);
+          if (alphabet_set.count(chr) == 0) {
+            return;
+          }
+          if (!is_first) {
+            chr.insert(0, continuing_subword_prefix_);
+          }
+          if (is_last) {
+            chr.append(end_of_word_suffix_);
+          }
+          word.symbols_.push_back(add_token(chr));
+        });
+    if (!word.symbols_.empty()) {
+      words.push_back(std::move(word));
+    }
+  }
+
+  MergeLearner learner(merge_score_,
+                       min_frequency_,
+                       continuing_subword_prefix_.length(),
+                       &words,
+                       &id_to_token,
+                       vocab);
+  learner.Learn(vocab_size_, merges);
+}
+
+models::BPE BPETrainer::TrainModel(
+    const WordCounts& word_counts,
+    const std::vector<std::string>& unk_token) const {
+  core::Vocab vocab;
+  core::Merges merges;
+  Train(word_counts, &vocab, &merges);
+  std::vector<std::string> continuing_subword_prefix;
+  if (!continuing_subword_prefix_.empty()) {
+    continuing_subword_prefix.push_back(continuing_subword_prefix_);
+  }
+  std::vector<std::string> end_of_word_suffix;
+  if (!end_of_word_suffix_.empty()) {
+    end_of_word_suffix.push_back(end_of_word_suffix_);
+  }
+  return models::BPE(vocab,
+                     merges,
+                     utils::DEFAULT_CACHE_CAPACITY,
+                     {},
+                     unk_token,
+                     continuing_subword_prefix,
+                     end_of_word_suffix);
+}
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,89 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/models/bpe.h"
+#include "fast_tokenizer/trainers/word_counter.h"
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+// How the pair to merge is chosen in every step. FREQUENCY picks the most
+// frequent pair as BPE. LIKELIHOOD picks the pair that increases the
+// likelihood of the corpus the most, i.e. count(ab) / (count(a) * count(b)),
+// as WordPiece.
+enum FASTTOKENIZER_DECL MergeScore { FREQUENCY, LIKELIHOOD };
+
+// Learn a vocab and the merges of BPE from the counts of the words. Every word
+// starts as a sequence of chars, the non-initial chars are prefixed by
+// continuing_subword_prefix and the final char is suffixed by
+// end_of_word_suffix. Then the best pair of adjacent symbols is merged until
+// the vocab reaches vocab_size. The counts of the pairs are updated
+// incrementally after each merge, only the words containing the merged pair
+// are visited, and the pairs are kept in a lazy max heap.
+class FASTTOKENIZER_DECL BPETrainer {
+public:
+  // limit_alphabet = 0 means the alphabet is unlimited. The chars of
+  // initial_alphabet are always in the alphabet.
+  BPETrainer(size_t vocab_size = 30000,
+             uint64_t min_frequency = 0,
+             const std::vector<std::string>& special_tokens = {},
+             size_t limit_alphabet = 0,
+             const std::vector<std::string>& initial_alphabet = {},
+             const std::string& continuing_subword_prefix = "",
+             const std::string& end_of_word_suffix = "",
+             MergeScore merge_score = FREQUENCY);
+
+  // The ids of the vocab are: the special tokens, the alphabet, the prefixed
+  // or suffixed chars, then the tokens of the merges in order.
+  void Train(const WordCounts& word_counts,
+             core::Vocab* vocab,
+             core::Merges* merges) const;
+  models::BPE TrainModel(const WordCounts& word_counts,
+                         const std::vector<std::string>& unk_token = {}) const;
+
+  size_t GetVocabSize() const { return vocab_size_; }
+  uint64_t GetMinFrequency() const { return min_frequency_; }
+  const std::vector<std::string>& GetSpecialTokens() const {
+    return special_tokens_;
+  }
+  const std::string& GetContinuingSubwordPrefix() const {
+    return continuing_subword_prefix_;
+  }
+  const std::string& GetEndOfWordSuffix() const { return end_of_word_suffix_; }
+  MergeScore GetMergeScore() const { return merge_score_; }
+
+private:
+  std::vector<std::string> ComputeAlphabet(const WordCounts& word_counts) const;
+
+  size_t vocab_size_;
+  uint64_t min_frequency_;
+  std::vector<std::string> special_tokens_;
+  size_t limit_alphabet_;
+  std::vector<std::string> initial_alphabet_;
+  std::string continuing_subword_prefix_;
+  std::string end_of_word_suffix_;
+  MergeScore merge_score_;
+};
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
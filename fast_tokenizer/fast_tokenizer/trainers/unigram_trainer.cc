@@ -0,0 +1,707 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/trainers/unigram_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "darts.h"
+#include "fast_tokenizer/utils/lattice.h"
+#include "glog/logging.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+namespace {
+
+// The same penalty as models::Unigram.
+constexpr double kUnkPenalty = 10.0;
+// The pieces whose expected frequency is lower are dropped by the M step.
+constexpr double kExpectedFrequencyThreshold = 0.5;
+// The chars that are missing in the last model get scores a little lower
+// than the minimum one.
+constexpr double kMinScorePenaltyDelta = 0.0001;
+
+// The symbols of the text of the suffix array, the chars start from
+// kFirstChar.
+constexpr uint32_t kSentinel = 0;
+constexpr uint32_t kSeparator = 1;
+constexpr uint32_t kFirstChar = 2;
+
+// Sort the cyclic shifts of the text by prefix doubling with radix sort, the
+// text must end with a unique smallest symbol so that the order of the shifts
+// is the order of the suffixes. O(n log n) time and 5n integers of memory.
+std::vector<uint32_t> SortSuffixes(const std::vector<uint32_t>& text,
+                                   size_t alphabet_size) {
+  size_t n = text.size();
+  std::vector<uint32_t> sa(n), rank(n), new_sa(n), new_rank(n);
+  std::vector<uint32_t> cnt(std::max(alphabet_size, n), 0);
+  for (size_t i = 0; i < n; ++i) {
+    ++cnt[text[i]];
+  }
+  for (size_t i = 1; i < alphabet_size; ++i) {
+    cnt[i] += cnt[i - 1];
+  }
+  for (size_t i = n; i > 0; --i) {
+    sa[--cnt[text[i - 1]]] = i - 1;
+  }
+  size_t classes = 1;
+  rank[sa[0]] = 0;
+  for (size_t i = 1; i < n; ++i) {
+    if (text[sa[i]] != text[sa[i - 1]]) {
+      ++classes;
+    }
+    rank[sa[i]] = classes - 1;
+  }
+  for (size_t h = 1; h < n && classes < n; h <<= 1) {
+    // Sort by the second half, which is the order of sa shifted by h.
+    for (size_t i = 0; i < n; ++i) {
+      new_sa[i] = (sa[i] + n - h) % n;
+    }
+    // Then stable sort by the first half.
+    std::fill(cnt.begin(), cnt.begin() + classes, 0);
+    for (size_t i = 0; i < n; ++i) {
+      ++cnt[rank[new_sa[i]]];
+    }
+    for (size_t i = 1; i < classes; ++i) {
+      cnt[i] += cnt[i - 1];
+    }
+    for (size_t i = n; i > 0; --i) {
+      sa[--cnt[rank[new_sa[i - 1]]]] = new_sa[i - 1];
+    }
+    new_rank[sa[0]] = 0;
+    classes = 1;
+    for (size_t i = 1; i < n; ++i) {
+      if (rank[sa[i]] != rank[sa[i - 1]] ||
+          rank[(sa[i] + h) % n] != rank[(sa[i - 1] + h) % n]) {
+        ++classes;
+      }
+      new_rank[sa[i]] = classes - 1;
+    }
+    rank.swap(new_rank);
+  }
+  return sa;
+}
+
+// lcp[i] is the length of the common prefix of the suffixes sa[i - 1] and
+// sa[i] by Kasai's algorithm. The common prefixes stop at the separators, so
+// they never cross the boundary of a word.
+std::vector<uint32_t> ComputeLCP(const std::vector<uint32_t>& text,
+                                 const std::vector<uint32_t>& sa) {
+  size_t n = text.size();
+  std::vector<uint32_t> rank(n);
+  for (size_t i = 0; i < n; ++i) {
+    rank[sa[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n, 0);
+  size_t h = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    size_t j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && text[i + h] == text[j + h] &&
+           text[i + h] >= kFirstChar) {
+      ++h;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      --h;
+    }
+  }
+  return lcp;
+}
+
+double Digamma(double x) {
+  double result = 0.0;
+  for (; x < 7.0; x += 1.0) {
+    result -= 1.0 / x;
+  }
+  x -= 0.5;
+  double xx = 1.0 / x;
+  double xx2 = xx * xx;
+  double xx4 = xx2 * xx2;
+  result += std::log(x) + (1.0 / 24.0) * xx2 - (7.0 / 960.0) * xx4 +
+            (31.0 / 8064.0) * xx4 * xx2 - (127.0 / 30720.0) * xx4 * xx4;
+  return result;
+}
+
+}  // namespace
+
+// The model of the pieces during training. Unlike models::Unigram, the piece 0
+// is the unk piece which is never in the trie, and the model is immutable so
+// that it can be shared by the threads.
+class UnigramTrainer::PieceModel {
+public:
+  explicit PieceModel(const std::vector<Piece>& pieces)
+      : min_score_(std::numeric_limits<double>::max()),
+        trie_results_size_(0) {
+    scores_.reserve(pieces.size());
+    std::vector<const char*> keys;
+    std::vector<int> values;
+    for (size_t id = 0; id < pieces.size(); ++id) {
+      scores_.push_back(static_cast<float>(pieces[id].second));
+      if (id == 0) {
+        continue;
+      }
+      keys.push_back(pieces[id].first.c_str());
+      values.push_back(id);
+      min_score_ = std::min(min_score_, pieces[id].second);
+    }
+    if (keys.empty()) {
+      return;
+    }
+    std::vector<const char*> sorted_keys;
+    std::vector<int> sorted_values;
+    utils::GetSortedVocab(keys, values, &sorted_keys, &sorted_values);
+    trie_.reset(new Darts::DoubleArray());
+    if (trie_->build(sorted_keys.size(),
+                     const_cast<char**>(&sorted_keys[0]),
+                     nullptr,
+                     &sorted_values[0]) != 0) {
+      throw std::runtime_error("Cannot build double-array.");
+    }
+    const int kMaxTrieResultsSize = 1024;
+    std::vector<Darts::DoubleArray::result_pair_type> results(
+        kMaxTrieResultsSize);
+    for (size_t id = 1; id < pieces.size(); ++id) {
+      int num_nodes = trie_->commonPrefixSearch(pieces[id].first.data(),
+                                                results.data(),
+                                                results.size(),
+                                                pieces[id].first.size());
+      trie_results_size_ = std::max(trie_results_size_, num_nodes);
+    }
+  }
+
+  void PopulateNodes(utils::Lattice* lattice) const {
+    const float unk_score = static_cast<float>(min_score_ - kUnkPenalty);
+    const int len = lattice->size();
+    const char* end = lattice->sentence() + lattice->utf8_size();
+    std::vector<Darts::DoubleArray::result_pair_type> trie_results(
+        trie_results_size_ + 1);
+    for (int begin_pos = 0; begin_pos < len; ++begin_pos) {
+      const char* begin = lattice->surface(begin_pos);
+      size_t num_nodes = 0;
+      if (trie_ != nullptr) {
+        num_nodes = trie_->commonPrefixSearch(begin,
+                                              trie_results.data(),
+                                              trie_results.size(),
+                                              static_cast<int>(end - begin));
+      }
+      bool has_single_node = false;
+      for (size_t k = 0; k < num_nodes; ++k) {
+        const char* piece_end = begin + trie_results[k].length;
+        int length = 0;
+        while (lattice->surface(begin_pos + length) < piece_end) {
+          ++length;
+        }
+        auto* node = lattice->Insert(begin_pos, length);
+        node->id = trie_results[k].value;
+        node->score = scores_[node->id];
+        has_single_node = has_single_node || length == 1;
+      }
+      if (!has_single_node) {
+        auto* node = lattice->Insert(begin_pos, 1);
+        node->id = 0;
+        node->score = unk_score;
+      }
+    }
+  }
+
+  size_t Size() const { return scores_.size(); }
+
+private:
+  std::unique_ptr<Darts::DoubleArray> trie_;
+  std::vector<float> scores_;
+  double min_score_;
+  int trie_results_size_;
+};
+
+UnigramTrainer::UnigramTrainer(size_t vocab_size,
+                               size_t n_sub_iterations,
+                               double shrinking_factor,
+                               const std::vector<std::string>& special_tokens,
+                               const std::vector<std::string>& initial_alphabet,
+                               const std::string& unk_token,
+                               size_t max_piece_length,
+                               size_t seed_size,
+                               size_t max_seed_chars)
+    : vocab_size_(vocab_size),
+      n_sub_iterations_(n_sub_iterations),
+      shrinking_factor_(shrinking_factor),
+      special_tokens_(special_tokens),
+      initial_alphabet_(initial_alphabet),
+      unk_token_(unk_token),
+      max_piece_length_(max_piece_length),
+      seed_size_(seed_size),
+      max_seed_chars_(std::min<size_t>(
+          max_seed_chars, std::numeric_limits<uint32_t>::max() / 2)) {}
+
+std::vector<UnigramTrainer::Piece> UnigramTrainer::MakeSeedPieces(
+    const Words& words, const std::vector<Piece>& required_chars) const {
+  // Only the most frequent words are put into the suffix array.
+  Words seed_words(words);
+  std::stable_sort(seed_words.begin(),
+                   seed_words.end(),
+                   [](const WordCounts::value_type* a,
+                      const WordCounts::value_type* b) {
+                     return a->second > b->second;
+                   });
+  std::unordered_map<std::string, uint32_t> char_ids;
+  std::vector<uint32_t> text;
+  // The count of the word of every symbol and the offset of it in seed_str.
+  std::vector<uint64_t> weights;
+  std::vector<size_t> offsets;
+  std::string seed_str;
+  for (auto word : seed_words) {
+    if (text.size() + word->first.length() + 2 > max_seed_chars_) {
+      continue;
+    }
+    ForEachChar(word->first, [&](const char* chr, size_t len, bool, bool) {
+      uint32_t char_id = kFirstChar + char_ids.size();
+      text.push_back(
+          char_ids.emplace(std::string(chr, len), char_id).first->second);
+      weights.push_back(word->second);
+      offsets.push_back(seed_str.length());
+      seed_str.append(chr, len);
+    });
+    text.push_back(kSeparator);
+    weights.push_back(0);
+    offsets.push_back(seed_str.length());
+    seed_str.push_back('\0');
+  }
+  text.push_back(kSentinel);
+  weights.push_back(0);
+  offsets.push_back(seed_str.length());
+
+  size_t n = text.size();
+  auto sa = SortSuffixes(text, kFirstChar + char_ids.size());
+  auto lcp = ComputeLCP(text, sa);
+  // The weighted count of the suffixes sa[0, i).
+  std::vector<uint64_t> weight_sums(n + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    weight_sums[i + 1] = weight_sums[i] + weights[sa[i]];
+  }
+
+  // Every lcp interval [lb, rb) is an internal node of the suffix tree, whose
+  // string is the common prefix of the suffixes in it, and its frequency is
+  // the total count of them.
+  struct Substring {
+    double score_;
+    uint32_t pos_;
+    uint32_t len_;
+  };
+  std::vector<Substring> substrings;
+  struct Interval {
+    uint32_t lcp_;
+    uint32_t lb_;
+  };
+  std::vector<Interval> stack(1, {0, 0});
+  for (size_t i = 1; i <= n; ++i) {
+    uint32_t h = (i < n) ? lcp[i] : 0;
+    uint32_t lb = i - 1;
+    while (h < stack.back().lcp_) {
+      Interval top = stack.back();
+      stack.pop_back();
+      if (top.lcp_ > 1 && top.lcp_ <= max_piece_length_) {
+        double freq =
+            static_cast<double>(weight_sums[i] - weight_sums[top.lb_]);
+        substrings.push_back({freq * top.lcp_, sa[top.lb_], top.lcp_});
+      }
+      lb = top.lb_;
+    }
+    if (h > stack.back().lcp_) {
+      stack.push_back({h, lb});
+    }
+  }
+  // The words are unique in the text, so a frequent word is usually a leaf of
+  // the suffix tree. A leaf is the suffix up to the end of its word, it's a
+  // new substring if it's longer than the lcp with its neighbours.
+  std::vector<uint32_t> word_rest(n, 0);
+  for (size_t i = n - 1; i > 0; --i) {
+    if (text[i - 1] >= kFirstChar) {
+      word_rest[i - 1] = word_rest[i] + 1;
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t len = word_rest[sa[i]];
+    uint32_t depth = std::max(lcp[i], (i + 1 < n) ? lcp[i + 1] : 0);
+    if (len > depth && len > 1 && len <= max_piece_length_) {
+      substrings.push_back(
+          {static_cast<double>(weights[sa[i]]) * len, sa[i], len});
+    }
+  }
+  std::vector<uint32_t>().swap(word_rest);
+  std::vector<uint32_t>().swap(sa);
+  std::vector<uint32_t>().swap(lcp);
+
+  size_t substring_num = 0;
+  if (seed_size_ > required_chars.size()) {
+    substring_num = std::min(seed_size_ - required_chars.size(),
+                             substrings.size());
+  }
+  auto compare = [](const Substring& a, const Substring& b) {
+    return a.score_ > b.score_ || (a.score_ == b.score_ && a.pos_ < b.pos_);
+  };
+  std::partial_sort(substrings.begin(),
+                    substrings.begin() + substring_num,
+                    substrings.end(),
+                    compare);
+
+  std::vector<Piece> pieces(required_chars);
+  double sum = 0.0;
+  for (const auto& piece : pieces) {
+    sum += piece.second;
+  }
+  for (size_t i = 0; i < substring_num; ++i) {
+    const auto& substring = substrings[i];
+    size_t begin = offsets[substring.pos_];
+    size_t end = offsets[substring.pos_ + substring.len_];
+    pieces.emplace_back(seed_str.substr(begin, end - begin), substring.score_);
+    sum += substring.score_;
+  }
+  double logsum = std::log(sum);
+  for (auto& piece : pieces) {
+    piece.second = std::log(piece.second) - logsum;
+  }
+  return pieces;
+}
+
+double UnigramTrainer::RunEStep(const PieceModel& model,
+                                const Words& words,
+                                std::vector<double>* expected) const {
+  size_t shard_num = GetShardNum();
+  std::vector<std::vector<float>> shard_expected(shard_num);
+  std::vector<double> shard_likelihood(shard_num, 0.0);
+  RunShards(words.size(), [&](size_t shard_idx, size_t begin, size_t end) {
+    auto& expected = shard_expected[shard_idx];
+    expected.assign(model.Size(), 0.0f);
+    // The nodes of the lattice are reused from one word to another.
+    utils::Lattice lattice;
+    for (size_t i = begin; i < end; ++i) {
+      const auto& word = words[i]->first;
+      lattice.SetSentence(utils::simple_string_view(word.data(), word.size()));
+      model.PopulateNodes(&lattice);
+      shard_likelihood[shard_idx] += lattice.PopulateMarginal(
+          static_cast<float>(words[i]->second), &expected);
+    }
+  });
+  expected->assign(model.Size(), 0.0);
+  double likelihood = 0.0;
+  for (size_t i = 0; i < shard_num; ++i) {
+    for (size_t id = 0; id < shard_expected[i].size(); ++id) {
+      (*expected)[id] += shard_expected[i][id];
+    }
+    likelihood += shard_likelihood[i];
+  }
+  return likelihood;
+}
+
+std::vector<UnigramTrainer::Piece> UnigramTrainer::RunMStep(
+    const std::vector<Piece>& pieces,
+    const std::vector<double>& expected) const {
+  std::vector<Piece> new_pieces;
+  new_pieces.reserve(pieces.size());
+  double sum = 0.0;
+  for (size_t id = 0; id < pieces.size(); ++id) {
+    // Always keep the unk piece.
+    if (id == 0) {
+      new_pieces.push_back(pieces[id]);
+      continue;
+    }
+    if (expected[id] < kExpectedFrequencyThreshold) {
+      continue;
+    }
+    new_pieces.emplace_back(pieces[id].first, expected[id]);
+    sum += expected[id];
+  }
+  // Variational bayes, the digamma works as a sparse prior.
+  double logsum = Digamma(sum);
+  for (size_t id = 1; id < new_pieces.size(); ++id) {
+    new_pieces[id].second = Digamma(new_pieces[id].second) - logsum;
+  }
+  return new_pieces;
+}
+
+std::vector<UnigramTrainer::Piece> UnigramTrainer::PrunePieces(
+    const PieceModel& model,
+    const std::vector<Piece>& pieces,
+    const Words& words) const {
+  size_t n = pieces.size();
+  size_t shard_num = GetShardNum();
+  // A piece is always kept if it's the best segmentation of itself. If so,
+  // alternatives are the pieces of its second best segmentation.
+  std::vector<char> always_keep(n, 1);
+  std::vector<std::vector<uint32_t>> alternatives(n);
+  RunShards(n, [&](size_t shard_idx, size_t begin, size_t end) {
+    utils::Lattice lattice;
+    for (size_t id = std::max<size_t>(begin, 1); id < end; ++id) {
+      const auto& piece = pieces[id].first;
+      lattice.SetSentence(
+          utils::simple_string_view(piece.data(), piece.size()));
+      model.PopulateNodes(&lattice);
+      auto nbests = lattice.NBest(2, false, 0.0f);
+      if (nbests.size() == 1) {
+        always_keep[id] = 1;
+      } else if (nbests[0].first.size() >= 2) {
+        always_keep[id] = 0;
+      } else if (nbests[0].first.size() == 1) {
+        always_keep[id] = 1;
+        for (const auto* node : nbests[1].first) {
+          alternatives[id].push_back(node->id);
+        }
+      }
+    }
+  });
+
+  // The frequencies of the pieces in the viterbi paths of the words, and the
+  // total count of the words containing them.
+  std::vector<std::vector<double>> shard_freqs(shard_num);
+  std::vector<std::vector<double>> shard_word_freqs(shard_num);
+  RunShards(words.size(), [&](size_t shard_idx, size_t begin, size_t end) {
+    auto& freqs = shard_freqs[shard_idx];
+    auto& word_freqs = shard_word_freqs[shard_idx];
+    freqs.assign(n, 0.0);
+    word_freqs.assign(n, 0.0);
+    std::vector<size_t> last_word(n, std::numeric_limits<size_t>::max());
+    utils::Lattice lattice;
+    for (size_t i = begin; i < end; ++i) {
+      const auto& word = words[i]->first;
+      double count = static_cast<double>(words[i]->second);
+      lattice.SetSentence(utils::simple_string_view(word.data(), word.size()));
+      model.PopulateNodes(&lattice);
+      for (const auto* node : lattice.Viterbi().first) {
+        freqs[node->id] += count;
+        if (last_word[node->id] != i) {
+          last_word[node->id] = i;
+          word_freqs[node->id] += count;
+        }
+      }
+    }
+  });
+  std::vector<double> freqs(n, 0.0);
+  std::vector<double> word_freqs(n, 0.0);
+  for (size_t i = 0; i < shard_num; ++i) {
+    for (size_t id = 0; id < shard_freqs[i].size(); ++id) {
+      freqs[id] += shard_freqs[i][id];
+      word_freqs[id] += shard_word_freqs[i][id];
+    }
+  }
+  double total_count = 0.0;
+  for (auto word : words) {
+    total_count += static_cast<double>(word->second);
+  }
+  double sum = 0.0;
+  for (auto freq : freqs) {
+    sum += freq;
+  }
+  double logsum = std::log(sum);
+
+  std::vector<Piece> new_pieces(1, pieces[0]);
+  std::vector<std::pair<double, uint32_t>> candidates;
+  for (size_t id = 1; id < n; ++id) {
+    if (freqs[id] == 0 || !always_keep[id]) {
+      // Not in any viterbi path, it's safe to remove.
+      continue;
+    } else if (alternatives[id].empty()) {
+      new_pieces.push_back(pieces[id]);
+    } else {
+      // The loss of the likelihood if the piece is replaced by the
+      // alternatives, which take over its frequency.
+      double word_prob = word_freqs[id] / total_count;
+      double logprob = std::log(freqs[id]) - logsum;
+      double logsum_alt =
+          std::log(sum + freqs[id] * (alternatives[id].size() - 1));
+      double logprob_alt = 0.0;
+      for (auto alt : alternatives[id]) {
+        logprob_alt += std::log(freqs[alt] + freqs[id]) - logsum_alt;
+      }
+      candidates.emplace_back(word_prob * (logprob - logprob_alt), id);
+    }
+  }
+  size_t desired_size = vocab_size_ * 11 / 10;
+  size_t pruned_size =
+      std::max(desired_size, static_cast<size_t>(shrinking_factor_ * n));
+  std::sort(candidates.begin(),
+            candidates.end(),
+            [](const std::pair<double, uint32_t>& a,
+               const std::pair<double, uint32_t>& b) {
+              return a.first > b.first ||
+                     (a.first == b.first && a.second < b.second);
+            });
+  for (const auto& candidate : candidates) {
+    if (new_pieces.size() >= pruned_size) {
+      break;
+    }
+    new_pieces.push_back(pieces[candidate.second]);
+  }
+  return new_pieces;
+}
+
+std::vector<UnigramTrainer::Piece> UnigramTrainer::Finalize(
+    const std::vector<Piece>& pieces,
+    const std::vector<Piece>& required_chars,
+    size_t max_pieces) const {
+  double min_score = std::numeric_limits<double>::max();
+  std::unordered_map<std::string, double> scores;
+  for (size_t id = 1; id < pieces.size(); ++id) {
+    scores.emplace(pieces[id].first, pieces[id].second);
+    min_score = std::min(min_score, pieces[id].second);
+  }
+  std::vector<Piece> result;
+  std::unordered_set<std::string> inserted;
+  // The chars are always kept so that every word can be tokenized.
+  double penalty = kMinScorePenaltyDelta;
+  for (const auto& chr : required_chars) {
+    auto it = scores.find(chr.first);
+    if (it != scores.end()) {
+      result.emplace_back(chr.first, it->second);
+    } else {
+      result.emplace_back(chr.first, min_score - penalty);
+      penalty += kMinScorePenaltyDelta;
+    }
+    inserted.insert(chr.first);
+  }
+  std::vector<Piece> sorted_pieces(pieces.begin() + 1, pieces.end());
+  std::sort(sorted_pieces.begin(),
+            sorted_pieces.end(),
+            [](const Piece& a, const Piece& b) {
+              return a.second > b.second ||
+                     (a.second == b.second && a.first < b.first);
+            });
+  for (const auto& piece : sorted_pieces) {
+    if (result.size() >= max_pieces) {
+      break;
+    }
+    if (inserted.insert(piece.first).second) {
+      result.push_back(piece);
+    }
+  }
+  std::stable_sort(result.begin(),
+                   result.end(),
+                   [](const Piece& a, const Piece& b) {
+                     return a.second > b.second;
+                   });
+  return result;
+}
+
+void UnigramTrainer::Train(const WordCounts& word_counts,
+                           core::VocabList* vocab,
+                           std::vector<size_t>* unk_id) const {
+  vocab->clear();
+  unk_id->clear();
+  Words words;
+  words.reserve(word_counts.size());
+  for (const auto& item : word_counts) {
+    if (!item.first.empty()) {
+      words.push_back(&item);
+    }
+  }
+  std::sort(words.begin(),
+            words.end(),
+            [](const WordCounts::value_type* a,
+               const WordCounts::value_type* b) { return a->first < b->first; });
+
+  std::unordered_map<std::string, double> char_counts;
+  for (auto word : words) {
+    ForEachChar(word->first, [&](const char* chr, size_t len, bool, bool) {
+      char_counts[std::string(chr, len)] += static_cast<double>(word->second);
+    });
+  }
+  for (const auto& chr : initial_alphabet_) {
+    char_counts.emplace(chr, 1.0);
+  }
+  std::vector<Piece> required_chars(char_counts.begin(), char_counts.end());
+  std::sort(required_chars.begin(),
+            required_chars.end(),
+            [](const Piece& a, const Piece& b) {
+              return a.second > b.second ||
+                     (a.second == b.second && a.first < b.first);
+            });
+
+  // The piece 0 is the unk piece during training, whatever unk_token is.
+  std::vector<Piece> pieces(1, Piece("", 0.0));
+  auto seed_pieces = MakeSeedPieces(words, required_chars);
+  pieces.insert(pieces.end(), seed_pieces.begin(), seed_pieces.end());
+  VLOG(6) << "Using " << pieces.size() << " seed pieces of " << words.size()
+          << " words for EM training.";
+
+  size_t desired_size = vocab_size_ * 11 / 10;
+  while (true) {
+    for (size_t iter = 0; iter < n_sub_iterations_; ++iter) {
+      PieceModel model(pieces);
+      std::vector<double> expected;
+      double likelihood = RunEStep(model, words, &expected);
+      pieces = RunMStep(pieces, expected);
+      VLOG(6) << "EM iteration " << iter << ", pieces: " << pieces.size()
+              << ", likelihood: " << likelihood;
+    }
+    if (pieces.size() <= desired_size) {
+      break;
+    }
+    PieceModel model(pieces);
+    auto pruned_pieces = PrunePieces(model, pieces, words);
+    if (pruned_pieces.size() >= pieces.size()) {
+      break;
+    }
+    pieces.swap(pruned_pieces);
+  }
+
+  std::vector<std::string> special_tokens(special_tokens_);
+  if (!unk_token_.empty()) {
+    auto it =
+        std::find(special_tokens.begin(), special_tokens.end(), unk_token_);
+    if (it == special_tokens.end()) {
+      special_tokens.insert(special_tokens.begin(), unk_token_);
+      unk_id->push_back(0);
+    } else {
+      unk_id->push_back(it - special_tokens.begin());
+    }
+  }
+  size_t max_pieces = vocab_size_ > special_tokens.size()
+                          ? vocab_size_ - special_tokens.size()
+                          : 0;
+  auto final_pieces = Finalize(pieces, required_chars, max_pieces);
+  std::unordered_set<std::string> special_set(special_tokens.begin(),
+                                              special_tokens.end());
+  vocab->reserve(special_tokens.size() + final_pieces.size());
+  for (const auto& token : special_tokens) {
+    vocab->emplace_back(token, 0.0f);
+  }
+  for (const auto& piece : final_pieces) {
+    if (special_set.count(piece.first) == 0) {
+      vocab->emplace_back(piece.first, static_cast<float>(piece.second));
+    }
+  }
+}
+
+models::Unigram UnigramTrainer::TrainModel(
+    const WordCounts& word_counts) const {
+  core::VocabList vocab;
+  std::vector<size_t> unk_id;
+  Train(word_counts, &vocab, &unk_id);
+  return models::Unigram(vocab, unk_id);
+}
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
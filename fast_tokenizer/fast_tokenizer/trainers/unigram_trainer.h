@@ -0,0 +1,100 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/models/unigram.h"
+#include "fast_tokenizer/trainers/word_counter.h"
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+// Learn the pieces and the scores of Unigram from the counts of the words,
+// in the same way as SentencePiece:
+// 1. Seed the pieces with all the chars and the most frequent substrings,
+//    which are the nodes of the suffix tree found by a suffix array.
+// 2. Re-estimate the scores by EM. The E step computes the marginal
+//    probabilities of the pieces with the forward backward algorithm of
+//    utils::Lattice, every thread owns a lattice and its node allocator.
+// 3. Drop the pieces whose removal reduces the likelihood the least, and go
+//    back to 2 until the number of pieces reaches the vocab_size.
+class FASTTOKENIZER_DECL UnigramTrainer {
+public:
+  // unk_token is added before the special tokens if it's not one of them, no
+  // unk token is used if it's empty. The suffix array is built from the most
+  // frequent words of at most max_seed_chars chars in total.
+  UnigramTrainer(size_t vocab_size = 8000,
+                 size_t n_sub_iterations = 2,
+                 double shrinking_factor = 0.75,
+                 const std::vector<std::string>& special_tokens = {},
+                 const std::vector<std::string>& initial_alphabet = {},
+                 const std::string& unk_token = "",
+                 size_t max_piece_length = 16,
+                 size_t seed_size = 1000000,
+                 size_t max_seed_chars = 1 << 26);
+
+  // The special tokens come first, then the pieces in the descending order
+  // of scores.
+  void Train(const WordCounts& word_counts,
+             core::VocabList* vocab,
+             std::vector<size_t>* unk_id) const;
+  models::Unigram TrainModel(const WordCounts& word_counts) const;
+
+  size_t GetVocabSize() const { return vocab_size_; }
+  const std::vector<std::string>& GetSpecialTokens() const {
+    return special_tokens_;
+  }
+  const std::string& GetUnkToken() const { return unk_token_; }
+
+private:
+  using Piece = std::pair<std::string, double>;
+  using Words = std::vector<const WordCounts::value_type*>;
+  class PieceModel;
+
+  std::vector<Piece> MakeSeedPieces(
+      const Words& words, const std::vector<Piece>& required_chars) const;
+  // Return the log likelihood of the words.
+  double RunEStep(const PieceModel& model,
+                  const Words& words,
+                  std::vector<double>* expected) const;
+  std::vector<Piece> RunMStep(const std::vector<Piece>& pieces,
+                              const std::vector<double>& expected) const;
+  std::vector<Piece> PrunePieces(const PieceModel& model,
+                                 const std::vector<Piece>& pieces,
+                                 const Words& words) const;
+  std::vector<Piece> Finalize(const std::vector<Piece>& pieces,
+                              const std::vector<Piece>& required_chars,
+                              size_t max_pieces) const;
+
+  size_t vocab_size_;
+  size_t n_sub_iterations_;
+  double shrinking_factor_;
+  std::vector<std::string> special_tokens_;
+  std::vector<std::string> initial_alphabet_;
+  std::string unk_token_;
+  size_t max_piece_length_;
+  size_t seed_size_;
+  size_t max_seed_chars_;
+};
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,146 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/trainers/word_counter.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "fast_tokenizer/core/base.h"
+#include "fast_tokenizer/utils/mapped_file.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+size_t GetShardNum() {
+  return static_cast<size_t>(std::max(core::GetThreadNum(), 1));
+}
+
+void RunShards(size_t size, std::function<void(size_t, size_t, size_t)> func) {
+  if (size == 0) {
+    return;
+  }
+  core::RunMultiThread(
+      [&](size_t start, size_t step) {
+        if (step == 0 || start >= size) {
+          return;
+        }
+        size_t end = std::min(start + step, size);
+        func(start / step, start, end);
+      },
+      size);
+}
+
+WordCounter::WordCounter(const normalizers::Normalizer* normalizer,
+                         const pretokenizers::PreTokenizer* pretokenizer)
+    : normalizer_(normalizer), pretokenizer_(pretokenizer) {}
+
+void WordCounter::CountText(const char* text,
+                            size_t len,
+                            WordCounts* word_counts) const {
+  if (len == 0) {
+    return;
+  }
+  pretokenizers::PreTokenizedString pretokenized(std::string(text, len));
+  if (normalizer_ != nullptr) {
+    pretokenized.Normalize([&](normalizers::NormalizedString* normalized) {
+      (*normalizer_)(normalized);
+    });
+  }
+  if (pretokenizer_ != nullptr) {
+    (*pretokenizer_)(&pretokenized);
+  }
+  // Only visit the words, no token is produced.
+  pretokenized.Tokenize([&](normalizers::NormalizedString* normalized) {
+    const auto& word = normalized->GetStr();
+    if (!word.empty()) {
+      ++(*word_counts)[word];
+    }
+    return std::vector<core::Token>();
+  });
+}
+
+void WordCounter::MergeShards(std::vector<WordCounts>* shards) {
+  for (auto& shard : *shards) {
+    if (word_counts_.empty()) {
+      word_counts_.swap(shard);
+      continue;
+    }
+    for (auto& item : shard) {
+      word_counts_[item.first] += item.second;
+    }
+    WordCounts().swap(shard);
+  }
+}
+
+void WordCounter::Feed(const std::vector<std::string>& texts) {
+  std::vector<WordCounts> shards(GetShardNum());
+  RunShards(texts.size(), [&](size_t shard_idx, size_t begin, size_t end) {
+    auto& word_counts = shards[shard_idx];
+    for (size_t i = begin; i < end; ++i) {
+      CountText(texts[i].data(), texts[i].length(), &word_counts);
+    }
+  });
+  MergeShards(&shards);
+}
+
+void WordCounter::FeedFiles(const std::vector<std::string>& files) {
+  size_t shard_num = GetShardNum();
+  for (const auto& file : files) {
+    std::unique_ptr<utils::MappedFile> mapped(new utils::MappedFile(file));
+    if (!mapped->IsValid()) {
+      throw std::runtime_error("The corpus file " + file + " can't be read.");
+    }
+    const char* data = mapped->Data();
+    size_t size = mapped->Size();
+    // Cut the file into shards of nearly the same bytes, and move every cut
+    // to the next line boundary.
+    std::vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < shard_num; ++i) {
+      size_t pos = std::max(size / shard_num * i, bounds.back());
+      auto newline = static_cast<const char*>(
+          std::memchr(data + pos, '\n', size - pos));
+      pos = (newline == nullptr) ? size : newline - data + 1;
+      bounds.push_back(pos);
+    }
+    bounds.push_back(size);
+    std::vector<WordCounts> shards(shard_num);
+    RunShards(shard_num, [&](size_t shard_idx, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        utils::ForEachLine(
+            data + bounds[i],
+            bounds[i + 1] - bounds[i],
+            [&](const char* line, size_t len) {
+              if (len > 0 && line[len - 1] == '\r') {
+                --len;
+              }
+              CountText(line, len, &shards[shard_idx]);
+            });
+      }
+    });
+    MergeShards(&shards);
+  }
+}
+
+void WordCounter::AddWordCounts(const WordCounts& word_counts) {
+  for (const auto& item : word_counts) {
+    word_counts_[item.first] += item.second;
+  }
+}
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
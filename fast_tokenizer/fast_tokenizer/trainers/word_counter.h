@@ -0,0 +1,91 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fast_tokenizer/normalizers/normalizer.h"
+#include "fast_tokenizer/pretokenizers/pretokenizer.h"
+#include "fast_tokenizer/utils/utf8.h"
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+using WordCounts = std::unordered_map<std::string, uint64_t>;
+
+// Count the words of a corpus, which are the inputs of the trainers. The texts
+// are normalized and split into words by the same normalizer and pretokenizer
+// as the tokenizer, both of them are optional. The texts are counted by
+// core::GetThreadNum() threads, each of them counts its shard into its own
+// map, and the maps are merged at the end of every Feed.
+class FASTTOKENIZER_DECL WordCounter {
+public:
+  // The normalizer and the pretokenizer are not owned by the counter, they
+  // must outlive it and are shared by the counting threads.
+  WordCounter(const normalizers::Normalizer* normalizer = nullptr,
+              const pretokenizers::PreTokenizer* pretokenizer = nullptr);
+
+  // Can be called many times to feed a large corpus by chunks.
+  void Feed(const std::vector<std::string>& texts);
+  // Count every line of the files. The files are memory mapped and split into
+  // shards at the line boundaries, so they are never loaded as a whole.
+  void FeedFiles(const std::vector<std::string>& files);
+  // Add the words that are counted by other means, e.g. another counter.
+  void AddWordCounts(const WordCounts& word_counts);
+
+  const WordCounts& GetWordCounts() const { return word_counts_; }
+  void Clear() { word_counts_.clear(); }
+
+private:
+  void CountText(const char* text, size_t len, WordCounts* word_counts) const;
+  void MergeShards(std::vector<WordCounts>* shards);
+
+  const normalizers::Normalizer* normalizer_;
+  const pretokenizers::PreTokenizer* pretokenizer_;
+  WordCounts word_counts_;
+};
+
+// Split [0, size) into at most core::GetThreadNum() contiguous shards and call
+// func(shard_idx, begin, end) for each of them in parallel. The shard_idx is
+// less than GetShardNum().
+FASTTOKENIZER_DECL void RunShards(
+    size_t size, std::function<void(size_t, size_t, size_t)> func);
+FASTTOKENIZER_DECL size_t GetShardNum();
+
+// Call func(char, char_len, is_first, is_last) for every utf8 char of the
+// word. The chars are split in the same way as utils::Lattice.
+template <typename Func>
+void ForEachChar(const std::string& word, Func func) {
+  size_t pos = 0;
+  while (pos < word.length()) {
+    size_t char_len = utils::BytesInUTF8Char(word[pos]);
+    char_len = std::max<size_t>(1, std::min(char_len, word.length() - pos));
+    func(word.data() + pos,
+         char_len,
+         pos == 0,
+         pos + char_len == word.length());
+    pos += char_len;
+  }
+}
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,63 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/trainers/wordpiece_trainer.h"
+
+#include <stdexcept>
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+WordPieceTrainer::WordPieceTrainer(
+    size_t vocab_size,
+    uint64_t min_frequency,
+    const std::vector<std::string>& special_tokens,
+    size_t limit_alphabet,
+    const std::vector<std::string>& initial_alphabet,
+    const std::string& continuing_subword_prefix)
+    : bpe_trainer_(vocab_size,
+                   min_frequency,
+                   special_tokens,
+                   limit_alphabet,
+                   initial_alphabet,
+                   continuing_subword_prefix,
+                   "",
+                   LIKELIHOOD) {}
+
+void WordPieceTrainer::Train(const WordCounts& word_counts,
+                             core::Vocab* vocab) const {
+  core::Merges merges;
+  bpe_trainer_.Train(word_counts, vocab, &merges);
+}
+
+models::FastWordPiece WordPieceTrainer::TrainModel(
+    const WordCounts& word_counts,
+    const std::string& unk_token,
+    size_t max_input_chars_per_word) const {
+  core::Vocab vocab;
+  Train(word_counts, &vocab);
+  if (vocab.count(unk_token) == 0) {
+    throw std::runtime_error("The unk_token " + unk_token +
+                             " is not in the special tokens of the trainer.");
+  }
+  return models::FastWordPiece(vocab,
+                               unk_token,
+                               max_input_chars_per_word,
+                               bpe_trainer_.GetContinuingSubwordPrefix());
+}
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,59 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fast_tokenizer/models/fast_wordpiece.h"
+#include "fast_tokenizer/trainers/bpe_trainer.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace trainers {
+
+// Learn the vocab of WordPiece. The subwords are merged in the same way as
+// BPETrainer, but the pair to merge is the one with the highest likelihood
+// score instead of the most frequent one, and the merges are dropped since
+// WordPiece only needs the vocab.
+class FASTTOKENIZER_DECL WordPieceTrainer {
+public:
+  WordPieceTrainer(
+      size_t vocab_size = 30000,
+      uint64_t min_frequency = 0,
+      const std::vector<std::string>& special_tokens = {"[PAD]",
+                                                        "[UNK]",
+                                                        "[CLS]",
+                                                        "[SEP]",
+                                                        "[MASK]"},
+      size_t limit_alphabet = 0,
+      const std::vector<std::string>& initial_alphabet = {},
+      const std::string& continuing_subword_prefix = "##");
+
+  void Train(const WordCounts& word_counts, core::Vocab* vocab) const;
+  // The unk_token should be one of the special tokens.
+  models::FastWordPiece TrainModel(const WordCounts& word_counts,
+                                   const std::string& unk_token = "[UNK]",
+                                   size_t max_input_chars_per_word = 100) const;
+
+  const BPETrainer& GetBPETrainer() const { return bpe_trainer_; }
+
+private:
+  BPETrainer bpe_trainer_;
+};
+
+}  // namespace trainers
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
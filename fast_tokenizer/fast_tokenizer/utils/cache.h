@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -32,11 +33,14 @@ template <typename K, typename V>
 struct Cache {
   std::unordered_map<K, V> map_;
   size_t capacity_;
-  Cache(size_t capacity = DEFAULT_CACHE_CAPACITY) : capacity_(capacity) {
+  Cache(size_t capacity = DEFAULT_CACHE_CAPACITY)
+      : capacity_(capacity), collect_stats_(false), hits_(0), misses_(0) {
     Fresh();
   }
 
-  Cache(const Cache& other) {
+  // The statistics are not copied
+  Cache(const Cache& other)
+      : collect_stats_(false), hits_(0), misses_(0) {
     RLock guard(cache_mutex_);
     map_ = other.map_;
     capacity_ = other.capacity_;
@@ -56,18 +60,33 @@ struct Cache {
   }
 
   bool GetValue(const K& key, V* value) {
+    bool found = false;
     // It's not guaranteed to get the value if the key is in cache
     // for non-blocking read.
     if (cache_mutex_.try_lock_shared()) {
-      if (map_.find(key) == map_.end()) {
-        cache_mutex_.unlock_shared();
-        return false;
+      auto it = map_.find(key);
+      if (it != map_.end()) {
+        *value = it->second;
+        found = true;
       }
-      *value = map_.at(key);
       cache_mutex_.unlock_shared();
-      return true;
     }
-    return false;
+    if (collect_stats_) {
+      (found ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
+  }
+
+  // Count the hits and misses of GetValue, the counters are reset when the
+  // statistics are enabled.
+  void EnableStats(bool enable) {
+    hits_ = 0;
+    misses_ = 0;
+    collect_stats_ = enable;
+  }
+  void GetStats(uint64_t* hits, uint64_t* misses) const {
+    *hits = hits_.load();
+    *misses = misses_.load();
   }
 
   bool SetValue(const K& key, const V& value) {
@@ -95,6 +114,9 @@ private:
     map_ = std::unordered_map<K, V>(capacity);
   }
   RWLock cache_mutex_;
+  bool collect_stats_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
 };
 
 }  // namespace utils
@@ -175,6 +175,19 @@ void FailureArray::CreateVocabFromFailureVocab(
   }
 }
 
+size_t FailureArray::GetMemoryUsage() const {
+  size_t usage = failure_array_.capacity() * sizeof(Failure) +
+                 failure_pops_pool_.capacity() * sizeof(int) +
+                 node_id_is_punc_map_.bucket_count() * sizeof(void*) +
+                 node_id_is_punc_map_.size() *
+                     (sizeof(std::pair<uint32_t, bool>) + 2 * sizeof(void*)) +
+                 failure_vocab_tokens_.capacity() * sizeof(FailureVocabToken);
+  for (const auto& token : failure_vocab_tokens_) {
+    usage += token.Token().capacity();
+  }
+  return usage;
+}
+
 void FailureArray::InitFromVocabAndTrie(
     const std::unordered_map<std::string, uint32_t>& vocab,
     Trie* trie,
@@ -75,6 +75,8 @@ struct FailureArray {
   void SetWithPretokenization(bool with_pretokenization) {
     with_pretokenization_ = with_pretokenization;
   }
+  // The bytes allocated by the failure array, excluding sizeof(FailureArray).
+  size_t GetMemoryUsage() const;
 
 private:
   void BuildOutgoingEdgeLabelsForTrie(
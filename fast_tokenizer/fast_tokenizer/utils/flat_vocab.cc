@@ -0,0 +1,267 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/utils/flat_vocab.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace utils {
+
+constexpr uint32_t FlatVocab::kEmptySlot;
+constexpr uint32_t FlatVocab::kInvalidEntry;
+
+static constexpr size_t kMinCapacity = 16;
+// The ids that are larger than the number of tokens multiplied by the factor
+// plus the slack are not stored in the dense vector.
+static constexpr size_t kDenseIdFactor = 2;
+static constexpr size_t kDenseIdSlack = 1024;
+
+static inline uint64_t MixHash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static inline uint64_t Load64(const char* data) {
+  uint64_t k;
+  std::memcpy(&k, data, 8);
+  return k;
+}
+
+static inline uint64_t Load32(const char* data) {
+  uint32_t k;
+  std::memcpy(&k, data, 4);
+  return k;
+}
+
+// The short tails are loaded by overlapping reads of fixed sizes, since
+// memcpy of a variable size is a function call.
+uint64_t FlatVocab::Hash(const char* data, size_t len) {
+  const uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+  uint64_t h = len * kMul;
+  if (len > 8) {
+    const char* end = data + len;
+    while (end - data > 8) {
+      h = (h ^ Load64(data)) * kMul;
+      h ^= h >> 29;
+      data += 8;
+    }
+    h = (h ^ Load64(end - 8)) * kMul;
+  } else if (len >= 4) {
+    h = (h ^ ((Load32(data) << 32) | Load32(data + len - 4))) * kMul;
+  } else if (len > 0) {
+    uint64_t k = (static_cast<uint64_t>(static_cast<uint8_t>(data[0])) << 16) |
+                 (static_cast<uint64_t>(static_cast<uint8_t>(data[len >> 1]))
+                  << 8) |
+                 static_cast<uint8_t>(data[len - 1]);
+    h = (h ^ k) * kMul;
+  }
+  return MixHash(h);
+}
+
+FlatVocab::FlatVocab() : mask_(0) {}
+
+FlatVocab::FlatVocab(const std::unordered_map<std::string, uint32_t>& vocab)
+    : mask_(0) {
+  // Insert the tokens in the order of ids, so that the arena is laid out
+  // like the vocab file and the lookups of nearby ids share cache lines.
+  std::vector<std::pair<uint32_t, const std::string*>> sorted_vocab;
+  sorted_vocab.reserve(vocab.size());
+  size_t total_len = 0;
+  for (const auto& item : vocab) {
+    sorted_vocab.emplace_back(item.second, &item.first);
+    total_len += item.first.length();
+  }
+  std::sort(sorted_vocab.begin(),
+            sorted_vocab.end(),
+            [](const std::pair<uint32_t, const std::string*>& a,
+               const std::pair<uint32_t, const std::string*>& b) {
+              return a.first < b.first ||
+                     (a.first == b.first && *a.second < *b.second);
+            });
+  Reserve(vocab.size());
+  arena_.reserve(total_len);
+  for (const auto& item : sorted_vocab) {
+    Insert(*item.second, item.first);
+  }
+}
+
+void FlatVocab::Reserve(size_t size) {
+  entries_.reserve(size);
+  size_t capacity = kMinCapacity;
+  // Keep the load factor under 1/2.
+  while (capacity < size * 2) {
+    capacity *= 2;
+  }
+  if (capacity > slots_.size()) {
+    Rehash(capacity);
+  }
+}
+
+void FlatVocab::Clear() {
+  arena_.clear();
+  entries_.clear();
+  slots_.clear();
+  mask_ = 0;
+  id_to_entry_.clear();
+  sparse_ids_.clear();
+}
+
+void FlatVocab::Rehash(size_t capacity) {
+  slots_.assign(capacity, Slot{kEmptySlot, 0, 0, 0});
+  mask_ = capacity - 1;
+  for (const auto& entry : entries_) {
+    InsertSlot(entry, Hash(arena_.data() + entry.offset_, entry.len_));
+  }
+}
+
+void FlatVocab::InsertSlot(const Entry& entry, uint64_t hash) {
+  size_t pos = hash & mask_;
+  while (slots_[pos].hash_ != kEmptySlot) {
+    pos = (pos + 1) & mask_;
+  }
+  slots_[pos] = {GetSlotHash(hash), entry.offset_, entry.len_, entry.id_};
+}
+
+const FlatVocab::Slot* FlatVocab::FindSlot(const char* token,
+                                           size_t len,
+                                           uint64_t hash) const {
+  if (slots_.empty()) {
+    return nullptr;
+  }
+  uint32_t slot_hash = GetSlotHash(hash);
+  size_t pos = hash & mask_;
+  while (slots_[pos].hash_ != kEmptySlot) {
+    const auto& slot = slots_[pos];
+    if (slot.hash_ == slot_hash && slot.len_ == len &&
+        std::memcmp(arena_.data() + slot.offset_, token, len) == 0) {
+      return &slot;
+    }
+    pos = (pos + 1) & mask_;
+  }
+  return nullptr;
+}
+
+void FlatVocab::SetIdEntry(uint32_t id, uint32_t entry_idx) {
+  if (id >= id_to_entry_.size()) {
+    if (id >= entries_.size() * kDenseIdFactor + kDenseIdSlack) {
+      sparse_ids_.insert({id, entry_idx});
+      return;
+    }
+    size_t new_size = std::max<size_t>(id + 1, id_to_entry_.size() * 2);
+    new_size = std::min<size_t>(
+        new_size, entries_.size() * kDenseIdFactor + kDenseIdSlack);
+    id_to_entry_.resize(new_size, kInvalidEntry);
+    // Move the sparse ids that fit into the dense vector now.
+    for (auto it = sparse_ids_.begin(); it != sparse_ids_.end();) {
+      if (it->first < id_to_entry_.size()) {
+        id_to_entry_[it->first] = it->second;
+        it = sparse_ids_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (id_to_entry_[id] == kInvalidEntry) {
+    id_to_entry_[id] = entry_idx;
+  }
+}
+
+bool FlatVocab::Insert(const char* token, size_t len, uint32_t id) {
+  uint64_t hash = Hash(token, len);
+  if (FindSlot(token, len, hash) != nullptr) {
+    return false;
+  }
+  if (arena_.size() + len > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("The total length of the vocab is too large.");
+  }
+  if ((entries_.size() + 1) * 2 > slots_.size()) {
+    Rehash(std::max(kMinCapacity, slots_.size() * 2));
+  }
+  uint32_t entry_idx = entries_.size();
+  entries_.push_back({static_cast<uint32_t>(arena_.size()),
+                      static_cast<uint32_t>(len),
+                      id});
+  arena_.append(token, len);
+  InsertSlot(entries_.back(), hash);
+  SetIdEntry(id, entry_idx);
+  return true;
+}
+
+bool FlatVocab::Find(const char* token, size_t len, uint32_t* id) const {
+  auto slot = FindSlot(token, len, Hash(token, len));
+  if (slot == nullptr) {
+    return false;
+  }
+  *id = slot->id_;
+  return true;
+}
+
+bool FlatVocab::FindToken(uint32_t id, const char** token, size_t* len) const {
+  uint32_t entry_idx = kInvalidEntry;
+  if (id < id_to_entry_.size()) {
+    entry_idx = id_to_entry_[id];
+  } else if (!sparse_ids_.empty()) {
+    auto it = sparse_ids_.find(id);
+    if (it != sparse_ids_.end()) {
+      entry_idx = it->second;
+    }
+  }
+  if (entry_idx == kInvalidEntry) {
+    return false;
+  }
+  const auto& entry = entries_[entry_idx];
+  *token = arena_.data() + entry.offset_;
+  *len = entry.len_;
+  return true;
+}
+
+bool FlatVocab::FindToken(uint32_t id, std::string* token) const {
+  const char* data;
+  size_t len;
+  if (!FindToken(id, &data, &len)) {
+    return false;
+  }
+  token->assign(data, len);
+  return true;
+}
+
+size_t FlatVocab::GetMemoryUsage() const {
+  return arena_.capacity() + entries_.capacity() * sizeof(Entry) +
+         slots_.capacity() * sizeof(Slot) +
+         id_to_entry_.capacity() * sizeof(uint32_t) +
+         sparse_ids_.size() * (sizeof(std::pair<uint32_t, uint32_t>) +
+                               2 * sizeof(void*));
+}
+
+std::unordered_map<std::string, uint32_t> FlatVocab::ToMap() const {
+  std::unordered_map<std::string, uint32_t> vocab;
+  vocab.reserve(entries_.size());
+  for (const auto& entry : entries_) {
+    vocab.emplace(std::string(arena_.data() + entry.offset_, entry.len_),
+                  entry.id_);
+  }
+  return vocab;
+}
+
+}  // namespace utils
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
@@ -0,0 +1,115 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace utils {
+
+// A vocabulary that maps tokens to ids and ids to tokens. The tokens are
+// stored in one contiguous arena, and are indexed by an open addressing hash
+// table whose slots keep a part of the hash, the position and the id of the
+// token, so that a lookup only touches one slot in most cases and compares
+// the bytes of the token once. The ids are indexed by a dense vector. The
+// tokens can be looked up by (pointer, length) without constructing a
+// std::string.
+class FASTTOKENIZER_DECL FlatVocab {
+public:
+  FlatVocab();
+  explicit FlatVocab(const std::unordered_map<std::string, uint32_t>& vocab);
+
+  void Reserve(size_t size);
+  void Clear();
+  // Insert the token if it's absent, return false if it exists already. A
+  // token is returned by FindToken only if it's the first one of its id.
+  bool Insert(const char* token, size_t len, uint32_t id);
+  bool Insert(const std::string& token, uint32_t id) {
+    return Insert(token.data(), token.length(), id);
+  }
+
+  bool Find(const char* token, size_t len, uint32_t* id) const;
+  bool Find(const std::string& token, uint32_t* id) const {
+    return Find(token.data(), token.length(), id);
+  }
+  bool Contains(const std::string& token) const {
+    uint32_t id;
+    return Find(token.data(), token.length(), &id);
+  }
+  // The token is valid until the vocab is modified.
+  bool FindToken(uint32_t id, const char** token, size_t* len) const;
+  bool FindToken(uint32_t id, std::string* token) const;
+
+  size_t Size() const { return entries_.size(); }
+  bool Empty() const { return entries_.empty(); }
+  // The bytes allocated by the vocab, excluding sizeof(FlatVocab).
+  size_t GetMemoryUsage() const;
+  std::unordered_map<std::string, uint32_t> ToMap() const;
+  // Call func(token, len, id) for every token in the order of insertion.
+  template <typename Func>
+  void ForEach(Func func) const {
+    for (const auto& entry : entries_) {
+      func(arena_.data() + entry.offset_, entry.len_, entry.id_);
+    }
+  }
+
+  static uint64_t Hash(const char* data, size_t len);
+
+private:
+  // The position of a token in the arena
+  struct Entry {
+    uint32_t offset_;
+    uint32_t len_;
+    uint32_t id_;
+  };
+  struct Slot {
+    // The high bits of the hash, kEmptySlot means the slot is empty.
+    uint32_t hash_;
+    uint32_t offset_;
+    uint32_t len_;
+    uint32_t id_;
+  };
+  static constexpr uint32_t kEmptySlot = 0;
+  static constexpr uint32_t kInvalidEntry = 0xffffffff;
+
+  static uint32_t GetSlotHash(uint64_t hash) {
+    // Never equal to kEmptySlot
+    return static_cast<uint32_t>(hash >> 32) | 1;
+  }
+  void Rehash(size_t capacity);
+  void InsertSlot(const Entry& entry, uint64_t hash);
+  const Slot* FindSlot(const char* token, size_t len, uint64_t hash) const;
+  void SetIdEntry(uint32_t id, uint32_t entry_idx);
+
+  std::string arena_;
+  // In the order of insertion
+  std::vector<Entry> entries_;
+  std::vector<Slot> slots_;
+  size_t mask_;
+  // Map the id to the index of entry. The ids are expected to be dense, the
+  // ones that are too large to be in the vector are kept in sparse_ids_.
+  std::vector<uint32_t> id_to_entry_;
+  std::unordered_map<uint32_t, uint32_t> sparse_ids_;
+};
+
+}  // namespace utils
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
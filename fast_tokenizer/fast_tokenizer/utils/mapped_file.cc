@@ -0,0 +1,124 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "fast_tokenizer/utils/mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace utils {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+    : data_(nullptr),
+      size_(0),
+      is_valid_(false),
+      file_handle_(INVALID_HANDLE_VALUE),
+      mapping_handle_(nullptr) {
+  HANDLE file = CreateFileA(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  file_handle_ = file;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    return;
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    // Empty files can't be mapped
+    is_valid_ = true;
+    return;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    return;
+  }
+  mapping_handle_ = mapping;
+  data_ = static_cast<const char*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  is_valid_ = (data_ != nullptr);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+    : data_(nullptr), size_(0), is_valid_(false) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+    close(fd);
+    return;
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ == 0) {
+    // Empty files can't be mapped
+    close(fd);
+    is_valid_ = true;
+    return;
+  }
+  void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping is still valid after the file is closed.
+  close(fd);
+  if (addr == MAP_FAILED) {
+    size_ = 0;
+    return;
+  }
+  // The file is read from the beginning to the end once.
+  madvise(addr, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(addr);
+  is_valid_ = true;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+#endif
+
+}  // namespace utils
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
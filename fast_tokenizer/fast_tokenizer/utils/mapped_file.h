@@ -0,0 +1,82 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include "fast_tokenizer/utils/utils.h"
+
+namespace paddlenlp {
+namespace fast_tokenizer {
+namespace utils {
+
+// A read-only memory mapping of a whole file. The content is only valid during
+// the lifetime of the object.
+class FASTTOKENIZER_DECL MappedFile {
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Return false if the file doesn't exist or can't be mapped.
+  bool IsValid() const { return is_valid_; }
+  const char* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+private:
+  const char* data_;
+  size_t size_;
+  bool is_valid_;
+#ifdef _WIN32
+  void* file_handle_;
+  void* mapping_handle_;
+#endif
+};
+
+// Count the lines of the buffer, the last line may not end with '\n'.
+inline size_t CountLines(const char* data, size_t size) {
+  const char* end = data + size;
+  size_t lines = 0;
+  while (data < end) {
+    auto newline =
+        static_cast<const char*>(std::memchr(data, '\n', end - data));
+    ++lines;
+    if (newline == nullptr) {
+      break;
+    }
+    data = newline + 1;
+  }
+  return lines;
+}
+
+// Call func(line, line_len) for each line of the buffer without copying. The
+// '\n' is excluded from the line.
+template <typename Func>
+void ForEachLine(const char* data, size_t size, Func func) {
+  const char* end = data + size;
+  while (data < end) {
+    auto newline =
+        static_cast<const char*>(std::memchr(data, '\n', end - data));
+    const char* line_end = (newline == nullptr) ? end : newline;
+    func(data, static_cast<size_t>(line_end - data));
+    data = line_end + 1;
+  }
+}
+
+}  // namespace utils
+}  // namespace fast_tokenizer
+}  // namespace paddlenlp
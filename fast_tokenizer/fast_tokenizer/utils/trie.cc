@@ -207,6 +207,15 @@ bool Trie::TryGetData(const Trie::TraversalCursor& cursor,
   return true;
 }
 
+size_t Trie::GetMemoryUsage() const {
+  size_t usage = trie_array_.capacity() * sizeof(uint32_t) +
+                 continuing_subword_prefix_.capacity() + unk_token_.capacity();
+  if (trie_ != nullptr) {
+    usage += trie_->total_size();
+  }
+  return usage;
+}
+
 void Trie::DeleteValueOfNode(uint32_t node_id) {
   trie_array_[node_id] &= 0xFFFFFEFF;
 }
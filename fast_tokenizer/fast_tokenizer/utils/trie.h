@@ -72,6 +72,8 @@ public:
   }
   uint32_t GetSuffixRoot() const { return suffix_root_; }
   uint32_t GetPuncFailureNode() const { return punct_failure_link_node_; }
+  // The bytes allocated by the trie, excluding sizeof(Trie).
+  size_t GetMemoryUsage() const;
   void DeleteValueOfNode(uint32_t node_id);
   void DeleteLinkFromParent(uint32_t child_node_id);
 
@@ -14,42 +14,63 @@ limitations under the License. */
 
 #include "fast_tokenizer/utils/utils.h"
 
+#include "fast_tokenizer/utils/mapped_file.h"
 #include "unicode/uchar.h"
 
 namespace paddlenlp {
 namespace fast_tokenizer {
 namespace utils {
 
+static inline bool IsVocabWhiteSpace(char ch) {
+  return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\f' ||
+         ch == '\v';
+}
+
+void GetVocabFromBuffer(const char* data,
+                        size_t size,
+                        std::unordered_map<std::string, uint32_t>* vocab) {
+  vocab->clear();
+  vocab->reserve(CountLines(data, size));
+  uint32_t i = 0;
+  ForEachLine(data, size, [&](const char* line, size_t len) {
+    // Strip the whitespaces. A line that only contains whitespaces is kept
+    // as it is.
+    const char* begin = line;
+    const char* end = line + len;
+    while (begin < end && IsVocabWhiteSpace(*begin)) {
+      ++begin;
+    }
+    if (begin < end) {
+      while (IsVocabWhiteSpace(*(end - 1))) {
+        --end;
+      }
+    } else {
+      begin = line;
+      end = line + len;
+    }
+    if (begin == end) {
+      return;
+    }
+    auto result = vocab->emplace(std::string(begin, end - begin), i);
+    if (!result.second) {
+      // The last one of the duplicated tokens wins.
+      result.first->second = i;
+    }
+    ++i;
+  });
+}
+
 void GetVocabFromFiles(const std::string& files,
                        std::unordered_map<std::string, uint32_t>* vocab) {
-  const static std::string WHITESPACE = " \n\r\t\f\v";
-  std::ifstream fin(files);
-  if (!fin.good()) {
+  MappedFile file(files);
+  if (!file.IsValid()) {
     std::cerr << "The vocab file " << files
               << " seems to be unable to access"
                  " or non-exists, please check again. "
               << std::endl;
     return;
   }
-  vocab->clear();
-  int i = 0;
-  constexpr int MAX_BUFFER_SIZE = 256;
-  char word[MAX_BUFFER_SIZE];
-  while (fin.getline(word, MAX_BUFFER_SIZE)) {
-    std::string word_str = word;
-    auto leading_spaces = word_str.find_first_not_of(WHITESPACE);
-    if (leading_spaces != std::string::npos) {
-      leading_spaces = (std::min)(leading_spaces, word_str.length() - 1);
-      word_str = word_str.substr(leading_spaces);
-    }
-    auto trailing_spaces = word_str.find_last_not_of(WHITESPACE);
-    if (trailing_spaces != std::string::npos) {
-      word_str = word_str.substr(0, trailing_spaces + 1);
-    }
-    if (word_str != "") {
-      (*vocab)[word_str] = i++;
-    }
-  }
+  GetVocabFromBuffer(file.Data(), file.Size(), vocab);
 }
 
 bool IsChineseChar(int ch) {
@@ -49,8 +49,15 @@ namespace paddlenlp {
 namespace fast_tokenizer {
 namespace utils {
 
+// Read the vocab from a file that contains one token per line, the id of a
+// token is its line number, ignoring the empty lines. The file is mapped into
+// memory instead of being read line by line, so there is no limit on the
+// length of the tokens.
 void GetVocabFromFiles(const std::string& files,
                        std::unordered_map<std::string, uint32_t>* vocab);
+void GetVocabFromBuffer(const char* data,
+                        size_t size,
+                        std::unordered_map<std::string, uint32_t>* vocab);
 
 bool IsChineseChar(int ch);
 
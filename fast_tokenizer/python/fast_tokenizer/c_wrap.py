@@ -323,6 +323,12 @@ class Encoding:
     def char_to_token(self, char_pos, sequence_index: int = 0):
         return self._encoding.char_to_token(char_pos, sequence_index)
 
+    def char_to_token_batch(self, char_positions: List[int], sequence_index: int = 0):
+        return self._encoding.char_to_token_batch(char_positions, sequence_index)
+
+    def char_to_word_batch(self, char_positions: List[int], sequence_index: int = 0):
+        return self._encoding.char_to_word_batch(char_positions, sequence_index)
+
     @staticmethod
     def merge(encodings: List, growing_offsets: bool = True):
         return C.Encoding.merge(encodings, growing_offsets)
@@ -342,6 +348,12 @@ class Encoding:
     def word_to_tokens(self, word_index: int, sequence_index: int = 0):
         return self._encoding.word_to_tokens(word_index, sequence_index)
 
+    def word_to_chars_batch(self, word_indices: List[int], sequence_index: int = 0):
+        return self._encoding.word_to_chars_batch(word_indices, sequence_index)
+
+    def word_to_tokens_batch(self, word_indices: List[int], sequence_index: int = 0):
+        return self._encoding.word_to_tokens_batch(word_indices, sequence_index)
+
     def truncate(self, max_length: int, stride: int = 0, direction: str = "right"):
         return self._encoding.truncate(max_length, stride, direction)
 
@@ -433,6 +445,15 @@ class Tokenizer:
     def disable_truncation(self):
         return self._tokenizer.disable_truncation()
 
+    def enable_stats(self, enable: bool = True):
+        return self._tokenizer.enable_stats(enable)
+
+    def reset_stats(self):
+        return self._tokenizer.reset_stats()
+
+    def get_stats(self):
+        return self._tokenizer.get_stats()
+
     def get_vocab(self, with_added_vocabulary: bool = True):
         return self._tokenizer.get_vocab(with_added_vocabulary)
 
@@ -453,8 +474,9 @@ class Tokenizer:
         input: Union[List[EncodeInput], Tuple[EncodeInput]],
         add_special_tokens: bool = True,
         is_pretokenized: bool = False,
+        output_fields: List[str] = None,
     ):
-        return self._tokenizer.encode_batch(input, add_special_tokens, is_pretokenized)
+        return self._tokenizer.encode_batch(input, add_special_tokens, is_pretokenized, output_fields)
 
     def decode(self, ids: List[int], skip_special_tokens: bool = True):
         return self._tokenizer.decode(ids, skip_special_tokens)
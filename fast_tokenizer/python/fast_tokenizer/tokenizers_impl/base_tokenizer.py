@@ -71,6 +71,15 @@ class BaseFastTokenizer:
     def truncation(self):
         return self._tokenizer.truncation
 
+    def enable_stats(self, enable=True):
+        self._tokenizer.enable_stats(enable)
+
+    def reset_stats(self):
+        self._tokenizer.reset_stats()
+
+    def get_stats(self):
+        return self._tokenizer.get_stats()
+
     def add_tokens(self, tokens):
         return self._tokenizer.add_tokens(tokens)
 
@@ -88,10 +97,10 @@ class BaseFastTokenizer:
             raise ValueError("encode: `sequence` can't be `None`")
         return self._tokenizer.encode(sequence, pair, is_pretokenized, add_special_tokens)
 
-    def encode_batch(self, inputs, add_special_tokens=True, is_pretokenized=False):
+    def encode_batch(self, inputs, add_special_tokens=True, is_pretokenized=False, output_fields=None):
         if inputs is None:
             raise ValueError("encode_batch: `inputs` can't be `None`")
-        return self._tokenizer.encode_batch(inputs, add_special_tokens, is_pretokenized)
+        return self._tokenizer.encode_batch(inputs, add_special_tokens, is_pretokenized, output_fields)
 
     def decode(self, ids, skip_special_tokens=True) -> str:
         if ids is None:
@@ -0,0 +1,114 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Benchmark helpers.build_blending_indices with the number of datasets, the
+size and the number of threads, and check it against the greedy scan.
+
+    make -C data_tools
+    python data_tools/benchmark_blending.py --num_datasets 2 64 512 2048
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.abspath(os.path.dirname(__file__)))
+import helpers  # noqa: E402
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--num_datasets", type=int, nargs="+", default=[2, 16, 128, 512, 2048])
+    parser.add_argument("--sizes", type=int, nargs="+", default=[10**6, 10**7])
+    parser.add_argument("--num_threads", type=int, nargs="+", default=[1, 8])
+    parser.add_argument("--weights", choices=["random", "equal"], default="random")
+    parser.add_argument("--check_size", type=int, default=20000, help="Samples checked against the greedy scan.")
+    parser.add_argument("--seed", type=int, default=1234)
+    return parser.parse_args()
+
+
+def get_weights(num_datasets, kind, rng):
+    if kind == "equal":
+        weights = np.ones(num_datasets, dtype=np.float64)
+    else:
+        weights = np.exp(rng.uniform(0.0, 5.0, num_datasets))
+    return weights / np.sum(weights)
+
+
+def get_index_dtype(num_datasets):
+    for dtype in [np.uint8, np.uint16, np.int32]:
+        if num_datasets - 1 <= np.iinfo(dtype).max:
+            return dtype
+
+
+def build(weights, size, num_threads):
+    dataset_index = np.zeros(size, dtype=get_index_dtype(len(weights)))
+    dataset_sample_index = np.zeros(size, dtype=np.int64)
+    start = time.time()
+    helpers.build_blending_indices(
+        dataset_index, dataset_sample_index, weights, len(weights), size, False, num_threads
+    )
+    return dataset_index, dataset_sample_index, time.time() - start
+
+
+def build_by_scan(weights, size):
+    """The greedy scan: every sample goes to the first dataset of the max error."""
+    counts = np.zeros(len(weights), dtype=np.int64)
+    dataset_index = np.zeros(size, dtype=np.int64)
+    dataset_sample_index = np.zeros(size, dtype=np.int64)
+    for sample_idx in range(size):
+        errors = weights * max(float(sample_idx), 1.0) - counts
+        dataset = np.argmax(errors)
+        dataset_index[sample_idx] = dataset
+        dataset_sample_index[sample_idx] = counts[dataset]
+        counts[dataset] += 1
+    return dataset_index, dataset_sample_index
+
+
+def main():
+    args = parse_args()
+    rng = np.random.RandomState(args.seed)
+    print("%12s %12s %8s %10s %14s" % ("datasets", "size", "threads", "seconds", "ns/sample"))
+    for num_datasets in args.num_datasets:
+        weights = get_weights(num_datasets, args.weights, rng)
+
+        dataset_index, dataset_sample_index, _ = build(weights, args.check_size, 1)
+        expected_index, expected_sample_index = build_by_scan(weights, args.check_size)
+        if not (
+            np.array_equal(dataset_index, expected_index)
+            and np.array_equal(dataset_sample_index, expected_sample_index)
+        ):
+            raise RuntimeError("The indices of %d datasets differ from the greedy scan" % num_datasets)
+
+        for size in args.sizes:
+            results = []
+            for num_threads in args.num_threads:
+                dataset_index, dataset_sample_index, seconds = build(weights, size, num_threads)
+                results.append((dataset_index, dataset_sample_index))
+                print(
+                    "%12d %12d %8d %10.3f %14.1f"
+                    % (num_datasets, size, num_threads, seconds, seconds * 1e9 / size)
+                )
+            for dataset_index, dataset_sample_index in results[1:]:
+                if not (
+                    np.array_equal(dataset_index, results[0][0])
+                    and np.array_equal(dataset_sample_index, results[0][1])
+                ):
+                    raise RuntimeError("The indices depend on the number of threads")
+
+
+if __name__ == "__main__":
+    main()
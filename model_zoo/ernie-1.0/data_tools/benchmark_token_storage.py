@@ -0,0 +1,88 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Benchmark helpers.MMapIndexedDataset.get_samples on the _ids.npy file and
+on its token blocks, and check that both give the same samples.
+
+    make -C data_tools
+    python data_tools/compress_ids.py --input_prefix ./data/wudao_200g_sample
+    python data_tools/benchmark_token_storage.py --input_prefix ./data/wudao_200g_sample
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.abspath(os.path.dirname(__file__)))
+import helpers  # noqa: E402
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--input_prefix", type=str, required=True, help="The prefix of the _ids and _idx files.")
+    parser.add_argument("--seq_length", type=int, default=512)
+    parser.add_argument("--batch_size", type=int, default=64)
+    parser.add_argument("--num_batches", type=int, default=200)
+    parser.add_argument("--seed", type=int, default=1234)
+    return parser.parse_args()
+
+
+def read_batches(dataset, sample_idx, doc_idx, batches, seq_length):
+    out = np.zeros((len(batches[0]), seq_length + 1), dtype=np.int64)
+    outputs = []
+    start = time.time()
+    for indices in batches:
+        dataset.get_samples(sample_idx, doc_idx, indices, out)
+        outputs.append(out.copy())
+    return outputs, time.time() - start
+
+
+def main():
+    args = parse_args()
+    sizes = np.load(args.input_prefix + "_idx.npz")["lens"].astype(np.int32)
+    doc_idx = np.arange(len(sizes), dtype=np.int32)
+    sample_idx = helpers.build_sample_idx(sizes, doc_idx, args.seq_length, 1, int(np.sum(sizes, dtype=np.int64)))
+    num_samples = sample_idx.shape[0] - 1
+    rng = np.random.RandomState(args.seed)
+    batches = [rng.randint(0, num_samples, args.batch_size).astype(np.int64) for _ in range(args.num_batches)]
+    num_tokens = args.num_batches * args.batch_size * (args.seq_length + 1)
+
+    print("%8s %14s %14s %14s" % ("file", "bytes/token", "Mtokens/s", "ratio"))
+    results = []
+    for suffix in ["_ids.npy", "_ids.blk"]:
+        path = args.input_prefix + suffix
+        dataset = helpers.MMapIndexedDataset(path, sizes)
+        # The first pass pages the file in, the second one is timed.
+        read_batches(dataset, sample_idx, doc_idx, batches, args.seq_length)
+        outputs, seconds = read_batches(dataset, sample_idx, doc_idx, batches, args.seq_length)
+        file_bytes = os.path.getsize(path)
+        results.append((outputs, file_bytes))
+        print(
+            "%8s %14.3f %14.1f %14.2f"
+            % (
+                suffix,
+                file_bytes / max(dataset.num_tokens, 1),
+                num_tokens / seconds / 1e6,
+                results[0][1] / file_bytes,
+            )
+        )
+    for expected, output in zip(results[0][0], results[1][0]):
+        if not np.array_equal(expected, output):
+            raise RuntimeError("The samples of the token blocks differ from the _ids.npy file")
+
+
+if __name__ == "__main__":
+    main()
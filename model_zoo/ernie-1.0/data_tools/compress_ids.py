@@ -0,0 +1,53 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Compress the token ids of a preprocessed dataset into token blocks, i.e.
+write <input_prefix>_ids.blk from <input_prefix>_ids.npy.
+
+    make -C data_tools
+    python data_tools/compress_ids.py --input_prefix ./data/wudao_200g_sample
+"""
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.abspath(os.path.dirname(__file__)))
+import helpers  # noqa: E402
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--input_prefix", type=str, required=True, help="The prefix of the _ids.npy file.")
+    parser.add_argument("--block_size", type=int, default=1024, help="The number of tokens of a block.")
+    parser.add_argument("--num_threads", type=int, default=os.cpu_count())
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    ids_path = args.input_prefix + "_ids.npy"
+    out_path = args.input_prefix + "_ids.blk"
+    start = time.time()
+    helpers.compress_ids(ids_path, out_path, args.block_size, args.num_threads)
+    ids_bytes = os.path.getsize(ids_path)
+    out_bytes = os.path.getsize(out_path)
+    print(
+        "Wrote %s in %.1fs, %d bytes -> %d bytes (%.2fx)"
+        % (out_path, time.time() - start, ids_bytes, out_bytes, ids_bytes / max(out_bytes, 1))
+    )
+
+
+if __name__ == "__main__":
+    main()
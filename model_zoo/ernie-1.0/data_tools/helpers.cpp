@@ -18,66 +18,369 @@
 
 /* Helper methods for fast index mapping builds */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace py = pybind11;
 using namespace std;
 
 const int32_t LONG_SENTENCE_LEN = 512;
 
-void build_blending_indices(py::array_t<uint8_t>& dataset_index,
+template <typename Func>
+void parallel_for(const int64_t num_tasks,
+                  const int32_t num_threads,
+                  Func func) {
+  /* Run func(task) for every task in [0, num_tasks) on num_threads threads.
+     The first exception thrown by a task is rethrown. */
+  std::atomic<int64_t> next_task(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    try {
+      for (int64_t task = next_task++; task < num_tasks; task = next_task++) {
+        func(task);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next_task = num_tasks;
+    }
+  };
+  const auto num_workers =
+      std::max<int64_t>(1, std::min<int64_t>(num_threads, num_tasks));
+  std::vector<std::thread> threads;
+  for (int64_t i = 1; i < num_workers; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// The sample indices of the blending are written by chunks in parallel.
+const int64_t MIN_SAMPLES_PER_CHUNK = 1 << 20;
+const int64_t MAX_NUM_CHUNKS = 256;
+
+// The band of errors below the max error of the hot datasets.
+const double INITIAL_ERROR_GAP = 0.25;
+const double MIN_ERROR_GAP = 1.0 / 64;
+const double MAX_ERROR_GAP = 4.0;
+// The min number of samples between two scans that raise the threshold.
+const int64_t MIN_REBUILD_STEPS = 1024;
+// Fewer datasets are simply scanned.
+const size_t MIN_QUEUE_DATASETS = 128;
+
+class MaxErrorQueue {
+  /* Finds the dataset with the max sampling error, weights[i] * x -
+     counts[i], for increasing x, with the same result as a scan over the
+     datasets, the ties going to the first dataset.
+
+     The errors of the datasets stay within a band below the max error, so
+     only the datasets whose errors are above a threshold (hot) are checked,
+     the others (cold) wait in a heap for the x at which their errors reach
+     the threshold. The hot datasets of the same weight are ordered by their
+     counts, so only the first of every weight is checked. If the max error
+     of the hot datasets isn't above the threshold, the datasets are scanned
+     and the threshold is lowered. The threshold is raised from time to time
+     to keep the hot datasets few. */
+ public:
+  MaxErrorQueue(const std::vector<double>& weights, const int64_t max_x)
+      : weights_(weights),
+        counts_(weights.size(), 0),
+        groups_(weights.size()),
+        gap_(INITIAL_ERROR_GAP),
+        steps_(0) {
+    // A bound of the rounding error of an error.
+    error_bound_ = ldexp(static_cast<double>(max_x) + 2.0, -50);
+    std::vector<double> distinct(weights);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                   distinct.end());
+    for (size_t i = 0; i < weights.size(); ++i) {
+      groups_[i] = std::lower_bound(distinct.begin(), distinct.end(),
+                                    weights[i]) -
+                   distinct.begin();
+    }
+    hot_.resize(distinct.size());
+    group_pos_.assign(distinct.size(), -1);
+  }
+
+  int64_t get_max(const double x) {
+    /* The dataset with the max error at x, whose count is then increased. */
+    if (weights_.size() < MIN_QUEUE_DATASETS) {
+      return scan(x);
+    }
+    ++steps_;
+    if (threshold_pending_) {
+      return rebuild(x);
+    }
+    while (!cold_.empty() && cold_.front().first <= x + 1.0) {
+      std::pop_heap(cold_.begin(), cold_.end(), std::greater<Cold>());
+      push_hot(cold_.back().second);
+      cold_.pop_back();
+    }
+    int64_t max_error_index = -1;
+    double max_error = 0.0;
+    for (const auto group : active_) {
+      const auto dataset = hot_[group].front().second;
+      const double error = get_error(dataset, x);
+      if (max_error_index < 0 || error > max_error ||
+          (error == max_error && dataset < max_error_index)) {
+        max_error = error;
+        max_error_index = dataset;
+      }
+    }
+    // The cold datasets are below the threshold.
+    if (max_error_index < 0 || max_error <= threshold_ + error_bound_) {
+      gap_ = std::min(2.0 * gap_, MAX_ERROR_GAP);
+      return rebuild(x);
+    }
+    if (steps_ >= std::max<int64_t>(weights_.size(), MIN_REBUILD_STEPS)) {
+      // Try a higher threshold from the next sample.
+      gap_ = std::max(gap_ / 1.5, MIN_ERROR_GAP);
+      threshold_pending_ = true;
+    }
+    pop_hot(max_error_index);
+    add_sample(max_error_index, x);
+    return max_error_index;
+  }
+
+  const std::vector<int64_t>& get_counts() const { return counts_; }
+
+ private:
+  // The hot datasets of a weight, as [count, dataset].
+  typedef std::pair<int64_t, int32_t> Hot;
+  // The cold datasets, as [x at which the error reaches the threshold,
+  // dataset].
+  typedef std::pair<double, int32_t> Cold;
+
+  double get_error(const int64_t dataset, const double x) const {
+    return weights_[dataset] * x - static_cast<double>(counts_[dataset]);
+  }
+
+  int64_t scan(const double x, double* max_error_ = nullptr) {
+    /* Pick the dataset with the max error like the scan. */
+    int64_t max_error_index = 0;
+    double max_error = get_error(0, x);
+    for (size_t dataset = 1; dataset < weights_.size(); ++dataset) {
+      const double error = get_error(dataset, x);
+      if (error > max_error) {
+        max_error = error;
+        max_error_index = dataset;
+      }
+    }
+    if (max_error_ != nullptr) {
+      *max_error_ = max_error;
+    }
+    ++counts_[max_error_index];
+    return max_error_index;
+  }
+
+  int64_t rebuild(const double x) {
+    /* Scan the datasets, then split them by a threshold below the max
+       error. */
+    double max_error;
+    const auto max_error_index = scan(x, &max_error);
+    threshold_ = max_error - gap_;
+    threshold_pending_ = false;
+    steps_ = 0;
+    for (auto group : active_) {
+      hot_[group].clear();
+      group_pos_[group] = -1;
+    }
+    active_.clear();
+    cold_.clear();
+    for (size_t dataset = 0; dataset < weights_.size(); ++dataset) {
+      const double hot_x = get_hot_x(dataset, x);
+      if (hot_x <= x + 1.0) {
+        const auto group = groups_[dataset];
+        if (hot_[group].empty()) {
+          group_pos_[group] = active_.size();
+          active_.push_back(group);
+        }
+        hot_[group].push_back(
+            std::make_pair(counts_[dataset], static_cast<int32_t>(dataset)));
+      } else if (hot_x < INFINITY) {
+        cold_.push_back(std::make_pair(hot_x, static_cast<int32_t>(dataset)));
+      }
+    }
+    for (auto group : active_) {
+      std::make_heap(
+          hot_[group].begin(), hot_[group].end(), std::greater<Hot>());
+    }
+    std::make_heap(cold_.begin(), cold_.end(), std::greater<Cold>());
+    return max_error_index;
+  }
+
+  double get_hot_x(const int64_t dataset, const double x) const {
+    /* The x at which the error of the dataset reaches the threshold. */
+    const double weight = weights_[dataset];
+    if (weight > 0.0) {
+      return (static_cast<double>(counts_[dataset]) + threshold_) / weight;
+    }
+    // The error never changes.
+    return get_error(dataset, x) >= threshold_ ? -INFINITY : INFINITY;
+  }
+
+  void add_sample(const int64_t dataset, const double x) {
+    ++counts_[dataset];
+    add_dataset(dataset, x);
+  }
+
+  void add_dataset(const int64_t dataset, const double x) {
+    /* Add the dataset to the hot or the cold ones. */
+    const double hot_x = get_hot_x(dataset, x);
+    if (hot_x <= x + 1.0) {
+      push_hot(dataset);
+    } else if (hot_x < INFINITY) {
+      cold_.push_back(std::make_pair(hot_x, static_cast<int32_t>(dataset)));
+      std::push_heap(cold_.begin(), cold_.end(), std::greater<Cold>());
+    }
+  }
+
+  void push_hot(const int64_t dataset) {
+    const auto group = groups_[dataset];
+    auto& hot = hot_[group];
+    if (hot.empty()) {
+      group_pos_[group] = active_.size();
+      active_.push_back(group);
+    }
+    hot.push_back(std::make_pair(counts_[dataset],
+                                 static_cast<int32_t>(dataset)));
+    std::push_heap(hot.begin(), hot.end(), std::greater<Hot>());
+  }
+
+  void pop_hot(const int64_t dataset) {
+    /* Remove the dataset, which is the first of its weight. */
+    const auto group = groups_[dataset];
+    auto& hot = hot_[group];
+    std::pop_heap(hot.begin(), hot.end(), std::greater<Hot>());
+    hot.pop_back();
+    if (hot.empty()) {
+      const auto last = active_.back();
+      active_[group_pos_[group]] = last;
+      group_pos_[last] = group_pos_[group];
+      active_.pop_back();
+      group_pos_[group] = -1;
+    }
+  }
+
+  const std::vector<double>& weights_;
+  std::vector<int64_t> counts_;
+  // The index of the weight of every dataset.
+  std::vector<int32_t> groups_;
+  // The heaps of the hot datasets of every weight.
+  std::vector<std::vector<Hot>> hot_;
+  // The weights that have hot datasets and their positions in it.
+  std::vector<int32_t> active_;
+  std::vector<int64_t> group_pos_;
+  std::vector<Cold> cold_;
+  double threshold_ = 0.0;
+  bool threshold_pending_ = true;
+  double gap_;
+  int64_t steps_;
+  double error_bound_;
+};
+
+template <typename DatasetIdx>
+void build_blending_indices(py::array_t<DatasetIdx>& dataset_index,
                             py::array_t<int64_t>& dataset_sample_index,
                             const py::array_t<double>& weights,
                             const int32_t num_datasets,
                             const int64_t size,
-                            const bool verbose) {
+                            const bool verbose,
+                            const int32_t num_threads) {
   /* Given multiple datasets and a weighting array, build samples
-   such that it follows those wieghts.*/
+   such that it follows those wieghts. Every sample is taken from the
+   dataset whose number of samples is the furthest behind its weight.*/
+
+  const int64_t max_num_datasets =
+      static_cast<int64_t>(std::numeric_limits<DatasetIdx>::max()) + 1;
+  if (num_datasets <= 0 || num_datasets > max_num_datasets) {
+    throw std::invalid_argument(
+        "The number of datasets doesn't fit the type of dataset_index");
+  }
+  if (weights.shape(0) < num_datasets || dataset_index.shape(0) < size ||
+      dataset_sample_index.shape(0) < size) {
+    throw std::invalid_argument("The arrays are smaller than the size");
+  }
 
   if (verbose) {
     std::cout << "> building indices for blendable datasets ..." << std::endl;
   }
 
   // Get the pointer access without the checks.
-  auto dataset_index_ptr = dataset_index.mutable_unchecked<1>();
+  auto dataset_index_ptr = dataset_index.template mutable_unchecked<1>();
   auto dataset_sample_index_ptr = dataset_sample_index.mutable_unchecked<1>();
   auto weights_ptr = weights.unchecked<1>();
-
-  // Initialize buffer for number of samples used for each dataset.
-  int64_t current_samples[num_datasets];
+  std::vector<double> weights_vec(num_datasets);
   for (int64_t i = 0; i < num_datasets; ++i) {
-    current_samples[i] = 0;
+    weights_vec[i] = weights_ptr[i];
   }
 
-  // For each sample:
-  for (int64_t sample_idx = 0; sample_idx < size; ++sample_idx) {
-    // Determine where the max error in sampling is happening.
-    auto sample_idx_double = std::max(static_cast<double>(sample_idx), 1.0);
-    int64_t max_error_index = 0;
-    double max_error = weights_ptr[0] * sample_idx_double -
-                       static_cast<double>(current_samples[0]);
-    for (int64_t dataset_idx = 1; dataset_idx < num_datasets; ++dataset_idx) {
-      double error = weights_ptr[dataset_idx] * sample_idx_double -
-                     static_cast<double>(current_samples[dataset_idx]);
-      if (error > max_error) {
-        max_error = error;
-        max_error_index = dataset_idx;
+  const int64_t num_chunks = std::max<int64_t>(
+      1, std::min(size / MIN_SAMPLES_PER_CHUNK, MAX_NUM_CHUNKS));
+  const int64_t chunk_size = (size + num_chunks - 1) / num_chunks;
+  // The number of samples used for each dataset before every chunk.
+  std::vector<int64_t> chunk_samples(num_chunks * num_datasets);
+  std::vector<int64_t> current_samples;
+  {
+    py::gil_scoped_release release;
+    MaxErrorQueue queue(weights_vec, std::max<int64_t>(size, 1));
+    // Find the dataset of every sample.
+    for (int64_t sample_idx = 0; sample_idx < size; ++sample_idx) {
+      if (sample_idx % chunk_size == 0) {
+        std::copy(queue.get_counts().begin(),
+                  queue.get_counts().end(),
+                  chunk_samples.begin() +
+                      sample_idx / chunk_size * num_datasets);
       }
+      // Determine where the max error in sampling is happening.
+      auto sample_idx_double = std::max(static_cast<double>(sample_idx), 1.0);
+      dataset_index_ptr[sample_idx] =
+          static_cast<DatasetIdx>(queue.get_max(sample_idx_double));
     }
-
-    // Populate the indices.
-    dataset_index_ptr[sample_idx] = static_cast<uint8_t>(max_error_index);
-    dataset_sample_index_ptr[sample_idx] = current_samples[max_error_index];
-
-    // Update the total samples.
-    current_samples[max_error_index] += 1;
+    current_samples = queue.get_counts();
+
+    // Populate the sample indices.
+    parallel_for(num_chunks, num_threads, [&](const int64_t chunk) {
+      auto counts = chunk_samples.begin() + chunk * num_datasets;
+      const int64_t end = std::min(size, (chunk + 1) * chunk_size);
+      for (int64_t sample_idx = chunk * chunk_size; sample_idx < end;
+           ++sample_idx) {
+        dataset_sample_index_ptr[sample_idx] =
+            counts[dataset_index_ptr[sample_idx]]++;
+      }
+    });
   }
 
   // print info
@@ -94,11 +397,347 @@ void build_blending_indices(py::array_t<uint8_t>& dataset_index,
 }
 
 
-py::array build_sample_idx(const py::array_t<int32_t>& sizes_,
-                           const py::array_t<int32_t>& doc_idx_,
-                           const int32_t seq_length,
-                           const int32_t num_epochs,
-                           const int64_t tokens_per_epoch) {
+/* The index cache keeps the indices built by the helpers in versioned binary
+   files, so that later runs and the other ranks can map them read-only and
+   share the page cache instead of building private copies. A file is named
+   by a key that hashes the inputs and the arguments of the builder, and the
+   header keeps the arguments and the lengths of the inputs, which are compared
+   before a file is used:
+
+     header (IndexCacheHeader) | padding | data (C-contiguous)
+
+   The files are written into a temporary file first and renamed, so a file
+   is either complete or absent. */
+
+const char INDEX_CACHE_MAGIC[8] = {'P', 'N', 'L', 'P', 'I', 'D', 'X', '\0'};
+const uint32_t INDEX_CACHE_FORMAT_VERSION = 2;
+// Bump it whenever a builder changes its result for the same arguments.
+const uint32_t INDEX_ALGORITHM_VERSION = 1;
+const uint64_t INDEX_CACHE_DATA_ALIGNMENT = 4096;
+const uint32_t INDEX_CACHE_MAX_KEY_FIELDS = 16;
+
+enum IndexDType : uint32_t {
+  INDEX_INT32 = 0,
+  INDEX_UINT32 = 1,
+  INDEX_UINT64 = 2,
+};
+
+struct IndexCacheHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t algorithm_version;
+  uint64_t key;
+  uint32_t dtype;
+  uint32_t ndim;
+  int64_t shape[2];
+  uint64_t data_offset;
+  uint32_t num_key_fields;
+  uint32_t reserved;
+  uint64_t key_fields[INDEX_CACHE_MAX_KEY_FIELDS];
+};
+
+class IndexKey {
+  /* A 64 bits hash of the inputs of a builder, and the fields that are stored
+     in the header to check a cache hit: the scalar arguments and the lengths
+     of the arrays. */
+ public:
+  explicit IndexKey(const std::string& builder) : hash_(0x9e3779b97f4a7c15) {
+    add_bytes(builder.data(), builder.size());
+    add(INDEX_ALGORITHM_VERSION);
+  }
+
+  void add_bytes(const void* data, size_t len) {
+    const auto bytes = static_cast<const char*>(data);
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= len; pos += sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, bytes + pos, sizeof(uint64_t));
+      mix(word);
+    }
+    if (pos < len) {
+      uint64_t tail = 0;
+      memcpy(&tail, bytes + pos, len - pos);
+      mix(tail);
+    }
+    mix(len);
+  }
+
+  template <typename T>
+  void add(const T& value) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "The field is too large.");
+    add_bytes(&value, sizeof(T));
+    uint64_t field = 0;
+    memcpy(&field, &value, sizeof(T));
+    add_field(field);
+  }
+
+  template <typename T>
+  void add_array(const py::array_t<T>& array) {
+    // A slice isn't contiguous, so its elements are gathered before hashing.
+    const auto view = array.template unchecked<1>();
+    const int64_t size = view.shape(0);
+    if (size <= 1 || array.strides(0) == static_cast<int64_t>(sizeof(T))) {
+      add_bytes(array.data(), size * sizeof(T));
+    } else {
+      std::vector<T> elements(size);
+      for (int64_t i = 0; i < size; ++i) {
+        elements[i] = view(i);
+      }
+      add_bytes(elements.data(), size * sizeof(T));
+    }
+    add_field(static_cast<uint64_t>(size));
+  }
+
+  uint64_t get() const {
+    // Final avalanche of splitmix64
+    uint64_t hash = hash_;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    return hash ^ (hash >> 31);
+  }
+
+  const std::vector<uint64_t>& fields() const { return fields_; }
+
+ private:
+  void add_field(const uint64_t field) {
+    if (fields_.size() == INDEX_CACHE_MAX_KEY_FIELDS) {
+      throw std::logic_error("Too many fields in the index cache key.");
+    }
+    fields_.push_back(field);
+  }
+
+  void mix(uint64_t word) {
+    word *= 0x87c37b91114253d5;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937f;
+    hash_ ^= word;
+    hash_ = ((hash_ << 27) | (hash_ >> 37)) * 5 + 0x52dce729;
+  }
+
+  uint64_t hash_;
+  std::vector<uint64_t> fields_;
+};
+
+struct MappedIndex {
+  void* addr;
+  size_t len;
+};
+
+std::string get_index_cache_path(const std::string& cache_dir,
+                                 const std::string& builder,
+                                 const uint64_t key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+  return cache_dir + "/" + builder + "_" + name + ".idx";
+}
+
+template <typename T>
+py::array get_mapped_array(const int64_t* shape,
+                           const void* data,
+                           py::capsule& owner) {
+  const int64_t byte_size = sizeof(T);
+  return py::array(std::vector<int64_t>{shape[0], shape[1]},
+                   std::vector<int64_t>{shape[1] * byte_size, byte_size},
+                   static_cast<const T*>(data),
+                   owner);
+}
+
+bool load_index_cache(const std::string& path,
+                      const IndexKey& key,
+                      const uint32_t dtype,
+                      py::array* index) {
+  /* Map the cached index read-only, return false if there is no valid cache
+     of the key. */
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(IndexCacheHeader)) {
+    close(fd);
+    return false;
+  }
+  const size_t len = static_cast<size_t>(st.st_size);
+  void* addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  IndexCacheHeader header;
+  memcpy(&header, addr, sizeof(header));
+  const size_t item_size = (dtype == INDEX_UINT64) ? 8 : 4;
+  const bool valid =
+      memcmp(header.magic, INDEX_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.format_version == INDEX_CACHE_FORMAT_VERSION &&
+      header.algorithm_version == INDEX_ALGORITHM_VERSION &&
+      header.key == key.get() &&
+      header.num_key_fields == key.fields().size() &&
+      std::equal(key.fields().begin(),
+                 key.fields().end(),
+                 header.key_fields) &&
+      header.dtype == dtype && header.ndim == 2 &&
+      header.shape[0] >= 0 && header.shape[1] >= 0 &&
+      header.data_offset + static_cast<uint64_t>(header.shape[0]) *
+                               header.shape[1] * item_size ==
+          len;
+  if (!valid) {
+    munmap(addr, len);
+    return false;
+  }
+  madvise(addr, len, MADV_WILLNEED);
+
+  // Unmap the file when the array is released.
+  auto mapped = new MappedIndex{addr, len};
+  py::capsule owner(mapped, [](void* mem_) {
+    auto mem = reinterpret_cast<MappedIndex*>(mem_);
+    munmap(mem->addr, mem->len);
+    delete mem;
+  });
+  const void* data = static_cast<const char*>(addr) + header.data_offset;
+  if (dtype == INDEX_INT32) {
+    *index = get_mapped_array<int32_t>(header.shape, data, owner);
+  } else if (dtype == INDEX_UINT32) {
+    *index = get_mapped_array<uint32_t>(header.shape, data, owner);
+  } else {
+    *index = get_mapped_array<uint64_t>(header.shape, data, owner);
+  }
+  // The pages are shared with the other processes.
+  index->attr("setflags")(py::arg("write") = false);
+  return true;
+}
+
+void write_all(const int fd, const void* data, size_t len) {
+  auto bytes = static_cast<const char*>(data);
+  while (len > 0) {
+    const auto written = write(fd, bytes, len);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("Failed to write: ") +
+                               strerror(errno));
+    }
+    bytes += written;
+    len -= written;
+  }
+}
+
+void pwrite_all(const int fd, const void* data, size_t len, off_t offset) {
+  auto bytes = static_cast<const char*>(data);
+  while (len > 0) {
+    const auto written = pwrite(fd, bytes, len, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("Failed to write: ") +
+                               strerror(errno));
+    }
+    bytes += written;
+    len -= written;
+    offset += written;
+  }
+}
+
+std::string get_temp_path(const std::string& path) {
+  /* A temporary path next to path, unique among the ranks that may write the
+     same file. */
+  char suffix[64];
+  snprintf(suffix,
+           sizeof(suffix),
+           ".tmp.%ld.%llx",
+           static_cast<long>(getpid()),
+           static_cast<unsigned long long>(std::random_device()()));
+  return path + suffix;
+}
+
+void write_index_cache(const std::string& path,
+                       const IndexKey& key,
+                       const uint32_t dtype,
+                       const py::array& index) {
+  /* Write the index into a temporary file and rename it to path. */
+  IndexCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, INDEX_CACHE_MAGIC, sizeof(header.magic));
+  header.format_version = INDEX_CACHE_FORMAT_VERSION;
+  header.algorithm_version = INDEX_ALGORITHM_VERSION;
+  header.key = key.get();
+  header.num_key_fields = key.fields().size();
+  std::copy(key.fields().begin(), key.fields().end(), header.key_fields);
+  header.dtype = dtype;
+  header.ndim = 2;
+  header.shape[0] = index.shape(0);
+  header.shape[1] = index.shape(1);
+  header.data_offset = INDEX_CACHE_DATA_ALIGNMENT;
+  const size_t item_size = (dtype == INDEX_UINT64) ? 8 : 4;
+
+  const std::string tmp_path = get_temp_path(path);
+  const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create the index cache " + tmp_path +
+                             ": " + strerror(errno));
+  }
+  try {
+    std::vector<char> head(header.data_offset, 0);
+    memcpy(head.data(), &header, sizeof(header));
+    write_all(fd, head.data(), head.size());
+    write_all(fd, index.data(), index.size() * item_size);
+    if (fsync(fd) != 0) {
+      throw std::runtime_error(std::string("Failed to sync the index cache: ") +
+                               strerror(errno));
+    }
+  } catch (...) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    throw;
+  }
+  close(fd);
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    const auto error = errno;
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Failed to rename the index cache to " + path +
+                             ": " + strerror(error));
+  }
+}
+
+template <typename Build>
+py::array get_cached_index(const std::string& cache_dir,
+                           const std::string& builder,
+                           const IndexKey& key,
+                           const uint32_t dtype,
+                           const bool verbose,
+                           Build build) {
+  /* Return the cached index of the key, or build it, cache it and return the
+     mapped cache. */
+  const auto path = get_index_cache_path(cache_dir, builder, key.get());
+  py::array index;
+  if (load_index_cache(path, key, dtype, &index)) {
+    if (verbose) {
+      cout << "    loaded the cached index " << path << endl << std::flush;
+    }
+    return index;
+  }
+  {
+    const auto built = build();
+    write_index_cache(path, key, dtype, built);
+    if (verbose) {
+      cout << "    saved the index into " << path << endl << std::flush;
+    }
+  }
+  // Map the file, so that the private copy is released.
+  if (!load_index_cache(path, key, dtype, &index)) {
+    throw std::runtime_error("Failed to load the index cache " + path);
+  }
+  return index;
+}
+
+
+py::array build_sample_idx_impl(const py::array_t<int32_t>& sizes_,
+                                const py::array_t<int32_t>& doc_idx_,
+                                const int32_t seq_length,
+                                const int32_t num_epochs,
+                                const int64_t tokens_per_epoch) {
   /* Sample index (sample_idx) is used for gpt2 like dataset for which
      the documents are flattened and the samples are built based on this
      1-D flatten array. It is a 2D array with sizes [number-of-samples + 1, 2]
@@ -183,6 +822,31 @@ py::array build_sample_idx(const py::array_t<int32_t>& sizes_,
 }
 
 
+py::array build_sample_idx(const py::array_t<int32_t>& sizes_,
+                           const py::array_t<int32_t>& doc_idx_,
+                           const int32_t seq_length,
+                           const int32_t num_epochs,
+                           const int64_t tokens_per_epoch,
+                           const std::string& cache_dir,
+                           const bool verbose) {
+  /* The index is cached in cache_dir if it isn't empty. */
+  auto build = [&]() {
+    return build_sample_idx_impl(
+        sizes_, doc_idx_, seq_length, num_epochs, tokens_per_epoch);
+  };
+  if (cache_dir.empty()) {
+    return build();
+  }
+  IndexKey key("sample_idx");
+  key.add_array(sizes_);
+  key.add_array(doc_idx_);
+  key.add(seq_length);
+  key.add(num_epochs);
+  key.add(tokens_per_epoch);
+  return get_cached_index(
+      cache_dir, "sample_idx", key, INDEX_INT32, verbose, build);
+}
+
 inline int32_t get_target_sample_len(const int32_t short_seq_ratio,
                                      const int32_t max_length,
                                      std::mt19937& rand32_gen) {
@@ -436,81 +1100,475 @@ py::array build_mapping_impl(const py::array_t<int64_t>& docs_,
 }
 
 
-py::array build_mapping(const py::array_t<int64_t>& docs_,
-                        const py::array_t<int>& sizes_,
-                        const int num_epochs,
-                        const uint64_t max_num_samples,
-                        const int max_seq_length,
-                        const double short_seq_prob,
-                        const int seed,
-                        const bool verbose,
-                        const int32_t min_num_sent) {
-  if (sizes_.size() > std::numeric_limits<uint32_t>::max()) {
-    if (verbose) {
-      cout << "    using uint64 for data mapping..." << endl << std::flush;
+// The partitioned mapping splits the documents into partitions and the samples
+// into shuffle buckets whose numbers only depend on the number of documents,
+// so that its result doesn't depend on the number of threads.
+const int64_t MIN_DOCS_PER_PARTITION = 1024;
+const int64_t MAX_NUM_PARTITIONS = 256;
+const int64_t NUM_SHUFFLE_BUCKETS = 1024;
+
+// The random streams of the partitioned mapping.
+const int64_t TARGET_LEN_STREAM = 0;
+const int64_t BUCKET_STREAM = 1;
+const int64_t SHUFFLE_STREAM = 2;
+
+template <typename Generator>
+Generator get_stream_gen(const int32_t seed,
+                         const int64_t stream,
+                         const int64_t first_key,
+                         const int64_t second_key) {
+  /* A generator seeded by the seed and the keys of a stream, e.g. the epoch
+     and the partition, so that every task draws its own numbers. */
+  std::seed_seq seq{static_cast<uint32_t>(seed),
+                    static_cast<uint32_t>(stream),
+                    static_cast<uint32_t>(first_key),
+                    static_cast<uint32_t>(first_key >> 32),
+                    static_cast<uint32_t>(second_key),
+                    static_cast<uint32_t>(second_key >> 32)};
+  return Generator(seq);
+}
+
+struct MappingStats {
+  uint64_t empty_docs = 0;
+  uint64_t one_sent_docs = 0;
+  uint64_t long_sent_docs = 0;
+};
+
+/* A cached partitioned mapping saves its progress into a checkpoint next to
+   the cache every CHECKPOINT_INTERVAL seconds and once the samples are
+   counted, so that a build that is interrupted resumes from it:
+
+     <cache path>.ckpt: header (MappingCheckpointHeader) | done (uint8) |
+                        bucket counts | epoch counts | stats
+     <cache path>.fill: the samples filled into the buckets, not shuffled yet
+
+   The random streams of every (epoch, partition) pair are recreated from the
+   seed, so the progress is only which tasks are done. The partitions are
+   counted epoch by epoch and then filled, and redoing a task gives the same
+   counts or writes the same samples. The buckets are shuffled out of the
+   fill file, so the shuffle is done again as a whole. */
+
+const char MAPPING_CHECKPOINT_MAGIC[8] = {
+    'P', 'N', 'L', 'P', 'C', 'K', 'P', '\0'};
+const uint32_t MAPPING_CHECKPOINT_FORMAT_VERSION = 1;
+const double CHECKPOINT_INTERVAL = 60;
+const double PROGRESS_INTERVAL = 10;
+
+struct MappingCheckpointHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t algorithm_version;
+  uint32_t doc_idx_itemsize;
+  uint32_t counted;
+  int32_t epoch;
+  int32_t reserved;
+  int64_t num_partitions;
+  uint64_t map_index;
+};
+
+struct MappingState {
+  /* The progress of build_mapping_parallel_impl. The samples of the epochs
+     before epoch are counted into bucket_counts and map_index, done tells
+     the partitions of epoch that are counted too, whose numbers of samples
+     are in epoch_counts. Once every epoch is counted, epoch is the number of
+     mapped epochs and done tells the partitions that are filled. */
+  explicit MappingState(const int64_t num_partitions)
+      : epoch(0),
+        counted(false),
+        map_index(0),
+        done(num_partitions, 0),
+        bucket_counts(num_partitions * NUM_SHUFFLE_BUCKETS, 0),
+        epoch_counts(num_partitions, 0),
+        partition_stats(num_partitions) {}
+
+  int32_t epoch;
+  bool counted;
+  uint64_t map_index;
+  std::vector<uint8_t> done;
+  std::vector<uint64_t> bucket_counts;
+  std::vector<uint64_t> epoch_counts;
+  std::vector<MappingStats> partition_stats;
+};
+
+template <typename T>
+void read_values(const char** data, std::vector<T>* values) {
+  memcpy(values->data(), *data, values->size() * sizeof(T));
+  *data += values->size() * sizeof(T);
+}
+
+bool load_mapping_checkpoint(const std::string& path,
+                             const uint32_t doc_idx_itemsize,
+                             MappingState* state) {
+  /* Read the checkpoint into state, return false if there is no valid
+     checkpoint of the same algorithm and partitions. */
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  const int64_t num_partitions = state->done.size();
+  const size_t len =
+      sizeof(MappingCheckpointHeader) +
+      num_partitions * (sizeof(uint8_t) +
+                        NUM_SHUFFLE_BUCKETS * sizeof(uint64_t) +
+                        sizeof(uint64_t) + sizeof(MappingStats));
+  std::vector<char> buffer(len + 1);
+  size_t read_len = 0;
+  while (read_len < buffer.size()) {
+    const auto count =
+        read(fd, buffer.data() + read_len, buffer.size() - read_len);
+    if (count < 0 && errno == EINTR) {
+      continue;
     }
-    return build_mapping_impl<uint64_t>(docs_,
-                                        sizes_,
-                                        num_epochs,
-                                        max_num_samples,
-                                        max_seq_length,
-                                        short_seq_prob,
-                                        seed,
-                                        verbose,
-                                        min_num_sent);
-  } else {
-    if (verbose) {
-      cout << "    using uint32 for data mapping..." << endl << std::flush;
+    if (count <= 0) {
+      break;
+    }
+    read_len += count;
+  }
+  close(fd);
+  MappingCheckpointHeader header;
+  if (read_len != len) {
+    return false;
+  }
+  memcpy(&header, buffer.data(), sizeof(header));
+  if (memcmp(header.magic, MAPPING_CHECKPOINT_MAGIC, sizeof(header.magic)) !=
+          0 ||
+      header.format_version != MAPPING_CHECKPOINT_FORMAT_VERSION ||
+      header.algorithm_version != INDEX_ALGORITHM_VERSION ||
+      header.doc_idx_itemsize != doc_idx_itemsize ||
+      header.num_partitions != num_partitions || header.epoch < 0) {
+    return false;
+  }
+  state->epoch = header.epoch;
+  state->counted = header.counted != 0;
+  state->map_index = header.map_index;
+  const char* data = buffer.data() + sizeof(header);
+  read_values(&data, &state->done);
+  read_values(&data, &state->bucket_counts);
+  read_values(&data, &state->epoch_counts);
+  read_values(&data, &state->partition_stats);
+  return true;
+}
+
+void save_mapping_checkpoint(const std::string& path,
+                             const uint32_t doc_idx_itemsize,
+                             const MappingState& state) {
+  /* Write the checkpoint into a temporary file and rename it to path. */
+  MappingCheckpointHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAPPING_CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.format_version = MAPPING_CHECKPOINT_FORMAT_VERSION;
+  header.algorithm_version = INDEX_ALGORITHM_VERSION;
+  header.doc_idx_itemsize = doc_idx_itemsize;
+  header.counted = state.counted;
+  header.epoch = state.epoch;
+  header.num_partitions = state.done.size();
+  header.map_index = state.map_index;
+
+  const std::string tmp_path = get_temp_path(path);
+  const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create the checkpoint " + tmp_path +
+                             ": " + strerror(errno));
+  }
+  try {
+    write_all(fd, &header, sizeof(header));
+    write_all(fd, state.done.data(), state.done.size() * sizeof(uint8_t));
+    write_all(fd,
+              state.bucket_counts.data(),
+              state.bucket_counts.size() * sizeof(uint64_t));
+    write_all(fd,
+              state.epoch_counts.data(),
+              state.epoch_counts.size() * sizeof(uint64_t));
+    write_all(fd,
+              state.partition_stats.data(),
+              state.partition_stats.size() * sizeof(MappingStats));
+    if (fsync(fd) != 0) {
+      throw std::runtime_error(std::string("Failed to sync the checkpoint: ") +
+                               strerror(errno));
+    }
+  } catch (...) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    throw;
+  }
+  close(fd);
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    const auto error = errno;
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Failed to rename the checkpoint to " + path +
+                             ": " + strerror(error));
+  }
+}
+
+class MappedFile {
+  /* A file of len bytes mapped read-write and shared, it's created or
+     resized if it doesn't have len bytes, which keep_contents tells. */
+ public:
+  MappedFile(const std::string& path, const size_t len)
+      : addr_(NULL), len_(len), keep_contents_(false) {
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("Failed to open " + path + ": " +
+                               strerror(errno));
+    }
+    struct stat st;
+    keep_contents_ =
+        fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == len;
+    if (!keep_contents_ &&
+        (ftruncate(fd, 0) != 0 || ftruncate(fd, len) != 0)) {
+      const auto error = errno;
+      close(fd);
+      throw std::runtime_error("Failed to resize " + path + ": " +
+                               strerror(error));
+    }
+    addr_ = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+      throw std::runtime_error("Failed to map " + path + ": " +
+                               strerror(errno));
+    }
+  }
+
+  ~MappedFile() { munmap(addr_, len_); }
+
+  void* data() const { return addr_; }
+  bool keep_contents() const { return keep_contents_; }
+
+  void sync() const {
+    if (msync(addr_, len_, MS_SYNC) != 0) {
+      throw std::runtime_error(std::string("Failed to sync the mapping: ") +
+                               strerror(errno));
+    }
+  }
+
+ private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  void* addr_;
+  const size_t len_;
+  bool keep_contents_;
+};
+
+class BuildProgress {
+  /* Report the progress of the phases of a builder every PROGRESS_INTERVAL
+     seconds, as progress(phase, done, total, seconds) if progress isn't None
+     or else as a log line if verbose. seconds is the time since the build
+     began, and done includes the work resumed from a checkpoint. The workers
+     prepare a report with the state of the builder locked and send it once
+     the lock is released, so that a slow callback doesn't stall them. */
+ public:
+  struct Report {
+    std::string phase;
+    uint64_t done;
+    uint64_t total;
+    double seconds;
+    double rate;
+  };
+
+  BuildProgress(const py::object& progress, const bool verbose)
+      : progress_(progress),
+        verbose_(verbose),
+        start_(std::chrono::steady_clock::now()),
+        last_time_(0),
+        last_done_(0) {}
+
+  double get_seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+  bool prepare(const std::string& phase,
+               const uint64_t done,
+               const uint64_t total,
+               const bool force,
+               Report* report) {
+    /* Return whether a report is due, and fill it if so. The calls should be
+       serialized by the caller. */
+    const auto seconds = get_seconds();
+    if (phase != last_phase_) {
+      last_phase_ = phase;
+      last_time_ = seconds;
+      last_done_ = done;
+    } else if (!force && seconds - last_time_ < PROGRESS_INTERVAL) {
+      return false;
+    }
+    report->phase = phase;
+    report->done = done;
+    report->total = total;
+    report->seconds = seconds;
+    report->rate = (seconds > last_time_)
+                       ? (done - last_done_) / (seconds - last_time_)
+                       : 0.0;
+    last_time_ = seconds;
+    last_done_ = done;
+    return true;
+  }
+
+  void send(const Report& report) const {
+    if (!progress_.is_none()) {
+      py::gil_scoped_acquire acquire;
+      progress_(report.phase, report.done, report.total, report.seconds);
+    } else if (verbose_) {
+      cout << "    " << report.phase << ": " << report.done << " / "
+           << report.total << ", " << static_cast<uint64_t>(report.rate)
+           << " per second" << endl
+           << std::flush;
+    }
+  }
+
+  void report(const std::string& phase,
+              const uint64_t done,
+              const uint64_t total,
+              const bool force) {
+    Report report;
+    if (prepare(phase, done, total, force, &report)) {
+      send(report);
+    }
+  }
+
+ private:
+  const py::object& progress_;
+  const bool verbose_;
+  const std::chrono::steady_clock::time_point start_;
+  std::string last_phase_;
+  double last_time_;
+  uint64_t last_done_;
+};
+
+template <typename Docs, typename Sizes, typename Emit>
+void map_documents(const Docs& docs,
+                   const Sizes& sizes,
+                   const int64_t doc_first,
+                   const int64_t doc_last,
+                   const int32_t short_seq_ratio,
+                   const int32_t max_seq_length,
+                   const int32_t min_num_sent,
+                   std::mt19937& rand32_gen,
+                   MappingStats* stats,
+                   Emit emit) {
+  /* Split the documents [doc_first, doc_last) into samples like an epoch of
+     build_mapping_impl, calling emit(start-index, end-index, target length)
+     for every sample. stats is updated if it isn't NULL. */
+  for (auto doc = doc_first; doc < doc_last; ++doc) {
+    const auto sent_index_first = docs[doc];
+    const auto sent_index_last = docs[doc + 1];
+    auto prev_start_index = sent_index_first;
+    auto num_remain_sent = sent_index_last - sent_index_first;
+
+    if (stats != NULL) {
+      if (num_remain_sent == 0) {
+        ++stats->empty_docs;
+      }
+      if (num_remain_sent == 1) {
+        ++stats->one_sent_docs;
+      }
+    }
+
+    bool contains_long_sentence = false;
+    if (num_remain_sent > 1) {
+      for (auto sent_index = sent_index_first; sent_index < sent_index_last;
+           ++sent_index) {
+        if (sizes[sent_index] > LONG_SENTENCE_LEN) {
+          if (stats != NULL) {
+            ++stats->long_sent_docs;
+          }
+          contains_long_sentence = true;
+          break;
+        }
+      }
+    }
+    if ((num_remain_sent < min_num_sent) || contains_long_sentence) {
+      continue;
+    }
+    auto seq_len = int32_t{0};
+    auto num_sent = int32_t{0};
+    auto target_seq_len =
+        get_target_sample_len(short_seq_ratio, max_seq_length, rand32_gen);
+    for (auto sent_index = sent_index_first; sent_index < sent_index_last;
+         ++sent_index) {
+      seq_len += sizes[sent_index];
+      ++num_sent;
+      --num_remain_sent;
+      if (((seq_len >= target_seq_len) && (num_remain_sent > 1) &&
+           (num_sent >= min_num_sent)) ||
+          (num_remain_sent == 0)) {
+        emit(prev_start_index, sent_index + 1, target_seq_len);
+        prev_start_index = sent_index + 1;
+        target_seq_len =
+            get_target_sample_len(short_seq_ratio, max_seq_length, rand32_gen);
+        seq_len = 0;
+        num_sent = 0;
+      }
     }
-    return build_mapping_impl<uint32_t>(docs_,
-                                        sizes_,
-                                        num_epochs,
-                                        max_num_samples,
-                                        max_seq_length,
-                                        short_seq_prob,
-                                        seed,
-                                        verbose,
-                                        min_num_sent);
   }
 }
 
 template <typename DocIdx>
-py::array build_blocks_mapping_impl(const py::array_t<int64_t>& docs_,
-                                    const py::array_t<int32_t>& sizes_,
-                                    const py::array_t<int32_t>& titles_sizes_,
-                                    const int32_t num_epochs,
-                                    const uint64_t max_num_samples,
-                                    const int32_t max_seq_length,
-                                    const int32_t seed,
-                                    const bool verbose,
-                                    const bool use_one_sent_blocks) {
-  /* Build a mapping of (start-index, end-index, sequence-length) where
-     start and end index are the indices of the sentences in the sample
-     and sequence-length is the target sequence length.
+py::array build_mapping_parallel_impl(const py::array_t<int64_t>& docs_,
+                                      const py::array_t<int32_t>& sizes_,
+                                      const int32_t num_epochs,
+                                      const uint64_t max_num_samples,
+                                      const int32_t max_seq_length,
+                                      const double short_seq_prob,
+                                      const int32_t seed,
+                                      const bool verbose,
+                                      const int32_t min_num_sent,
+                                      const int32_t num_threads,
+                                      const std::string& checkpoint_prefix,
+                                      const py::object& progress) {
+  /* The partitioned version of build_mapping_impl. The documents are split
+     into partitions, every (epoch, partition) pair draws the target lengths
+     from its own random stream. The samples are counted in parallel, and
+     every sample is written into a random shuffle bucket at the position
+     given by the prefix sums of the counts. The buckets are then shuffled in
+     parallel, which makes the whole mapping a random permutation as well.
+
+     The result only depends on the arguments other than num_threads, a
+     single thread gives the reference result of any number of threads. It
+     differs from the one of build_mapping_impl since the random streams are
+     different.
+
+     If checkpoint_prefix isn't empty, the progress is saved into the
+     checkpoint files of the prefix and resumed from them, they are removed
+     once the mapping is built.
   */
 
   // Consistency checks.
   assert(num_epochs > 0);
   assert(max_seq_length > 1);
+  assert(short_seq_prob >= 0.0);
+  assert(short_seq_prob <= 1.0);
   assert(seed > 0);
+  assert(num_threads > 0);
 
   // Remove bound checks.
   auto docs = docs_.unchecked<1>();
   auto sizes = sizes_.unchecked<1>();
-  auto titles_sizes = titles_sizes_.unchecked<1>();
+
+  int32_t short_seq_ratio = 0;
+  if (short_seq_prob > 0) {
+    short_seq_ratio = static_cast<int32_t>(round(1.0 / short_seq_prob));
+  }
+
+  const int64_t num_docs = docs_.shape(0) - 1;
+  const int64_t num_partitions = std::max<int64_t>(
+      1,
+      std::min(MAX_NUM_PARTITIONS,
+               (num_docs + MIN_DOCS_PER_PARTITION - 1) /
+                   MIN_DOCS_PER_PARTITION));
+  auto get_partition_first = [num_docs, num_partitions](int64_t partition) {
+    return num_docs * partition / num_partitions;
+  };
+  auto get_partition_docs = [&](int64_t partition) {
+    return static_cast<uint64_t>(get_partition_first(partition + 1) -
+                                 get_partition_first(partition));
+  };
 
   if (verbose) {
-    const auto sent_start_index = docs[0];
-    const auto sent_end_index = docs[docs_.shape(0) - 1];
-    const auto num_sentences = sent_end_index - sent_start_index;
     cout << "    using:" << endl << std::flush;
-    cout << "     number of documents:            " << docs_.shape(0) - 1
-         << endl
-         << std::flush;
-    cout << "     sentences range:                [" << sent_start_index << ", "
-         << sent_end_index << ")" << endl
-         << std::flush;
-    cout << "     total number of sentences:      " << num_sentences << endl
+    cout << "     number of documents:            " << num_docs << endl
          << std::flush;
     cout << "     number of epochs:               " << num_epochs << endl
          << std::flush;
@@ -518,14 +1576,534 @@ py::array build_blocks_mapping_impl(const py::array_t<int64_t>& docs_,
          << std::flush;
     cout << "     maximum sequence length:        " << max_seq_length << endl
          << std::flush;
+    cout << "     minimum sentences num:          " << min_num_sent << endl
+         << std::flush;
+    cout << "     short sequence probability:     " << short_seq_prob << endl
+         << std::flush;
     cout << "     seed:                           " << seed << endl
          << std::flush;
+    cout << "     number of partitions:           " << num_partitions << endl
+         << std::flush;
+    cout << "     number of threads:              " << num_threads << endl
+         << std::flush;
   }
 
-  // Mapping and its length (1D).
-  int64_t num_samples = -1;
-  DocIdx* maps = NULL;
-
+  // The number of samples of every (partition, bucket) pair is in
+  // state.bucket_counts.
+  MappingState state(num_partitions);
+  const std::string checkpoint_path =
+      checkpoint_prefix.empty() ? "" : checkpoint_prefix + ".ckpt";
+  const std::string fill_path =
+      checkpoint_prefix.empty() ? "" : checkpoint_prefix + ".fill";
+  if (!checkpoint_path.empty() &&
+      load_mapping_checkpoint(checkpoint_path, sizeof(DocIdx), &state) &&
+      verbose) {
+    cout << "    resuming from the checkpoint " << checkpoint_path << " at "
+         << (state.counted ? "filling" : "counting") << " epoch "
+         << state.epoch << endl
+         << std::flush;
+  }
+  BuildProgress reporter(progress, verbose);
+  std::mutex state_mutex;
+  double last_checkpoint = 0;
+  uint64_t num_checkpoints = 0;
+  // Serializes the checkpoints, which are written without state_mutex.
+  std::mutex checkpoint_mutex;
+  uint64_t saved_checkpoint = 0;
+  std::unique_ptr<MappedFile> fill;
+
+  // What a task does once state_mutex is released: the report to send and
+  // the copy of the state to checkpoint, if they are due.
+  struct TaskUpdate {
+    TaskUpdate() : report_due(false), checkpoint_id(0) {}
+
+    bool report_due;
+    BuildProgress::Report report;
+    std::unique_ptr<MappingState> checkpoint;
+    uint64_t checkpoint_id;
+  };
+  // Called with state_mutex held once a task is done.
+  auto update = [&](const char* phase,
+                    uint64_t done,
+                    uint64_t total,
+                    TaskUpdate* task) {
+    task->report_due =
+        reporter.prepare(phase, done, total, false, &task->report);
+    if (!checkpoint_path.empty() &&
+        reporter.get_seconds() - last_checkpoint >= CHECKPOINT_INTERVAL) {
+      task->checkpoint.reset(new MappingState(state));
+      task->checkpoint_id = ++num_checkpoints;
+      last_checkpoint = reporter.get_seconds();
+    }
+  };
+  // Called once state_mutex is released, so that syncing the fill file
+  // doesn't stall the other tasks.
+  auto finish = [&](const TaskUpdate& task) {
+    if (task.checkpoint) {
+      std::lock_guard<std::mutex> lock(checkpoint_mutex);
+      // A later copy of the state may have been saved already.
+      if (task.checkpoint_id > saved_checkpoint) {
+        // The filled samples should be on the disk before the partitions are
+        // saved as filled.
+        if (fill) {
+          fill->sync();
+        }
+        save_mapping_checkpoint(
+            checkpoint_path, sizeof(DocIdx), *task.checkpoint);
+        saved_checkpoint = task.checkpoint_id;
+      }
+    }
+    if (task.report_due) {
+      reporter.send(task.report);
+    }
+  };
+
+  DocIdx* maps = NULL;
+  {
+    py::gil_scoped_release release;
+    // Count the samples epoch by epoch, since the number of epochs depends
+    // on the number of samples.
+    for (; !state.counted && state.epoch < num_epochs; ++state.epoch) {
+      const int32_t epoch = state.epoch;
+      if (state.map_index >= max_num_samples) {
+        if (verbose) {
+          cout << "    reached " << max_num_samples << " samples after "
+               << epoch << " epochs ..." << endl
+               << std::flush;
+        }
+        break;
+      }
+      if (epoch > 0 && state.map_index == 0) {
+        cout << endl
+             << "     No available documtment find this dataset." << endl
+             << std::flush;
+        throw std::invalid_argument(
+            "Invalid dataset! the document should be with more than " +
+            std::to_string(min_num_sent) + " scentences.");
+      }
+      uint64_t docs_done = epoch * num_docs;
+      for (int64_t partition = 0; partition < num_partitions; ++partition) {
+        if (state.done[partition]) {
+          docs_done += get_partition_docs(partition);
+        }
+      }
+      parallel_for(num_partitions, num_threads, [&](int64_t partition) {
+        if (state.done[partition]) {
+          return;
+        }
+        auto rand32_gen = get_stream_gen<std::mt19937>(
+            seed, TARGET_LEN_STREAM, epoch, partition);
+        auto bucket_gen = get_stream_gen<std::mt19937_64>(
+            seed, BUCKET_STREAM, epoch, partition);
+        std::vector<uint64_t> counts(NUM_SHUFFLE_BUCKETS, 0);
+        MappingStats stats;
+        uint64_t count = 0;
+        map_documents(docs,
+                      sizes,
+                      get_partition_first(partition),
+                      get_partition_first(partition + 1),
+                      short_seq_ratio,
+                      max_seq_length,
+                      min_num_sent,
+                      rand32_gen,
+                      (epoch == 0) ? &stats : NULL,
+                      [&](int64_t, int64_t, int32_t) {
+                        ++counts[bucket_gen() % NUM_SHUFFLE_BUCKETS];
+                        ++count;
+                      });
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        auto bucket_counts =
+            state.bucket_counts.data() + partition * NUM_SHUFFLE_BUCKETS;
+        for (int64_t bucket = 0; bucket < NUM_SHUFFLE_BUCKETS; ++bucket) {
+          bucket_counts[bucket] += counts[bucket];
+        }
+        state.epoch_counts[partition] = count;
+        if (epoch == 0) {
+          state.partition_stats[partition] = stats;
+        }
+        state.done[partition] = 1;
+        docs_done += get_partition_docs(partition);
+        TaskUpdate task;
+        update("counting", docs_done, num_epochs * num_docs, &task);
+        lock.unlock();
+        finish(task);
+      });
+      std::lock_guard<std::mutex> lock(state_mutex);
+      for (auto count : state.epoch_counts) {
+        state.map_index += count;
+      }
+      std::fill(state.done.begin(), state.done.end(), 0);
+      std::fill(state.epoch_counts.begin(), state.epoch_counts.end(), 0);
+      if ((3 * state.map_index + 2) >
+          static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+        cout << "number of samples exceeded maximum "
+             << "allowed by type int64: "
+             << std::numeric_limits<int64_t>::max() << endl;
+        throw std::overflow_error("Number of samples");
+      }
+    }
+    if (!state.counted) {
+      state.counted = true;
+      if (!checkpoint_path.empty()) {
+        save_mapping_checkpoint(checkpoint_path, sizeof(DocIdx), state);
+        last_checkpoint = reporter.get_seconds();
+      }
+      const uint64_t docs_done = state.epoch * num_docs;
+      reporter.report("counting", docs_done, docs_done, true);
+    }
+    const int32_t num_mapped_epochs = state.epoch;
+    const uint64_t map_index = state.map_index;
+
+    if (verbose) {
+      MappingStats stats;
+      for (const auto& partition_stat : state.partition_stats) {
+        stats.empty_docs += partition_stat.empty_docs;
+        stats.one_sent_docs += partition_stat.one_sent_docs;
+        stats.long_sent_docs += partition_stat.long_sent_docs;
+      }
+      cout << "   number of empty documents: " << stats.empty_docs << endl
+           << std::flush;
+      cout << "   number of documents with one sentence: "
+           << stats.one_sent_docs << endl
+           << std::flush;
+      cout << "   number of documents with long sentences: "
+           << stats.long_sent_docs << endl
+           << std::flush;
+      cout << "   will create mapping for " << map_index << " samples" << endl
+           << std::flush;
+    }
+
+    // Prefix sums: the buckets are laid out one after another, and the
+    // samples of a bucket are ordered by partition.
+    std::vector<uint64_t> bucket_offsets(NUM_SHUFFLE_BUCKETS + 1, 0);
+    std::vector<uint64_t> cursors(state.bucket_counts.size());
+    uint64_t offset = 0;
+    for (int64_t bucket = 0; bucket < NUM_SHUFFLE_BUCKETS; ++bucket) {
+      bucket_offsets[bucket] = offset;
+      for (int64_t partition = 0; partition < num_partitions; ++partition) {
+        const auto idx = partition * NUM_SHUFFLE_BUCKETS + bucket;
+        cursors[idx] = offset;
+        offset += state.bucket_counts[idx];
+      }
+    }
+    bucket_offsets[NUM_SHUFFLE_BUCKETS] = offset;
+    maps = new DocIdx[3 * map_index];
+    std::unique_ptr<DocIdx[]> maps_owner(maps);
+
+    // The samples are filled into the fill file of the checkpoint, so that
+    // the partitions that are filled are kept.
+    DocIdx* filled = maps;
+    if (!fill_path.empty() && map_index > 0) {
+      fill.reset(new MappedFile(fill_path, 3 * map_index * sizeof(DocIdx)));
+      filled = static_cast<DocIdx*>(fill->data());
+      if (!fill->keep_contents()) {
+        std::fill(state.done.begin(), state.done.end(), 0);
+      }
+    } else {
+      std::fill(state.done.begin(), state.done.end(), 0);
+    }
+    uint64_t docs_filled = 0;
+    for (int64_t partition = 0; partition < num_partitions; ++partition) {
+      if (state.done[partition]) {
+        docs_filled += get_partition_docs(partition) * num_mapped_epochs;
+      }
+    }
+
+    // Fill the map, every partition walks its documents once more with the
+    // same random streams.
+    parallel_for(num_partitions, num_threads, [&](int64_t partition) {
+      if (state.done[partition]) {
+        return;
+      }
+      auto partition_cursors = cursors.data() + partition * NUM_SHUFFLE_BUCKETS;
+      for (int32_t mapped_epoch = 0; mapped_epoch < num_mapped_epochs;
+           ++mapped_epoch) {
+        auto rand32_gen = get_stream_gen<std::mt19937>(
+            seed, TARGET_LEN_STREAM, mapped_epoch, partition);
+        auto bucket_gen = get_stream_gen<std::mt19937_64>(
+            seed, BUCKET_STREAM, mapped_epoch, partition);
+        map_documents(docs,
+                      sizes,
+                      get_partition_first(partition),
+                      get_partition_first(partition + 1),
+                      short_seq_ratio,
+                      max_seq_length,
+                      min_num_sent,
+                      rand32_gen,
+                      NULL,
+                      [&](int64_t start_index,
+                          int64_t end_index,
+                          int32_t target_seq_len) {
+                        const auto bucket = bucket_gen() % NUM_SHUFFLE_BUCKETS;
+                        const auto map_index_0 =
+                            3 * partition_cursors[bucket]++;
+                        filled[map_index_0] = static_cast<DocIdx>(start_index);
+                        filled[map_index_0 + 1] =
+                            static_cast<DocIdx>(end_index);
+                        filled[map_index_0 + 2] =
+                            static_cast<DocIdx>(target_seq_len);
+                      });
+      }
+
+      std::unique_lock<std::mutex> lock(state_mutex);
+      state.done[partition] = 1;
+      docs_filled += get_partition_docs(partition) * num_mapped_epochs;
+      TaskUpdate task;
+      update("filling", docs_filled, num_mapped_epochs * num_docs, &task);
+      lock.unlock();
+      finish(task);
+    });
+    reporter.report("filling", docs_filled, docs_filled, true);
+
+    // Shuffle every bucket, out of the fill file if there is one.
+    uint64_t samples_shuffled = 0;
+    parallel_for(NUM_SHUFFLE_BUCKETS, num_threads, [&](int64_t bucket) {
+      auto rand64_gen =
+          get_stream_gen<std::mt19937_64>(seed, SHUFFLE_STREAM, bucket, 0);
+      const auto first = static_cast<int64_t>(bucket_offsets[bucket]);
+      const auto size =
+          static_cast<int64_t>(bucket_offsets[bucket + 1]) - first;
+      if (filled != maps) {
+        std::copy(filled + 3 * first,
+                  filled + 3 * (first + size),
+                  maps + 3 * first);
+      }
+      for (auto i = (size - 1); i > 0; --i) {
+        const auto j = static_cast<int64_t>(rand64_gen() % (i + 1));
+        const auto i0 = 3 * (first + i);
+        const auto j0 = 3 * (first + j);
+        swap(maps[i0], maps[j0]);
+        swap(maps[i0 + 1], maps[j0 + 1]);
+        swap(maps[i0 + 2], maps[j0 + 2]);
+      }
+
+      std::unique_lock<std::mutex> lock(state_mutex);
+      samples_shuffled += size;
+      BuildProgress::Report report;
+      const bool due = reporter.prepare(
+          "shuffling", samples_shuffled, map_index, false, &report);
+      lock.unlock();
+      if (due) {
+        reporter.send(report);
+      }
+    });
+    reporter.report("shuffling", map_index, map_index, true);
+    maps_owner.release();
+  }
+  if (!checkpoint_prefix.empty()) {
+    fill.reset();
+    unlink(checkpoint_path.c_str());
+    unlink(fill_path.c_str());
+  }
+  const auto num_samples = static_cast<int64_t>(state.map_index);
+
+  // Method to deallocate memory.
+  py::capsule free_when_done(maps, [](void* mem_) {
+    DocIdx* mem = reinterpret_cast<DocIdx*>(mem_);
+    delete[] mem;
+  });
+
+  // Return the numpy array.
+  const auto byte_size = sizeof(DocIdx);
+  return py::array(std::vector<int64_t>{num_samples, 3},  // shape
+                   {3 * byte_size, byte_size},  // C-style contiguous strides
+                   maps,                        // the data pointer
+                   free_when_done);             // numpy array references
+}
+
+py::array build_mapping_uncached(const py::array_t<int64_t>& docs_,
+                                 const py::array_t<int>& sizes_,
+                                 const int num_epochs,
+                                 const uint64_t max_num_samples,
+                                 const int max_seq_length,
+                                 const double short_seq_prob,
+                                 const int seed,
+                                 const bool verbose,
+                                 const int32_t min_num_sent,
+                                 const int32_t num_threads,
+                                 const std::string& checkpoint_prefix,
+                                 const py::object& progress) {
+  /* build_mapping without the cache. The partitioned algorithm checkpoints
+     its progress with checkpoint_prefix if it isn't empty. */
+  if (sizes_.size() > std::numeric_limits<uint32_t>::max()) {
+    if (verbose) {
+      cout << "    using uint64 for data mapping..." << endl << std::flush;
+    }
+    if (num_threads > 0) {
+      return build_mapping_parallel_impl<uint64_t>(docs_,
+                                                   sizes_,
+                                                   num_epochs,
+                                                   max_num_samples,
+                                                   max_seq_length,
+                                                   short_seq_prob,
+                                                   seed,
+                                                   verbose,
+                                                   min_num_sent,
+                                                   num_threads,
+                                                   checkpoint_prefix,
+                                                   progress);
+    }
+    return build_mapping_impl<uint64_t>(docs_,
+                                        sizes_,
+                                        num_epochs,
+                                        max_num_samples,
+                                        max_seq_length,
+                                        short_seq_prob,
+                                        seed,
+                                        verbose,
+                                        min_num_sent);
+  } else {
+    if (verbose) {
+      cout << "    using uint32 for data mapping..." << endl << std::flush;
+    }
+    if (num_threads > 0) {
+      return build_mapping_parallel_impl<uint32_t>(docs_,
+                                                   sizes_,
+                                                   num_epochs,
+                                                   max_num_samples,
+                                                   max_seq_length,
+                                                   short_seq_prob,
+                                                   seed,
+                                                   verbose,
+                                                   min_num_sent,
+                                                   num_threads,
+                                                   checkpoint_prefix,
+                                                   progress);
+    }
+    return build_mapping_impl<uint32_t>(docs_,
+                                        sizes_,
+                                        num_epochs,
+                                        max_num_samples,
+                                        max_seq_length,
+                                        short_seq_prob,
+                                        seed,
+                                        verbose,
+                                        min_num_sent);
+  }
+}
+
+
+py::array build_mapping(const py::array_t<int64_t>& docs_,
+                        const py::array_t<int>& sizes_,
+                        const int num_epochs,
+                        const uint64_t max_num_samples,
+                        const int max_seq_length,
+                        const double short_seq_prob,
+                        const int seed,
+                        const bool verbose,
+                        const int32_t min_num_sent,
+                        const int32_t num_threads,
+                        const std::string& cache_dir,
+                        const py::object& progress) {
+  /* num_threads = 0 builds the mapping with the serial reference algorithm,
+     whose result is the same as the one of the previous versions. Otherwise
+     the partitioned algorithm is used, whose result is the same for any
+     positive num_threads. The mapping is cached in cache_dir if it isn't
+     empty, and then the partitioned algorithm checkpoints its progress next
+     to the cache, so that an interrupted build resumes from it. The
+     partitioned algorithm reports its progress to progress if it isn't None,
+     see BuildProgress. */
+  if (num_threads < 0) {
+    throw std::invalid_argument("num_threads should be non-negative.");
+  }
+  if (!cache_dir.empty()) {
+    IndexKey key("mapping");
+    key.add_array(docs_);
+    key.add_array(sizes_);
+    key.add(num_epochs);
+    key.add(max_num_samples);
+    key.add(max_seq_length);
+    key.add(short_seq_prob);
+    key.add(seed);
+    key.add(min_num_sent);
+    // The algorithm
+    key.add(num_threads > 0);
+    const auto dtype =
+        (sizes_.size() > std::numeric_limits<uint32_t>::max()) ? INDEX_UINT64
+                                                                : INDEX_UINT32;
+    const auto path = get_index_cache_path(cache_dir, "mapping", key.get());
+    return get_cached_index(cache_dir, "mapping", key, dtype, verbose, [&]() {
+      return build_mapping_uncached(docs_,
+                                    sizes_,
+                                    num_epochs,
+                                    max_num_samples,
+                                    max_seq_length,
+                                    short_seq_prob,
+                                    seed,
+                                    verbose,
+                                    min_num_sent,
+                                    num_threads,
+                                    path,
+                                    progress);
+    });
+  }
+  return build_mapping_uncached(docs_,
+                                sizes_,
+                                num_epochs,
+                                max_num_samples,
+                                max_seq_length,
+                                short_seq_prob,
+                                seed,
+                                verbose,
+                                min_num_sent,
+                                num_threads,
+                                "",
+                                progress);
+}
+
+template <typename DocIdx>
+py::array build_blocks_mapping_impl(const py::array_t<int64_t>& docs_,
+                                    const py::array_t<int32_t>& sizes_,
+                                    const py::array_t<int32_t>& titles_sizes_,
+                                    const int32_t num_epochs,
+                                    const uint64_t max_num_samples,
+                                    const int32_t max_seq_length,
+                                    const int32_t seed,
+                                    const bool verbose,
+                                    const bool use_one_sent_blocks) {
+  /* Build a mapping of (start-index, end-index, sequence-length) where
+     start and end index are the indices of the sentences in the sample
+     and sequence-length is the target sequence length.
+  */
+
+  // Consistency checks.
+  assert(num_epochs > 0);
+  assert(max_seq_length > 1);
+  assert(seed > 0);
+
+  // Remove bound checks.
+  auto docs = docs_.unchecked<1>();
+  auto sizes = sizes_.unchecked<1>();
+  auto titles_sizes = titles_sizes_.unchecked<1>();
+
+  if (verbose) {
+    const auto sent_start_index = docs[0];
+    const auto sent_end_index = docs[docs_.shape(0) - 1];
+    const auto num_sentences = sent_end_index - sent_start_index;
+    cout << "    using:" << endl << std::flush;
+    cout << "     number of documents:            " << docs_.shape(0) - 1
+         << endl
+         << std::flush;
+    cout << "     sentences range:                [" << sent_start_index << ", "
+         << sent_end_index << ")" << endl
+         << std::flush;
+    cout << "     total number of sentences:      " << num_sentences << endl
+         << std::flush;
+    cout << "     number of epochs:               " << num_epochs << endl
+         << std::flush;
+    cout << "     maximum number of samples:      " << max_num_samples << endl
+         << std::flush;
+    cout << "     maximum sequence length:        " << max_seq_length << endl
+         << std::flush;
+    cout << "     seed:                           " << seed << endl
+         << std::flush;
+  }
+
+  // Mapping and its length (1D).
+  int64_t num_samples = -1;
+  DocIdx* maps = NULL;
+
   // Acceptable number of sentences per block.
   int min_num_sent = 2;
   if (use_one_sent_blocks) {
@@ -703,7 +2281,36 @@ py::array build_blocks_mapping(const py::array_t<int64_t>& docs_,
                                const int max_seq_length,
                                const int seed,
                                const bool verbose,
-                               const bool use_one_sent_blocks) {
+                               const bool use_one_sent_blocks,
+                               const std::string& cache_dir) {
+  /* The mapping is cached in cache_dir if it isn't empty. */
+  if (!cache_dir.empty()) {
+    IndexKey key("blocks_mapping");
+    key.add_array(docs_);
+    key.add_array(sizes_);
+    key.add_array(titles_sizes_);
+    key.add(num_epochs);
+    key.add(max_num_samples);
+    key.add(max_seq_length);
+    key.add(seed);
+    key.add(use_one_sent_blocks);
+    const auto dtype =
+        (sizes_.size() > std::numeric_limits<uint32_t>::max()) ? INDEX_UINT64
+                                                                : INDEX_UINT32;
+    return get_cached_index(
+        cache_dir, "blocks_mapping", key, dtype, verbose, [&]() {
+          return build_blocks_mapping(docs_,
+                                      sizes_,
+                                      titles_sizes_,
+                                      num_epochs,
+                                      max_num_samples,
+                                      max_seq_length,
+                                      seed,
+                                      verbose,
+                                      use_one_sent_blocks,
+                                      "");
+        });
+  }
   if (sizes_.size() > std::numeric_limits<uint32_t>::max()) {
     if (verbose) {
       cout << "    using uint64 for data mapping..." << endl << std::flush;
@@ -733,9 +2340,1449 @@ py::array build_blocks_mapping(const py::array_t<int64_t>& docs_,
   }
 }
 
+// The random streams of the lazy sample index.
+const int64_t DOC_ORDER_STREAM = 3;
+const int64_t SAMPLE_ORDER_STREAM = 4;
+
+template <typename T>
+void shuffle_vector(std::vector<T>* values, std::mt19937_64& rand64_gen) {
+  /* The Fisher-Yates shuffle of the other indices, whose result doesn't depend
+     on the standard library as the one of std::shuffle does. */
+  for (auto i = static_cast<int64_t>(values->size()) - 1; i > 0; --i) {
+    const auto j = static_cast<int64_t>(rand64_gen() % (i + 1));
+    swap((*values)[i], (*values)[j]);
+  }
+}
+
+class LazySampleIndex {
+  /* The samples of build_sample_idx, built an epoch at a time. The sample
+     index of an epoch is built when it is first accessed and the one of the
+     next epoch is built in the background meanwhile, the others are dropped,
+     so only about two epochs are kept in memory.
+
+     The samples whose first token is in an epoch belong to it. Every epoch
+     has its own order of documents and, if shuffle is set, its own order of
+     samples, both drawn from the seed and the epoch, so a sample doesn't
+     depend on the order in which the epochs are accessed. */
+ public:
+  LazySampleIndex(
+      const py::array_t<int32_t, py::array::c_style | py::array::forcecast>&
+          sizes,
+      const py::array_t<int32_t>& documents,
+      const int32_t seq_length,
+      const int32_t num_epochs,
+      const int32_t seed,
+      const bool shuffle)
+      : sizes_(sizes),
+        seq_length_(seq_length),
+        num_epochs_(num_epochs),
+        seed_(seed),
+        shuffle_(shuffle) {
+    if (seq_length <= 1 || num_epochs <= 0) {
+      throw std::invalid_argument(
+          "seq_length should be greater than 1 and num_epochs positive");
+    }
+    auto docs = documents.unchecked<1>();
+    tokens_per_epoch_ = 0;
+    documents_.resize(docs.shape(0));
+    for (int64_t i = 0; i < docs.shape(0); ++i) {
+      if (docs[i] < 0 || docs[i] >= sizes.shape(0)) {
+        throw std::out_of_range("The document is out of the range of sizes");
+      }
+      documents_[i] = docs[i];
+      tokens_per_epoch_ += sizes_.data()[docs[i]];
+    }
+    if (tokens_per_epoch_ <= 1) {
+      throw std::invalid_argument(
+          "The documents should have 2 tokens at least");
+    }
+    num_samples_ = (num_epochs * tokens_per_epoch_ - 1) / seq_length;
+
+    cout << "    using:" << endl << std::flush;
+    cout << "     number of documents:       " << documents_.size() << endl
+         << std::flush;
+    cout << "     number of epochs:          " << num_epochs << endl
+         << std::flush;
+    cout << "     sequence length:           " << seq_length << endl
+         << std::flush;
+    cout << "     total number of samples:   " << num_samples_ << endl
+         << std::flush;
+  }
+
+  ~LazySampleIndex() {
+    /* The epochs being built read the members. */
+    for (auto& epoch : epochs_) {
+      epoch.second.wait();
+    }
+  }
+
+  int64_t size() const { return num_samples_; }
+
+  int64_t get_tokens_per_epoch() const { return tokens_per_epoch_; }
+
+  py::array get_sample(const int64_t index) {
+    /* The pieces of the documents that make the index-th sample, a 2D array
+       of [document, offset, length]. Like build_sample_idx, a sample has
+       seq_length + 1 tokens and its last token is the first of the next
+       sample. */
+    if (index < 0 || index >= num_samples_) {
+      throw std::out_of_range("The sample index is out of range");
+    }
+    std::vector<int32_t> pieces;
+    {
+      py::gil_scoped_release release;
+      int64_t epoch_id = std::min<int64_t>(
+          index * seq_length_ / tokens_per_epoch_, num_epochs_ - 1);
+      auto epoch = get_epoch(epoch_id, true);
+      int64_t sample = index - get_first_sample(epoch_id);
+      if (shuffle_) {
+        sample = epoch->sample_order[sample];
+      }
+      size_t doc_pos = epoch->doc_pos[sample];
+      int32_t doc_offset = epoch->doc_offset[sample];
+      int32_t remaining_seq_length = seq_length_ + 1;
+      while (remaining_seq_length > 0) {
+        if (doc_pos == documents_.size()) {
+          // The sample goes on in the next epoch.
+          epoch = get_epoch(++epoch_id, false);
+          doc_pos = 0;
+        }
+        const auto doc_id = epoch->doc_order[doc_pos];
+        const auto length =
+            std::min(sizes_.data()[doc_id] - doc_offset, remaining_seq_length);
+        if (length > 0) {
+          pieces.push_back(doc_id);
+          pieces.push_back(doc_offset);
+          pieces.push_back(length);
+          remaining_seq_length -= length;
+        }
+        ++doc_pos;
+        doc_offset = 0;
+      }
+    }
+    return get_int32_array(pieces, pieces.size() / 3, 3);
+  }
+
+  py::array get_doc_idx(const int32_t epoch_id) {
+    /* The order of the documents in an epoch. */
+    if (epoch_id < 0 || epoch_id >= num_epochs_) {
+      throw std::out_of_range("The epoch is out of range");
+    }
+    EpochPtr epoch;
+    {
+      py::gil_scoped_release release;
+      epoch = get_epoch(epoch_id, false);
+    }
+    return get_int32_array(epoch->doc_order, epoch->doc_order.size(), 1);
+  }
+
+ private:
+  struct Epoch {
+    std::vector<int32_t> doc_order;
+    // The position in doc_order and the offset in the document of the first
+    // token of every sample.
+    std::vector<int32_t> doc_pos;
+    std::vector<int32_t> doc_offset;
+    std::vector<uint32_t> sample_order;
+  };
+  typedef std::shared_ptr<const Epoch> EpochPtr;
+
+  int64_t get_first_sample(const int64_t epoch_id) const {
+    return std::min(
+        (epoch_id * tokens_per_epoch_ + seq_length_ - 1) / seq_length_,
+        num_samples_);
+  }
+
+  EpochPtr build_epoch(const int64_t epoch_id) const {
+    std::shared_ptr<Epoch> epoch(new Epoch());
+    epoch->doc_order = documents_;
+    if (shuffle_) {
+      auto gen = get_stream_gen<std::mt19937_64>(
+          seed_, DOC_ORDER_STREAM, epoch_id, 0);
+      shuffle_vector(&epoch->doc_order, gen);
+    }
+
+    const int64_t first_sample = get_first_sample(epoch_id);
+    const int64_t num_samples = get_first_sample(epoch_id + 1) - first_sample;
+    if (num_samples > std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error("Too many samples in an epoch");
+    }
+    epoch->doc_pos.reserve(num_samples);
+    epoch->doc_offset.reserve(num_samples);
+    // Position of the first token of the current document in the epoch.
+    int64_t doc_start = 0;
+    int64_t doc_pos = 0;
+    for (int64_t sample = first_sample; sample < first_sample + num_samples;
+         ++sample) {
+      const int64_t position =
+          sample * seq_length_ - epoch_id * tokens_per_epoch_;
+      while (doc_start + sizes_.data()[epoch->doc_order[doc_pos]] <=
+             position) {
+        doc_start += sizes_.data()[epoch->doc_order[doc_pos]];
+        ++doc_pos;
+      }
+      epoch->doc_pos.push_back(doc_pos);
+      epoch->doc_offset.push_back(position - doc_start);
+    }
+
+    if (shuffle_) {
+      epoch->sample_order.resize(num_samples);
+      for (int64_t i = 0; i < num_samples; ++i) {
+        epoch->sample_order[i] = i;
+      }
+      auto gen = get_stream_gen<std::mt19937_64>(
+          seed_, SAMPLE_ORDER_STREAM, epoch_id, 0);
+      shuffle_vector(&epoch->sample_order, gen);
+    }
+    return epoch;
+  }
+
+  std::shared_future<EpochPtr> request_epoch(const int64_t epoch_id) {
+    /* Start building the epoch unless it is built or being built. The mutex
+       should be held. */
+    auto it = epochs_.find(epoch_id);
+    if (it != epochs_.end()) {
+      return it->second;
+    }
+    auto future = std::async(std::launch::async,
+                             [this, epoch_id]() {
+                               return build_epoch(epoch_id);
+                             })
+                      .share();
+    epochs_[epoch_id] = future;
+    return future;
+  }
+
+  EpochPtr get_epoch(const int64_t epoch_id, const bool advance) {
+    /* Wait for the epoch to be built. If advance is set, the next epoch is
+       built in the background and the built epochs other than the two are
+       dropped. */
+    std::shared_future<EpochPtr> future;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      future = request_epoch(epoch_id);
+      if (advance) {
+        if (epoch_id + 1 < num_epochs_) {
+          request_epoch(epoch_id + 1);
+        }
+        for (auto it = epochs_.begin(); it != epochs_.end();) {
+          if (it->first != epoch_id && it->first != epoch_id + 1 &&
+              it->second.wait_for(std::chrono::seconds(0)) ==
+                  std::future_status::ready) {
+            it = epochs_.erase(it);
+          } else {
+            ++it;
+          }
+        }
+      }
+    }
+    return future.get();
+  }
+
+  static py::array get_int32_array(const std::vector<int32_t>& values,
+                                   const int64_t rows,
+                                   const int64_t cols) {
+    int32_t* data = new int32_t[values.size()];
+    std::copy(values.begin(), values.end(), data);
+    py::capsule free_when_done(data, [](void* mem_) {
+      int32_t* mem = reinterpret_cast<int32_t*>(mem_);
+      delete[] mem;
+    });
+    const int64_t byte_size = sizeof(int32_t);
+    if (cols == 1) {
+      return py::array(std::vector<int64_t>{rows},
+                       std::vector<int64_t>{byte_size},
+                       data,
+                       free_when_done);
+    }
+    return py::array(std::vector<int64_t>{rows, cols},
+                     std::vector<int64_t>{cols * byte_size, byte_size},
+                     data,
+                     free_when_done);
+  }
+
+  const py::array_t<int32_t, py::array::c_style | py::array::forcecast>
+      sizes_;
+  std::vector<int32_t> documents_;
+  const int32_t seq_length_;
+  const int32_t num_epochs_;
+  const int32_t seed_;
+  const bool shuffle_;
+  int64_t tokens_per_epoch_;
+  int64_t num_samples_;
+  std::mutex mutex_;
+  std::map<int64_t, std::shared_future<EpochPtr>> epochs_;
+};
+
+/* The token blocks file (_ids.blk) keeps the tokens of an indexed dataset in
+   fixed-size blocks, so that a sample is read by decoding only the blocks it
+   spans:
+
+     header (TokenBlocksHeader) | offsets | blocks | padding
+
+   offsets[i] is the byte of the i-th block from the first one, and the last
+   of the num_blocks + 1 offsets is the end of the blocks. A block starts with
+   its codec and its bit width. The tokens of a block are bit-packed to the
+   width of its largest token or group varint coded, whichever is smaller:
+   the varints win when most tokens are frequent ones with small ids. A group
+   varint is a byte of the lengths (1 to 4 bytes) of the next 4 tokens
+   followed by their bytes, so it's decoded without branches. */
+
+const char TOKEN_BLOCKS_MAGIC[8] = {'P', 'N', 'L', 'P', 'T', 'O', 'K', '\0'};
+const uint32_t TOKEN_BLOCKS_FORMAT_VERSION = 1;
+const int32_t MAX_TOKEN_BLOCK_SIZE = 1 << 20;
+// The decoder reads the bytes of a token up to 8 bytes at a time, and a group
+// of varints may overrun a corrupted block by 16 bytes.
+const size_t TOKEN_BLOCKS_PADDING = 16;
+// The blocks are encoded in parallel by chunks.
+const int64_t BLOCKS_PER_CHUNK = 4096;
+
+enum TokenBlockCodec : uint8_t {
+  BLOCK_BIT_PACKED = 0,
+  BLOCK_GROUP_VARINT = 1,
+};
+
+struct TokenBlocksHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t block_size;
+  uint64_t num_tokens;
+  uint64_t num_blocks;
+};
+
+inline int get_varint_len(const uint32_t token) {
+  return token < (1u << 8) ? 1 : token < (1u << 16) ? 2
+         : token < (1u << 24) ? 3 : 4;
+}
+
+void encode_token_block(const int64_t* tokens,
+                        const int64_t len,
+                        std::vector<uint8_t>* block) {
+  uint32_t max_token = 0;
+  size_t varint_bytes = (len + 3) / 4;
+  for (int64_t i = 0; i < len; ++i) {
+    if (tokens[i] < 0 || tokens[i] > std::numeric_limits<uint32_t>::max()) {
+      throw std::out_of_range("The token ids should fit into 32 bits");
+    }
+    const auto token = static_cast<uint32_t>(tokens[i]);
+    max_token = std::max(max_token, token);
+    varint_bytes += get_varint_len(token);
+  }
+  uint8_t width = 0;
+  while (width < 32 && (max_token >> width) != 0) {
+    ++width;
+  }
+  const size_t packed_bytes = (len * width + 7) / 8;
+
+  block->clear();
+  if (packed_bytes <= varint_bytes) {
+    block->push_back(BLOCK_BIT_PACKED);
+    block->push_back(width);
+    uint64_t bits = 0;
+    int num_bits = 0;
+    for (int64_t i = 0; i < len; ++i) {
+      bits |= static_cast<uint64_t>(tokens[i]) << num_bits;
+      num_bits += width;
+      for (; num_bits >= 8; num_bits -= 8) {
+        block->push_back(bits & 0xff);
+        bits >>= 8;
+      }
+    }
+    if (num_bits > 0) {
+      block->push_back(bits & 0xff);
+    }
+  } else {
+    block->push_back(BLOCK_GROUP_VARINT);
+    block->push_back(0);
+    for (int64_t i = 0; i < len; i += 4) {
+      const size_t lens_pos = block->size();
+      uint8_t lens = 0;
+      block->push_back(0);
+      for (int64_t k = 0; k < 4 && i + k < len; ++k) {
+        const auto token = static_cast<uint32_t>(tokens[i + k]);
+        const int token_len = get_varint_len(token);
+        lens |= (token_len - 1) << (2 * k);
+        for (int j = 0; j < token_len; ++j) {
+          block->push_back(token >> (8 * j));
+        }
+      }
+      (*block)[lens_pos] = lens;
+    }
+  }
+}
+
+template <int Width>
+void unpack_bits(const uint8_t* data, const int64_t len, uint32_t* tokens) {
+  /* Every token is in the 8 bytes from its first byte, since it has at most
+     7 + 32 bits. A group of 8 tokens takes Width bytes, so the offsets and
+     the shifts inside a group are constants. */
+  const uint64_t mask = (uint64_t(1) << Width) - 1;
+  int64_t i = 0;
+  for (; i + 8 <= len; i += 8, data += Width) {
+    for (int j = 0; j < 8; ++j) {
+      uint64_t word;
+      memcpy(&word, data + j * Width / 8, sizeof(word));
+      tokens[i + j] = (word >> (j * Width % 8)) & mask;
+    }
+  }
+  for (int j = 0; i < len; ++i, ++j) {
+    uint64_t word;
+    memcpy(&word, data + j * Width / 8, sizeof(word));
+    tokens[i] = (word >> (j * Width % 8)) & mask;
+  }
+}
+
+typedef void (*UnpackBits)(const uint8_t*, const int64_t, uint32_t*);
+
+const UnpackBits UNPACK_BITS[33] = {
+    &unpack_bits<0>,  &unpack_bits<1>,  &unpack_bits<2>,  &unpack_bits<3>,
+    &unpack_bits<4>,  &unpack_bits<5>,  &unpack_bits<6>,  &unpack_bits<7>,
+    &unpack_bits<8>,  &unpack_bits<9>,  &unpack_bits<10>, &unpack_bits<11>,
+    &unpack_bits<12>, &unpack_bits<13>, &unpack_bits<14>, &unpack_bits<15>,
+    &unpack_bits<16>, &unpack_bits<17>, &unpack_bits<18>, &unpack_bits<19>,
+    &unpack_bits<20>, &unpack_bits<21>, &unpack_bits<22>, &unpack_bits<23>,
+    &unpack_bits<24>, &unpack_bits<25>, &unpack_bits<26>, &unpack_bits<27>,
+    &unpack_bits<28>, &unpack_bits<29>, &unpack_bits<30>, &unpack_bits<31>,
+    &unpack_bits<32>};
+
+void decode_token_block(const uint8_t* block,
+                        const size_t block_bytes,
+                        const int64_t len,
+                        uint32_t* tokens) {
+  /* Decode the len tokens of a block. The block is followed by at least
+     TOKEN_BLOCKS_PADDING readable bytes. */
+  if (block_bytes < 2) {
+    throw std::runtime_error("The token block is corrupted");
+  }
+  const uint8_t* data = block + 2;
+  const uint8_t* end = block + block_bytes;
+  if (block[0] == BLOCK_BIT_PACKED) {
+    const uint32_t width = block[1];
+    if (width > 32 || (len * width + 7) / 8 > end - data) {
+      throw std::runtime_error("The token block is corrupted");
+    }
+    UNPACK_BITS[width](data, len, tokens);
+  } else if (block[0] == BLOCK_GROUP_VARINT) {
+    static const uint32_t masks[4] = {0xff, 0xffff, 0xffffff, 0xffffffff};
+    for (int64_t i = 0; i < len; i += 4) {
+      if (data >= end) {
+        throw std::runtime_error("The token block is corrupted");
+      }
+      const uint8_t lens = *data++;
+      const int64_t group_len = std::min<int64_t>(4, len - i);
+      for (int64_t k = 0; k < group_len; ++k) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        const int token_len = ((lens >> (2 * k)) & 3) + 1;
+        tokens[i + k] = word & masks[token_len - 1];
+        data += token_len;
+      }
+    }
+    if (data > end) {
+      throw std::runtime_error("The token block is corrupted");
+    }
+  } else {
+    throw std::runtime_error("The token block has an unknown codec");
+  }
+}
+
+class MMapIndexedDataset {
+  /* A reader of the token ids (_ids.npy or _ids.blk) of an indexed dataset
+     that gathers the tokens of a batch of gpt samples into one array. The
+     file is mapped read-only and the tokens are gathered without the GIL. */
+ public:
+  MMapIndexedDataset(const std::string& ids_path,
+                     const py::array_t<int32_t>& sizes_)
+      : path_(ids_path), addr_(MAP_FAILED), len_(0) {
+    auto sizes = sizes_.unchecked<1>();
+    pointers_.resize(sizes.shape(0) + 1);
+    pointers_[0] = 0;
+    for (int64_t i = 0; i < sizes.shape(0); ++i) {
+      if (sizes[i] < 0) {
+        throw std::invalid_argument("The sizes should not be negative");
+      }
+      pointers_[i + 1] = pointers_[i] + sizes[i];
+    }
+    map_file();
+    if (pointers_.back() > num_tokens_) {
+      munmap(addr_, len_);
+      throw std::invalid_argument("The sizes exceed the tokens of " +
+                                  ids_path);
+    }
+  }
+
+  // All the tokens as one document.
+  explicit MMapIndexedDataset(const std::string& ids_path)
+      : path_(ids_path), addr_(MAP_FAILED), len_(0), pointers_(1, 0) {
+    map_file();
+  }
+
+  ~MMapIndexedDataset() {
+    if (addr_ != MAP_FAILED) {
+      munmap(addr_, len_);
+    }
+  }
+
+  int64_t size() const { return pointers_.size() - 1; }
+
+  int64_t get_num_tokens() const { return num_tokens_; }
+
+  void get_tokens(const int64_t first,
+                  const int64_t num_tokens,
+                  int64_t* out) const {
+    if (first < 0 || num_tokens < 0 || first + num_tokens > num_tokens_) {
+      throw std::out_of_range("The tokens are out of range");
+    }
+    std::vector<uint32_t> block_tokens;
+    copy_tokens(first, num_tokens, out, &block_tokens);
+  }
+
+  void get_samples(const py::array_t<int32_t>& sample_idx_,
+                   const py::array_t<int32_t>& doc_idx_,
+                   const py::array_t<int64_t>& indices_,
+                   py::array_t<int64_t>& out_) {
+    /* Write the tokens of the samples indices into the rows of out, which has
+       a shape of [len(indices), seq_length + 1]. Like the gpt dataset, the
+       i-th sample spans from sample_idx[i] to sample_idx[i + 1], both given
+       as [index into doc_idx, offset in the document]. */
+    auto sample_idx = sample_idx_.unchecked<2>();
+    auto doc_idx = doc_idx_.unchecked<1>();
+    auto indices = indices_.unchecked<1>();
+    auto out = out_.mutable_unchecked<2>();
+    if (out.shape(0) != indices.shape(0)) {
+      throw std::invalid_argument("out should have a row for every index");
+    }
+    if (out.shape(1) > 1 && out_.strides(1) != sizeof(int64_t)) {
+      throw std::invalid_argument("The rows of out should be contiguous");
+    }
+
+    // The spans of the documents to copy, as [first token, number of tokens].
+    // They are checked with the GIL held, so that a bad index raises cleanly.
+    std::vector<std::pair<int64_t, int64_t>> spans;
+    std::vector<size_t> first_spans;
+    for (int64_t i = 0; i < indices.shape(0); ++i) {
+      const auto index = indices[i];
+      if (index < 0 || index + 1 >= sample_idx.shape(0)) {
+        throw std::out_of_range("The sample index is out of range");
+      }
+      first_spans.push_back(spans.size());
+      const int64_t doc_index_f = sample_idx(index, 0);
+      const int64_t doc_index_l = sample_idx(index + 1, 0);
+      int64_t num_tokens = 0;
+      for (int64_t doc_index = doc_index_f; doc_index <= doc_index_l;
+           ++doc_index) {
+        if (doc_index < 0 || doc_index >= doc_idx.shape(0) ||
+            doc_idx[doc_index] < 0 || doc_idx[doc_index] >= size()) {
+          throw std::out_of_range("The document index is out of range");
+        }
+        const auto doc_id = doc_idx[doc_index];
+        int64_t first = pointers_[doc_id];
+        int64_t last = pointers_[doc_id + 1];
+        if (doc_index == doc_index_l) {
+          last = first + sample_idx(index + 1, 1) + 1;
+        }
+        if (doc_index == doc_index_f) {
+          first += sample_idx(index, 1);
+        }
+        if (first < last) {
+          if (first < 0 || last > num_tokens_) {
+            throw std::out_of_range("The sample is out of the tokens");
+          }
+          spans.push_back(std::make_pair(first, last - first));
+          num_tokens += last - first;
+        }
+      }
+      if (num_tokens != out.shape(1)) {
+        throw std::invalid_argument(
+            "The length of the sample doesn't match the columns of out");
+      }
+    }
+    first_spans.push_back(spans.size());
+
+    py::gil_scoped_release release;
+
+    // Ask for the pages of all spans before copying any of them, so that they
+    // are read in parallel.
+    const int64_t page_size = sysconf(_SC_PAGESIZE);
+    for (const auto& span : spans) {
+      size_t begin, end;
+      get_span_bytes(span.first, last_token(span), &begin, &end);
+      const auto page_begin = begin / page_size * page_size;
+      madvise(static_cast<char*>(addr_) + page_begin,
+              end - page_begin,
+              MADV_WILLNEED);
+    }
+
+    // The decoded block, shared by the spans so that it's allocated once.
+    std::vector<uint32_t> block_tokens;
+    for (int64_t i = 0; i < indices.shape(0); ++i) {
+      int64_t* row = &out(i, 0);
+      for (size_t j = first_spans[i]; j < first_spans[i + 1]; ++j) {
+        copy_tokens(spans[j].first, spans[j].second, row, &block_tokens);
+        row += spans[j].second;
+      }
+    }
+  }
+
+ private:
+  static int64_t last_token(const std::pair<int64_t, int64_t>& span) {
+    return span.first + span.second;
+  }
+
+  void map_file() {
+    const int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Failed to open " + path_ + ": " +
+                               strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      len_ = st.st_size;
+      addr_ = mmap(nullptr, len_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+      throw std::runtime_error("Failed to map " + path_);
+    }
+    // The samples read short spans all over the file.
+    madvise(addr_, len_, MADV_RANDOM);
+    try {
+      if (len_ >= sizeof(TokenBlocksHeader) &&
+          memcmp(addr_, TOKEN_BLOCKS_MAGIC, sizeof(TOKEN_BLOCKS_MAGIC)) == 0) {
+        parse_blocks_header();
+      } else {
+        parse_npy_header();
+      }
+    } catch (...) {
+      munmap(addr_, len_);
+      throw;
+    }
+  }
+
+  void parse_blocks_header() {
+    /* Check the header and the offsets of a token blocks file. */
+    TokenBlocksHeader header;
+    memcpy(&header, addr_, sizeof(header));
+    if (header.format_version != TOKEN_BLOCKS_FORMAT_VERSION) {
+      throw std::runtime_error(path_ + " has an unsupported format version");
+    }
+    if (header.block_size == 0 ||
+        header.block_size > static_cast<uint32_t>(MAX_TOKEN_BLOCK_SIZE) ||
+        header.num_blocks != (header.num_tokens + header.block_size - 1) /
+                                 header.block_size ||
+        header.num_blocks >= len_ / sizeof(uint64_t)) {
+      throw std::runtime_error(path_ + " has a corrupted header");
+    }
+    block_offsets_ = reinterpret_cast<const uint64_t*>(
+        static_cast<const char*>(addr_) + sizeof(header));
+    data_offset_ = sizeof(header) + (header.num_blocks + 1) * sizeof(uint64_t);
+    if (data_offset_ + TOKEN_BLOCKS_PADDING > len_ || block_offsets_[0] != 0 ||
+        block_offsets_[header.num_blocks] >
+            len_ - data_offset_ - TOKEN_BLOCKS_PADDING) {
+      throw std::runtime_error(path_ + " is truncated");
+    }
+    dtype_ = TOKEN_BLOCKS;
+    itemsize_ = 0;
+    block_size_ = header.block_size;
+    num_blocks_ = header.num_blocks;
+    num_tokens_ = header.num_tokens;
+  }
+
+  void get_span_bytes(const int64_t first,
+                      const int64_t last,
+                      size_t* begin,
+                      size_t* end) const {
+    /* The bytes of the file that keep the tokens [first, last). */
+    if (dtype_ == TOKEN_BLOCKS) {
+      *begin = data_offset_ + block_offsets_[first / block_size_];
+      *end = data_offset_ + block_offsets_[(last - 1) / block_size_ + 1];
+    } else {
+      *begin = data_offset_ + first * itemsize_;
+      *end = data_offset_ + last * itemsize_;
+    }
+  }
+
+  void copy_block_tokens(int64_t first,
+                         const int64_t num_tokens,
+                         int64_t* out,
+                         std::vector<uint32_t>* tokens) const {
+    /* tokens is the scratch buffer of the decoded blocks. */
+    const int64_t last = first + num_tokens;
+    tokens->resize(std::min<int64_t>(block_size_, num_tokens_));
+    const auto blocks = static_cast<const uint8_t*>(addr_) + data_offset_;
+    while (first < last) {
+      const int64_t block = first / block_size_;
+      const int64_t block_first = block * block_size_;
+      const int64_t block_len =
+          std::min<int64_t>(block_size_, num_tokens_ - block_first);
+      const uint64_t begin = block_offsets_[block];
+      const uint64_t end = block_offsets_[block + 1];
+      if (end < begin || end > block_offsets_[num_blocks_]) {
+        throw std::runtime_error(path_ + " has a corrupted block");
+      }
+      decode_token_block(
+          blocks + begin, end - begin, block_len, tokens->data());
+      const int64_t copy_end = std::min(last - block_first, block_len);
+      std::copy(tokens->begin() + (first - block_first),
+                tokens->begin() + copy_end,
+                out);
+      out += copy_end - (first - block_first);
+      first = block_first + copy_end;
+    }
+  }
+
+  void parse_npy_header() {
+    /* Check the header of a 1-D, C ordered npy array and find its dtype,
+       length and data. */
+    const char* data = static_cast<const char*>(addr_);
+    if (len_ < 10 || memcmp(data, "\x93NUMPY", 6) != 0) {
+      throw std::runtime_error(path_ + " is not a npy file");
+    }
+    const uint8_t major = data[6];
+    size_t header_len;
+    if (major == 1) {
+      header_len = static_cast<uint8_t>(data[8]) |
+                   static_cast<uint8_t>(data[9]) << 8;
+      data_offset_ = 10 + header_len;
+    } else {
+      if (len_ < 12) {
+        throw std::runtime_error(path_ + " is not a npy file");
+      }
+      header_len = 0;
+      for (int i = 3; i >= 0; --i) {
+        header_len = header_len << 8 | static_cast<uint8_t>(data[8 + i]);
+      }
+      data_offset_ = 12 + header_len;
+    }
+    if (data_offset_ > len_) {
+      throw std::runtime_error(path_ + " is not a npy file");
+    }
+    const std::string header(data + data_offset_ - header_len, header_len);
+    if (header.find("'fortran_order': False") == std::string::npos) {
+      throw std::runtime_error(path_ + " should be C ordered");
+    }
+    auto find_value = [&](const std::string& key) {
+      const auto pos = header.find("'" + key + "':");
+      if (pos == std::string::npos) {
+        throw std::runtime_error(path_ + " has no " + key);
+      }
+      return header.find_first_not_of(' ', pos + key.size() + 3);
+    };
+    auto pos = find_value("descr");
+    const auto descr = header.substr(pos, header.find(',', pos) - pos);
+    if (descr == "'<u2'") {
+      dtype_ = TOKEN_UINT16;
+      itemsize_ = 2;
+    } else if (descr == "'<i4'") {
+      dtype_ = TOKEN_INT32;
+      itemsize_ = 4;
+    } else if (descr == "'<i8'") {
+      dtype_ = TOKEN_INT64;
+      itemsize_ = 8;
+    } else {
+      throw std::runtime_error(path_ + " has an unsupported dtype " + descr);
+    }
+    pos = find_value("shape");
+    const auto shape = header.substr(pos, header.find(')', pos) + 1 - pos);
+    if (shape.size() < 4 || shape[0] != '(' ||
+        shape.find(',') != shape.size() - 2) {
+      throw std::runtime_error(path_ + " should have a 1-D array");
+    }
+    num_tokens_ = std::stoll(shape.substr(1));
+    if (data_offset_ + num_tokens_ * itemsize_ > len_) {
+      throw std::runtime_error(path_ + " is truncated");
+    }
+  }
+
+  template <typename T>
+  void copy_tokens(const int64_t first,
+                   const int64_t num_tokens,
+                   int64_t* out) const {
+    const T* tokens = reinterpret_cast<const T*>(
+                          static_cast<const char*>(addr_) + data_offset_) +
+                      first;
+    std::copy(tokens, tokens + num_tokens, out);
+  }
+
+  void copy_tokens(const int64_t first,
+                   const int64_t num_tokens,
+                   int64_t* out,
+                   std::vector<uint32_t>* block_tokens) const {
+    switch (dtype_) {
+      case TOKEN_UINT16:
+        copy_tokens<uint16_t>(first, num_tokens, out);
+        break;
+      case TOKEN_INT32:
+        copy_tokens<int32_t>(first, num_tokens, out);
+        break;
+      case TOKEN_INT64:
+        copy_tokens<int64_t>(first, num_tokens, out);
+        break;
+      case TOKEN_BLOCKS:
+        copy_block_tokens(first, num_tokens, out, block_tokens);
+        break;
+    }
+  }
+
+  enum TokenDType { TOKEN_UINT16, TOKEN_INT32, TOKEN_INT64, TOKEN_BLOCKS };
+
+  const std::string path_;
+  void* addr_;
+  size_t len_;
+  size_t data_offset_;
+  TokenDType dtype_;
+  size_t itemsize_;
+  int64_t num_tokens_;
+  std::vector<int64_t> pointers_;
+  // The blocks of a token blocks file
+  int64_t block_size_;
+  int64_t num_blocks_;
+  const uint64_t* block_offsets_;
+};
+
+void compress_ids(const std::string& ids_path,
+                  const std::string& out_path,
+                  const int32_t block_size,
+                  const int32_t num_threads) {
+  /* Write the tokens of ids_path (_ids.npy) into the token blocks file
+     out_path (_ids.blk), block_size tokens a block. The file is written into
+     a temporary file first and renamed. */
+  if (block_size <= 0 || block_size > MAX_TOKEN_BLOCK_SIZE) {
+    throw std::invalid_argument("The block size should be in [1, 2^20]");
+  }
+  const MMapIndexedDataset dataset(ids_path);
+  TokenBlocksHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TOKEN_BLOCKS_MAGIC, sizeof(header.magic));
+  header.format_version = TOKEN_BLOCKS_FORMAT_VERSION;
+  header.block_size = block_size;
+  header.num_tokens = dataset.get_num_tokens();
+  header.num_blocks = (header.num_tokens + block_size - 1) / block_size;
+  const uint64_t data_offset =
+      sizeof(header) + (header.num_blocks + 1) * sizeof(uint64_t);
+
+  const std::string tmp_path = get_temp_path(out_path);
+  const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create " + tmp_path + ": " +
+                             strerror(errno));
+  }
+  try {
+    py::gil_scoped_release release;
+    pwrite_all(fd, &header, sizeof(header), 0);
+    std::vector<std::vector<uint8_t>> blocks(BLOCKS_PER_CHUNK);
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> data;
+    uint64_t offset = 0;
+    for (uint64_t chunk = 0; chunk < header.num_blocks;
+         chunk += BLOCKS_PER_CHUNK) {
+      const int64_t num_blocks =
+          std::min<uint64_t>(BLOCKS_PER_CHUNK, header.num_blocks - chunk);
+      parallel_for(num_blocks, num_threads, [&](const int64_t i) {
+        const int64_t first = (chunk + i) * block_size;
+        const int64_t len =
+            std::min<int64_t>(block_size, header.num_tokens - first);
+        std::vector<int64_t> tokens(len);
+        dataset.get_tokens(first, len, tokens.data());
+        encode_token_block(tokens.data(), len, &blocks[i]);
+      });
+      offsets.clear();
+      data.clear();
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        offsets.push_back(offset + data.size());
+        data.insert(data.end(), blocks[i].begin(), blocks[i].end());
+      }
+      pwrite_all(fd,
+                 offsets.data(),
+                 offsets.size() * sizeof(uint64_t),
+                 sizeof(header) + chunk * sizeof(uint64_t));
+      pwrite_all(fd, data.data(), data.size(), data_offset + offset);
+      offset += data.size();
+    }
+    pwrite_all(fd,
+               &offset,
+               sizeof(offset),
+               sizeof(header) + header.num_blocks * sizeof(uint64_t));
+    const std::vector<char> padding(TOKEN_BLOCKS_PADDING, 0);
+    pwrite_all(fd, padding.data(), padding.size(), data_offset + offset);
+    if (fsync(fd) != 0) {
+      throw std::runtime_error(std::string("Failed to sync ") + tmp_path +
+                               ": " + strerror(errno));
+    }
+  } catch (...) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    throw;
+  }
+  close(fd);
+  if (rename(tmp_path.c_str(), out_path.c_str()) != 0) {
+    const auto error = errno;
+    unlink(tmp_path.c_str());
+    throw std::runtime_error("Failed to rename " + tmp_path + " to " +
+                             out_path + ": " + strerror(error));
+  }
+}
+
+// The random streams of the masking and of the shards.
+const int64_t MASK_STREAM = 5;
+const int64_t SHARD_STREAM = 6;
+
+// The shard indices are computed by chunks in parallel.
+const int64_t SHARD_INDICES_PER_CHUNK = 1 << 16;
+
+inline uint64_t mix_bits(uint64_t x) {
+  // The finalizer of splitmix64.
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+class CounterRng {
+  /* A counter-based generator: the n-th number of a key is a hash of the key
+     and n, so a sample draws the same numbers on whatever thread and in
+     whatever batch it is masked. */
+ public:
+  CounterRng(const int32_t seed, const int64_t stream, const int64_t key)
+      : key_(mix_bits(mix_bits(static_cast<uint32_t>(seed) |
+                               static_cast<uint64_t>(stream) << 32) +
+                      static_cast<uint64_t>(key))),
+        counter_(0) {}
+
+  uint64_t next() {
+    return mix_bits(key_ + ++counter_ * 0x9E3779B97F4A7C15ULL);
+  }
+
+  // A double in [0, 1).
+  double uniform() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+
+  // An integer in [0, n) without the bias of the modulo.
+  uint64_t below(const uint64_t n) {
+    const uint64_t threshold = (0 - n) % n;
+    uint64_t x = next();
+    while (x < threshold) {
+      x = next();
+    }
+    return x % n;
+  }
+
+  // The number of trials up to the first success of probability p.
+  int64_t geometric(const double p) {
+    const double trials = ceil(log1p(-uniform()) / log1p(-p));
+    return trials < 1 ? 1 : static_cast<int64_t>(trials);
+  }
+
+ private:
+  const uint64_t key_;
+  uint64_t counter_;
+};
+
+class FeistelPermutation {
+  /* A random permutation of [0, size) that is evaluated at any index, so the
+     order of a few indices is computed without the others. An index is split
+     into two halves of bits that are mixed by the rounds of a Feistel network,
+     which permutes [0, 2^bits) whatever the round function is, and an index
+     out of [0, size) is permuted again until it's back in, i.e. it walks along
+     its cycle. As 2^bits < 2 * size, that takes less than two walks on
+     average. */
+ public:
+  FeistelPermutation(const uint64_t size,
+                     const int32_t seed,
+                     const int64_t epoch)
+      : size_(size), num_bits_(0) {
+    while (size > 1 && ((size - 1) >> num_bits_) != 0) {
+      ++num_bits_;
+    }
+    CounterRng rng(seed, SHARD_STREAM, epoch);
+    for (auto& key : keys_) {
+      key = rng.next();
+    }
+  }
+
+  uint64_t operator()(uint64_t index) const {
+    do {
+      index = permute(index);
+    } while (index >= size_);
+    return index;
+  }
+
+ private:
+  // Fewer rounds bias the orders of the small sizes.
+  static const int NUM_ROUNDS = 8;
+
+  static uint64_t get_mask(const int num_bits) {
+    return (static_cast<uint64_t>(1) << num_bits) - 1;
+  }
+
+  uint64_t permute(const uint64_t index) const {
+    int left_bits = num_bits_ / 2;
+    int right_bits = num_bits_ - left_bits;
+    uint64_t left = index >> right_bits;
+    uint64_t right = index & get_mask(right_bits);
+    for (int round = 0; round < NUM_ROUNDS; ++round) {
+      const uint64_t next =
+          (left ^ mix_bits(keys_[round] ^ right)) & get_mask(left_bits);
+      left = right;
+      right = next;
+      std::swap(left_bits, right_bits);
+    }
+    return left << right_bits | right;
+  }
+
+  const uint64_t size_;
+  int num_bits_;
+  uint64_t keys_[NUM_ROUNDS];
+};
+
+struct MaskingOptions {
+  double masked_lm_prob;
+  int64_t cls_id;
+  int64_t sep_id;
+  int64_t mask_id;
+  int64_t vocab_size;
+  int32_t max_ngrams;
+  bool do_whole_word_mask;
+  bool geometric_dist;
+  bool bert_style;
+  bool inplace_random_mask;
+  // The cumulative probabilities of the ngram lengths 1..max_ngrams.
+  std::vector<double> ngram_cdf;
+};
+
+int64_t mask_sample(const int64_t* tokens,
+                    const int64_t len,
+                    const uint8_t* start_piece,
+                    const int64_t* char_ids,
+                    const MaskingOptions& options,
+                    const int64_t max_predictions,
+                    CounterRng& rng,
+                    int64_t* out_tokens,
+                    int64_t* positions,
+                    int64_t* labels) {
+  /* The masking of create_masked_lm_predictions in dataset_utils.py for one
+     sample, return the number of masked tokens. The words are the tokens
+     from a start piece up to the next one when do_whole_word_mask, and every
+     token otherwise. The candidates are ngrams of the words. */
+  std::vector<int64_t> word_offsets;
+  std::vector<int64_t> word_tokens;
+  std::vector<uint8_t> is_boundary(len, 0);
+  for (int64_t i = 0; i < len; ++i) {
+    const int64_t token = tokens[i];
+    if (token == options.cls_id || token == options.sep_id) {
+      is_boundary[i] = 1;
+      continue;
+    }
+    if (token < 0 || token >= options.vocab_size) {
+      throw std::out_of_range("The token is out of the vocab");
+    }
+    if (!options.do_whole_word_mask || word_offsets.empty() ||
+        start_piece[token]) {
+      word_offsets.push_back(word_tokens.size());
+      is_boundary[i] = start_piece[token];
+    }
+    word_tokens.push_back(i);
+  }
+  const int64_t num_words = word_offsets.size();
+  word_offsets.push_back(word_tokens.size());
+
+  // The labels are the tokens after the chinese chars are restored.
+  for (int64_t i = 0; i < len; ++i) {
+    out_tokens[i] = char_ids != nullptr && !is_boundary[i]
+                        ? char_ids[tokens[i]]
+                        : tokens[i];
+  }
+  if (options.masked_lm_prob == 0) {
+    return 0;
+  }
+  const std::vector<int64_t> orig_tokens(out_tokens, out_tokens + len);
+  const int64_t num_to_predict = std::min<int64_t>(
+      max_predictions,
+      std::max<int64_t>(1, nearbyint(len * options.masked_lm_prob)));
+
+  std::vector<int64_t> order(num_words);
+  for (int64_t i = 0; i < num_words; ++i) {
+    order[i] = i;
+  }
+  for (int64_t i = num_words - 1; i > 0; --i) {
+    std::swap(order[i], order[rng.below(i + 1)]);
+  }
+
+  std::vector<uint8_t> covered(len, 0);
+  std::vector<std::pair<int64_t, int64_t>> masked;
+  for (const auto first : order) {
+    if (static_cast<int64_t>(masked.size()) >= num_to_predict) {
+      break;
+    }
+    int64_t n;
+    if (options.geometric_dist) {
+      // p = 0.2 like SpanBERT
+      n = std::min<int64_t>(rng.geometric(0.2), options.max_ngrams);
+    } else {
+      const auto u = rng.uniform();
+      n = std::upper_bound(
+              options.ngram_cdf.begin(), options.ngram_cdf.end(), u) -
+          options.ngram_cdf.begin() + 1;
+      n = std::min<int64_t>(n, options.max_ngrams);
+    }
+    // The ngram takes the words [first, first + n) that exist, shorter ngrams
+    // are tried until it fits into the predictions.
+    auto ngram_size = [&](const int64_t n) {
+      return word_offsets[std::min(first + n, num_words)] - word_offsets[first];
+    };
+    const int64_t num_masked = masked.size();
+    while (n > 1 && num_masked + ngram_size(n) > num_to_predict) {
+      --n;
+    }
+    if (num_masked + ngram_size(n) > num_to_predict) {
+      continue;
+    }
+    const int64_t begin = word_offsets[first];
+    const int64_t end = begin + ngram_size(n);
+    bool is_covered = false;
+    for (int64_t j = begin; j < end; ++j) {
+      is_covered = is_covered || covered[word_tokens[j]];
+    }
+    if (is_covered) {
+      continue;
+    }
+    for (int64_t j = begin; j < end; ++j) {
+      const int64_t index = word_tokens[j];
+      covered[index] = 1;
+      int64_t masked_token = options.mask_id;
+      if (options.bert_style && rng.uniform() >= 0.8) {
+        // 10% of the time keep the token, 10% of the time replace it by a
+        // random one.
+        if (rng.uniform() < 0.5) {
+          masked_token = out_tokens[index];
+        } else if (options.inplace_random_mask) {
+          masked_token = orig_tokens[rng.below(len)];
+        } else {
+          masked_token = rng.below(options.vocab_size);
+        }
+      }
+      out_tokens[index] = masked_token;
+      masked.push_back(std::make_pair(index, orig_tokens[index]));
+    }
+  }
+
+  std::sort(masked.begin(), masked.end());
+  for (size_t i = 0; i < masked.size(); ++i) {
+    positions[i] = masked[i].first;
+    labels[i] = masked[i].second;
+  }
+  return masked.size();
+}
+
+void build_masked_lm_batch(
+    const py::array_t<int64_t, py::array::c_style | py::array::forcecast>&
+        tokens_,
+    const py::array_t<int32_t>& lengths_,
+    const py::array_t<int64_t>& sample_indices_,
+    const py::array_t<uint8_t, py::array::c_style | py::array::forcecast>&
+        start_piece_,
+    const py::array_t<int64_t, py::array::c_style | py::array::forcecast>&
+        char_ids_,
+    py::array_t<int64_t>& out_tokens_,
+    py::array_t<int64_t>& masked_positions_,
+    py::array_t<int64_t>& masked_labels_,
+    py::array_t<int64_t>& num_masked_,
+    const double masked_lm_prob,
+    const int64_t cls_id,
+    const int64_t sep_id,
+    const int64_t mask_id,
+    const int32_t seed,
+    const int32_t max_ngrams,
+    const bool do_whole_word_mask,
+    const bool favor_longer_ngram,
+    const bool geometric_dist,
+    const std::string& masking_style,
+    const bool inplace_random_mask,
+    const int32_t num_threads) {
+  /* Mask a batch of samples like create_masked_lm_predictions. The i-th row
+     of tokens has lengths[i] tokens, and its numbers are drawn from the seed
+     and sample_indices[i], so that it's masked the same in any batch.
+     start_piece[id] tells if a token starts a word, i.e. isn't a "##" piece.
+     If char_ids isn't empty, the tokens that don't start a word are replaced
+     by char_ids[id] first, e.g. "##中" by "中". The masked tokens are written
+     into out_tokens, which has the shape of tokens, and the positions and the
+     labels of the i-th row into the first num_masked[i] columns of
+     masked_positions and masked_labels, the others are -1. At most as many
+     tokens as the columns of masked_positions are masked in a row. */
+  auto tokens = tokens_.unchecked<2>();
+  auto lengths = lengths_.unchecked<1>();
+  auto sample_indices = sample_indices_.unchecked<1>();
+  auto out_tokens = out_tokens_.mutable_unchecked<2>();
+  auto masked_positions = masked_positions_.mutable_unchecked<2>();
+  auto masked_labels = masked_labels_.mutable_unchecked<2>();
+  auto num_masked = num_masked_.mutable_unchecked<1>();
+  const int64_t batch_size = tokens.shape(0);
+  const int64_t seq_length = tokens.shape(1);
+  const int64_t max_predictions = masked_positions.shape(1);
+  if (lengths.shape(0) != batch_size || sample_indices.shape(0) != batch_size ||
+      out_tokens.shape(0) != batch_size || out_tokens.shape(1) != seq_length ||
+      masked_positions.shape(0) != batch_size ||
+      masked_labels.shape(0) != batch_size ||
+      masked_labels.shape(1) != max_predictions ||
+      num_masked.shape(0) != batch_size) {
+    throw std::invalid_argument("The shapes of the arrays don't match");
+  }
+  if ((seq_length > 1 && out_tokens_.strides(1) != sizeof(int64_t)) ||
+      (max_predictions > 1 &&
+       (masked_positions_.strides(1) != sizeof(int64_t) ||
+        masked_labels_.strides(1) != sizeof(int64_t)))) {
+    throw std::invalid_argument("The rows of the outputs should be contiguous");
+  }
+  if (char_ids_.size() > 0 && char_ids_.size() != start_piece_.size()) {
+    throw std::invalid_argument("char_ids should have an id for every token");
+  }
+  if (max_ngrams < 1) {
+    throw std::invalid_argument("max_ngrams should be positive");
+  }
+  if (masking_style != "bert" && masking_style != "t5") {
+    throw std::invalid_argument("invalid value of masking style");
+  }
+
+  MaskingOptions options;
+  options.masked_lm_prob = masked_lm_prob;
+  options.cls_id = cls_id;
+  options.sep_id = sep_id;
+  options.mask_id = mask_id;
+  options.vocab_size = start_piece_.size();
+  options.max_ngrams = max_ngrams;
+  options.do_whole_word_mask = do_whole_word_mask;
+  options.geometric_dist = geometric_dist;
+  options.bert_style = masking_style == "bert";
+  options.inplace_random_mask = inplace_random_mask;
+  // The probabilities of the ngram lengths favor the shorter ones by 1 / n.
+  double total = 0;
+  for (int32_t n = 1; n <= max_ngrams; ++n) {
+    total += 1.0 / n;
+  }
+  double cumsum = 0;
+  for (int32_t n = 1; n <= max_ngrams; ++n) {
+    cumsum += 1.0 / (favor_longer_ngram ? max_ngrams + 1 - n : n) / total;
+    options.ngram_cdf.push_back(cumsum);
+  }
+  options.ngram_cdf.back() = 1.0;
+
+  const uint8_t* start_piece = start_piece_.data();
+  const int64_t* char_ids = char_ids_.size() > 0 ? char_ids_.data() : nullptr;
+  py::gil_scoped_release release;
+  parallel_for(batch_size, num_threads, [&](const int64_t i) {
+    const int64_t len = lengths[i];
+    if (len < 0 || len > seq_length) {
+      throw std::out_of_range("The length of the sample is out of range");
+    }
+    CounterRng rng(seed, MASK_STREAM, sample_indices[i]);
+    int64_t* row = &out_tokens(i, 0);
+    const int64_t count = mask_sample(&tokens(i, 0),
+                                      len,
+                                      start_piece,
+                                      char_ids,
+                                      options,
+                                      max_predictions,
+                                      rng,
+                                      row,
+                                      &masked_positions(i, 0),
+                                      &masked_labels(i, 0));
+    std::copy(&tokens(i, 0) + len, &tokens(i, 0) + seq_length, row + len);
+    for (int64_t j = count; j < max_predictions; ++j) {
+      masked_positions(i, j) = -1;
+      masked_labels(i, j) = -1;
+    }
+    num_masked[i] = count;
+  });
+}
+
+py::array build_shard_indices(const int64_t num_samples,
+                              const int32_t rank,
+                              const int32_t world_size,
+                              const int32_t seed,
+                              const int64_t epoch,
+                              const int64_t batch_size,
+                              const int32_t num_threads) {
+  /* The samples of a rank in a shuffled order of [0, num_samples), which is
+     drawn from the seed and the epoch. Like DistributedBatchSampler, the
+     order is cut into batches of batch_size samples that go to the ranks in
+     turn, and only the samples of the batches of the rank are computed. So
+     every rank keeps 1 / world_size of the order, and the rank 0 of a world
+     size of 1 gets the whole of it. */
+  if (num_samples < 0 || world_size <= 0 || rank < 0 || rank >= world_size ||
+      batch_size <= 0) {
+    throw std::invalid_argument(
+        "num_samples should be non-negative, batch_size and world_size "
+        "positive and rank in [0, world_size)");
+  }
+  const int64_t num_batches = (num_samples + batch_size - 1) / batch_size;
+  int64_t size = 0;
+  if (num_batches > rank) {
+    // The last batch of the rank may be the last one of the order, which is
+    // partial.
+    const int64_t rank_batches = (num_batches - rank - 1) / world_size + 1;
+    const int64_t last_batch = (rank_batches - 1) * world_size + rank;
+    size = (rank_batches - 1) * batch_size +
+           std::min(batch_size, num_samples - last_batch * batch_size);
+  }
+  std::unique_ptr<int64_t[]> shard(new int64_t[size]);
+  {
+    py::gil_scoped_release release;
+    const FeistelPermutation permutation(num_samples, seed, epoch);
+    const int64_t num_chunks =
+        (size + SHARD_INDICES_PER_CHUNK - 1) / SHARD_INDICES_PER_CHUNK;
+    parallel_for(num_chunks, num_threads, [&](const int64_t chunk) {
+      const int64_t first = chunk * SHARD_INDICES_PER_CHUNK;
+      const int64_t last = std::min(size, first + SHARD_INDICES_PER_CHUNK);
+      for (int64_t i = first; i < last; ++i) {
+        const int64_t batch = (i / batch_size) * world_size + rank;
+        shard[i] = permutation(batch * batch_size + i % batch_size);
+      }
+    });
+  }
+
+  int64_t* shard_ptr = shard.release();
+  py::capsule free_when_done(shard_ptr, [](void* mem_) {
+    int64_t* mem = reinterpret_cast<int64_t*>(mem_);
+    delete[] mem;
+  });
+  return py::array(std::vector<int64_t>{size},
+                   {sizeof(int64_t)},
+                   shard_ptr,
+                   free_when_done);
+}
+
 PYBIND11_MODULE(helpers, m) {
-  m.def("build_mapping", &build_mapping);
-  m.def("build_blocks_mapping", &build_blocks_mapping);
-  m.def("build_sample_idx", &build_sample_idx);
-  m.def("build_blending_indices", &build_blending_indices);
+  m.def("build_mapping",
+        &build_mapping,
+        py::arg("docs"),
+        py::arg("sizes"),
+        py::arg("num_epochs"),
+        py::arg("max_num_samples"),
+        py::arg("max_seq_length"),
+        py::arg("short_seq_prob"),
+        py::arg("seed"),
+        py::arg("verbose"),
+        py::arg("min_num_sent"),
+        py::arg("num_threads") = 0,
+        py::arg("cache_dir") = "",
+        py::arg("progress") = py::none());
+  m.def("build_blocks_mapping",
+        &build_blocks_mapping,
+        py::arg("docs"),
+        py::arg("sizes"),
+        py::arg("titles_sizes"),
+        py::arg("num_epochs"),
+        py::arg("max_num_samples"),
+        py::arg("max_seq_length"),
+        py::arg("seed"),
+        py::arg("verbose"),
+        py::arg("use_one_sent_blocks"),
+        py::arg("cache_dir") = "");
+  m.def("build_sample_idx",
+        &build_sample_idx,
+        py::arg("sizes"),
+        py::arg("doc_idx"),
+        py::arg("seq_length"),
+        py::arg("num_epochs"),
+        py::arg("tokens_per_epoch"),
+        py::arg("cache_dir") = "",
+        py::arg("verbose") = false);
+  // The dataset index is never converted, so that it can't be filled into a
+  // temporary copy.
+  m.def("build_blending_indices",
+        &build_blending_indices<uint8_t>,
+        py::arg("dataset_index").noconvert(),
+        py::arg("dataset_sample_index").noconvert(),
+        py::arg("weights"),
+        py::arg("num_datasets"),
+        py::arg("size"),
+        py::arg("verbose"),
+        py::arg("num_threads") = 1);
+  m.def("build_blending_indices",
+        &build_blending_indices<uint16_t>,
+        py::arg("dataset_index").noconvert(),
+        py::arg("dataset_sample_index").noconvert(),
+        py::arg("weights"),
+        py::arg("num_datasets"),
+        py::arg("size"),
+        py::arg("verbose"),
+        py::arg("num_threads") = 1);
+  m.def("build_blending_indices",
+        &build_blending_indices<int32_t>,
+        py::arg("dataset_index").noconvert(),
+        py::arg("dataset_sample_index").noconvert(),
+        py::arg("weights"),
+        py::arg("num_datasets"),
+        py::arg("size"),
+        py::arg("verbose"),
+        py::arg("num_threads") = 1);
+  m.def("build_masked_lm_batch",
+        &build_masked_lm_batch,
+        py::arg("tokens"),
+        py::arg("lengths"),
+        py::arg("sample_indices"),
+        py::arg("start_piece"),
+        py::arg("char_ids"),
+        py::arg("out_tokens").noconvert(),
+        py::arg("masked_positions").noconvert(),
+        py::arg("masked_labels").noconvert(),
+        py::arg("num_masked").noconvert(),
+        py::arg("masked_lm_prob"),
+        py::arg("cls_id"),
+        py::arg("sep_id"),
+        py::arg("mask_id"),
+        py::arg("seed"),
+        py::arg("max_ngrams") = 3,
+        py::arg("do_whole_word_mask") = true,
+        py::arg("favor_longer_ngram") = false,
+        py::arg("geometric_dist") = false,
+        py::arg("masking_style") = "bert",
+        py::arg("inplace_random_mask") = false,
+        py::arg("num_threads") = 1);
+  m.def("build_shard_indices",
+        &build_shard_indices,
+        py::arg("num_samples"),
+        py::arg("rank"),
+        py::arg("world_size"),
+        py::arg("seed"),
+        py::arg("epoch"),
+        py::arg("batch_size") = 1,
+        py::arg("num_threads") = 1);
+  m.def("compress_ids",
+        &compress_ids,
+        py::arg("ids_path"),
+        py::arg("out_path"),
+        py::arg("block_size") = 1024,
+        py::arg("num_threads") = 1);
+  py::class_<LazySampleIndex>(m, "LazySampleIndex")
+      .def(py::init<const py::array_t<int32_t,
+                                      py::array::c_style |
+                                          py::array::forcecast>&,
+                    const py::array_t<int32_t>&,
+                    const int32_t,
+                    const int32_t,
+                    const int32_t,
+                    const bool>(),
+           py::arg("sizes"),
+           py::arg("documents"),
+           py::arg("seq_length"),
+           py::arg("num_epochs"),
+           py::arg("seed"),
+           py::arg("shuffle") = true)
+      .def("__len__", &LazySampleIndex::size)
+      .def("__getitem__", &LazySampleIndex::get_sample)
+      .def("get_doc_idx", &LazySampleIndex::get_doc_idx)
+      .def_property_readonly("tokens_per_epoch",
+                             &LazySampleIndex::get_tokens_per_epoch);
+  py::class_<MMapIndexedDataset>(m, "MMapIndexedDataset")
+      .def(py::init<const std::string&, const py::array_t<int32_t>&>(),
+           py::arg("ids_path"),
+           py::arg("sizes"))
+      .def("__len__", &MMapIndexedDataset::size)
+      .def("get_samples",
+           &MMapIndexedDataset::get_samples,
+           py::arg("sample_idx"),
+           py::arg("doc_idx"),
+           py::arg("indices"),
+           py::arg("out").noconvert())
+      .def_property_readonly("num_tokens",
+                             &MMapIndexedDataset::get_num_tokens);
 }
@@ -0,0 +1,402 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Check the entry points of helpers against their Python or serial
+references on a tiny synthetic corpus.
+
+    make -C data_tools
+    python -m pytest data_tools/test_helpers.py
+"""
+
+import bisect
+import glob
+import math
+import os
+import re
+import sys
+import tempfile
+
+import numpy as np
+
+sys.path.insert(0, os.path.abspath(os.path.dirname(__file__)))
+import helpers  # noqa: E402
+from benchmark_blending import build_by_scan, get_index_dtype  # noqa: E402
+
+SEED = 1234
+MAX_NUM_SAMPLES = np.iinfo(np.int64).max
+
+
+def get_corpus(num_docs=300):
+    """The sentence boundaries (docs) and the sentence lengths (sizes) of a
+    random corpus, in which some documents are empty."""
+    rng = np.random.RandomState(SEED)
+    docs = np.concatenate([[0], np.cumsum(rng.randint(0, 8, num_docs))]).astype(np.int64)
+    sizes = rng.randint(3, 70, docs[-1]).astype(np.int32)
+    return docs, sizes
+
+
+def get_strided(array):
+    """A non-contiguous view of the same values."""
+    strided = np.repeat(array, 2)[::2]
+    assert not strided.flags.c_contiguous
+    return strided
+
+
+def build_mapping(docs, sizes, short_seq_prob=0.1, num_threads=0, cache_dir="", progress=None):
+    return helpers.build_mapping(
+        docs, sizes, 3, MAX_NUM_SAMPLES, 64, short_seq_prob, SEED, False, 2, num_threads, cache_dir, progress
+    )
+
+
+def sort_rows(array):
+    return array[np.lexsort(array.T[::-1])]
+
+
+def test_build_mapping_partitioned():
+    docs, sizes = get_corpus()
+    mapping = build_mapping(docs, sizes, num_threads=1)
+    for num_threads in [2, 4]:
+        np.testing.assert_array_equal(build_mapping(docs, sizes, num_threads=num_threads), mapping)
+
+    # Every sample is a run of sentences of a document.
+    starts, ends, target_lengths = mapping[:, 0], mapping[:, 1], mapping[:, 2]
+    assert np.all(starts < ends)
+    assert np.array_equal(np.searchsorted(docs, starts, "right"), np.searchsorted(docs, ends - 1, "right"))
+    assert np.all((target_lengths >= 2) & (target_lengths <= 64))
+    serial = build_mapping(docs, sizes)
+    assert abs(len(mapping) - len(serial)) <= 0.05 * len(serial)
+
+    # Without short samples no number is drawn for the target lengths, so
+    # only the order of the samples differs from the serial mapping.
+    serial = build_mapping(docs, sizes, short_seq_prob=0.0)
+    mapping = build_mapping(docs, sizes, short_seq_prob=0.0, num_threads=4)
+    np.testing.assert_array_equal(sort_rows(mapping), sort_rows(serial))
+
+
+def test_index_cache():
+    docs, sizes = get_corpus()
+    titles_sizes = np.full(len(docs) - 1, 5, dtype=np.int32)
+    doc_idx = np.tile(np.arange(len(sizes), dtype=np.int32), 2)
+    tokens_per_epoch = int(np.sum(sizes, dtype=np.int64))
+    with tempfile.TemporaryDirectory() as cache_dir:
+        for num_threads in [0, 2]:
+            expected = build_mapping(docs, sizes, num_threads=num_threads)
+            for _ in range(2):
+                cached = build_mapping(docs, sizes, num_threads=num_threads, cache_dir=cache_dir)
+                np.testing.assert_array_equal(cached, expected)
+                assert not cached.flags.writeable
+
+        expected = helpers.build_sample_idx(sizes, doc_idx, 64, 2, tokens_per_epoch)
+        for _ in range(2):
+            cached = helpers.build_sample_idx(sizes, doc_idx, 64, 2, tokens_per_epoch, cache_dir)
+            np.testing.assert_array_equal(cached, expected)
+
+        expected = helpers.build_blocks_mapping(docs, sizes, titles_sizes, 2, MAX_NUM_SAMPLES, 64, SEED, False, False)
+        for _ in range(2):
+            cached = helpers.build_blocks_mapping(
+                docs, sizes, titles_sizes, 2, MAX_NUM_SAMPLES, 64, SEED, False, False, cache_dir
+            )
+            np.testing.assert_array_equal(cached, expected)
+
+        # Non-contiguous inputs are hashed by their values, so they hit the
+        # cache of the same values.
+        num_files = len(os.listdir(cache_dir))
+        strided = build_mapping(get_strided(docs), get_strided(sizes), num_threads=2, cache_dir=cache_dir)
+        np.testing.assert_array_equal(strided, build_mapping(docs, sizes, num_threads=2))
+        assert len(os.listdir(cache_dir)) == num_files
+
+        # Other arguments don't.
+        build_mapping(docs, sizes, short_seq_prob=0.2, num_threads=2, cache_dir=cache_dir)
+        assert len(os.listdir(cache_dir)) == num_files + 1
+
+
+class Interrupted(Exception):
+    pass
+
+
+def test_build_mapping_resume():
+    docs, sizes = get_corpus()
+    expected = build_mapping(docs, sizes, num_threads=2)
+
+    def interrupt(phase, done, total, seconds):
+        # The counts are checkpointed once they are complete.
+        if phase == "filling":
+            raise Interrupted()
+
+    with tempfile.TemporaryDirectory() as cache_dir:
+        try:
+            build_mapping(docs, sizes, num_threads=2, cache_dir=cache_dir, progress=interrupt)
+            raise AssertionError("The build wasn't interrupted")
+        except Interrupted:
+            pass
+        assert glob.glob(os.path.join(cache_dir, "*.ckpt"))
+        assert not glob.glob(os.path.join(cache_dir, "*.idx"))
+
+        resumed = build_mapping(docs, sizes, num_threads=2, cache_dir=cache_dir)
+        np.testing.assert_array_equal(resumed, expected)
+        assert not glob.glob(os.path.join(cache_dir, "*.ckpt"))
+        assert not glob.glob(os.path.join(cache_dir, "*.fill"))
+
+
+def get_pieces(sizes, sample_idx, doc_idx, index):
+    """The (document, offset, length) pieces of a sample of build_sample_idx."""
+    (doc_f, offset_f), (doc_l, offset_l) = sample_idx[index], sample_idx[index + 1]
+    pieces = []
+    for k in range(doc_f, doc_l + 1):
+        doc = int(doc_idx[k])
+        first = offset_f if k == doc_f else 0
+        last = offset_l + 1 if k == doc_l else sizes[doc]
+        if first < last:
+            pieces.append((doc, int(first), int(last - first)))
+    return pieces
+
+
+def get_lazy_pieces(lazy, index):
+    return [tuple(int(x) for x in piece) for piece in lazy[index]]
+
+
+def test_lazy_sample_index():
+    _, sizes = get_corpus()
+    documents = np.arange(0, len(sizes), 3, dtype=np.int32)
+    num_epochs, seq_length = 3, 50
+
+    lazy = helpers.LazySampleIndex(sizes, documents, seq_length, num_epochs, SEED, False)
+    doc_idx = np.tile(documents, num_epochs)
+    sample_idx = helpers.build_sample_idx(sizes, doc_idx, seq_length, num_epochs, lazy.tokens_per_epoch)
+    assert len(lazy) == len(sample_idx) - 1
+    for index in range(len(lazy)):
+        assert get_lazy_pieces(lazy, index) == get_pieces(sizes, sample_idx, doc_idx, index)
+
+    # The shuffled samples are the ones of the shuffled documents, in another
+    # order, whatever the order in which they are read.
+    lazy = helpers.LazySampleIndex(sizes, documents, seq_length, num_epochs, SEED, True)
+    doc_idx = np.concatenate([lazy.get_doc_idx(epoch) for epoch in range(num_epochs)])
+    for epoch in range(num_epochs):
+        np.testing.assert_array_equal(np.sort(lazy.get_doc_idx(epoch)), documents)
+    sample_idx = helpers.build_sample_idx(sizes, doc_idx, seq_length, num_epochs, lazy.tokens_per_epoch)
+    indices = np.random.RandomState(SEED).permutation(len(lazy))
+    samples = sorted(get_lazy_pieces(lazy, index) for index in indices)
+    expected = sorted(get_pieces(sizes, sample_idx, doc_idx, index) for index in range(len(lazy)))
+    assert samples == expected
+
+    strided = helpers.LazySampleIndex(sizes, get_strided(documents), seq_length, num_epochs, SEED, True)
+    for index in range(len(lazy)):
+        assert get_lazy_pieces(strided, index) == get_lazy_pieces(lazy, index)
+
+
+def test_mmap_indexed_dataset():
+    rng = np.random.RandomState(SEED)
+    sizes = rng.randint(1, 100, 200).astype(np.int32)
+    pointers = np.concatenate([[0], np.cumsum(sizes)])
+    doc_idx = np.concatenate([rng.permutation(len(sizes)) for _ in range(2)]).astype(np.int32)
+    seq_length = 64
+    sample_idx = helpers.build_sample_idx(sizes, doc_idx, seq_length, 2, int(pointers[-1]))
+    indices = rng.randint(0, len(sample_idx) - 1, 64).astype(np.int64)
+
+    with tempfile.TemporaryDirectory() as data_dir:
+        for dtype in [np.uint16, np.int32, np.int64]:
+            ids = rng.randint(0, 60000, pointers[-1]).astype(dtype)
+            expected = np.stack(
+                [
+                    np.concatenate([ids[pointers[doc] + first :][:length] for doc, first, length in pieces])
+                    for pieces in (get_pieces(sizes, sample_idx, doc_idx, index) for index in indices)
+                ]
+            ).astype(np.int64)
+
+            ids_path = os.path.join(data_dir, "%s_ids.npy" % np.dtype(dtype).name)
+            blocks_path = ids_path[: -len(".npy")] + ".blk"
+            np.save(ids_path, ids)
+            helpers.compress_ids(ids_path, blocks_path, 64, 2)
+            for path in [ids_path, blocks_path]:
+                dataset = helpers.MMapIndexedDataset(path, sizes)
+                assert len(dataset) == len(sizes)
+                assert dataset.num_tokens == len(ids)
+                out = np.zeros((len(indices), seq_length + 1), dtype=np.int64)
+                dataset.get_samples(sample_idx, doc_idx, indices, out)
+                np.testing.assert_array_equal(out, expected)
+
+                out = np.zeros((len(indices) // 2, seq_length + 1), dtype=np.int64)
+                dataset.get_samples(sample_idx, doc_idx, indices[::2], out)
+                np.testing.assert_array_equal(out, expected[::2])
+
+                try:
+                    dataset.get_samples(sample_idx, doc_idx, np.array([len(sample_idx) - 1]), out[:1])
+                    raise AssertionError("An index out of range was read")
+                except IndexError:
+                    pass
+
+
+def test_build_blending_indices():
+    rng = np.random.RandomState(SEED)
+    size = 5000
+    for num_datasets in [3, 300]:
+        weights = rng.uniform(0.1, 1.0, num_datasets)
+        weights /= np.sum(weights)
+        expected_index, expected_sample_index = build_by_scan(weights, size)
+        for num_threads in [1, 4]:
+            dataset_index = np.zeros(size, dtype=get_index_dtype(num_datasets))
+            dataset_sample_index = np.zeros(size, dtype=np.int64)
+            helpers.build_blending_indices(
+                dataset_index, dataset_sample_index, weights, num_datasets, size, False, num_threads
+            )
+            np.testing.assert_array_equal(dataset_index, expected_index)
+            np.testing.assert_array_equal(dataset_sample_index, expected_sample_index)
+
+
+class CounterRng(object):
+    """CounterRng of helpers.cpp, with the methods of np.random.RandomState
+    that create_masked_lm_predictions calls."""
+
+    MASK = (1 << 64) - 1
+    MASK_STREAM = 5
+
+    def __init__(self, seed, stream, key):
+        self.key = self.mix_bits((self.mix_bits((seed & 0xFFFFFFFF) | (stream << 32)) + key) & self.MASK)
+        self.counter = 0
+
+    @classmethod
+    def mix_bits(cls, x):
+        x = ((x ^ (x >> 30)) * 0xBF58476D1CE4E5B9) & cls.MASK
+        x = ((x ^ (x >> 27)) * 0x94D049BB133111EB) & cls.MASK
+        return x ^ (x >> 31)
+
+    def next(self):
+        self.counter += 1
+        return self.mix_bits((self.key + self.counter * 0x9E3779B97F4A7C15) & self.MASK)
+
+    def random(self):
+        return (self.next() >> 11) * (1.0 / (1 << 53))
+
+    def randint(self, low, high):
+        n = high - low
+        threshold = ((1 << 64) - n) % n
+        x = self.next()
+        while x < threshold:
+            x = self.next()
+        return low + x % n
+
+    def shuffle(self, values):
+        for i in range(len(values) - 1, 0, -1):
+            j = self.randint(0, i + 1)
+            values[i], values[j] = values[j], values[i]
+
+    def choice(self, values, p):
+        cdf = np.cumsum(p)
+        cdf[-1] = 1.0
+        return values[bisect.bisect_right(list(cdf), self.random())]
+
+    def geometric(self, p):
+        return max(1, int(math.ceil(math.log1p(-self.random()) / math.log1p(-p))))
+
+
+def test_build_masked_lm_batch():
+    from dataset_utils import create_masked_lm_predictions, is_start_piece
+
+    vocab = ["[PAD]", "[CLS]", "[SEP]", "[MASK]"]
+    vocab += ["w%d" % i for i in range(100)] + ["##w%d" % i for i in range(100)]
+    chars = [chr(0x4E00 + i) for i in range(50)]
+    vocab += chars + ["##" + char for char in chars]
+    token_to_id = {token: i for i, token in enumerate(vocab)}
+    start_piece = np.array([is_start_piece(token) for token in vocab], dtype=np.uint8)
+    char_ids = np.array(
+        [token_to_id[token[2:]] if re.match("##[\u4E00-\u9FA5]", token) else i for i, token in enumerate(vocab)],
+        dtype=np.int64,
+    )
+
+    rng = np.random.RandomState(SEED)
+    batch_size, seq_length, max_predictions = 16, 48, 8
+    lengths = rng.randint(2, seq_length + 1, batch_size).astype(np.int32)
+    tokens = np.zeros((batch_size, seq_length), dtype=np.int64)
+    for i, length in enumerate(lengths):
+        tokens[i, 0], tokens[i, 1:length] = 1, rng.randint(4, len(vocab), length - 1)
+        tokens[i, length - 1] = 2
+    sample_indices = rng.randint(0, 10**6, batch_size).astype(np.int64)
+
+    configs = [
+        {},
+        {"masking_style": "t5"},
+        {"favor_longer_ngram": True, "inplace_random_mask": True},
+        {"do_whole_word_mask": False},
+        {"max_ngrams": 1, "to_chinese_char": True},
+        {"geometric_dist": True},
+    ]
+    for config in configs:
+        config = dict(config)
+        to_chinese_char = config.pop("to_chinese_char", False)
+        out_tokens = np.zeros_like(tokens)
+        masked_positions = np.zeros((batch_size, max_predictions), dtype=np.int64)
+        masked_labels = np.zeros_like(masked_positions)
+        num_masked = np.zeros(batch_size, dtype=np.int64)
+        for num_threads in [1, 4]:
+            helpers.build_masked_lm_batch(
+                tokens,
+                lengths,
+                sample_indices,
+                start_piece,
+                char_ids if to_chinese_char else np.zeros(0, dtype=np.int64),
+                out_tokens,
+                masked_positions,
+                masked_labels,
+                num_masked,
+                0.15,
+                1,
+                2,
+                3,
+                SEED,
+                num_threads=num_threads,
+                **config
+            )
+            for i, length in enumerate(lengths):
+                output, positions, labels = create_masked_lm_predictions(
+                    list(tokens[i, :length]),
+                    list(range(len(vocab))),
+                    vocab,
+                    0.15,
+                    1,
+                    2,
+                    3,
+                    max_predictions,
+                    CounterRng(SEED, CounterRng.MASK_STREAM, int(sample_indices[i])),
+                    vocab_token_to_id_dict=token_to_id,
+                    to_chinese_char=to_chinese_char,
+                    **config
+                )[:3]
+                np.testing.assert_array_equal(out_tokens[i, :length], output)
+                np.testing.assert_array_equal(out_tokens[i, length:], tokens[i, length:])
+                assert num_masked[i] == len(positions)
+                np.testing.assert_array_equal(masked_positions[i, : len(positions)], positions)
+                np.testing.assert_array_equal(masked_labels[i, : len(labels)], labels)
+                assert np.all(masked_positions[i, len(positions) :] == -1)
+
+
+def test_build_shard_indices():
+    for num_samples in [1, 7, 1000, 4097]:
+        order = helpers.build_shard_indices(num_samples, 0, 1, SEED, 3)
+        np.testing.assert_array_equal(np.sort(order), np.arange(num_samples))
+        for world_size, batch_size in [(2, 1), (3, 4), (8, 16)]:
+            batches = [order[i : i + batch_size] for i in range(0, num_samples, batch_size)]
+            for rank in range(world_size):
+                expected = batches[rank::world_size]
+                expected = np.concatenate(expected) if expected else np.zeros(0, dtype=np.int64)
+                for num_threads in [1, 4]:
+                    shard = helpers.build_shard_indices(
+                        num_samples, rank, world_size, SEED, 3, batch_size, num_threads
+                    )
+                    np.testing.assert_array_equal(shard, expected)
+
+
+if __name__ == "__main__":
+    for name, test in sorted(globals().items()):
+        if name.startswith("test_"):
+            test()
+            print("%s passed" % name)
@@ -0,0 +1,898 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+// A native version of create_pretraining_data.py. The documents are read,
+// decompressed, parsed, split into sentences and tokenized by a pipeline of
+// threads, and the token ids are streamed to the same _ids.npy and _idx.npz
+// files that the python script saves, so the memory doesn't grow with the
+// corpus.
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "fast_tokenizer/core/encoding.h"
+#include "fast_tokenizer/core/tokenizer.h"
+#include "fast_tokenizer/tokenizers/ernie_fast_tokenizer.h"
+#include "nlohmann/json.hpp"
+
+using namespace paddlenlp::fast_tokenizer;
+
+namespace {
+
+// The number of documents that a worker encodes at a time, the same as the
+// chunksize of pool.imap in the python script.
+constexpr size_t BATCH_DOCS = 256;
+// The number of batches that are read but not written yet for every worker.
+// It bounds the memory of the converter.
+constexpr size_t INFLIGHT_BATCHES_PER_WORKER = 4;
+
+struct ConverterArgs {
+  std::string vocab_file;
+  std::string tokenizer_file;
+  bool do_lower_case = true;
+  std::string input_path;
+  std::string output_prefix;
+  std::string json_key = "text";
+  bool split_sentences = false;
+  bool chinese = false;
+  bool append_eos = false;
+  std::string eos_token = "[SEP]";
+  int log_interval = 100;
+  int workers = 1;
+};
+
+void PrintUsage(const char* name) {
+  std::cerr
+      << "Usage: " << name
+      << " (--vocab_file VOCAB | --tokenizer_file TOKENIZER_JSON)\n"
+         "    --input_path INPUT_PATH --output_prefix OUTPUT_PREFIX\n"
+         "    [--do_lower_case=true|false] [--json_key text]\n"
+         "    [--split_sentences] [--chinese] [--append_eos]\n"
+         "    [--eos_token [SEP]] [--log_interval 100] [--workers 1]\n";
+}
+
+bool ParseBool(const std::string& flag, const std::string& value) {
+  if (value == "true" || value == "1") {
+    return true;
+  }
+  if (value == "false" || value == "0") {
+    return false;
+  }
+  throw std::invalid_argument("Invalid value of --" + flag + ": " + value);
+}
+
+// Parse the flags of the form --name value, --name=value, and --name for the
+// boolean ones.
+void ParseArgs(int argc, char** argv, ConverterArgs* args) {
+  std::map<std::string, bool*> bool_flags = {
+      {"do_lower_case", &args->do_lower_case},
+      {"split_sentences", &args->split_sentences},
+      {"chinese", &args->chinese},
+      {"append_eos", &args->append_eos}};
+  std::map<std::string, std::string*> string_flags = {
+      {"vocab_file", &args->vocab_file},
+      {"tokenizer_file", &args->tokenizer_file},
+      {"input_path", &args->input_path},
+      {"output_prefix", &args->output_prefix},
+      {"json_key", &args->json_key},
+      {"eos_token", &args->eos_token}};
+  std::map<std::string, int*> int_flags = {
+      {"log_interval", &args->log_interval}, {"workers", &args->workers}};
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      throw std::invalid_argument("Unexpected argument: " + arg);
+    }
+    std::string name = arg.substr(2);
+    std::string value;
+    bool has_value = false;
+    auto eq = name.find('=');
+    if (eq != std::string::npos) {
+      value = name.substr(eq + 1);
+      name = name.substr(0, eq);
+      has_value = true;
+    }
+    if (bool_flags.count(name)) {
+      *bool_flags[name] = has_value ? ParseBool(name, value) : true;
+      continue;
+    }
+    if (!string_flags.count(name) && !int_flags.count(name)) {
+      throw std::invalid_argument("Unknown flag: --" + name);
+    }
+    if (!has_value) {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument("Missing the value of --" + name);
+      }
+      value = argv[++i];
+    }
+    if (string_flags.count(name)) {
+      *string_flags[name] = value;
+    } else {
+      *int_flags[name] = std::stoi(value);
+    }
+  }
+  if (args->vocab_file.empty() == args->tokenizer_file.empty()) {
+    throw std::invalid_argument(
+        "Exactly one of --vocab_file and --tokenizer_file is required");
+  }
+  if (args->input_path.empty() || args->output_prefix.empty()) {
+    throw std::invalid_argument("--input_path and --output_prefix are required");
+  }
+  if (args->split_sentences && !args->chinese) {
+    // The python script splits the english sentences by nltk punkt, which
+    // has no native counterpart here.
+    throw std::invalid_argument(
+        "--split_sentences is only supported with --chinese, use "
+        "create_pretraining_data.py to split the english sentences");
+  }
+  if (args->workers < 1 || args->log_interval < 1) {
+    throw std::invalid_argument("--workers and --log_interval must be >= 1");
+  }
+}
+
+// The input files in the sorted order, like the python script.
+std::vector<std::string> GetInputFiles(const std::string& input_path) {
+  std::vector<std::string> files;
+  std::vector<std::string> dirs = {input_path};
+  struct stat st;
+  if (stat(input_path.c_str(), &st) != 0) {
+    throw std::runtime_error("Cannot access " + input_path);
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    return {input_path};
+  }
+  while (!dirs.empty()) {
+    std::string dir = dirs.back();
+    dirs.pop_back();
+    DIR* dp = opendir(dir.c_str());
+    if (dp == nullptr) {
+      throw std::runtime_error("Cannot open the directory " + dir);
+    }
+    while (struct dirent* entry = readdir(dp)) {
+      std::string name = entry->d_name;
+      if (name == "." || name == "..") {
+        continue;
+      }
+      std::string path = dir + "/" + name;
+      if (stat(path.c_str(), &st) != 0) {
+        continue;
+      }
+      if (S_ISDIR(st.st_mode)) {
+        dirs.push_back(path);
+      } else {
+        files.push_back(path);
+      }
+    }
+    closedir(dp);
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+class LineReader {
+public:
+  virtual ~LineReader() = default;
+  // Read the next line without the newline, return false at the end.
+  virtual bool ReadLine(std::string* line) = 0;
+};
+
+class TextLineReader : public LineReader {
+public:
+  explicit TextLineReader(const std::string& path) : fin_(path) {
+    if (!fin_) {
+      throw std::runtime_error("Cannot open " + path);
+    }
+  }
+  bool ReadLine(std::string* line) override {
+    return static_cast<bool>(std::getline(fin_, *line));
+  }
+
+private:
+  std::ifstream fin_;
+};
+
+#ifdef WITH_ZSTD
+class ZstdLineReader : public LineReader {
+public:
+  explicit ZstdLineReader(const std::string& path)
+      : file_(fopen(path.c_str(), "rb")),
+        stream_(ZSTD_createDStream()),
+        in_buf_(ZSTD_DStreamInSize()),
+        out_buf_(ZSTD_DStreamOutSize()),
+        in_{in_buf_.data(), 0, 0},
+        flush_(false),
+        pos_(0) {
+    if (file_ == nullptr || stream_ == nullptr) {
+      Release();
+      throw std::runtime_error("Cannot open " + path);
+    }
+    ZSTD_initDStream(stream_);
+  }
+  ~ZstdLineReader() override { Release(); }
+
+  bool ReadLine(std::string* line) override {
+    while (true) {
+      auto end = pending_.find('\n', pos_);
+      if (end != std::string::npos) {
+        line->assign(pending_, pos_, end - pos_);
+        pos_ = end + 1;
+        return true;
+      }
+      if (!Decompress()) {
+        if (pos_ >= pending_.size()) {
+          return false;
+        }
+        // The last line has no newline
+        line->assign(pending_, pos_, std::string::npos);
+        pos_ = pending_.size();
+        return true;
+      }
+    }
+  }
+
+private:
+  // Append the next decompressed bytes to pending_, return false at the end
+  // of the file.
+  bool Decompress() {
+    pending_.erase(0, pos_);
+    pos_ = 0;
+    while (true) {
+      if (in_.pos == in_.size && !flush_) {
+        size_t len = fread(in_buf_.data(), 1, in_buf_.size(), file_);
+        if (len == 0) {
+          return false;
+        }
+        in_ = {in_buf_.data(), len, 0};
+      }
+      ZSTD_outBuffer out = {out_buf_.data(), out_buf_.size(), 0};
+      size_t ret = ZSTD_decompressStream(stream_, &out, &in_);
+      if (ZSTD_isError(ret)) {
+        throw std::runtime_error(std::string("Failed to decompress: ") +
+                                 ZSTD_getErrorName(ret));
+      }
+      // The decoder may hold more output when it fills the buffer up.
+      flush_ = out.pos == out.size;
+      if (out.pos > 0) {
+        pending_.append(out_buf_.data(), out.pos);
+        return true;
+      }
+    }
+  }
+  void Release() {
+    if (file_ != nullptr) fclose(file_);
+    if (stream_ != nullptr) ZSTD_freeDStream(stream_);
+    file_ = nullptr;
+    stream_ = nullptr;
+  }
+
+  FILE* file_;
+  ZSTD_DStream* stream_;
+  std::vector<char> in_buf_;
+  std::vector<char> out_buf_;
+  ZSTD_inBuffer in_;
+  bool flush_;
+  std::string pending_;
+  size_t pos_;
+};
+#endif
+
+std::unique_ptr<LineReader> CreateLineReader(const std::string& path) {
+  if (EndsWith(path, ".jsonl")) {
+    return std::unique_ptr<LineReader>(new TextLineReader(path));
+  }
+  if (EndsWith(path, ".zst")) {
+#ifdef WITH_ZSTD
+    return std::unique_ptr<LineReader>(new ZstdLineReader(path));
+#else
+    std::cerr << "Built without zstd, skipped " << path << std::endl;
+    return nullptr;
+#endif
+  }
+  std::cerr << "Unexpected data format, skipped " << path << std::endl;
+  return nullptr;
+}
+
+uint32_t UpdateCrc32(uint32_t crc, const char* data, size_t len) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> table(256);
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+template <typename T>
+void AppendLittleEndian(T value, std::string* out) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+// The header of a 1-D npy array, the same as the one of np.save. The shape
+// is padded to 21 digits like numpy does, so the header keeps its length
+// while the array grows, and the one of _ids.npy is patched in place.
+std::string GetNpyHeader(const std::string& descr, uint64_t len) {
+  std::string shape = std::to_string(len);
+  std::string dict = "{'descr': '" + descr +
+                     "', 'fortran_order': False, 'shape': (" + shape + ",), }";
+  dict.append(21 - shape.size(), ' ');
+  size_t header_len = dict.size() + 1;
+  size_t pad_len = 64 - (10 + header_len) % 64;
+  std::string header("\x93NUMPY\x01\x00", 8);
+  AppendLittleEndian<uint16_t>(header_len + pad_len, &header);
+  header += dict;
+  header.append(pad_len, ' ');
+  header.push_back('\n');
+  return header;
+}
+
+// Stream a 1-D array to a file, the length is written into the npy header
+// when the file is closed.
+class NpyStreamWriter {
+public:
+  NpyStreamWriter(const std::string& path, const std::string& descr)
+      : path_(path), descr_(descr), fout_(path, std::ios::binary), len_(0) {
+    fout_ << GetNpyHeader(descr_, 0);
+    Check();
+  }
+  template <typename T>
+  void Write(const std::vector<T>& values) {
+    fout_.write(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(T));
+    len_ += values.size();
+    Check();
+  }
+  uint64_t Close() {
+    fout_.seekp(0);
+    fout_ << GetNpyHeader(descr_, len_);
+    fout_.close();
+    Check();
+    return len_;
+  }
+
+private:
+  void Check() {
+    if (!fout_) {
+      throw std::runtime_error("Failed to write " + path_);
+    }
+  }
+  std::string path_;
+  std::string descr_;
+  std::ofstream fout_;
+  uint64_t len_;
+};
+
+// Write the npz archive of np.savez from the raw arrays in the temporary
+// files. The entries are stored without compression and with the zip64
+// extra fields, as np.savez does.
+class NpzWriter {
+public:
+  explicit NpzWriter(const std::string& path)
+      : path_(path), fout_(path, std::ios::binary) {
+    Check();
+  }
+
+  void AddArray(const std::string& name,
+                const std::string& descr,
+                const std::string& data_path,
+                uint64_t len,
+                size_t item_size) {
+    std::string header = GetNpyHeader(descr, len);
+    uint64_t size = header.size() + len * item_size;
+    uint64_t offset = static_cast<uint64_t>(fout_.tellp());
+    std::string local;
+    AppendLittleEndian<uint32_t>(0x04034b50, &local);
+    AppendLittleEndian<uint16_t>(45, &local);  // version needed by zip64
+    AppendLittleEndian<uint16_t>(0, &local);   // flags
+    AppendLittleEndian<uint16_t>(0, &local);   // stored
+    AppendLittleEndian<uint16_t>(0, &local);   // time
+    AppendLittleEndian<uint16_t>(DOS_DATE, &local);
+    size_t crc_pos = local.size();
+    AppendLittleEndian<uint32_t>(0, &local);  // crc, patched below
+    AppendLittleEndian<uint32_t>(0xFFFFFFFF, &local);
+    AppendLittleEndian<uint32_t>(0xFFFFFFFF, &local);
+    AppendLittleEndian<uint16_t>(name.size(), &local);
+    AppendLittleEndian<uint16_t>(20, &local);
+    local += name;
+    AppendLittleEndian<uint16_t>(0x0001, &local);
+    AppendLittleEndian<uint16_t>(16, &local);
+    AppendLittleEndian<uint64_t>(size, &local);
+    AppendLittleEndian<uint64_t>(size, &local);
+    fout_ << local;
+
+    uint32_t crc = UpdateCrc32(0, header.data(), header.size());
+    fout_ << header;
+    std::ifstream fin(data_path, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    uint64_t copied = 0;
+    while (fin) {
+      fin.read(buffer.data(), buffer.size());
+      crc = UpdateCrc32(crc, buffer.data(), fin.gcount());
+      fout_.write(buffer.data(), fin.gcount());
+      copied += fin.gcount();
+    }
+    if (copied != len * item_size) {
+      throw std::runtime_error("Failed to read " + data_path);
+    }
+    std::string crc_bytes;
+    AppendLittleEndian<uint32_t>(crc, &crc_bytes);
+    fout_.seekp(offset + crc_pos);
+    fout_ << crc_bytes;
+    fout_.seekp(0, std::ios::end);
+    Check();
+    entries_.push_back({name, crc, size, offset});
+  }
+
+  void Close() {
+    uint64_t cd_offset = static_cast<uint64_t>(fout_.tellp());
+    std::string cd;
+    for (const auto& entry : entries_) {
+      AppendLittleEndian<uint32_t>(0x02014b50, &cd);
+      AppendLittleEndian<uint16_t>(0x032D, &cd);  // made by unix, zip64
+      AppendLittleEndian<uint16_t>(45, &cd);
+      AppendLittleEndian<uint16_t>(0, &cd);
+      AppendLittleEndian<uint16_t>(0, &cd);
+      AppendLittleEndian<uint16_t>(0, &cd);
+      AppendLittleEndian<uint16_t>(DOS_DATE, &cd);
+      AppendLittleEndian<uint32_t>(entry.crc, &cd);
+      AppendLittleEndian<uint32_t>(0xFFFFFFFF, &cd);
+      AppendLittleEndian<uint32_t>(0xFFFFFFFF, &cd);
+      AppendLittleEndian<uint16_t>(entry.name.size(), &cd);
+      AppendLittleEndian<uint16_t>(28, &cd);
+      AppendLittleEndian<uint16_t>(0, &cd);  // comment
+      AppendLittleEndian<uint16_t>(0, &cd);  // disk
+      AppendLittleEndian<uint16_t>(0, &cd);  // internal attributes
+      AppendLittleEndian<uint32_t>(0600u << 16, &cd);
+      AppendLittleEndian<uint32_t>(0xFFFFFFFF, &cd);
+      cd += entry.name;
+      AppendLittleEndian<uint16_t>(0x0001, &cd);
+      AppendLittleEndian<uint16_t>(24, &cd);
+      AppendLittleEndian<uint64_t>(entry.size, &cd);
+      AppendLittleEndian<uint64_t>(entry.size, &cd);
+      AppendLittleEndian<uint64_t>(entry.offset, &cd);
+    }
+    uint64_t eocd64_offset = cd_offset + cd.size();
+    // The zip64 end of central directory record and its locator
+    AppendLittleEndian<uint32_t>(0x06064b50, &cd);
+    AppendLittleEndian<uint64_t>(44, &cd);
+    AppendLittleEndian<uint16_t>(45, &cd);
+    AppendLittleEndian<uint16_t>(45, &cd);
+    AppendLittleEndian<uint32_t>(0, &cd);
+    AppendLittleEndian<uint32_t>(0, &cd);
+    AppendLittleEndian<uint64_t>(entries_.size(), &cd);
+    AppendLittleEndian<uint64_t>(entries_.size(), &cd);
+    AppendLittleEndian<uint64_t>(eocd64_offset - cd_offset, &cd);
+    AppendLittleEndian<uint64_t>(cd_offset, &cd);
+    AppendLittleEndian<uint32_t>(0x07064b50, &cd);
+    AppendLittleEndian<uint32_t>(0, &cd);
+    AppendLittleEndian<uint64_t>(eocd64_offset, &cd);
+    AppendLittleEndian<uint32_t>(1, &cd);
+    // The end of central directory record
+    AppendLittleEndian<uint32_t>(0x06054b50, &cd);
+    AppendLittleEndian<uint16_t>(0, &cd);
+    AppendLittleEndian<uint16_t>(0, &cd);
+    AppendLittleEndian<uint16_t>(entries_.size(), &cd);
+    AppendLittleEndian<uint16_t>(entries_.size(), &cd);
+    AppendLittleEndian<uint32_t>(
+        std::min<uint64_t>(eocd64_offset - cd_offset, 0xFFFFFFFF), &cd);
+    AppendLittleEndian<uint32_t>(std::min<uint64_t>(cd_offset, 0xFFFFFFFF),
+                                 &cd);
+    AppendLittleEndian<uint16_t>(0, &cd);
+    fout_ << cd;
+    fout_.close();
+    Check();
+  }
+
+private:
+  // 1980-01-01, so that the archive of the same corpus is the same.
+  static constexpr uint16_t DOS_DATE = (0 << 9) | (1 << 5) | 1;
+  struct Entry {
+    std::string name;
+    uint32_t crc;
+    uint64_t size;
+    uint64_t offset;
+  };
+  void Check() {
+    if (!fout_) {
+      throw std::runtime_error("Failed to write " + path_);
+    }
+  }
+  std::string path_;
+  std::ofstream fout_;
+  std::vector<Entry> entries_;
+};
+
+struct DocBatch {
+  uint64_t id;
+  std::vector<std::string> lines;
+};
+
+struct EncodedBatch {
+  std::vector<uint32_t> ids;
+  // The number of tokens of every sentence
+  std::vector<int32_t> sentence_lens;
+  // The number of sentences of every non-empty document
+  std::vector<int64_t> doc_sentences;
+  size_t num_docs = 0;
+  size_t num_bytes = 0;
+};
+
+// Read, encode and write the documents by a pipeline. A reader thread reads
+// and decompresses the lines into batches, the workers parse, split and
+// tokenize the batches, and the caller writes them in the order of the input.
+// At most INFLIGHT_BATCHES_PER_WORKER * workers batches are read but not
+// written yet.
+class PretrainingDataConverter {
+public:
+  PretrainingDataConverter(const ConverterArgs& args,
+                           const core::Tokenizer& tokenizer)
+      : args_(args),
+        tokenizer_(tokenizer),
+        eos_id_(0),
+        max_inflight_(INFLIGHT_BATCHES_PER_WORKER * args.workers),
+        num_batches_(0),
+        read_done_(false),
+        num_written_(0),
+        failed_(false) {
+    if (args_.append_eos && !tokenizer_.TokenToId(args_.eos_token, &eos_id_)) {
+      throw std::invalid_argument("The eos token " + args_.eos_token +
+                                  " is not in the vocab");
+    }
+  }
+
+  void Run() {
+    uint32_t vocab_size = tokenizer_.GetVocabSize();
+    if (vocab_size < (1 << 16) - 1) {
+      Convert<uint16_t>("<u2");
+    } else {
+      Convert<int32_t>("<i4");
+    }
+  }
+
+private:
+  template <typename T>
+  void Convert(const std::string& descr) {
+    std::thread reader(&PretrainingDataConverter::ReadBatches, this);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < args_.workers; ++i) {
+      workers.emplace_back(&PretrainingDataConverter::EncodeBatches, this);
+    }
+    try {
+      WriteBatches<T>(descr);
+    } catch (...) {
+      Fail(std::current_exception());
+    }
+    reader.join();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  void Fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!failed_) {
+      failed_ = true;
+      error_ = error;
+    }
+    cv_.notify_all();
+  }
+
+  void ReadBatches() {
+    try {
+      auto files = GetInputFiles(args_.input_path);
+      for (const auto& file : files) {
+        auto reader = CreateLineReader(file);
+        if (reader == nullptr) {
+          continue;
+        }
+        std::cout << "Processing " << file << std::endl;
+        DocBatch batch;
+        std::string line;
+        while (true) {
+          bool has_line = reader->ReadLine(&line);
+          if (has_line && line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+          }
+          if (has_line) {
+            batch.lines.push_back(std::move(line));
+          }
+          if (batch.lines.size() == BATCH_DOCS ||
+              (!has_line && !batch.lines.empty())) {
+            if (!PushBatch(&batch)) {
+              return;
+            }
+          }
+          if (!has_line) {
+            break;
+          }
+        }
+      }
+    } catch (...) {
+      Fail(std::current_exception());
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_done_ = true;
+    cv_.notify_all();
+  }
+
+  bool PushBatch(DocBatch* batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] {
+      return failed_ || num_batches_ - num_written_ < max_inflight_;
+    });
+    if (failed_) {
+      return false;
+    }
+    batch->id = num_batches_++;
+    input_batches_.push_back(std::move(*batch));
+    batch->lines.clear();
+    cv_.notify_all();
+    return true;
+  }
+
+  void EncodeBatches() {
+    try {
+      while (true) {
+        DocBatch batch;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cv_.wait(lock, [this] {
+            return failed_ || read_done_ || !input_batches_.empty();
+          });
+          if (failed_ || input_batches_.empty()) {
+            return;
+          }
+          batch = std::move(input_batches_.front());
+          input_batches_.pop_front();
+        }
+        EncodedBatch encoded = EncodeBatch(batch);
+        std::lock_guard<std::mutex> lock(mutex_);
+        encoded_batches_[batch.id] = std::move(encoded);
+        cv_.notify_all();
+      }
+    } catch (...) {
+      Fail(std::current_exception());
+    }
+  }
+
+  EncodedBatch EncodeBatch(const DocBatch& batch) const {
+    EncodedBatch encoded;
+    core::Encoding encoding;
+    std::vector<std::string> sentences;
+    for (const auto& line : batch.lines) {
+      auto json = nlohmann::json::parse(line);
+      const auto& text = json.at(args_.json_key).get_ref<const std::string&>();
+      encoded.num_docs += 1;
+      encoded.num_bytes += text.size();
+      sentences.clear();
+      if (args_.split_sentences) {
+        size_t start = 0;
+        while (true) {
+          size_t end = text.find('\n', start);
+          sentences.push_back(text.substr(start, end - start));
+          if (end == std::string::npos) break;
+          start = end + 1;
+        }
+      } else {
+        sentences.push_back(text);
+      }
+      int64_t num_sentences = 0;
+      for (const auto& sentence : sentences) {
+        // Only the ids are needed, the other fields are skipped.
+        tokenizer_.EncodeSingleText(
+            sentence, 0, core::OffsetType::CHAR, &encoding, 0);
+        const auto& ids = encoding.GetIds();
+        if (ids.empty()) {
+          continue;
+        }
+        encoded.ids.insert(encoded.ids.end(), ids.begin(), ids.end());
+        encoded.sentence_lens.push_back(ids.size());
+        num_sentences += 1;
+      }
+      if (num_sentences > 0) {
+        if (args_.append_eos) {
+          encoded.ids.push_back(eos_id_);
+          encoded.sentence_lens.back() += 1;
+        }
+        encoded.doc_sentences.push_back(num_sentences);
+      }
+    }
+    return encoded;
+  }
+
+  template <typename T>
+  void WriteBatches(const std::string& descr) {
+    std::string lens_path = args_.output_prefix + "_idx.lens.tmp";
+    std::string docs_path = args_.output_prefix + "_idx.docs.tmp";
+    NpyStreamWriter ids_writer(args_.output_prefix + "_ids.npy", descr);
+    std::ofstream lens_out(lens_path, std::ios::binary);
+    std::ofstream docs_out(docs_path, std::ios::binary);
+    int64_t num_sentences = 0;
+    uint64_t num_docs = 0;
+    docs_out.write(reinterpret_cast<const char*>(&num_sentences),
+                   sizeof(num_sentences));
+
+    uint64_t step = 0;
+    uint64_t total_bytes = 0;
+    std::vector<T> ids;
+    std::vector<int64_t> docs;
+    auto start_time = std::chrono::steady_clock::now();
+    while (true) {
+      EncodedBatch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] {
+          return failed_ || encoded_batches_.count(num_written_) ||
+                 (read_done_ && num_written_ == num_batches_);
+        });
+        if (failed_) {
+          return;
+        }
+        auto it = encoded_batches_.find(num_written_);
+        if (it == encoded_batches_.end()) {
+          break;
+        }
+        batch = std::move(it->second);
+        encoded_batches_.erase(it);
+      }
+
+      ids.assign(batch.ids.begin(), batch.ids.end());
+      ids_writer.Write(ids);
+      lens_out.write(reinterpret_cast<const char*>(batch.sentence_lens.data()),
+                     batch.sentence_lens.size() * sizeof(int32_t));
+      docs.clear();
+      for (auto doc_sentences : batch.doc_sentences) {
+        num_sentences += doc_sentences;
+        docs.push_back(num_sentences);
+      }
+      docs_out.write(reinterpret_cast<const char*>(docs.data()),
+                     docs.size() * sizeof(int64_t));
+      if (!lens_out || !docs_out) {
+        throw std::runtime_error("Failed to write the temporary files of " +
+                                 args_.output_prefix);
+      }
+      num_docs += docs.size();
+
+      for (size_t i = 0; i < batch.num_docs; ++i) {
+        step += 1;
+        if (step % args_.log_interval == 0) {
+          double elapsed = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start_time)
+                               .count();
+          // The bytes of the batch are counted as a whole.
+          double mbs = (total_bytes + batch.num_bytes) / elapsed / 1024 / 1024;
+          fprintf(stderr,
+                  "Processed %lu documents (%.2f docs/s, %.4f MB/s).\n",
+                  static_cast<unsigned long>(step),
+                  step / elapsed,
+                  mbs);
+        }
+      }
+      total_bytes += batch.num_bytes;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_written_ += 1;
+      cv_.notify_all();
+    }
+
+    std::cout << "Saving tokens to files..." << std::endl;
+    uint64_t num_tokens = ids_writer.Close();
+    lens_out.close();
+    docs_out.close();
+    NpzWriter npz_writer(args_.output_prefix + "_idx.npz");
+    npz_writer.AddArray(
+        "lens.npy", "<i4", lens_path, num_sentences, sizeof(int32_t));
+    npz_writer.AddArray(
+        "docs.npy", "<i8", docs_path, num_docs + 1, sizeof(int64_t));
+    npz_writer.Close();
+    std::remove(lens_path.c_str());
+    std::remove(docs_path.c_str());
+
+    printf("Total sentences num: %ld\n", static_cast<long>(num_sentences));
+    printf("Total documents num: %lu\n", static_cast<unsigned long>(num_docs));
+    printf("Total tokens num: %lu\n", static_cast<unsigned long>(num_tokens));
+    printf("Average tokens per sentence: %.2f\n",
+           static_cast<double>(num_tokens) / num_sentences);
+    printf("Average tokens per document: %.2f\n",
+           static_cast<double>(num_tokens) / num_docs);
+  }
+
+  const ConverterArgs& args_;
+  const core::Tokenizer& tokenizer_;
+  uint32_t eos_id_;
+  const uint64_t max_inflight_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<DocBatch> input_batches_;
+  uint64_t num_batches_;
+  bool read_done_;
+  std::map<uint64_t, EncodedBatch> encoded_batches_;
+  uint64_t num_written_;
+  bool failed_;
+  std::exception_ptr error_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ConverterArgs args;
+  try {
+    ParseArgs(argc, argv, &args);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  try {
+    core::Tokenizer tokenizer;
+    if (!args.tokenizer_file.empty()) {
+      tokenizer = core::Tokenizer::LoadFromFile(args.tokenizer_file);
+    } else {
+      tokenizer = tokenizers_impl::ErnieFastTokenizer(args.vocab_file,
+                                                      "[UNK]",
+                                                      "[SEP]",
+                                                      "[CLS]",
+                                                      "[PAD]",
+                                                      "[MASK]",
+                                                      true,
+                                                      true,
+                                                      args.do_lower_case,
+                                                      args.do_lower_case);
+    }
+    PretrainingDataConverter converter(args, tokenizer);
+    converter.Run();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}